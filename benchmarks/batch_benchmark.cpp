@@ -0,0 +1,90 @@
+/**
+ * @file batch_benchmark.cpp
+ * @brief Batch runs (mips_batch) of many small traces: new simulation objects per trace, as one
+ * process per trace has, against one reusing batch::Worker, and the work-stealing pool at
+ * several thread counts.
+ *
+ * The corpus is every integration trace in three configurations (pipeline, pipeline with
+ * forwarding, fast engine), repeated. Process startup is not part of the "fresh" time, so the
+ * gain over launching mips_simulator per trace is larger than shown.
+ *
+ * Usage: batch_benchmark [repeats]
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_runner.h"
+#include "bench_common.h"
+
+#ifndef MIPS_TRACE_DIR
+#define MIPS_TRACE_DIR "traces/hex"
+#endif
+
+int main(int argc, char* argv[]) {
+    const int repeats = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    std::vector<batch::Job> jobs;
+    for (int r = 0; r < repeats; ++r) {
+        for (const batch::Job& trace : batch::jobsInDirectory(MIPS_TRACE_DIR)) {
+            for (const std::vector<std::string>& flags :
+                 std::vector<std::vector<std::string>>{{}, {"-f"}, {"-s"}}) {
+                batch::Job job = trace;
+                batch::parseFlags(flags, job);
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    std::cout << "Batch of " << jobs.size() << " jobs (integration traces x 3 configurations x "
+              << repeats << ")\n\n";
+
+    // Jobs per second and speedup over fresh objects per job
+    double fresh = 0;
+    auto print = [&](const std::string& name, double seconds) {
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+                  << std::setprecision(4) << std::setw(9) << seconds << " s" << std::setprecision(0)
+                  << std::setw(10) << jobs.size() / seconds << " jobs/s" << std::setprecision(1)
+                  << std::setw(8) << fresh / seconds << "x\n";
+    };
+
+    uint64_t fresh_instructions = 0;
+    fresh = bench::timeSeconds([&] {
+        for (const batch::Job& job : jobs) {
+            batch::Worker worker;  // Everything constructed anew, as in a process per trace
+            fresh_instructions += worker.run(job).instructions;
+        }
+    });
+    print("fresh objects per job", fresh);
+
+    uint64_t reused_instructions = 0;
+    double reused = bench::timeSeconds([&] {
+        batch::Worker worker;
+        for (const batch::Job& job : jobs) {
+            reused_instructions += worker.run(job).instructions;
+        }
+    });
+    print("reused worker", reused);
+    if (reused_instructions != fresh_instructions) {
+        std::cerr << "Reused worker retired a different number of instructions\n";
+        return 1;
+    }
+
+    // Powers of two up to the hardware threads, and the hardware threads themselves
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads = std::min(threads * 2, hardware)) {
+        double seconds = bench::timeSeconds([&] { batch::run(jobs, threads); });
+        print("pool, " + std::to_string(threads) + (threads == 1 ? " thread" : " threads"),
+              seconds);
+        if (threads == hardware) {
+            break;
+        }
+    }
+    return 0;
+}
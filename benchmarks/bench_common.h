@@ -0,0 +1,174 @@
+/**
+ * @file bench_common.h
+ * @brief Shared helpers for the MIPS-lite benchmark executables.
+ *
+ * Provides instruction encoders, a configurable hot-loop workload, hex image output and a
+ * simple wall-clock timer. Benchmarks should be built in Release mode to be meaningful.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "memory_interface.h"
+#include "mips_lite_defs.h"
+
+namespace bench {
+
+// Instruction encoders (see mips_lite_defs.h for the formats)
+constexpr uint32_t encodeR(uint8_t opcode, uint8_t rd, uint8_t rs, uint8_t rt) {
+    return (uint32_t(opcode) << 26) | (uint32_t(rs) << 21) | (uint32_t(rt) << 16) |
+           (uint32_t(rd) << 11);
+}
+
+constexpr uint32_t encodeI(uint8_t opcode, uint8_t rt, uint8_t rs, int16_t imm) {
+    return (uint32_t(opcode) << 26) | (uint32_t(rs) << 21) | (uint32_t(rt) << 16) |
+           static_cast<uint16_t>(imm);
+}
+
+/**
+ * @brief Hot loop workload: ALU work, a load/store pair and a counted back-edge.
+ *
+ * HALT is kept out of the two fetch slots behind the taken back-edge, since the pipeline stops
+ * fetching as soon as it fetches a HALT.
+ *
+ * @param iterations Loop trip count (1 to 32767).
+ * @return Memory image words, program first followed by one data word.
+ */
+inline std::vector<uint32_t> loopProgram(int16_t iterations) {
+    using namespace mips_lite::opcode;
+    return {
+        encodeI(ADDI, 1, 0, iterations),  //  0: R1 = iterations
+        encodeI(ADDI, 5, 0, 56),          //  4: R5 = &data
+        encodeI(ADDI, 2, 2, 3),           //  8: loop: R2 += 3
+        encodeR(ADD, 3, 3, 2),            // 12: R3 += R2
+        encodeR(XOR, 4, 3, 2),            // 16: R4 = R3 ^ R2
+        encodeI(LDW, 6, 5, 0),            // 20: R6 = data
+        encodeR(ADD, 6, 6, 4),            // 24: R6 += R4
+        encodeI(STW, 6, 5, 0),            // 28: data = R6
+        encodeI(SUBI, 1, 1, 1),           // 32: R1 -= 1
+        encodeI(BZ, 0, 1, 4),             // 36: if R1 == 0 goto 52
+        encodeI(BEQ, 0, 0, -8),           // 40: goto loop
+        encodeR(ADD, 0, 0, 0),            // 44: padding
+        encodeR(ADD, 0, 0, 0),            // 48: padding
+        encodeI(HALT, 0, 0, 0),           // 52: HALT
+        0x00000000,                       // 56: data
+    };
+}
+
+/**
+ * @brief Load-use chain workload: every instruction of the loop body consumes the result of the
+ * one before it, starting with a load, so the pipeline stalls on nearly every instruction.
+ *
+ * @param iterations Loop trip count (1 to 32767).
+ * @return Memory image words, program first followed by one data word.
+ */
+inline std::vector<uint32_t> loadUseProgram(int16_t iterations) {
+    using namespace mips_lite::opcode;
+    return {
+        encodeI(ADDI, 1, 0, iterations),  //  0: R1 = iterations
+        encodeI(ADDI, 5, 0, 52),          //  4: R5 = &data
+        encodeI(LDW, 2, 5, 0),            //  8: loop: R2 = data
+        encodeI(ADDI, 3, 2, 1),           // 12: R3 = R2 + 1 (load-use)
+        encodeR(ADD, 4, 3, 3),            // 16: R4 = R3 + R3
+        encodeI(STW, 4, 5, 0),            // 20: data = R4
+        encodeI(SUBI, 1, 1, 1),           // 24: R1 -= 1
+        encodeI(BZ, 0, 1, 3),             // 28: if R1 == 0 goto 40
+        encodeI(BEQ, 0, 0, -6),           // 32: goto loop
+        encodeR(ADD, 0, 0, 0),            // 36: padding
+        encodeR(ADD, 0, 0, 0),            // 40: padding
+        encodeI(HALT, 0, 0, 0),           // 44: HALT
+        encodeR(ADD, 0, 0, 0),            // 48: padding
+        0x00000000,                       // 52: data
+    };
+}
+
+/**
+ * @brief Phased workload: an outer loop alternating an ALU loop and a load-use loop, so the
+ * pipeline's CPI changes from one program phase to the next.
+ *
+ * @param outer Outer loop trip count (1 to 32767).
+ * @param inner Trip count of each phase (1 to 32767).
+ * @return Memory image words, program first followed by one data word.
+ */
+inline std::vector<uint32_t> phasedProgram(int16_t outer, int16_t inner) {
+    using namespace mips_lite::opcode;
+    return {
+        encodeI(ADDI, 10, 0, outer),  //  0: R10 = outer
+        encodeI(ADDI, 1, 0, inner),   //  4: phase A: R1 = inner
+        encodeI(ADDI, 2, 2, 3),       //  8: R2 += 3
+        encodeI(ADDI, 3, 3, 5),       // 12: R3 += 5
+        encodeR(XOR, 4, 2, 3),        // 16: R4 = R2 ^ R3
+        encodeI(SUBI, 1, 1, 1),       // 20: R1 -= 1
+        encodeI(BZ, 0, 1, 2),         // 24: if R1 == 0 goto 32
+        encodeI(BEQ, 0, 0, -5),       // 28: goto 8
+        encodeI(ADDI, 1, 0, inner),   // 32: phase B: R1 = inner
+        encodeI(ADDI, 5, 0, 88),      // 36: R5 = &data
+        encodeI(LDW, 6, 5, 0),        // 40: R6 = data
+        encodeI(ADDI, 7, 6, 1),       // 44: R7 = R6 + 1 (load-use)
+        encodeI(STW, 7, 5, 0),        // 48: data = R7
+        encodeI(SUBI, 1, 1, 1),       // 52: R1 -= 1
+        encodeI(BZ, 0, 1, 2),         // 56: if R1 == 0 goto 64
+        encodeI(BEQ, 0, 0, -5),       // 60: goto 40
+        encodeI(SUBI, 10, 10, 1),     // 64: R10 -= 1
+        encodeI(BZ, 0, 10, 4),        // 68: if R10 == 0 goto 84
+        encodeI(BEQ, 0, 0, -17),      // 72: goto 4
+        encodeR(ADD, 0, 0, 0),        // 76: padding
+        encodeR(ADD, 0, 0, 0),        // 80: padding
+        encodeI(HALT, 0, 0, 0),       // 84: HALT
+        0x00000000,                   // 88: data
+    };
+}
+
+/// Write words to a hex trace file in the MemoryParser input format.
+inline void writeHexImage(const std::string& path, const std::vector<uint32_t>& words) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open benchmark image: " + path);
+    }
+    for (uint32_t word : words) {
+        file << std::uppercase << std::hex << std::setw(8) << std::setfill('0') << word << "\n";
+    }
+}
+
+/// Run a callable once and return the elapsed wall-clock time in seconds.
+template <typename Func>
+double timeSeconds(Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/// Print one result line: name, operation count, elapsed time and throughput.
+inline void report(const std::string& name, uint64_t ops, double seconds, const char* unit) {
+    std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << ops << " "
+              << unit << "  " << std::fixed << std::setprecision(4) << seconds << " s  "
+              << std::setprecision(2) << (ops / seconds / 1e6) << " M" << unit << "/s\n";
+}
+
+/**
+ * @brief Forwards to another memory but hides its program image, forcing the simulator to
+ * read and decode every instruction on fetch as it did before predecoding.
+ */
+class UndecodedMemory : public IMemoryParser {
+   public:
+    explicit UndecodedMemory(IMemoryParser& inner) : inner_(inner) {}
+    uint32_t readInstruction(uint32_t address) override { return inner_.readInstruction(address); }
+    uint32_t readMemory(uint32_t address) override { return inner_.readMemory(address); }
+    void writeMemory(uint32_t address, uint32_t value) override {
+        inner_.writeMemory(address, value);
+    }
+
+   private:
+    IMemoryParser& inner_;
+};
+
+}  // namespace bench
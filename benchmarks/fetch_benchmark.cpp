@@ -0,0 +1,81 @@
+/**
+ * @file fetch_benchmark.cpp
+ * @brief Compares instruction fetch throughput with and without the predecoded ProgramImage.
+ *
+ * 1. Raw fetch: walk the image reading + constructing an Instruction from each word, versus
+ *    constructing it from the predecoded DecodedOp.
+ * 2. End to end: run the cycle-accurate simulator on a hot loop with both fetch paths.
+ *
+ * Usage: fetch_benchmark [passes]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "bench_common.h"
+#include "functional_simulator.h"
+#include "mips_instruction.h"
+#include "mips_mem_parser.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+
+int main(int argc, char* argv[]) {
+    const uint64_t passes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    const std::string image_path =
+        (std::filesystem::temp_directory_path() / "mips_fetch_benchmark.txt").string();
+    bench::writeHexImage(image_path, bench::loopProgram(10000));
+
+    MemoryParser mp(image_path);
+    mp.setOutputFileOnModified(false);
+    const ProgramImage* image = mp.getProgramImage();
+    const uint32_t num_words = static_cast<uint32_t>(image->size());
+
+    std::cout << "Raw fetch (" << num_words << " words x " << passes << " passes)\n";
+    uint64_t checksum = 0;
+    double decode_s = bench::timeSeconds([&] {
+        for (uint64_t p = 0; p < passes; ++p) {
+            for (uint32_t pc = 0; pc < num_words * 4; pc += 4) {
+                Instruction instr(mp.readInstruction(pc));
+                checksum += instr.getOpcode() + instr.getRs();
+            }
+        }
+    });
+    double predecoded_s = bench::timeSeconds([&] {
+        for (uint64_t p = 0; p < passes; ++p) {
+            for (uint32_t pc = 0; pc < num_words * 4; pc += 4) {
+                Instruction instr(*image->lookup(pc));
+                checksum += instr.getOpcode() + instr.getRs();
+            }
+        }
+    });
+    bench::report("  readInstruction + decode", passes * num_words, decode_s, "fetch");
+    bench::report("  predecoded lookup", passes * num_words, predecoded_s, "fetch");
+
+    std::cout << "Cycle-accurate simulator on hot loop\n";
+    for (bool predecoded : {false, true}) {
+        MemoryParser run_mp(image_path);
+        run_mp.setOutputFileOnModified(false);
+        bench::UndecodedMemory undecoded(run_mp);
+        RegisterFile rf;
+        Stats stats;
+        IMemoryParser* mem = predecoded ? static_cast<IMemoryParser*>(&run_mp) : &undecoded;
+        FunctionalSimulator sim(&rf, &stats, mem, true);
+
+        double s = bench::timeSeconds([&] {
+            while (!sim.isProgramFinished()) {
+                sim.cycle();
+            }
+        });
+        bench::report(predecoded ? "  cycle() with predecoded image" : "  cycle() decoding on fetch",
+                      stats.getClockCycles(), s, "cycle");
+        checksum += rf.read(6);
+    }
+
+    std::filesystem::remove(image_path);
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file hybrid_benchmark.cpp
+ * @brief Hybrid simulation (-H) against a full FunctionalSimulator run: a long setup loop
+ * outside the region of interest followed by a short load-use kernel inside it.
+ *
+ * The hybrid run only simulates the kernel cycle by cycle, so its time approaches that of the
+ * fast engine as the setup grows. The region's cycles and CPI are shown next to the full run's
+ * cycles.
+ *
+ * Usage: hybrid_benchmark [setup_iterations] [kernel_iterations]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "functional_simulator.h"
+#include "hybrid_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace {
+
+/// A counted ALU loop, then a load-use loop between the region-of-interest markers
+std::vector<uint32_t> regionProgram(int16_t setup, int16_t kernel) {
+    using namespace mips_lite::opcode;
+    using bench::encodeI;
+    using bench::encodeR;
+    return {
+        encodeI(ADDI, 1, 0, setup),   //  0: R1 = setup
+        encodeI(ADDI, 2, 2, 3),       //  4: loop: R2 += 3
+        encodeR(ADD, 3, 3, 2),        //  8: R3 += R2
+        encodeR(XOR, 4, 3, 2),        // 12: R4 = R3 ^ R2
+        encodeI(SUBI, 1, 1, 1),       // 16: R1 -= 1
+        encodeI(BZ, 0, 1, 2),         // 20: if R1 == 0 goto 28
+        encodeI(BEQ, 0, 0, -5),       // 24: goto loop
+        mips_lite::roi::BEGIN,        // 28
+        encodeI(ADDI, 1, 0, kernel),  // 32: R1 = kernel
+        encodeI(ADDI, 5, 0, 88),      // 36: R5 = &data
+        encodeI(LDW, 6, 5, 0),        // 40: kernel: R6 = data
+        encodeI(ADDI, 7, 6, 1),       // 44: R7 = R6 + 1 (load-use)
+        encodeI(STW, 7, 5, 0),        // 48: data = R7
+        encodeI(SUBI, 1, 1, 1),       // 52: R1 -= 1
+        encodeI(BZ, 0, 1, 2),         // 56: if R1 == 0 goto 64
+        encodeI(BEQ, 0, 0, -5),       // 60: goto kernel
+        mips_lite::roi::END,          // 64
+        encodeI(HALT, 0, 0, 0),       // 68
+        encodeR(ADD, 0, 0, 0),        // 72: padding
+        encodeR(ADD, 0, 0, 0),        // 76: padding
+        encodeR(ADD, 0, 0, 0),        // 80: padding
+        encodeR(ADD, 0, 0, 0),        // 84: padding
+        0x00000000,                   // 88: data
+    };
+}
+
+void compare(const std::string& path, int16_t setup, int16_t kernel, bool forwarding) {
+    bench::writeHexImage(path, regionProgram(setup, kernel));
+
+    Stats full_stats;
+    uint32_t full_r7 = 0;
+    double full_seconds = bench::timeSeconds([&] {
+        MemoryParser memory(path);
+        memory.setOutputFileOnModified(false);
+        RegisterFile rf;
+        FunctionalSimulator sim(&rf, &full_stats, &memory, forwarding);
+        sim.run(UINT64_MAX);
+        full_r7 = rf.read(7);
+    });
+
+    Stats outside_stats, roi_stats;
+    uint32_t hybrid_r7 = 0;
+    double hybrid_seconds = bench::timeSeconds([&] {
+        MemoryParser memory(path);
+        memory.setOutputFileOnModified(false);
+        RegisterFile rf;
+        HybridSimulator sim(&rf, &outside_stats, &roi_stats, &memory, forwarding);
+        sim.run(UINT64_MAX);
+        hybrid_r7 = rf.read(7);
+    });
+    if (hybrid_r7 != full_r7) {
+        std::cerr << "Hybrid run ended in a different state\n";
+        std::exit(1);
+    }
+
+    uint64_t instructions = full_stats.totalInstructions();
+    std::cout << std::setw(7) << setup << std::setw(7) << kernel << std::setw(5)
+              << (forwarding ? "on" : "off") << std::setw(10) << instructions << std::setw(9)
+              << roi_stats.totalInstructions() << std::setw(10) << full_stats.getClockCycles()
+              << std::setw(9) << roi_stats.getClockCycles() << std::fixed << std::setprecision(3)
+              << std::setw(8)
+              << static_cast<double>(roi_stats.getClockCycles()) / roi_stats.totalInstructions()
+              << std::setprecision(4) << std::setw(9) << full_seconds << std::setw(9)
+              << hybrid_seconds << std::setprecision(1) << std::setw(8)
+              << full_seconds / hybrid_seconds << "x\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const int16_t setup =
+        static_cast<int16_t>(argc > 1 ? std::strtol(argv[1], nullptr, 10) : 30000);
+    const int16_t kernel = static_cast<int16_t>(argc > 2 ? std::strtol(argv[2], nullptr, 10) : 300);
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "mips_hybrid_benchmark.txt").string();
+
+    std::cout << "Hybrid (-H) vs full pipeline run; setup loop outside the region, kernel "
+                 "inside\n\n";
+    std::cout << std::setw(7) << "setup" << std::setw(7) << "kernel" << std::setw(5) << "fwd"
+              << std::setw(10) << "instr" << std::setw(9) << "roi" << std::setw(10) << "cycles"
+              << std::setw(9) << "roi cyc" << std::setw(8) << "roi CPI" << std::setw(9)
+              << "full s" << std::setw(9) << "hybrid s" << std::setw(9) << "speedup\n";
+    for (int16_t kernel_iterations : {kernel, static_cast<int16_t>(kernel * 10)}) {
+        for (bool forwarding : {false, true}) {
+            compare(path, setup, kernel_iterations, forwarding);
+        }
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
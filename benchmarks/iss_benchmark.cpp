@@ -0,0 +1,89 @@
+/**
+ * @file iss_benchmark.cpp
+ * @brief Compares instruction throughput of the cycle-accurate pipeline against the
+ * pipeline-free FastSimulator, interpreted, with basic-block translation and with blocks
+ * compiled to native code, on the same hot loop. The timing-model row produces the same clock
+ * cycle and stall counts as the cycle() row.
+ *
+ * Usage: iss_benchmark [iterations]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "bench_common.h"
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "jit_compiler.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+int main(int argc, char* argv[]) {
+    const int16_t iterations =
+        argc > 1 ? static_cast<int16_t>(std::strtol(argv[1], nullptr, 10)) : 30000;
+    const std::string image_path =
+        (std::filesystem::temp_directory_path() / "mips_iss_benchmark.txt").string();
+    bench::writeHexImage(image_path, bench::loopProgram(iterations));
+    uint64_t checksum = 0;
+
+    std::cout << "Hot loop, " << iterations << " iterations\n";
+    {
+        MemoryParser mp(image_path);
+        mp.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FunctionalSimulator sim(&rf, &stats, &mp, true);
+        double s = bench::timeSeconds([&] {
+            while (!sim.isProgramFinished()) {
+                sim.cycle();
+            }
+        });
+        bench::report("  FunctionalSimulator::cycle()", stats.totalInstructions(), s, "instr");
+        checksum += rf.read(6);
+    }
+    for (bool translate : {false, true}) {
+        MemoryParser mp(image_path);
+        mp.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FastSimulator iss(&rf, &stats, &mp);
+        iss.setBlockTranslation(translate);
+        double s = bench::timeSeconds([&] { iss.run(UINT64_MAX); });
+        const char* name =
+            translate ? "  FastSimulator, translated blocks" : "  FastSimulator, interpreted";
+        bench::report(name, iss.getInstructionCount(), s, "instr");
+        checksum += rf.read(6);
+    }
+
+    {
+        MemoryParser mp(image_path);
+        mp.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FastSimulator iss(&rf, &stats, &mp);
+        iss.setTiming(true, true);
+        double s = bench::timeSeconds([&] { iss.run(UINT64_MAX); });
+        bench::report("  FastSimulator, timing model", iss.getInstructionCount(), s, "instr");
+        checksum += rf.read(6) + stats.getClockCycles();
+    }
+
+    if (JitCompiler::isSupported()) {
+        MemoryParser mp(image_path);
+        mp.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FastSimulator iss(&rf, &stats, &mp);
+        iss.setNativeCompilation(true);
+        double s = bench::timeSeconds([&] { iss.run(UINT64_MAX); });
+        bench::report("  FastSimulator, native code (JIT)", iss.getInstructionCount(), s, "instr");
+        checksum += rf.read(6);
+    }
+
+    std::filesystem::remove(image_path);
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file loader_benchmark.cpp
+ * @brief Measures how fast memory images load: the stream loader MemoryParser used to have
+ * (getline, trim, a std::stringstream per word) against hex_image::load, and the whole
+ * MemoryParser constructor built on it, on a generated multi-megabyte trace.
+ *
+ * Usage: loader_benchmark [words]   (default 2000000, about 18 MB)
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "hex_image.h"
+#include "mips_mem_parser.h"
+
+namespace {
+/// The loader as it was before hex_image
+std::vector<uint32_t> streamLoad(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open input file: " + path);
+    }
+    std::vector<uint32_t> words;
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r\n"));
+        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+        if (!line.empty()) {
+            uint32_t value = 0;
+            std::stringstream ss;
+            ss << std::hex << line;
+            if (!(ss >> value)) {
+                throw std::runtime_error("Failed to parse instruction: " + line);
+            }
+            words.push_back(value);
+        }
+    }
+    return words;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const uint32_t num_words = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10))
+                                        : 2000000;
+    const std::string image_path =
+        (std::filesystem::temp_directory_path() / "mips_loader_benchmark.txt").string();
+
+    std::mt19937 rng(1);
+    std::vector<uint32_t> image(num_words);
+    for (uint32_t& word : image) {
+        word = rng();
+    }
+    bench::writeHexImage(image_path, image);
+    const uint64_t bytes = std::filesystem::file_size(image_path);
+    uint64_t checksum = 0;
+
+    std::cout << "Loading " << num_words << " words\n";
+    std::vector<uint32_t> words;
+    double s = bench::timeSeconds([&] { words = streamLoad(image_path); });
+    bench::report("  getline + stringstream", bytes, s, "B");
+    checksum += words.back();
+
+    s = bench::timeSeconds([&] { words = hex_image::load(image_path, MAX_VEC_SIZE); });
+    bench::report("  hex_image::load", bytes, s, "B");
+    checksum += words.back();
+    if (words != image) {
+        std::cerr << "hex_image::load returned a different image\n";
+        return 1;
+    }
+
+    s = bench::timeSeconds([&] {
+        MemoryParser mp(image_path);
+        mp.setOutputFileOnModified(false);
+        checksum += mp.getNumMemoryElements();
+    });
+    bench::report("  MemoryParser constructor", bytes, s, "B");
+
+    std::filesystem::remove(image_path);
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file memory_benchmark.cpp
+ * @brief Compares the pipeline's loads and stores through the virtual IMemoryParser interface
+ * against the statically dispatched path it takes when the memory is a MemoryParser.
+ *
+ * The virtual path is forced by wrapping the MemoryParser in an IMemoryParser that forwards
+ * every call, program image included, so both runs fetch from the same predecoded image and
+ * differ only in how the MEM stage reaches memory. Statistics are dropped (NullStats) to keep
+ * the memory accesses a larger share of the work.
+ *
+ * It then compares the storage behind the memory: the paged MemoryParser against the
+ * FlatMemoryParser (with and without huge pages), on a workload that sweeps loads and stores
+ * over a few MiB of data, one word per page.
+ *
+ * Usage: memory_benchmark [iterations]   (the sweep runs iterations / 1000 passes)
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace {
+/// Forwards to a memory through the interface only, keeping its program image
+class VirtualMemory : public IMemoryParser {
+   public:
+    explicit VirtualMemory(IMemoryParser& inner) : inner_(inner) {}
+    uint32_t readInstruction(uint32_t address) override { return inner_.readInstruction(address); }
+    uint32_t readMemory(uint32_t address) override { return inner_.readMemory(address); }
+    void writeMemory(uint32_t address, uint32_t value) override {
+        inner_.writeMemory(address, value);
+    }
+    const ProgramImage* getProgramImage() const override { return inner_.getProgramImage(); }
+
+   private:
+    IMemoryParser& inner_;
+};
+
+/**
+ * @brief Strided sweep: each pass loads, updates and stores one word in each of 2048 pages
+ * (8 MiB of address space), so nearly every access misses the caches and the TLB.
+ * @param passes Number of sweeps (1 to 32767).
+ */
+std::vector<uint32_t> sweepProgram(int16_t passes) {
+    using namespace mips_lite::opcode;
+    using bench::encodeI;
+    using bench::encodeR;
+    return {
+        encodeI(ADDI, 1, 0, passes),  //  0: R1 = passes
+        encodeI(ADDI, 5, 0, 4096),    //  4: outer: R5 = &data
+        encodeI(ADDI, 7, 0, 2048),    //  8: R7 = words per pass
+        encodeI(LDW, 2, 5, 0),        // 12: inner: R2 = *R5
+        encodeR(ADD, 2, 2, 7),        // 16: R2 += R7
+        encodeI(STW, 2, 5, 0),        // 20: *R5 = R2
+        encodeI(ADDI, 5, 5, 4160),    // 24: R5 += one page and a cache line
+        encodeI(SUBI, 7, 7, 1),       // 28: R7 -= 1
+        encodeI(BZ, 0, 7, 3),         // 32: if R7 == 0 goto 44
+        encodeI(BEQ, 0, 0, -6),       // 36: goto inner
+        encodeR(ADD, 0, 0, 0),        // 40: padding
+        encodeI(SUBI, 1, 1, 1),       // 44: R1 -= 1
+        encodeI(BZ, 0, 1, 4),         // 48: if R1 == 0 goto 64
+        encodeI(BEQ, 0, 0, -12),      // 52: goto outer
+        encodeR(ADD, 0, 0, 0),        // 56: padding
+        encodeR(ADD, 0, 0, 0),        // 60: padding
+        encodeI(HALT, 0, 0, 0),       // 64: HALT
+    };
+}
+
+/// Run a program on one memory backend, reporting cycles per second
+template <typename Memory>
+uint64_t runOn(const std::string& label, Memory& mp) {
+    mp.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FunctionalSimulator sim(&rf, &stats, &mp, true);
+    sim.setStatsCollection(false);
+    uint64_t cycles = 0;
+    double s = bench::timeSeconds([&] { cycles = sim.run(UINT64_MAX).cycles; });
+    bench::report(label, cycles, s, "cycles");
+    return cycles + rf.read(2) + mp.readMemory(4096);
+}
+
+uint64_t runBackends(const std::string& name, const std::vector<uint32_t>& program) {
+    const std::string image_path =
+        (std::filesystem::temp_directory_path() / "mips_memory_benchmark.txt").string();
+    bench::writeHexImage(image_path, program);
+    uint64_t checksum = 0;
+
+    std::cout << name << "\n";
+    {
+        MemoryParser mp(image_path);
+        checksum += runOn("  PagedMemory", mp);
+    }
+    {
+        FlatMemoryParser mp(image_path);
+        checksum += runOn("  FlatMemory", mp);
+    }
+    {
+        FlatMemoryParser mp(image_path, "", FlatMemory(true));
+        checksum += runOn("  FlatMemory, huge pages", mp);
+    }
+    std::filesystem::remove(image_path);
+    return checksum;
+}
+
+uint64_t runWorkload(const std::string& name, const std::vector<uint32_t>& program) {
+    const std::string image_path =
+        (std::filesystem::temp_directory_path() / "mips_memory_benchmark.txt").string();
+    bench::writeHexImage(image_path, program);
+    uint64_t checksum = 0;
+
+    std::cout << name << "\n";
+    for (bool forward : {false, true}) {
+        for (bool concrete : {false, true}) {
+            MemoryParser mp(image_path);
+            mp.setOutputFileOnModified(false);
+            VirtualMemory wrapper(mp);
+            RegisterFile rf;
+            Stats stats;
+            FunctionalSimulator sim(&rf, &stats,
+                                    concrete ? static_cast<IMemoryParser*>(&mp) : &wrapper,
+                                    forward);
+            sim.setStatsCollection(false);
+            uint64_t cycles = 0;
+            double s = bench::timeSeconds([&] { cycles = sim.run(UINT64_MAX).cycles; });
+            std::string label = std::string(concrete ? "  MemoryParser" : "  IMemoryParser") +
+                                (forward ? ", forwarding" : "");
+            bench::report(label, cycles, s, "cycles");
+            checksum += cycles + rf.read(4) + rf.read(6);
+        }
+    }
+    std::filesystem::remove(image_path);
+    return checksum;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const int16_t iterations =
+        argc > 1 ? static_cast<int16_t>(std::strtol(argv[1], nullptr, 10)) : 30000;
+    uint64_t checksum = 0;
+    checksum += runWorkload("Load-use chain, " + std::to_string(iterations) + " iterations",
+                            bench::loadUseProgram(iterations));
+    checksum += runWorkload("Hot loop, " + std::to_string(iterations) + " iterations",
+                            bench::loopProgram(iterations));
+    const int16_t passes = static_cast<int16_t>(iterations / 1000 > 0 ? iterations / 1000 : 1);
+    checksum += runBackends("Strided sweep, " + std::to_string(passes) + " passes",
+                            sweepProgram(passes));
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file pipeline_benchmark.cpp
+ * @brief Compares the cycle-accurate pipeline stepped with cycle() against advance(), which
+ * takes stall and drain stretches several cycles at a time, with and without forwarding.
+ *
+ * Usage: pipeline_benchmark [iterations]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace {
+uint64_t runWorkload(const std::string& name, const std::vector<uint32_t>& program) {
+    const std::string image_path =
+        (std::filesystem::temp_directory_path() / "mips_pipeline_benchmark.txt").string();
+    bench::writeHexImage(image_path, program);
+    uint64_t checksum = 0;
+
+    std::cout << name << "\n";
+    for (bool forward : {false, true}) {
+        for (bool skip : {false, true}) {
+            MemoryParser mp(image_path);
+            mp.setOutputFileOnModified(false);
+            RegisterFile rf;
+            Stats stats;
+            FunctionalSimulator sim(&rf, &stats, &mp, forward);
+            double s = bench::timeSeconds([&] {
+                if (skip) {
+                    sim.advance(UINT64_MAX);
+                } else {
+                    while (!sim.isProgramFinished()) {
+                        sim.cycle();
+                    }
+                }
+            });
+            std::string label = std::string(skip ? "  advance()" : "  cycle()") +
+                                (forward ? ", forwarding" : "");
+            bench::report(label, stats.getClockCycles(), s, "cycles");
+            std::cout << "      " << stats.getStalls() << " stalls\n";
+            checksum += stats.getClockCycles() + stats.getStalls() + rf.read(4);
+        }
+    }
+    std::filesystem::remove(image_path);
+    return checksum;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const int16_t iterations =
+        argc > 1 ? static_cast<int16_t>(std::strtol(argv[1], nullptr, 10)) : 30000;
+    uint64_t checksum = 0;
+    checksum += runWorkload("Load-use chain, " + std::to_string(iterations) + " iterations",
+                            bench::loadUseProgram(iterations));
+    checksum += runWorkload("Hot loop, " + std::to_string(iterations) + " iterations",
+                            bench::loopProgram(iterations));
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
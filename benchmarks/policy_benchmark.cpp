@@ -0,0 +1,68 @@
+/**
+ * @file policy_benchmark.cpp
+ * @brief Runs every integration trace through FunctionalSimulator::run() in each PipelinePolicy
+ * instantiation: forwarding off and on, with statistics collected into Stats or dropped through
+ * NullStats.
+ *
+ * Each trace is short, so it is run from many fresh copies of its memory image; copying the
+ * images is not timed.
+ *
+ * Usage: policy_benchmark [repetitions]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+#ifndef MIPS_TRACE_DIR
+#define MIPS_TRACE_DIR "traces/hex"
+#endif
+
+int main(int argc, char* argv[]) {
+    const int repetitions = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    std::vector<std::string> traces;
+    for (const auto& entry : std::filesystem::directory_iterator(MIPS_TRACE_DIR)) {
+        if (entry.path().extension() == ".txt") {
+            traces.push_back(entry.path().string());
+        }
+    }
+    std::cout << traces.size() << " integration traces, " << repetitions << " runs each\n";
+
+    uint64_t checksum = 0;
+    for (bool forward : {false, true}) {
+        for (bool collect : {true, false}) {
+            uint64_t cycles = 0;
+            double seconds = 0;
+            for (const std::string& trace : traces) {
+                MemoryParser image(trace);
+                image.setOutputFileOnModified(false);
+                std::vector<MemoryParser> copies(repetitions, image);
+                seconds += bench::timeSeconds([&] {
+                    for (MemoryParser& mem : copies) {
+                        RegisterFile rf;
+                        Stats stats;
+                        FunctionalSimulator sim(&rf, &stats, &mem, forward);
+                        sim.setStatsCollection(collect);
+                        cycles += sim.run(100000).cycles;
+                        checksum += rf.read(1) + stats.getClockCycles();
+                    }
+                });
+            }
+            std::string label = std::string(forward ? "  forwarding" : "  no forwarding") +
+                                (collect ? ", Stats" : ", NullStats");
+            bench::report(label, cycles, seconds, "cycles");
+        }
+    }
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
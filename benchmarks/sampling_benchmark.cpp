@@ -0,0 +1,155 @@
+/**
+ * @file sampling_benchmark.cpp
+ * @brief Validation report for sampled simulation: the clock cycles, stalls and CPI that
+ * sampling::estimate() extrapolates from its representative intervals, against a full
+ * FunctionalSimulator run of the same program, with and without forwarding.
+ *
+ * The corpus is every integration trace, with intervals scaled down to their length, and long
+ * synthetic workloads (hot loop, load-use chain, alternating phases) at the given interval
+ * length, where sampling saves time. Errors are relative to the full run's cycles; the last
+ * lines give the largest errors over the corpus.
+ *
+ * Usage: sampling_benchmark [interval] [warmup]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "sampled_simulation.h"
+#include "stats.h"
+
+#ifndef MIPS_TRACE_DIR
+#define MIPS_TRACE_DIR "traces/hex"
+#endif
+
+namespace {
+
+struct Workload {
+    std::string name;
+    std::string path;
+    uint64_t interval;
+    uint64_t warmup;
+    bool trace;  // One of the integration traces
+};
+
+// Largest errors seen, for the traces and for the synthetic workloads
+double max_cycle_error[2] = {0, 0}, max_stall_error[2] = {0, 0};
+
+/// Interval and warm-up length for the traces, which are only a few dozen instructions long
+constexpr uint64_t TRACE_INTERVAL = 8;
+
+/// Percentage error of an estimate relative to the full run's cycles
+double percentOfCycles(double estimate, uint64_t actual, uint64_t cycles) {
+    return cycles == 0 ? 0.0 : 100.0 * (estimate - static_cast<double>(actual)) / cycles;
+}
+
+void validate(const Workload& workload, bool forwarding) {
+    MemoryParser image(workload.path);
+    image.setOutputFileOnModified(false);
+
+    // The full cycle-accurate run
+    uint64_t cycles = 0, stalls = 0, instructions = 0;
+    double full_seconds = bench::timeSeconds([&] {
+        MemoryParser memory(image);
+        memory.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FunctionalSimulator sim(&rf, &stats, &memory, forwarding);
+        sim.run(UINT64_MAX);
+        cycles = stats.getClockCycles();
+        stalls = stats.getStalls();
+        instructions = stats.totalInstructions();
+    });
+
+    sampling::Config config;
+    config.interval_length = workload.interval;
+    config.warmup_length = workload.warmup;
+    config.forwarding = forwarding;
+    sampling::Estimate estimate;
+    double sampled_seconds =
+        bench::timeSeconds([&] { estimate = sampling::estimate(image, config); });
+
+    double cycle_error = percentOfCycles(estimate.clock_cycles, cycles, cycles);
+    double stall_error = percentOfCycles(estimate.stalls, stalls, cycles);
+    double& cycle_bound = max_cycle_error[workload.trace ? 0 : 1];
+    double& stall_bound = max_stall_error[workload.trace ? 0 : 1];
+    cycle_bound = std::max(cycle_bound, std::fabs(cycle_error));
+    stall_bound = std::max(stall_bound, std::fabs(stall_error));
+
+    std::cout << std::left << std::setw(28) << workload.name << std::setw(4)
+              << (forwarding ? "on" : "off") << std::right << std::setw(10) << instructions
+              << std::setw(6) << estimate.num_intervals << std::setw(5)
+              << estimate.samples.size() << std::fixed << std::setprecision(1) << std::setw(7)
+              << 100.0 * estimate.detailed_instructions / std::max<uint64_t>(instructions, 1)
+              << "%" << std::setw(11) << cycles << std::setw(13) << std::setprecision(0)
+              << estimate.clock_cycles << std::setprecision(2) << std::setw(8) << cycle_error
+              << "%" << std::setw(8) << stall_error << "%" << std::setprecision(3) << std::setw(7)
+              << static_cast<double>(cycles) / std::max<uint64_t>(instructions, 1)
+              << std::setw(7) << estimate.cpi << std::setprecision(1) << std::setw(8)
+              << full_seconds / sampled_seconds << "x\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const uint64_t interval = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    const uint64_t warmup = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+    std::vector<Workload> workloads;
+    std::vector<std::filesystem::path> traces;
+    for (const auto& entry : std::filesystem::directory_iterator(MIPS_TRACE_DIR)) {
+        if (entry.path().extension() == ".txt") {
+            traces.push_back(entry.path());
+        }
+    }
+    std::sort(traces.begin(), traces.end());
+    for (const auto& trace : traces) {
+        workloads.push_back({trace.filename().string(), trace.string(), TRACE_INTERVAL,
+                             TRACE_INTERVAL, true});
+    }
+    std::vector<std::string> generated;
+    auto synthetic = [&](const std::string& name, const std::vector<uint32_t>& words) {
+        std::string path = (dir / ("mips_sampling_" + name + ".txt")).string();
+        bench::writeHexImage(path, words);
+        generated.push_back(path);
+        workloads.push_back({name, path, interval, warmup, false});
+    };
+    synthetic("hot loop", bench::loopProgram(30000));
+    synthetic("load-use chain", bench::loadUseProgram(30000));
+    synthetic("phases", bench::phasedProgram(200, 2500));
+    synthetic("short phases", bench::phasedProgram(3000, 150));
+
+    std::cout << "Sampled vs full simulation; interval " << interval << ", warm-up " << warmup
+              << " (traces: " << TRACE_INTERVAL << ", " << TRACE_INTERVAL << ")\n\n";
+    std::cout << std::left << std::setw(28) << "workload" << std::setw(4) << "fwd" << std::right
+              << std::setw(10) << "instr" << std::setw(6) << "intv" << std::setw(5) << "smp"
+              << std::setw(8) << "detail" << std::setw(11) << "cycles" << std::setw(13)
+              << "estimate" << std::setw(9) << "error" << std::setw(9) << "stalls"
+              << std::setw(7) << "CPI" << std::setw(7) << "est" << std::setw(9) << "speedup"
+              << "\n";
+    for (const Workload& workload : workloads) {
+        for (bool forwarding : {false, true}) {
+            validate(workload, forwarding);
+        }
+    }
+    std::cout << std::setprecision(2) << "\nLargest errors, as % of cycles: traces "
+              << max_cycle_error[0] << "% (stalls " << max_stall_error[0]
+              << "%), synthetic workloads " << max_cycle_error[1] << "% (stalls " << max_stall_error[1] << "%)\n";
+
+    for (const std::string& path : generated) {
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
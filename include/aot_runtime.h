@@ -0,0 +1,144 @@
+/**
+ * @file aot_runtime.h
+ * @brief Runtime support for programs translated ahead of time by mips_aot.
+ *
+ * mips_aot turns a memory image into a C++ translation unit with one function per basic block
+ * and a dispatcher keyed by PC. Each block function updates the guest registers directly,
+ * records its instruction counts through Context::retire() and returns the next PC. A load or
+ * store that faults retires the instructions before it and reports its own PC through
+ * Context::faultAt(), as the interpreter does when it leaves a block early. run() drives
+ * the dispatcher and falls back to the FastSimulator interpreter for PCs that have no block,
+ * e.g. indirect JR targets, and for the rest of the run once a store has modified translated
+ * code.
+ *
+ * Generated units register themselves at static initialization, so a checker can link any
+ * number of them and iterate over registeredPrograms().
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "memory_interface.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace aot {
+
+/**
+ * @struct Context
+ * @brief Guest state passed to generated block functions.
+ */
+struct Context {
+    uint32_t* regs = nullptr;  ///< RegisterFile storage; generated code never writes R0
+    IMemoryParser* memory = nullptr;
+    Stats* stats = nullptr;
+    const uint8_t* code_map = nullptr;  ///< Non-zero for each word a block was translated from
+    uint32_t code_map_size = 0;         ///< Number of words in code_map
+    bool halted = false;
+    bool code_modified = false;  ///< Set once a store hits a translated word
+    bool faulted = false;        ///< Set with fault_pc when a memory access faults
+    uint32_t fault_pc = 0;       ///< PC of the faulting instruction
+    uint64_t retired = 0;
+    uint64_t category_counts[4] = {0, 0, 0, 0};  ///< Indexed by mips_lite::InstructionCategory
+    uint32_t written_registers = 0;              ///< Bit n set if register n was written
+
+    uint32_t load(uint32_t address) { return memory->readMemory(address); }
+
+    /// Store a word; returns true if it overwrote translated code, ending compiled execution
+    bool store(uint32_t address, uint32_t value) {
+        memory->writeMemory(address, value);
+        stats->addMemoryAddress(address);
+        uint32_t index = address >> 2;
+        if (index < code_map_size && code_map[index]) {
+            code_modified = true;
+        }
+        return code_modified;
+    }
+
+    /// Account for retired instructions (the counts are constants in the generated code)
+    void retire(uint32_t arithmetic, uint32_t logical, uint32_t memory_access,
+                uint32_t control_flow, uint32_t registers) {
+        category_counts[0] += arithmetic;
+        category_counts[1] += logical;
+        category_counts[2] += memory_access;
+        category_counts[3] += control_flow;
+        retired += arithmetic + logical + memory_access + control_flow;
+        written_registers |= registers;
+    }
+
+    /// Stop the program with the PC at next_pc
+    uint32_t haltAt(uint32_t next_pc) {
+        halted = true;
+        return next_pc;
+    }
+
+    /// Record that the instruction at pc faulted and rethrow the fault; only call from a handler
+    [[noreturn]] void faultAt(uint32_t pc) {
+        faulted = true;
+        fault_pc = pc;
+        throw;
+    }
+};
+
+/**
+ * @brief Generated dispatcher: runs the block starting at pc and updates pc.
+ * @return False if there is no block for pc.
+ */
+using DispatchFunction = bool (*)(Context& context, uint32_t& pc);
+
+/**
+ * @struct Program
+ * @brief Description of one generated translation unit.
+ */
+struct Program {
+    const char* name;            ///< Name given to mips_aot (-n), the image file stem by default
+    DispatchFunction dispatch;   ///< Generated dispatcher
+    const uint32_t* code_words;  ///< Image words, checked against memory before running
+    const uint8_t* code_map;     ///< Non-zero for each word a block was translated from
+    uint32_t code_map_size;      ///< Number of entries in code_words and code_map
+};
+
+/**
+ * @struct Result
+ * @brief Outcome of run().
+ */
+struct Result {
+    uint32_t pc;            ///< Final PC, one instruction past the HALT once halted, or the
+                            ///< faulting instruction's
+    bool halted;            ///< True if the program reached HALT
+    uint64_t instructions;  ///< Instructions retired
+    std::string trap;       ///< The memory fault that stopped the program, empty otherwise
+};
+
+/**
+ * @brief Run a translated program from PC 0.
+ * @param program Generated program.
+ * @param rf Register file.
+ * @param stats Receives the instruction counts, written registers and stored addresses.
+ * @param memory Memory loaded from the same image the program was translated from.
+ * @param max_instructions Budget, checked between blocks.
+ * @return Final state of the run. A memory fault stops the run like the fast engines do: the
+ *         instructions before the faulting one have retired and pc is the faulting one's.
+ * @throws std::runtime_error if memory does not hold the translated code.
+ */
+Result run(const Program& program, RegisterFile& rf, Stats& stats, IMemoryParser& memory,
+           uint64_t max_instructions);
+
+/**
+ * @brief Command line driver for a standalone translated simulator (mips_aot --main).
+ *
+ * Accepts -i, -o and -m like mips_simulator, plus -l to change the instruction budget, and
+ * prints the same report as mips_simulator -s.
+ */
+int standaloneMain(const Program& program, int argc, char* argv[]);
+
+/// Add a program to the registry. Called by generated code; always returns true.
+bool registerProgram(const Program& program);
+
+/// Programs linked into this executable.
+const std::vector<const Program*>& registeredPrograms();
+
+}  // namespace aot
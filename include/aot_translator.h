@@ -0,0 +1,45 @@
+/**
+ * @file aot_translator.h
+ * @brief Ahead-of-time translation of a memory image into a C++ translation unit.
+ *
+ * The AotTranslator walks the basic blocks reachable from PC 0 through direct branches and
+ * fall-through edges, using the same BlockTranslator as the fast simulator, and emits one C++
+ * function per block plus a switch-based dispatcher (see aot_runtime.h). Instruction counts are
+ * emitted as constants at every block exit. Targets only reachable through JR are left to the
+ * runtime's interpreter fallback.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "program_image.h"
+
+/**
+ * @struct AotOptions
+ * @brief Settings for one generated translation unit.
+ */
+struct AotOptions {
+    std::string name;         ///< Program name; also used to derive the C++ namespace
+    std::string source_path;  ///< Image path, only quoted in the generated header comment
+    bool with_main = false;   ///< Emit a main() that calls aot::standaloneMain()
+};
+
+/**
+ * @class AotTranslator
+ * @brief Generates C++ source for a predecoded program image.
+ */
+class AotTranslator {
+   public:
+    /**
+     * @brief Generate the translation unit.
+     * @param image Predecoded image of the program.
+     * @param options Naming and driver settings.
+     * @return C++ source code.
+     */
+    static std::string translate(const ProgramImage& image, const AotOptions& options);
+
+    /// Turn an arbitrary name into a valid C++ identifier.
+    static std::string identifier(const std::string& name);
+};
@@ -0,0 +1,161 @@
+/**
+ * @file batch_runner.h
+ * @brief Runs many traces in one process, concurrently on a work-stealing thread pool
+ * (mips_batch).
+ *
+ * A batch is a list of jobs, each a memory image plus the simulator configuration to run it
+ * with: the pipeline (optionally with forwarding), the fast engine (optionally with modelled
+ * timing) or hybrid simulation, and a budget. Jobs come from a manifest, one per line, or from
+ * every file of a directory with a common configuration.
+ *
+ * Jobs are started longest-expected-first, so a long trace picked up last does not leave the
+ * other threads idle at the end. The estimate is the size of the image weighted by how slow the
+ * configuration simulates; it knows nothing about loops, but ranks traces that differ widely in
+ * size correctly, which is where the order matters. The jobs are dealt in that order to one
+ * deque per worker; a worker takes its next job from the front of its own deque, and once that
+ * is empty steals the longest job at the front of the others.
+ *
+ * Each worker owns one memory parser, register file, Stats and simulator of each kind, and
+ * reloads and resets them between jobs rather than constructing new ones, so the page table,
+ * dirty page map, pages and translation caches are allocated once per worker rather than once
+ * per trace. Results are handed to a callback in job order as soon as every earlier job has
+ * finished, so the output does not depend on the number of threads or on timing.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "hybrid_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace batch {
+
+/// Budget of a job that does not set one, as in mips_simulator
+constexpr uint64_t DEFAULT_BUDGET = 100000;
+
+/// Which simulator runs a job
+enum class Mode {
+    PIPELINE,  ///< FunctionalSimulator; the budget counts clock cycles
+    FAST,      ///< FastSimulator (-s); the budget counts instructions
+    HYBRID     ///< HybridSimulator (-H); the budget counts instructions
+};
+
+/// One trace and the configuration to run it with
+struct Job {
+    std::string trace;                 ///< Memory image: hex trace or binary image
+    Mode mode = Mode::PIPELINE;        ///< Simulator to run it on
+    bool forwarding = false;           ///< Data forwarding in the pipeline (-f)
+    bool timing = false;               ///< Model clock cycles and stalls in FAST mode (-t)
+    uint64_t budget = DEFAULT_BUDGET;  ///< Clock cycles (PIPELINE) or instructions (-c)
+};
+
+/// Outcome of a job
+struct Result {
+    enum class Status {
+        HALTED,   ///< The program ran to its HALT
+        BUDGET,   ///< The budget ran out first
+        TRAPPED,  ///< The guest faulted; see message
+        ERROR     ///< The job could not run, e.g. the trace is missing; see message
+    };
+
+    Status status = Status::ERROR;
+    std::string message;        ///< "CAUSE at PC n, address m" in every mode, the error, or empty
+    uint64_t instructions = 0;  ///< Instructions retired
+    uint64_t cycles = 0;        ///< Clock cycles; for HYBRID those of the region of interest
+    uint64_t stalls = 0;        ///< Stall cycles, counted like cycles
+    bool timed = false;         ///< cycles and stalls were modelled
+    uint32_t pc = 0;            ///< Final program counter
+};
+
+/**
+ * @brief Parse the configuration flags of a job (-f, -s, -t, -H, -c <budget>) into job.
+ * @param args The flags, each its own element.
+ * @throws std::invalid_argument on an unknown flag, an invalid budget, or -s with -H.
+ */
+void parseFlags(const std::vector<std::string>& args, Job& job);
+
+/**
+ * @brief Read a manifest: one job per line, the trace followed by its flags, which are applied
+ * on top of defaults. Blank lines and everything after a '#' are ignored. Relative trace paths
+ * are relative to the manifest's directory.
+ * @throws std::runtime_error if the manifest cannot be read.
+ * @throws std::invalid_argument on an invalid line, with its line number.
+ */
+std::vector<Job> readManifest(const std::string& path, const Job& defaults = Job());
+
+/**
+ * @brief One job per regular file of a directory, in file name order, all configured like
+ * defaults.
+ * @throws std::runtime_error if the directory cannot be read.
+ */
+std::vector<Job> jobsInDirectory(const std::string& path, const Job& defaults = Job());
+
+/// Relative run time estimate used to order the jobs; 0 if the trace cannot be read.
+uint64_t expectedCost(const Job& job);
+
+/// The flags of a job's configuration, e.g. "-s -t -f -c 5000"; the budget only if not default.
+std::string describeConfig(const Job& job);
+
+/// Name of a result status: "halted", "budget", "trap" or "error".
+const char* statusName(Result::Status status);
+
+/**
+ * @brief A worker's simulation objects, kept across jobs. Not thread safe; every thread of a
+ * batch has its own.
+ */
+class Worker {
+   public:
+    Worker() = default;
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    /// Run one job, reusing the objects left by the previous one. Never throws.
+    Result run(const Job& job);
+
+    /// Number of jobs that reused the objects of an earlier one.
+    uint64_t getReuses() const { return reuses; }
+
+   private:
+    std::optional<MemoryParser> memory;  // Created by the first job, reloaded by the others
+    RegisterFile registers;
+    Stats stats;
+    Stats roi_stats;
+
+    // Simulators over the members above, created the first time a job needs them
+    std::unique_ptr<FunctionalSimulator> pipeline;
+    SimulatorState initial_state;  // The pipeline's state when new
+    std::unique_ptr<FastSimulator> fast;
+    std::unique_ptr<HybridSimulator> hybrid;
+
+    uint64_t reuses = 0;
+
+    /// Load the job's trace and clear everything the previous job left.
+    void prepare(const Job& job);
+
+    Result runPipeline(const Job& job);
+    Result runFast(const Job& job);
+    Result runHybrid(const Job& job);
+};
+
+/**
+ * @brief Run jobs concurrently on a work-stealing pool, longest expected first.
+ * @param jobs Jobs to run.
+ * @param num_threads Worker threads; 0 for one per hardware thread. Never more than jobs.
+ * @param on_result Called with each job's index and result, in job order, as soon as all
+ *        earlier jobs are done. Calls never overlap; they are made from the worker threads.
+ * @return Results, in job order.
+ */
+std::vector<Result> run(const std::vector<Job>& jobs, unsigned num_threads,
+                        const std::function<void(size_t, const Result&)>& on_result = nullptr);
+
+}  // namespace batch
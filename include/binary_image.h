@@ -0,0 +1,107 @@
+/**
+ * @file binary_image.h
+ * @brief Compact binary memory image format, loaded by mapping the file.
+ *
+ * A binary image holds the same memory image as a hex trace, without any text to parse:
+ *
+ *   Header     32 bytes: magic "MIPSLBIN", version, byte-order tag, image length in words,
+ *              segment count, checksum, reserved
+ *   Segments   16 bytes each: load address, length in words, file offset of the data
+ *   Data       Each data segment's words, starting at a 4 KiB aligned file offset
+ *
+ * Every word of the image belongs to exactly one segment, in address order. Runs of zero words
+ * (BSS-like regions) can be stored as segments with no data (offset 0), so they take no space
+ * in the file. Words are stored in host byte order; the byte-order tag rejects images written
+ * on a host of the other order. The checksum is 32-bit FNV-1a over the segment table and the
+ * data of every segment, and is verified on load.
+ *
+ * Loading maps the file read-only: the segment data is used in place from the page cache, so
+ * many runs of one image share a single copy of it and nothing is parsed.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class BinaryImage
+ * @brief A binary memory image mapped from disk.
+ */
+class BinaryImage {
+   public:
+    /// One run of words at consecutive addresses
+    struct Segment {
+        uint32_t address;      ///< Byte address of the first word
+        uint32_t num_words;    ///< Number of words
+        uint64_t data_offset;  ///< File offset of the words, or 0 if they are all zero
+    };
+
+    /// Fixed-size file header
+    struct Header {
+        char magic[8];          ///< MAGIC
+        uint32_t version;       ///< VERSION
+        uint32_t byte_order;    ///< BYTE_ORDER_TAG as written by the host that made the file
+        uint32_t num_words;     ///< Words in the image (its length, zero runs included)
+        uint32_t num_segments;  ///< Entries in the segment table that follows the header
+        uint32_t checksum;      ///< FNV-1a of the segment table and segment data
+        uint32_t reserved;      ///< 0
+    };
+
+    static constexpr char MAGIC[8] = {'M', 'I', 'P', 'S', 'L', 'B', 'I', 'N'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t BYTE_ORDER_TAG = 0x01020304;
+    /// Alignment of segment data in the file, so it can be mapped a page at a time
+    static constexpr uint64_t DATA_ALIGNMENT = 4096;
+    /// Shortest zero run write() stores without data by default (1 KiB)
+    static constexpr uint32_t DEFAULT_MIN_ZERO_RUN = 256;
+
+    /**
+     * @brief Map and validate a binary image.
+     * @param path File to load.
+     * @throws std::runtime_error if the file cannot be opened or is not a valid binary image.
+     */
+    explicit BinaryImage(const std::string& path);
+    BinaryImage(const BinaryImage&) = delete;
+    BinaryImage& operator=(const BinaryImage&) = delete;
+    ~BinaryImage();
+
+    /// Whether a file starts with the binary image magic.
+    static bool isBinaryImage(const std::string& path);
+
+    /**
+     * @brief Write words as a binary image.
+     * @param path File to write.
+     * @param words Image words, where words[i] lives at address i * 4.
+     * @param min_zero_run Zero runs at least this many words long are stored without data; 0
+     *        stores every word.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    static void write(const std::string& path, const std::vector<uint32_t>& words,
+                      uint32_t min_zero_run = DEFAULT_MIN_ZERO_RUN);
+
+    /// Words in the image, zero runs included.
+    uint32_t numWords() const { return header_->num_words; }
+
+    /// Segments in address order; together they cover words [0, numWords()).
+    const Segment* segments() const { return segments_; }
+    uint32_t numSegments() const { return header_->num_segments; }
+
+    /// The words of a segment, read from the mapping, or nullptr for a zero run.
+    const uint32_t* data(const Segment& segment) const {
+        return segment.data_offset == 0 ?
+                   nullptr :
+                   reinterpret_cast<const uint32_t*>(base_ + segment.data_offset);
+    }
+
+    /// Every word of the image as a vector, zero runs filled in.
+    std::vector<uint32_t> words() const;
+
+   private:
+    const char* base_ = nullptr;  // Start of the mapping
+    size_t size_ = 0;             // Bytes mapped
+    const Header* header_ = nullptr;
+    const Segment* segments_ = nullptr;
+};
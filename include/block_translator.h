@@ -0,0 +1,187 @@
+/**
+ * @file block_translator.h
+ * @brief Basic-block translation cache for the fast functional simulator.
+ *
+ * The BlockTranslator splits a predecoded ProgramImage into basic blocks that end at BZ, BEQ,
+ * JR or HALT. Each block is translated once into a short chain of BlockOps whose handler is
+ * already bound (the op kind) and whose operands are already extracted, so FastSimulator can
+ * run the whole block from a single lookup. Common instruction pairs are fused into one
+ * superinstruction:
+ *
+ *  - LDW followed by an ALU instruction (LDW_<op>)
+ *  - an ALU instruction followed by BZ, e.g. a SUBI/ADDI loop counter feeding the back-edge
+ *    (<op>_BZ)
+ *
+ * Instruction-category counts and the set of written registers are computed per block at
+ * translation time, because every instruction of a block retires whenever the block runs to
+ * its end.
+ *
+ * A block covers the words it was translated from. A store into a covered word must call
+ * invalidate(), which drops every block covering it. Blocks are only ever translated from the
+ * ProgramImage, and the store has invalidated the word there for good, so the stored word is
+ * never translated again: blocks that would reach it now end just before it, and FastSimulator
+ * interprets it from the current memory contents every time it runs. Blocks are at most
+ * MAX_BLOCK_INSTRUCTIONS long, so only the blocks starting up to that many words before the
+ * store can cover it, and invalidation costs the same whatever the size of the image.
+ *
+ * Blocks also end before the region-of-interest markers (mips_lite::roi), so the interpreter
+ * always gets to see them.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "program_image.h"
+
+/**
+ * @brief Handler selector of a BlockOp.
+ *
+ * Kinds 0..17 are single instructions and share the numbering of mips_lite::opcode. The fused
+ * kinds follow, each group indexed by the opcode of its ALU instruction (ADD..XORI).
+ */
+namespace block_op {
+constexpr uint8_t NUM_ALU_OPCODES = 12;  // ADD (0) .. XORI (11)
+constexpr uint8_t EXIT = 18;             // Block ends without a terminator; continue at end_pc
+constexpr uint8_t LDW_ALU_BASE = 19;     // LDW followed by the ALU op (19..30)
+constexpr uint8_t ALU_BZ_BASE = 31;      // ALU op followed by BZ (31..42)
+constexpr uint8_t NUM_KINDS = ALU_BZ_BASE + NUM_ALU_OPCODES;
+}  // namespace block_op
+
+/**
+ * @struct BlockInstr
+ * @brief Operands of one instruction inside a BlockOp, in a format-independent layout.
+ */
+struct BlockInstr {
+    int32_t imm;     ///< Sign-extended immediate, or the absolute target of BZ/BEQ
+    uint8_t opcode;  ///< Original opcode
+    uint8_t dest;    ///< Register written (rd for R-type, rt for I-type), 0 if none
+    uint8_t src1;    ///< First source register (rs)
+    uint8_t src2;    ///< Second source register (rt for R-type, BEQ and STW), 0 if none
+};
+
+/**
+ * @struct BlockOp
+ * @brief One dispatch within a translated block: a single instruction or a fused pair.
+ */
+struct BlockOp {
+    BlockInstr first;
+    BlockInstr second;  ///< Only used by fused kinds
+    uint8_t kind;       ///< See block_op
+    uint8_t length;     ///< Number of instructions (0 for EXIT, 2 for fused kinds)
+};
+
+struct JitContext;
+
+/// Entry point of a block compiled to native code by the JitCompiler
+using NativeBlockFunction = uint32_t (*)(JitContext*);
+
+/**
+ * @struct TranslatedBlock
+ * @brief A basic block translated from the program image.
+ */
+struct TranslatedBlock {
+    uint32_t start_pc;          ///< Address of the first instruction
+    uint32_t end_pc;            ///< Address of the terminator, or of the next untranslated word
+    uint32_t num_instructions;  ///< Instructions retired when the block runs to its end
+    std::array<uint64_t, 4> category_counts;  ///< Indexed by mips_lite::InstructionCategory
+    uint32_t written_registers;               ///< Bit n set if register n is written
+    std::vector<BlockOp> ops;                 ///< Always ends with a terminator or EXIT
+    /// Native code for this block, compiled on first use when the JIT is enabled
+    mutable NativeBlockFunction native_code = nullptr;
+};
+
+/**
+ * @class BlockTranslator
+ * @brief Translates and caches basic blocks, indexed by start PC.
+ */
+class BlockTranslator {
+   public:
+    /// Longest straight-line run translated into one block
+    static constexpr uint32_t MAX_BLOCK_INSTRUCTIONS = 64;
+
+    /**
+     * @brief Constructor.
+     * @param image Predecoded program image to translate from. Must outlive the translator.
+     */
+    explicit BlockTranslator(const ProgramImage* image);
+
+    /**
+     * @brief Get the block starting at an address, translating it on first use.
+     * @param pc Start address.
+     * @return The block, or nullptr if the instruction at pc cannot be translated (outside of
+     * the image, invalidated by a store, or not a valid instruction).
+     */
+    const TranslatedBlock* lookup(uint32_t pc) {
+        uint32_t index = pc >> 2;
+        if ((pc & 0x3) != 0 || index >= blocks_.size()) {
+            return nullptr;
+        }
+        if (!blocks_[index]) {
+            blocks_[index] = translate(pc);
+        }
+        return blocks_[index].get();
+    }
+
+    /// True if any cached block was translated from the word at an address.
+    bool covers(uint32_t address) const {
+        uint32_t index = address >> 2;
+        return index < coverage_.size() && coverage_[index] != 0;
+    }
+
+    /**
+     * @brief Drop every block translated from the word at an address.
+     * @param address Byte address that was stored to.
+     * @return True if any block was dropped.
+     */
+    bool invalidate(uint32_t address) {
+        if (!covers(address)) {
+            return false;
+        }
+        dropBlocksCovering(address >> 2);
+        return true;
+    }
+
+    /// Drop all translated blocks, e.g. after memory was changed behind the simulator's back or
+    /// the image was reloaded.
+    void clear();
+
+    /**
+     * @brief Drop the blocks translated from words the image has invalidated since, i.e. words
+     * stored over through the memory parser without a call to invalidate().
+     * @return True if any block was dropped.
+     */
+    bool dropStale();
+
+    /// Number of blocks currently cached.
+    size_t numBlocks() const;
+
+    /**
+     * @brief Add the category counts and written registers of the first instructions of a
+     * block, for a run that left the block early.
+     * @param block Block that was executed.
+     * @param num_ops Number of BlockOps that completed.
+     * @param category_counts Counts to add to, indexed by mips_lite::InstructionCategory.
+     * @param written_registers Register mask to add to.
+     * @return Number of instructions in those ops.
+     */
+    static uint32_t accountPrefix(const TranslatedBlock& block, size_t num_ops,
+                                  uint64_t* category_counts, uint32_t& written_registers);
+
+   private:
+    const ProgramImage* image_;
+    std::vector<std::unique_ptr<TranslatedBlock>> blocks_;  // Indexed by start PC >> 2
+    std::vector<uint16_t> coverage_;  // Number of cached blocks covering each word
+    std::vector<uint16_t> page_blocks_;  // Number of cached blocks starting in each page of
+                                         // 1 << PAGE_WORDS_SHIFT words
+    size_t num_blocks_ = 0;
+
+    static constexpr uint32_t PAGE_WORDS_SHIFT = 10;
+
+    std::unique_ptr<TranslatedBlock> translate(uint32_t pc);
+    void dropBlocksCovering(uint32_t index);
+    void dropBlock(uint32_t index);  // Drop the cached block starting at word index
+};
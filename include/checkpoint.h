@@ -0,0 +1,140 @@
+/**
+ * @file checkpoint.h
+ * @brief Checkpoints of a pipelined simulation, saved to disk and restored by mapping the file.
+ *
+ * A checkpoint holds everything needed to continue a FunctionalSimulator run exactly where it
+ * stopped, mid-pipeline included: the SimulatorState (PC, pipeline slots with their in-flight
+ * data, control flags, trap), the register file, the Stats and guest memory. Memory is stored as
+ * a delta against the input image, made of the pages stored to since it was loaded (the
+ * parser's dirty pages, so they must not have been cleared). Restoring therefore needs a parser
+ * freshly loaded from the same image; the checkpoint records the image's length and checksum
+ * and refuses any other.
+ *
+ * File layout (version 1), in host byte order like binary images:
+ *
+ *   Header      64 bytes: magic "MIPSLCKP", version, byte-order tag, image length and checksum,
+ *               words reached, counts of pages and addresses, checksum, offset of the pages
+ *   CPU         CpuRecord: PC, registers, control flags, trap, retirement counters, pipeline
+ *   Stats       StatsRecord, then each memory address Stats has recorded (uint32)
+ *   Page table  Number (address >> 12) of each page stored, ascending (uint32)
+ *   Pages       4 KiB of words per page, from a 4 KiB aligned offset
+ *
+ * The checksum is 32-bit FNV-1a over everything after the header. Restoring maps the file and
+ * copies the pages into memory straight from the mapping, so it costs time in proportion to the
+ * delta rather than to the run that produced it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace checkpoint {
+
+constexpr char MAGIC[8] = {'M', 'I', 'P', 'S', 'L', 'C', 'K', 'P'};
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BYTE_ORDER_TAG = 0x01020304;
+/// Alignment of the page data in the file, so it can be mapped a page at a time
+constexpr uint64_t PAGE_ALIGNMENT = 4096;
+/// Words in one stored page
+constexpr uint32_t WORDS_PER_PAGE = 1u << (DirtyPageMap::PAGE_SHIFT - 2);
+
+/// Fixed-size file header
+struct Header {
+    char magic[8];            ///< MAGIC
+    uint32_t version;         ///< VERSION
+    uint32_t byte_order;      ///< BYTE_ORDER_TAG as written by the host that made the file
+    uint32_t image_words;     ///< Length of the input image the delta applies to
+    uint32_t image_checksum;  ///< FNV-1a of the input image words
+    uint32_t words_reached;   ///< The parser's getNumMemoryElements()
+    uint32_t num_pages;       ///< Pages stored
+    uint32_t num_addresses;   ///< Memory addresses recorded by Stats
+    uint32_t checksum;        ///< FNV-1a of everything after the header
+    uint64_t pages_offset;    ///< File offset of the first page
+    uint8_t reserved[16];     ///< 0
+};
+
+/// One pipeline slot (PipelineStageData)
+struct SlotRecord {
+    uint32_t instruction;  ///< Instruction word; the rest of Instruction is decoded from it
+    uint32_t pc;
+    uint32_t rs_value;
+    uint32_t rt_value;
+    int32_t alu_result;
+    uint32_t memory_data;
+    uint32_t branch_target;
+    uint8_t valid;
+    uint8_t has_dest_reg;
+    uint8_t dest_reg;
+    uint8_t fault;  ///< mips_lite::TrapCause
+};
+
+/// Processor state: SimulatorState and the register file
+struct CpuRecord {
+    uint64_t retired_instructions;
+    uint32_t pc;
+    uint32_t last_retired_pc;
+    uint32_t trap_pc;
+    uint32_t trap_address;
+    uint32_t registers[32];
+    SlotRecord slots[SimulatorState::NUM_SLOTS];
+    uint8_t stage_slot[SimulatorState::NUM_SLOTS];
+    uint8_t trap_cause;  ///< mips_lite::TrapCause
+    uint8_t branch_taken;
+    uint8_t forward;
+    uint8_t halt_pipeline;
+    uint8_t stall;
+    uint8_t reserved[6];  ///< 0
+};
+
+/// Stats counters; the recorded memory addresses follow
+struct StatsRecord {
+    uint64_t categories[Stats::NUM_CATEGORIES];
+    uint64_t opcodes[Stats::NUM_OPCODES];
+    uint64_t stalls;
+    uint64_t clock_cycles;
+    uint64_t data_hazards;
+    uint32_t register_mask;
+    uint32_t reserved;  ///< 0
+};
+
+/**
+ * @brief Write a checkpoint of a simulation.
+ * @param path File to write.
+ * @param simulator Simulator to save, over registers, stats and memory.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+template <typename Storage>
+void save(const std::string& path, const FunctionalSimulator& simulator,
+          const RegisterFile& registers, const Stats& stats,
+          const BasicMemoryParser<Storage>& memory);
+
+/**
+ * @brief Restore a checkpoint, so the simulation continues exactly as the saved one would have.
+ * @param path File to read.
+ * @param simulator Simulator over registers, stats and memory.
+ * @param memory Parser freshly loaded from the input image the checkpoint was taken from;
+ *        the stored pages are written over it.
+ * @throws std::runtime_error if the file cannot be read, is not a valid checkpoint, or was taken
+ *         from a different image.
+ */
+template <typename Storage>
+void restore(const std::string& path, FunctionalSimulator& simulator, RegisterFile& registers,
+             Stats& stats, BasicMemoryParser<Storage>& memory);
+
+// Instantiated in checkpoint.cpp
+extern template void save(const std::string&, const FunctionalSimulator&, const RegisterFile&,
+                          const Stats&, const MemoryParser&);
+extern template void save(const std::string&, const FunctionalSimulator&, const RegisterFile&,
+                          const Stats&, const FlatMemoryParser&);
+extern template void restore(const std::string&, FunctionalSimulator&, RegisterFile&, Stats&,
+                             MemoryParser&);
+extern template void restore(const std::string&, FunctionalSimulator&, RegisterFile&, Stats&,
+                             FlatMemoryParser&);
+
+}  // namespace checkpoint
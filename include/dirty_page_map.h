@@ -0,0 +1,67 @@
+/**
+ * @file dirty_page_map.h
+ * @brief Bitmap of the 4 KiB guest pages written since a baseline.
+ *
+ * DirtyPageMap keeps one bit per page of the 32-bit address space (128 KiB), plus a summary
+ * bitmap with one bit per 64-page word of it. Marking a page is two ORs, and enumerating the
+ * dirty pages only visits the summary and the words it flags, so consumers such as the memory
+ * dump cost time proportional to what was written rather than to the size of memory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class DirtyPageMap
+ * @brief Set of dirty page numbers (address >> PAGE_SHIFT) over the 32-bit address space.
+ */
+class DirtyPageMap {
+   public:
+    /// log2 of the page size; matches PagedMemory
+    static constexpr uint32_t PAGE_SHIFT = 12;
+    /// Pages in the 32-bit address space
+    static constexpr uint32_t NUM_PAGES = 1u << (32 - PAGE_SHIFT);
+
+    /// A run of consecutive dirty pages, [begin, end) in page numbers
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    DirtyPageMap() : bits_(NUM_PAGES / 64), summary_(NUM_PAGES / 64 / 64) {}
+
+    /// Mark the page holding a byte address as dirty.
+    void mark(uint32_t address) {
+        uint32_t page = address >> PAGE_SHIFT;
+        bits_[page >> 6] |= 1ull << (page & 63);
+        summary_[page >> 12] |= 1ull << ((page >> 6) & 63);
+    }
+
+    /// Whether a page (by page number) is dirty.
+    bool isDirty(uint32_t page) const { return (bits_[page >> 6] >> (page & 63)) & 1; }
+
+    /// Whether no page is dirty.
+    bool empty() const {
+        for (uint64_t word : summary_) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Dirty pages as maximal runs of consecutive pages, in ascending order.
+    std::vector<Range> ranges() const;
+
+    /// Number of dirty pages.
+    uint32_t count() const;
+
+    /// Mark every page clean.
+    void clear();
+
+   private:
+    std::vector<uint64_t> bits_;     // Bit n of word w: page w * 64 + n is dirty
+    std::vector<uint64_t> summary_;  // Bit n of word s: bits_[s * 64 + n] is nonzero
+};
@@ -0,0 +1,328 @@
+/**
+ * @file fast_simulator.h
+ * @brief Pipeline-free functional (instruction-set) simulator for MIPS-lite.
+ *
+ * FastSimulator retires one instruction per step with no pipeline bookkeeping. It is meant
+ * for runs that only need the final registers, memory and instruction-category counts, and
+ * produces the same architectural end state and Stats instruction counts as
+ * FunctionalSimulator. Timing statistics (clock cycles, stalls) are not modelled unless a
+ * TimingModel is enabled with setTiming(), which derives them from the retired instructions.
+ *
+ * Instructions come from the memory's predecoded ProgramImage when it has one, and are
+ * dispatched through a computed-goto table indexed by opcode (a switch on compilers without
+ * labels-as-values). Words that are not predecoded, e.g. ones overwritten by a store, are read
+ * and decoded on the fly.
+ *
+ * With block translation enabled (the default when an image is available), straight-line code
+ * is run a whole basic block at a time from a BlockTranslator cache, using fused
+ * superinstructions for common pairs. The per-instruction interpreter remains the fallback for
+ * untranslatable code and for the tail of a run() budget that a whole block would overshoot.
+ *
+ * With setStopAtRoiBegin(), run() also stops in front of a region-of-interest BEGIN marker
+ * (mips_lite::roi::BEGIN) without executing it, so a HybridSimulator can hand the region to the
+ * pipeline. Translated blocks never contain markers, so the check costs nothing on their path.
+ *
+ * A BlockProfile can be attached to count the instructions retired per basic block, as input to
+ * sampled simulation. Blocks are keyed by their leader, so the counts are the same whether
+ * translated blocks are used or not; they are only touched at taken branches and jumps.
+ *
+ * To match the pipelined simulator exactly, a HALT that directly follows a taken branch or
+ * jump ends the program at the branch target without being retired. The pipeline has already
+ * fetched that HALT when the branch resolves, and stops fetching once it has seen one.
+ *
+ * A fault in the guest program (unaligned or out-of-range access, fetch outside the image,
+ * invalid opcode) does not throw either. It is recorded as a trap, as FunctionalSimulator does:
+ * the faulting instruction is not retired, everything before it is, and run() returns with the
+ * PC at it. The non-faulting path only checks the result of the memory access.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "block_translator.h"
+#include "jit_compiler.h"
+#include "memory_interface.h"
+#include "mips_lite_defs.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+#include "timing_model.h"
+
+/// Instructions retired per basic block, keyed by the block's leader: the PC a run started at,
+/// or the target of a taken branch or jump. Blocks longer than
+/// FastSimulator::PROFILE_PIECE_LENGTH instructions are counted in pieces of that length, each
+/// keyed by the PC it starts at, so that stretches of long straight-line code tell apart.
+using BlockProfile = std::unordered_map<uint32_t, uint64_t>;
+
+/**
+ * @class FastSimulator
+ * @brief Executes MIPS-lite programs one instruction at a time without a pipeline model.
+ */
+class FastSimulator {
+   public:
+    /// Longest stretch of a block a BlockProfile counts under one key
+    static constexpr uint32_t PROFILE_PIECE_LENGTH = 16;
+
+    /**
+     * @brief Constructor using dependency injection.
+     * @param rf Pointer to the RegisterFile instance.
+     * @param st Pointer to the Stats instance.
+     * @param mem Pointer to the memory instance.
+     * @throws std::invalid_argument if any dependency is null.
+     */
+    FastSimulator(RegisterFile* rf, Stats* st, IMemoryParser* mem);
+
+    /**
+     * @brief Execute instructions until the program halts or the budget is used up.
+     * @param max_instructions Maximum number of instructions to retire in this call.
+     * @return Number of instructions retired by this call; 0 once the program has halted or
+     * trapped.
+     */
+    uint64_t run(uint64_t max_instructions);
+
+    /**
+     * @brief Execute a single instruction.
+     * @return True if an instruction was retired, false if the program has halted or trapped.
+     */
+    bool step() { return run(1) == 1; }
+
+    /**
+     * @brief Get the current Program Counter. Once halted this is one instruction past the
+     * HALT, once trapped the faulting instruction, matching FunctionalSimulator::getPC().
+     */
+    uint32_t getPC() const { return pc; }
+
+    /**
+     * @brief Set the Program Counter.
+     * @param new_pc New value for the PC.
+     */
+    void setPC(uint32_t new_pc) {
+        pc = new_pc;
+        at_roi_begin = false;
+        leader_pc = new_pc;  // Execution continues from a new block
+        leader_offset = 0;
+    }
+
+    bool isHalted() const { return halted; }
+
+    /// True once the program has halted or trapped.
+    bool isProgramFinished() const { return halted || isTrapped(); }
+
+    /// True once an instruction has trapped; the program then finishes without a HALT.
+    bool isTrapped() const { return trap.cause != mips_lite::TrapCause::NONE; }
+
+    /// The trap taken by the program, with cause NONE if there was none.
+    const mips_lite::Trap& getTrap() const { return trap; }
+
+    /// Total number of instructions retired so far.
+    uint64_t getInstructionCount() const { return instructions_retired; }
+
+    /**
+     * @brief Start over as if newly constructed over the same objects, keeping the settings
+     * (translation, native code, timing, ROI stop, block profile): PC 0, nothing retired, no
+     * trap, no translated blocks and a fresh timing model. For running another program after
+     * the memory parser was reloaded; the registers, Stats and profile are the caller's to clear.
+     */
+    void reset();
+
+    /**
+     * @brief Enable or disable basic-block translation. Has no effect without a program image.
+     * @param enabled True to run translated blocks, false to interpret every instruction.
+     */
+    void setBlockTranslation(bool enabled);
+
+    /// True if translated blocks are used.
+    bool usesBlockTranslation() const { return translator != nullptr; }
+
+    /**
+     * @brief Enable or disable compiling translated blocks to native x86-64 code. Enabling it
+     * also enables block translation.
+     * @param enabled True to run compiled blocks.
+     * @return True if native compilation is now in use; false if it was disabled or is not
+     * available (unsupported host, or no program image).
+     */
+    bool setNativeCompilation(bool enabled);
+
+    /// True if translated blocks are compiled to native code.
+    bool usesNativeCompilation() const { return jit != nullptr; }
+
+    /**
+     * @brief Drop all translated blocks. Call after memory was written by anything other than
+     * this simulator.
+     */
+    void invalidateTranslations();
+
+    /**
+     * @brief Drop only the translated blocks whose words were stored over by anything other than
+     * this simulator. Enough after another simulator wrote through the same memory parser, which
+     * keeps the program image up to date; otherwise use invalidateTranslations().
+     */
+    void dropStaleTranslations();
+
+    /// The block translation cache, or nullptr if translation is disabled.
+    const BlockTranslator* getBlockTranslator() const { return translator.get(); }
+
+    /**
+     * @brief Enable or disable the analytic pipeline timing model. While enabled, every run()
+     * adds the clock cycles and stalls FunctionalSimulator::cycle() would have counted for the
+     * retired instructions to Stats. Timed runs use the per-instruction interpreter, not
+     * translated blocks. Enable it before the first run(); enabling it again starts over.
+     * @param enabled True to model timing.
+     * @param enable_forwarding Model the pipeline with data forwarding.
+     */
+    void setTiming(bool enabled, bool enable_forwarding = false);
+
+    /// The timing model, or nullptr if timing is disabled.
+    const TimingModel* getTimingModel() const { return timing.get(); }
+
+    /**
+     * @brief Count retired instructions per basic block into a profile, or stop counting. Every
+     * run() leaves the profile complete up to the instructions it retired, so clearing it
+     * between runs yields per-run block vectors.
+     * @param profile Profile to add to, or nullptr to stop profiling.
+     */
+    void setBlockProfile(BlockProfile* profile);
+
+    /**
+     * @brief Make run() stop in front of a region-of-interest BEGIN marker, leaving the PC at it
+     * unexecuted, or run markers as the no-ops they are.
+     * @param enabled True to stop at BEGIN markers.
+     */
+    void setStopAtRoiBegin(bool enabled) { stop_at_roi_begin = enabled; }
+
+    /// True if the last run() stopped at a BEGIN marker; the PC is that marker's address.
+    bool isAtRoiBegin() const { return at_roi_begin; }
+
+   private:
+    static constexpr int NUM_CATEGORIES = 4;
+
+    /// Stands in for a word whose fetch faulted; decodes to an invalid opcode
+    static constexpr uint32_t FETCH_FAULT_WORD = 0xFC000000;
+    static_assert(!mips_lite::opcode_info(FETCH_FAULT_WORD >> 26).valid,
+                  "FETCH_FAULT_WORD must not decode to an instruction");
+
+    /// Progress of the current run(), flushed to the members and Stats when it ends
+    struct RunState {
+        uint32_t pc = 0;
+        uint64_t retired = 0;
+        uint64_t category_counts[NUM_CATEGORIES] = {0, 0, 0, 0};
+        uint32_t written_registers = 0;  // Bit n set if register n was written
+    };
+
+    uint32_t pc = 0;
+    bool halted = false;
+    mips_lite::Trap trap;  // Trap taken by the program, if any
+    uint64_t instructions_retired = 0;
+    bool stop_at_roi_begin = false;
+    bool at_roi_begin = false;
+
+    RegisterFile* register_file;
+    Stats* stats;
+    IMemoryParser* memory_parser;
+
+    /// Predecoded instructions from memory_parser, or nullptr if it does not provide any
+    const ProgramImage* program_image;
+
+    /// Translated basic blocks, or nullptr if block translation is disabled
+    std::unique_ptr<BlockTranslator> translator;
+
+    /// Native code generator, or nullptr if native compilation is disabled
+    std::unique_ptr<JitCompiler> jit;
+    JitContext jit_context;
+
+    /// Pipeline timing model, or nullptr if timing is disabled
+    std::unique_ptr<TimingModel> timing;
+    uint64_t reported_cycles = 0;  // Model totals already added to Stats
+    uint64_t reported_stalls = 0;
+
+    /// Block profile, or nullptr if profiling is disabled
+    BlockProfile* block_profile = nullptr;
+    uint32_t leader_pc = 0;       // Leader of the block being executed
+    uint64_t leader_retired = 0;  // instructions_retired when it was entered, or last counted
+    uint64_t leader_offset = 0;   // Instructions of it counted before leader_retired
+
+    /// Count the instructions of the current block retired up to `retired` into block_profile.
+    void countBlock(uint64_t retired);
+
+    /// Count the block being left and start one at target_pc.
+    void enterBlock(uint32_t target_pc, uint64_t retired);
+
+    /// The interpreter loop behind run(); the TIMED version feeds every instruction to timing.
+    template <bool TIMED>
+    uint64_t runLoop(uint64_t max_instructions);
+
+    /// Write the results of a run back to the PC, instruction count and Stats.
+    void flushRun(const RunState& state);
+
+    /// Record a trap for the instruction at state.pc, which is left unretired.
+    void raiseTrap(mips_lite::TrapCause cause, uint32_t address, const RunState& state) {
+        trap = mips_lite::Trap{cause, state.pc, address};
+    }
+
+    /**
+     * @brief Run one translated block, normally to its end.
+     * @param block Block starting at state.pc.
+     * @param state Run progress to update.
+     * @return True if the program halted or trapped.
+     */
+    bool executeBlock(const TranslatedBlock& block, RunState& state);
+
+    /**
+     * @brief Run one translated block as native code, compiling it first if needed.
+     * @param block Block starting at state.pc.
+     * @param state Run progress to update.
+     * @return True if the program halted or trapped.
+     */
+    bool executeNative(const TranslatedBlock& block, RunState& state);
+
+    /// Account for a block that ran to its end, and leave state.pc at its last instruction.
+    void accountBlock(const TranslatedBlock& block, RunState& state);
+
+    /// Account for the first num_ops ops of a block and continue after them.
+    void leaveBlockEarly(const TranslatedBlock& block, size_t num_ops, RunState& state);
+
+    /**
+     * @brief Finish a block whose terminator was taken, applying the HALT-behind-a-taken-branch
+     * rule.
+     * @return True if the program halted.
+     */
+    bool finishTaken(const TranslatedBlock& block, uint32_t target_pc, RunState& state);
+
+    /**
+     * @brief Whether the word behind a taken branch or jump is a HALT. A word that cannot be
+     * fetched, e.g. past the end of the image, is not: the pipeline squashes that fetch fault
+     * along with the rest of the wrong path.
+     * @param branch_pc Address of the branch or jump.
+     */
+    bool haltFollows(uint32_t branch_pc) {
+        uint32_t address = branch_pc + 4;
+        if (const DecodedOp* op = program_image ? program_image->lookup(address) : nullptr) {
+            return op->opcode == mips_lite::opcode::HALT;
+        }
+        uint32_t word = 0;
+        return memory_parser->tryReadInstruction(address, word) == mips_lite::TrapCause::NONE &&
+               mips_lite::is_halt_instruction(word);
+    }
+
+    /**
+     * @brief Get the decoded instruction at an address. A fetch that faults yields an invalid
+     * opcode, whose handler finds out why.
+     * @param address Instruction address.
+     * @param scratch Storage used when the word has to be decoded on the fly.
+     */
+    const DecodedOp* fetch(uint32_t address, DecodedOp& scratch) {
+        const DecodedOp* op = program_image ? program_image->lookup(address) : nullptr;
+        if (op) {
+            return op;
+        }
+        uint32_t word = 0;
+        if (memory_parser->tryReadInstruction(address, word) != mips_lite::TrapCause::NONE) {
+            word = FETCH_FAULT_WORD;
+        }
+        scratch = ProgramImage::decode(word);
+        return &scratch;
+    }
+};
@@ -2,23 +2,26 @@
 
 #include <array>
 #include <cstdint>
-#include <memory>  // For smart pointers
 #include <optional>
 
 #include "memory_interface.h"
+#include "mips_instruction.h"
+#include "program_image.h"
 #include "register_file.h"
 #include "stats.h"
 
-class Instruction;
 /**
  * @struct PipelineStageData
  * @brief Holds all data related to an instruction as it moves through the pipeline.
  *
- * This structure encapsulates an instruction pointer along with all intermediate values
- * and control signals needed as the instruction flows through the pipeline stages.
+ * This structure encapsulates the decoded instruction along with all intermediate values
+ * and control signals needed as the instruction flows through the pipeline stages. Instances
+ * live in fixed pipeline slots owned by the simulator; a slot without a valid instruction is
+ * a bubble.
  */
 struct PipelineStageData {
-    std::unique_ptr<Instruction> instruction;  ///< Instruction object
+    Instruction instruction;  ///< Decoded instruction (only meaningful when valid)
+    bool valid;               ///< False if the slot holds a bubble
     uint32_t pc;           ///< Program counter value when instruction was fetched
                            ///< TODO: I think we need to store PC at the time of the instruction
                            ///< to accurately calculate PC relative addressing
@@ -28,35 +31,75 @@ struct PipelineStageData {
     uint32_t memory_data;  ///< Data read from memory (if applicable)
     std::optional<uint8_t> dest_reg;  ///< Destination register (if any)
     uint32_t branch_target;           ///< Target address for branch/jump
+    mips_lite::TrapCause fault;       ///< Why fetching this instruction faulted, or NONE
 
     // Constructor to initialize with default values
     PipelineStageData()
-        : instruction(nullptr),
+        : instruction(0),
+          valid(false),
           pc(0),
           rs_value(0),
           rt_value(0),
           alu_result(0),
           memory_data(0),
           dest_reg(std::nullopt),
-          branch_target(0) {}
+          branch_target(0),
+          fault(mips_lite::TrapCause::NONE) {}
 
     // Constructor with instruction
-    explicit PipelineStageData(Instruction* instr, uint32_t program_counter)
-        : instruction(std::move(instr)),
+    explicit PipelineStageData(const Instruction& instr, uint32_t program_counter)
+        : instruction(instr),
+          valid(true),
           pc(program_counter),
           rs_value(0),
           rt_value(0),
           alu_result(0),
           memory_data(0),
           dest_reg(std::nullopt),
-          branch_target(0) {}
+          branch_target(0),
+          fault(mips_lite::TrapCause::NONE) {}
 
     // Check if stage is a bubble (no instruction)
-    bool isEmpty() const { return instruction == nullptr; }
+    bool isEmpty() const { return !valid; }
     int32_t getRsValueSigned() const { return static_cast<int32_t>(rs_value); }
     int32_t getRtValueSigned() const { return static_cast<int32_t>(rt_value); }
 };
 
+/**
+ * @brief Everything a FunctionalSimulator holds apart from the objects injected into it, as
+ * saved in a checkpoint (see checkpoint.h). The register scoreboard is not included; it is
+ * rebuilt from the slots.
+ */
+struct SimulatorState {
+    static constexpr int NUM_SLOTS = 5;
+
+    uint32_t pc = 0;
+    std::array<PipelineStageData, NUM_SLOTS> slots;  ///< Pipeline slots, bubbles included
+    std::array<uint8_t, NUM_SLOTS> stage_slot{};     ///< Slot holding each stage, FETCH first
+    bool branch_taken = false;
+    bool forward = false;
+    bool halt_pipeline = false;
+    bool stall = false;
+    mips_lite::Trap trap;
+    uint64_t retired_instructions = 0;
+    uint32_t last_retired_pc = 0;
+};
+
+/**
+ * @brief Compile-time configuration of the pipeline model.
+ * @tparam FORWARDING True to model data forwarding.
+ * @tparam StatsSink Where statistics go: Stats, or NullStats to drop them.
+ * @tparam MemoryType Type the MEM stage accesses memory through: IMemoryParser for virtual calls,
+ *         or the final MemoryParser or FlatMemoryParser so its accessors are called directly and
+ *         inlined.
+ */
+template <bool FORWARDING, typename StatsSink, typename MemoryType = IMemoryParser>
+struct PipelinePolicy {
+    static constexpr bool forwarding = FORWARDING;
+    using Sink = StatsSink;
+    using Memory = MemoryType;
+};
+
 /**
  * @class FunctionalSimulator
  * @brief Simulates a simplified MIPS pipelined processor with optional data forwarding.
@@ -65,6 +108,21 @@ struct PipelineStageData {
  * RegisterFile, Stats, and MemoryParser. Upon construction, the simulator sets
  * the program counter to 0, disables forwarding by default, clears the pipeline,
  * and resets the stall counter.
+ *
+ * A fault in the guest program (unaligned or out-of-range access, fetch outside the image,
+ * invalid opcode) does not throw. It is recorded as a trap when the faulting instruction
+ * reaches EX (fetch faults, invalid opcodes) or MEM (loads and stores): that instruction and
+ * everything younger are squashed, fetch stops, and the older instructions drain as after a
+ * HALT, so the run ends with the state just before the faulting instruction and reports
+ * StopReason::TRAPPED. Nothing is checked for this on the non-faulting path beyond the result of
+ * the memory access; a faulting fetch enters the pipeline as an invalid opcode.
+ *
+ * Forwarding and statistics collection are chosen at run time, but the stages that depend on
+ * them are templates on a PipelinePolicy. Every public entry point selects the matching
+ * instantiation once, so the hazard checks, operand reads and Stats updates inside cycle(),
+ * advance() and runUntil() are resolved at compile time. The same goes for the memory: when the
+ * injected IMemoryParser is a MemoryParser or FlatMemoryParser, loads and stores bypass the
+ * virtual interface.
  */
 class FunctionalSimulator {
    public:
@@ -78,6 +136,37 @@ class FunctionalSimulator {
     FunctionalSimulator(RegisterFile* rf, Stats* st, IMemoryParser* mem,
                         bool enable_forwarding = false);
 
+    /**
+     * @brief Why run() or runUntil() returned.
+     */
+    enum class StopReason {
+        HALTED,             ///< The HALT has drained out of the pipeline
+        CYCLE_LIMIT,        ///< The cycle budget was used up
+        INSTRUCTION_LIMIT,  ///< The instruction budget was used up
+        PC_REACHED,         ///< The instruction at the stop PC was written back
+        WORD_RETIRED,       ///< An instruction encoded as the stop word was written back
+        TRAPPED,            ///< An instruction faulted and the older ones have drained
+    };
+
+    /**
+     * @brief Stop conditions for runUntil(); the run ends at the first one met.
+     */
+    struct RunLimits {
+        uint64_t max_cycles = UINT64_MAX;        ///< Cycles to simulate at most
+        uint64_t max_instructions = UINT64_MAX;  ///< Instructions to write back at most
+        std::optional<uint32_t> stop_pc;         ///< Stop once the instruction at this PC retires
+        std::optional<uint32_t> stop_word;       ///< Stop after writing back this encoding
+    };
+
+    /**
+     * @brief Outcome of run() or runUntil().
+     */
+    struct RunResult {
+        StopReason reason;      ///< Condition that ended the run
+        uint64_t cycles;        ///< Cycles simulated by this run
+        uint64_t instructions;  ///< Instructions written back by this run
+    };
+
     // Getter methods
 
     /**
@@ -92,7 +181,30 @@ class FunctionalSimulator {
      */
     bool isForwardingEnabled() const;
 
-    bool isProgramFinished() { return checkProgramCompletion(); }
+    /**
+     * @brief Enable or disable statistics collection. While disabled the simulator runs the
+     * NullStats instantiations and leaves the Stats instance untouched; the PC, pipeline,
+     * registers, memory and the run() results are the same either way.
+     * @param enabled True (the default) to update Stats.
+     */
+    void setStatsCollection(bool enabled) { collect_stats = enabled; }
+
+    bool isStatsCollectionEnabled() const { return collect_stats; }
+
+    bool isProgramFinished() const { return checkProgramCompletion(); }
+
+    /// True once an instruction has trapped; the program then finishes without a HALT.
+    bool isTrapped() const { return trap.cause != mips_lite::TrapCause::NONE; }
+
+    /// The trap taken by the program, with cause NONE if there was none. The PC is left at
+    /// the faulting instruction.
+    const mips_lite::Trap& getTrap() const { return trap; }
+
+    /// Number of instructions written back since construction.
+    uint64_t getRetiredInstructions() const { return retired_instructions; }
+
+    /// PC of the latest instruction written back.
+    uint32_t getLastRetiredPC() const { return last_retired_pc; }
 
     /**
      * @brief Get the stall signal.
@@ -114,6 +226,17 @@ class FunctionalSimulator {
 
     bool isBranchTaken() const { return branch_taken; }
 
+    /// The PC, pipeline slots, control flags, trap and retirement counters.
+    SimulatorState getState() const;
+
+    /**
+     * @brief Continue from a state returned by getState(), possibly of another simulator over an
+     * identical register file and memory: the following cycles are exactly those the original
+     * would have simulated.
+     * @param state State to adopt.
+     */
+    void setState(const SimulatorState& state);
+
     // Setter methods
 
     /**
@@ -156,8 +279,9 @@ class FunctionalSimulator {
     /**
      * @brief Advance all pipeline stages by one cycle.
      *
-     * This shifts each pipeline stage, moving instructions forward in the pipeline.
-     * Should be called at the end of each simulation cycle.
+     * This shifts each pipeline stage, moving instructions forward in the pipeline by rotating
+     * slot indices; no stage data is copied or allocated. Should be called at the end of each
+     * simulation cycle.
      */
     void advancePipeline();
 
@@ -173,6 +297,38 @@ class FunctionalSimulator {
      */
     void cycle();
 
+    /**
+     * @brief Simulate up to max_cycles cycles, stopping early once the program has finished.
+     *
+     * Equivalent to calling cycle() until isProgramFinished() or max_cycles cycles have
+     * elapsed, leaving the same pipeline state and Stats. Stretches whose outcome is already
+     * known are advanced several cycles per step: the cycles of a detected stall, and the drain
+     * once the HALT has been decoded. These skip hazard detection, fetch, decode and the
+     * completion check, and add their clock and stall cycles to Stats at once.
+     * @param max_cycles Maximum number of cycles to simulate.
+     * @return Number of cycles simulated.
+     */
+    uint64_t advance(uint64_t max_cycles);
+
+    /**
+     * @brief Simulate until the program finishes or max_cycles cycles have elapsed.
+     * @param max_cycles Cycle budget for this run.
+     * @return Why the run stopped, with the cycles and instructions it took.
+     */
+    RunResult run(uint64_t max_cycles);
+
+    /**
+     * @brief Simulate until the program finishes or one of the limits is reached.
+     *
+     * The limits count from the start of this call. Cycle-only runs go through advance();
+     * instruction, PC and word limits are checked after every cycle, so they stop exactly on the
+     * cycle that writes back the instruction concerned. A program that is already finished returns
+     * HALTED without simulating anything.
+     * @param limits Stop conditions.
+     * @return Why the run stopped, with the cycles and instructions it took.
+     */
+    RunResult runUntil(const RunLimits& limits);
+
     /**
      * @brief Check for data hazards and stall if necessary.
      * @return True if a stall is needed, false otherwise.
@@ -205,8 +361,11 @@ class FunctionalSimulator {
     /// General purpose registers
     RegisterFile* register_file;
 
-    /// 5-stage pipeline array
-    std::array<std::unique_ptr<PipelineStageData>, NUM_STAGES> pipeline;
+    /// Fixed storage for the 5 pipeline registers
+    std::array<PipelineStageData, NUM_STAGES> pipeline;
+
+    /// Maps each pipeline stage to the slot in `pipeline` currently holding its data
+    std::array<uint8_t, NUM_STAGES> stage_slot;
 
     /// Stats instance to track runtime metrics
     Stats* stats;
@@ -214,26 +373,94 @@ class FunctionalSimulator {
     /// Serves as the simulator memory
     IMemoryParser* memory_parser;
 
+    /// Predecoded instructions from memory_parser, or nullptr if it does not provide any
+    const ProgramImage* program_image = nullptr;
+
     // Control signals
     bool branch_taken = false;   // EXE stage sets this to true if a branch is taken
     bool forward = false;        // Forwarding enabled or not during construction
     bool halt_pipeline = false;  // Set to true when fetch stage encounters a halt instruction
     bool stall = false;          // Set to true when a hazard is detected
+    bool collect_stats = true;   // Update Stats, or run the NullStats instantiations
+
+    /// Concrete type of memory_parser, when it is one the pipeline accesses without vcalls
+    enum class ConcreteMemory : uint8_t { NONE, PAGED, FLAT };
+    ConcreteMemory concrete_memory = ConcreteMemory::NONE;
+
+    /// Number of pipeline slots holding a valid instruction, kept up to date by fetch, flush and
+    /// the release of the writeback slot so completion is checked without scanning the stages
+    int occupied_stages = 0;
 
     /**
-     * @brief Helper method to check if an instruction writes to a register.
-     * @param instr Pointer to the instruction to check.
-     * @return True if the instruction writes to a register, false otherwise.
+     * @brief Register scoreboard entry for one pipeline slot, as bitmasks over R1-R31 (bit n
+     * stands for Rn; R0 is never set since it cannot cause a hazard).
+     *
+     * reads is filled in when the slot is fetched and writes when it is decoded, so a hazard or
+     * forwarding check is an AND of the decode slot's reads with the EX or MEM slot's writes.
+     * Bubbles have both masks clear.
      */
-    bool isRegisterWriteInstruction(const Instruction* instr) const;
+    struct SlotRegisters {
+        uint32_t reads = 0;   ///< Source registers of the instruction
+        uint32_t writes = 0;  ///< Destination register, once decoded
+        bool load = false;    ///< The result is only ready after MEM (latency 2, i.e. LDW)
+    };
+
+    /// Scoreboard entries, indexed by slot like `pipeline`
+    std::array<SlotRegisters, NUM_STAGES> slot_registers{};
+
+    mips_lite::Trap trap;  // Trap taken by the program, if any
+
+    uint64_t retired_instructions = 0;  // Instructions written back
+    uint32_t last_retired_pc = 0;       // PC of the latest instruction written back
+    uint32_t last_retired_word = 0;     // Its encoding; only read right after it retires
+
+    /**
+     * @brief Get the slot currently assigned to a pipeline stage (valid or bubble).
+     * @param stage Index (0 to 4) of the pipeline stage. Not range checked.
+     */
+    PipelineStageData& stageData(int stage) { return pipeline[stage_slot[stage]]; }
+    const PipelineStageData& stageData(int stage) const { return pipeline[stage_slot[stage]]; }
+
+    /// Call fn with a default-constructed PipelinePolicy matching forward, collect_stats and
+    /// concrete_memory
+    template <typename Fn>
+    decltype(auto) dispatch(Fn&& fn);
+
+    /// The Stats instance, or a NullStats that discards the updates
+    template <typename Policy>
+    typename Policy::Sink& sink();
+
+    /// memory_parser as the memory type of the policy
+    template <typename Policy>
+    typename Policy::Memory& memory() {
+        return *static_cast<typename Policy::Memory*>(memory_parser);
+    }
+
+    // Policy-specialized stages and loops behind the public methods of the same name
+    template <typename Policy>
+    void instructionDecodeImpl();
+    template <typename Policy>
+    void memoryImpl();
+    template <typename Policy>
+    void writeBackImpl();
+    template <typename Policy>
+    void advancePipelineImpl();
+    template <typename Policy>
+    void cycleImpl();
+    template <typename Policy>
+    uint64_t advanceImpl(uint64_t max_cycles);
+    template <typename Policy>
+    RunResult runUntilImpl(const RunLimits& limits);
 
     /**
      * @brief Helper method to get the value of a register.
      * @param reg_num Register number to read. Handles forwarding if needed. Note that this
      * function should only be called when the pipeline is not stalled. If stalled we shouldn't be
-     * reading any registers.
+     * reading any registers. Without forwarding, decode only proceeds once every producer has
+     * written back, so the register file is read directly.
      * @return Value of the register.
      */
+    template <typename Policy>
     uint32_t readRegisterValue(uint8_t reg_num);
 
     /* @brief Detects hazards in the pipeline and returns the number of stall cycles needed.
@@ -244,25 +471,83 @@ class FunctionalSimulator {
      *
      * @return Number of stall cycles needed to resolve hazards, or 0 if no hazards are detected.
      */
-    bool detectStalls(void);
+    template <typename Policy>
+    bool detectStalls() const;
+
+    /// Scoreboard entry of the slot currently assigned to a pipeline stage
+    const SlotRegisters& stageRegisters(int stage) const {
+        return slot_registers[stage_slot[stage]];
+    }
+
+    /// Bitmask with the bit for reg_num set, or 0 for R0
+    static uint32_t registerBit(uint8_t reg_num) { return (1u << reg_num) & ~1u; }
+
+    /// Registers read in ID that are written by the instruction in EX and MEM respectively
+    uint32_t executeHazards() const {
+        return stageRegisters(PipelineStage::DECODE).reads &
+               stageRegisters(PipelineStage::EXECUTE).writes;
+    }
+    uint32_t memoryHazards() const {
+        return stageRegisters(PipelineStage::DECODE).reads &
+               stageRegisters(PipelineStage::MEMORY).writes;
+    }
+
+    /// Move every stage's slot along by one cycle; while stalled, IF and ID hold and EX gets a
+    /// bubble. Does not touch Stats.
+    void rotateStages();
 
-    // Hazard helper methods
-    bool causesHazard(uint8_t reg_num, uint8_t dest_reg) const;
-    bool checkExecuteStageForHazard(uint8_t rs, uint8_t rt, bool needs_rt) const;
-    bool checkMemoryStageForHazard(uint8_t rs, uint8_t rt, bool needs_rt) const;
+    /**
+     * @brief Number of consecutive stall cycles starting with the next cycle: 2 for an EX
+     * hazard without forwarding, 1 for a load-use hazard with forwarding or a MEM hazard
+     * without it, 0 if the next cycle does not stall or may resolve a branch.
+     */
+    template <typename Policy>
+    int pendingStallCycles() const;
 
-    // determines if the instruction needs the Rt register value as a source operand
-    bool needsRtValue(const Instruction* instr) const;
+    /**
+     * @brief Number of cycles until the pipeline is empty if it is only draining (HALT fetched,
+     * IF and ID empty, no branch left to resolve), 0 otherwise.
+     */
+    int pendingDrainCycles() const;
 
-    /** check for program completion
-     * @brief Check if the program has finished executing. If so it will set
-     * program_finished to true
+    /**
+     * @brief Check if the program has finished executing: HALT fetched (or a trap taken) and
+     * every stage empty.
+     */
+    bool checkProgramCompletion(void) const { return halt_pipeline && occupied_stages == 0; }
+
+    /// Recompute occupied_stages and the scoreboard from the slots, after they were written
+    /// from outside
+    void resyncPipelineState();
+
+    /// Turn the instruction in a stage into a bubble
+    void flushStage(int stage);
+
+    /**
+     * @brief Record a trap for the instruction in a stage: squash it and every younger stage
+     * and stop fetching, leaving the older instructions to drain.
      */
-    bool checkProgramCompletion(void);
+    void raiseTrap(int stage, mips_lite::TrapCause cause, uint32_t address);
+
+    /// HALTED or TRAPPED, for a program that has finished
+    StopReason finishReason() const {
+        return isTrapped() ? StopReason::TRAPPED : StopReason::HALTED;
+    }
 
 #ifdef UNIT_TEST
     // Allow functional simulator tests access to private class member pipeline
    public:
-    std::array<std::unique_ptr<PipelineStageData>, NUM_STAGES>& getPipeline() { return pipeline; }
+    /// Stage-indexed view of the pipeline slots, e.g. getPipeline()[DECODE] = data;
+    class PipelineView {
+       public:
+        explicit PipelineView(FunctionalSimulator& sim) : sim_(sim) {}
+        // Runs at the end of the full expression, after the slot has been assigned
+        ~PipelineView() { sim_.resyncPipelineState(); }
+        PipelineStageData& operator[](int stage) { return sim_.stageData(stage); }
+
+       private:
+        FunctionalSimulator& sim_;
+    };
+    PipelineView getPipeline() { return PipelineView(*this); }
 #endif
 };
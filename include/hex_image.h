@@ -0,0 +1,57 @@
+/**
+ * @file hex_image.h
+ * @brief Loader for memory images in the hex trace format.
+ *
+ * The format is one 32-bit word per line, written in hex. Blank lines are skipped and spaces,
+ * tabs and carriage returns around a word are ignored. A line "ADDRESS: VALUE", as the memory
+ * dump writes for pages stored to far beyond the image, places VALUE at that byte address
+ * rather than after the previous word; only callers that ask for such words accept them.
+ *
+ * The file is mapped into memory rather than read through a stream. Lines are split with
+ * memchr (vectorized by the C library) and a line of one to eight hex digits, which is every
+ * line the simulator and the compiler script write, is decoded through a lookup table with no
+ * per-digit branches. Any other line is parsed with the std::hex stream extraction the loader
+ * has always used, so unusual input (a 0x prefix, leading zeros, trailing text, malformed
+ * words) gives the same value or the same error as before.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hex_image {
+
+/// A word given by an "ADDRESS: VALUE" line
+struct PlacedWord {
+    uint32_t address;  ///< Word-aligned byte address
+    uint32_t value;
+};
+
+/**
+ * @brief Parse a hex image held in memory.
+ * @param data Image text.
+ * @param size Bytes of text.
+ * @param max_words Largest number of words accepted.
+ * @param placed Receives the "ADDRESS: VALUE" lines, in file order; nullptr to reject them.
+ * @return The other words, in file order.
+ * @throws std::runtime_error on a line that is not a hex word, an unaligned or rejected
+ *         "ADDRESS: VALUE" line, or beyond max_words words.
+ */
+std::vector<uint32_t> parse(const char* data, size_t size, size_t max_words,
+                            std::vector<PlacedWord>* placed = nullptr);
+
+/**
+ * @brief Load a hex image from a file.
+ * @param path File to read.
+ * @param max_words Largest number of words accepted.
+ * @param placed As for parse().
+ * @return The words, in file order.
+ * @throws std::runtime_error if the file cannot be opened, or as parse().
+ */
+std::vector<uint32_t> load(const std::string& path, size_t max_words,
+                           std::vector<PlacedWord>* placed = nullptr);
+
+}  // namespace hex_image
@@ -0,0 +1,111 @@
+/**
+ * @file hybrid_simulator.h
+ * @brief Hybrid simulation: the FastSimulator outside a program's region of interest, the
+ * cycle-accurate FunctionalSimulator inside it.
+ *
+ * The guest marks the region with the reserved no-op encodings mips_lite::roi::BEGIN and END
+ * (ROI_BEGIN and ROI_END in the assembler). The FastSimulator runs up to a BEGIN marker and stops
+ * in front of it; a fresh pipeline then starts at the marker, over the same registers and memory,
+ * and runs until the END marker is written back. At that point the registers hold exactly the
+ * results of the instructions up to END, so the fast engine resumes after it and the younger
+ * instructions still in the pipeline are discarded. Those were only fetched and decoded, apart
+ * from at most one in MEM, whose load or store the fast engine repeats with the same operands.
+ *
+ * Both markers count as region instructions. Region and non-region statistics go to separate
+ * Stats: the region's clock cycles and stalls are the pipeline's, including its fill on every
+ * entry; outside the region only instruction counts, registers and memory addresses are
+ * recorded. Markers outside their role (END outside a region, BEGIN inside one) are plain
+ * no-ops, and a region left open runs cycle-accurately to the end of the program.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "memory_interface.h"
+#include "mips_lite_defs.h"
+#include "register_file.h"
+#include "stats.h"
+
+/**
+ * @class HybridSimulator
+ * @brief Switches between the fast and the pipelined simulator at region-of-interest markers.
+ */
+class HybridSimulator {
+   public:
+    /**
+     * @brief Constructor using dependency injection.
+     * @param rf Pointer to the RegisterFile instance.
+     * @param outside_stats Stats for the instructions outside the region of interest.
+     * @param roi_stats Stats for the instructions inside it.
+     * @param mem Pointer to the memory instance.
+     * @param enable_forwarding Simulate the region with data forwarding.
+     * @throws std::invalid_argument if any dependency is null.
+     */
+    HybridSimulator(RegisterFile* rf, Stats* outside_stats, Stats* roi_stats, IMemoryParser* mem,
+                    bool enable_forwarding = false);
+
+    /**
+     * @brief Execute instructions until the program finishes or the budget is used up.
+     * @param max_instructions Maximum number of instructions to retire in this call, inside and
+     * outside the region.
+     * @return Number of instructions retired by this call.
+     */
+    uint64_t run(uint64_t max_instructions);
+
+    /// Current PC of the engine in charge.
+    uint32_t getPC() const { return pipeline ? pipeline->getPC() : fast.getPC(); }
+
+    /// True once the program has halted or trapped.
+    bool isProgramFinished() const { return finished; }
+
+    /// True if an instruction trapped, inside or outside the region; see getTrap().
+    bool isTrapped() const { return trap.cause != mips_lite::TrapCause::NONE; }
+
+    /// The trap taken by the engine in charge (FunctionalSimulator::getTrap() or
+    /// FastSimulator::getTrap()), with cause NONE if there was none.
+    const mips_lite::Trap& getTrap() const { return trap; }
+
+    /// True while the pipeline is running a region.
+    bool isInRegion() const { return pipeline != nullptr; }
+
+    /// Number of times a region was entered.
+    uint64_t getRegionEntries() const { return region_entries; }
+
+    /// Instructions retired outside and inside the region so far.
+    uint64_t getOutsideInstructions() const { return fast.getInstructionCount(); }
+    uint64_t getRegionInstructions() const { return region_instructions; }
+
+    /// The fast engine, e.g. to enable native compilation.
+    FastSimulator& getFastSimulator() { return fast; }
+
+    /**
+     * @brief Start over at PC 0 outside the region, e.g. after the memory parser was reloaded
+     * with another program. The registers and both Stats are the caller's to clear.
+     * @param enable_forwarding Simulate regions with data forwarding from now on.
+     */
+    void reset(bool enable_forwarding);
+
+   private:
+    RegisterFile* register_file;
+    Stats* roi_stats;
+    IMemoryParser* memory_parser;
+    bool forwarding;
+
+    FastSimulator fast;
+    std::unique_ptr<FunctionalSimulator> pipeline;  // Set while in the region
+
+    bool finished = false;
+    mips_lite::Trap trap;
+    uint64_t region_entries = 0;
+    uint64_t region_instructions = 0;
+
+    /// Start the pipeline at the BEGIN marker the fast engine stopped at.
+    void enterRegion();
+
+    /// Hand back to the fast engine after the END marker the pipeline wrote back.
+    void leaveRegion();
+};
@@ -0,0 +1,95 @@
+/**
+ * @file jit_compiler.h
+ * @brief x86-64 native code backend for translated basic blocks.
+ *
+ * The JitCompiler turns a TranslatedBlock into x86-64 machine code placed in an mmap'd code
+ * arena. Guest registers stay in the RegisterFile array, which the generated code addresses
+ * through a pinned host register; LDW and STW call back into C++ helpers so memory keeps going
+ * through IMemoryParser. Generated code never throws: a faulting access is recorded in the
+ * JitContext and the block returns an exit code, leaving Stats accounting and the trap to
+ * FastSimulator.
+ *
+ * The backend is only available on x86-64 Linux. Elsewhere isSupported() is false and
+ * FastSimulator keeps running blocks through its interpreter.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "block_translator.h"
+#include "memory_interface.h"
+#include "mips_lite_defs.h"
+#include "stats.h"
+
+/// Exit codes returned by a compiled block
+namespace jit_exit {
+constexpr uint32_t FALLTHROUGH = 0;      // Block completed, continue at JitContext::next_pc
+constexpr uint32_t TAKEN = 1;            // Block ended in a taken branch or jump to next_pc
+constexpr uint32_t HALT = 2;             // Block ended in HALT
+constexpr uint32_t STORE_INTO_CODE = 3;  // Op op_index stored into translated code
+constexpr uint32_t FAULT = 4;            // Op op_index faulted; see fault and fault_address
+}  // namespace jit_exit
+
+/**
+ * @struct JitContext
+ * @brief State shared between FastSimulator and generated code.
+ */
+struct JitContext {
+    uint32_t* regs = nullptr;               ///< RegisterFile storage
+    IMemoryParser* memory = nullptr;        ///< Memory accessed by LDW/STW
+    Stats* stats = nullptr;                 ///< Receives STW addresses
+    BlockTranslator* translator = nullptr;  ///< Checked for stores into translated code
+    uint32_t next_pc = 0;                   ///< Set on FALLTHROUGH and TAKEN
+    uint32_t status = 0;                    ///< Non-zero after a helper requested an exit
+    uint32_t op_index = 0;                  ///< Index of the op that last called a helper
+    uint32_t store_address = 0;             ///< Address of a STORE_INTO_CODE store
+    uint32_t fault_address = 0;             ///< Address of a FAULT access
+    mips_lite::TrapCause fault = mips_lite::TrapCause::NONE;  ///< Why it faulted
+};
+
+/**
+ * @class JitCompiler
+ * @brief Compiles translated blocks into a fixed-size executable code arena.
+ */
+class JitCompiler {
+   public:
+    /// Signature of a compiled block; returns a jit_exit code
+    using BlockFunction = NativeBlockFunction;
+
+    /// Default size of the code arena
+    static constexpr size_t DEFAULT_CODE_CAPACITY = 1 << 20;
+
+    /// True if native code can be generated and run on this host.
+    static bool isSupported();
+
+    /**
+     * @brief Constructor. Maps the code arena.
+     * @param code_capacity Size of the code arena in bytes.
+     * @throws std::runtime_error if the host is unsupported or the arena cannot be mapped.
+     */
+    explicit JitCompiler(size_t code_capacity = DEFAULT_CODE_CAPACITY);
+    ~JitCompiler();
+
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    /**
+     * @brief Compile a block into the arena.
+     * @param block Block to compile.
+     * @return Entry point, or nullptr if the arena is full. Code stays valid until reset().
+     */
+    BlockFunction compile(const TranslatedBlock& block);
+
+    /// Discard all generated code. Entry points returned before are invalid afterwards.
+    void reset();
+
+    /// Bytes of the arena in use.
+    size_t codeSize() const { return code_size_; }
+
+   private:
+    uint8_t* code_ = nullptr;
+    size_t code_capacity_ = 0;
+    size_t code_size_ = 0;
+};
@@ -19,6 +19,10 @@
 
 #include <cstdint>
 
+#include "mips_lite_defs.h"
+
+class ProgramImage;
+
 /**
  * @interface IMemoryParser
  * @brief Abstract interface for memory access to support mocking in tests.
@@ -45,4 +49,42 @@ class IMemoryParser {
      * @param value 32-bit value to write.
      */
     virtual void writeMemory(uint32_t address, uint32_t value) = 0;
+    /**
+     * @brief Get the predecoded instruction image backing this memory, if any.
+     * @return Pointer to the image, or nullptr if instructions must be decoded on every fetch.
+     */
+    virtual const ProgramImage* getProgramImage() const { return nullptr; }
+
+    /**
+     * @brief Non-throwing readInstruction(): reports a fault as a trap cause instead.
+     * The defaults forward to the throwing accessors, so implementations that never fault
+     * (such as test mocks) only need to provide those.
+     * @param address Memory address to read from.
+     * @param word Receives the instruction; unchanged on a fault.
+     * @return TrapCause::NONE, or why the access faulted.
+     */
+    virtual mips_lite::TrapCause tryReadInstruction(uint32_t address, uint32_t& word) {
+        word = readInstruction(address);
+        return mips_lite::TrapCause::NONE;
+    }
+    /**
+     * @brief Non-throwing readMemory().
+     * @param address Memory address to read.
+     * @param value Receives the value; unchanged on a fault.
+     * @return TrapCause::NONE, or why the access faulted.
+     */
+    virtual mips_lite::TrapCause tryReadMemory(uint32_t address, uint32_t& value) {
+        value = readMemory(address);
+        return mips_lite::TrapCause::NONE;
+    }
+    /**
+     * @brief Non-throwing writeMemory(). Memory is unchanged on a fault.
+     * @param address Memory address to write.
+     * @param value 32-bit value to write.
+     * @return TrapCause::NONE, or why the access faulted.
+     */
+    virtual mips_lite::TrapCause tryWriteMemory(uint32_t address, uint32_t value) {
+        writeMemory(address, value);
+        return mips_lite::TrapCause::NONE;
+    }
 };
@@ -7,6 +7,8 @@
 
 #include "mips_lite_defs.h"
 
+struct DecodedOp;
+
 // Basic data class to store MIPs instruction information
 class Instruction {
    private:
@@ -22,6 +24,9 @@ class Instruction {
    public:
     explicit Instruction(uint32_t instruction);
 
+    // Build from an already predecoded op without re-extracting any fields
+    explicit Instruction(const DecodedOp& op);
+
     // Getters
     uint8_t getOpcode() const { return opcode_; }
     uint8_t getRs() const { return rs_; }
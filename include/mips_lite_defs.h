@@ -9,10 +9,14 @@
  *
  * 2. I-type Format (6 bits opcode, 5 bits Rs, 5 bits Rt, 16 bits immediate)
  *    Used by: ADDI, SUBI, MULI, ORI, ANDI, XORI, LDW, STW, BZ, BEQ, JR, HALT
+ *
+ * The instructions themselves are listed in mips_lite_isa.def, which this header expands into
+ * the opcode constants and a constexpr table of per-opcode metadata (OPCODE_TABLE).
  */
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <stdexcept>
 
@@ -24,35 +28,23 @@ enum class InstructionType { R_TYPE, I_TYPE };
 // Instruction Category Types
 enum class InstructionCategory { ARITHMETIC, LOGICAL, MEMORY_ACCESS, CONTROL_FLOW };
 
-// Opcode Definitions
+// Opcode Definitions, one constant per instruction of mips_lite_isa.def (ADD, ADDI, ..., HALT)
 namespace opcode {
-// Arithmetic Instructions
-constexpr uint8_t ADD = 0b000000;   // 0
-constexpr uint8_t ADDI = 0b000001;  // 1
-constexpr uint8_t SUB = 0b000010;   // 2
-constexpr uint8_t SUBI = 0b000011;  // 3
-constexpr uint8_t MUL = 0b000100;   // 4
-constexpr uint8_t MULI = 0b000101;  // 5
-
-// Logical Instructions
-constexpr uint8_t OR = 0b000110;    // 6
-constexpr uint8_t ORI = 0b000111;   // 7
-constexpr uint8_t AND = 0b001000;   // 8
-constexpr uint8_t ANDI = 0b001001;  // 9
-constexpr uint8_t XOR = 0b001010;   // 10
-constexpr uint8_t XORI = 0b001011;  // 11
-
-// Memory Access Instructions
-constexpr uint8_t LDW = 0b001100;  // 12
-constexpr uint8_t STW = 0b001101;  // 13
-
-// Control Flow Instructions
-constexpr uint8_t BZ = 0b001110;    // 14
-constexpr uint8_t BEQ = 0b001111;   // 15
-constexpr uint8_t JR = 0b010000;    // 16
-constexpr uint8_t HALT = 0b010001;  // 17
+#define MIPS_LITE_OPCODE(name, value, type, category, control_word, reads_rt, latency) \
+    constexpr uint8_t name = value;
+#include "mips_lite_isa.def"
+#undef MIPS_LITE_OPCODE
 }  // namespace opcode
 
+// Region-of-interest markers: reserved encodings of XORI into R0, which every engine runs as a
+// no-op. A HybridSimulator switches to cycle-accurate simulation at BEGIN and back after END.
+namespace roi {
+constexpr uint32_t BEGIN = (uint32_t(opcode::XORI) << 26) | 0x1001;  // XORI R0 R0 4097
+constexpr uint32_t END = (uint32_t(opcode::XORI) << 26) | 0x1002;    // XORI R0 R0 4098
+
+constexpr bool is_marker(uint32_t word) { return word == BEGIN || word == END; }
+}  // namespace roi
+
 // Register Constants
 constexpr uint8_t NUM_REGISTERS = 32;
 // Memory Constants
@@ -61,6 +53,38 @@ constexpr uint8_t WORD_SIZE = 4;  // 4 bytes per word
 // Pipeline Stage Definitions
 enum class PipelineStage { FETCH, DECODE, EXECUTE, MEMORY, WRITEBACK };
 
+// Guest trap causes: faults raised by the simulated program rather than by the simulator
+enum class TrapCause : uint8_t {
+    NONE,
+    UNALIGNED_ACCESS,             // Load, store or fetch address that is not word aligned
+    ADDRESS_OUT_OF_RANGE,         // Load or store outside the memory the IMemoryParser backs
+    INVALID_INSTRUCTION_ADDRESS,  // Fetch beyond the loaded image
+    INVALID_OPCODE,               // Opcode that is not part of the ISA
+};
+
+/// A trap taken by the guest program
+struct Trap {
+    TrapCause cause = TrapCause::NONE;
+    uint32_t pc = 0;       ///< PC of the faulting instruction
+    uint32_t address = 0;  ///< Faulting data or instruction address (the PC for INVALID_OPCODE)
+};
+
+inline const char* trap_cause_name(TrapCause cause) {
+    switch (cause) {
+        case TrapCause::NONE:
+            return "none";
+        case TrapCause::UNALIGNED_ACCESS:
+            return "unaligned access";
+        case TrapCause::ADDRESS_OUT_OF_RANGE:
+            return "address out of range";
+        case TrapCause::INVALID_INSTRUCTION_ADDRESS:
+            return "invalid instruction address";
+        case TrapCause::INVALID_OPCODE:
+            return "invalid opcode";
+    }
+    return "unknown";
+}
+
 // Bit Manipulation Helper Functions
 inline uint32_t extract_bits(uint32_t value, int start, int length) {
     return (value >> start) & ((1 << length) - 1);
@@ -88,59 +112,6 @@ inline int16_t get_immediate(uint32_t instruction) {
     return static_cast<int16_t>(extract_bits(instruction, 0, 16));
 }
 
-// Get instruction type from opcode
-inline InstructionType get_instruction_type(uint8_t opcode) {
-    switch (opcode) {
-        case opcode::ADD:
-            [[fallthrough]];
-        case opcode::SUB:
-            [[fallthrough]];
-        case opcode::MUL:
-            [[fallthrough]];
-        case opcode::OR:
-            [[fallthrough]];
-        case opcode::AND:
-            [[fallthrough]];
-        case opcode::XOR:
-            return InstructionType::R_TYPE;
-        default:
-            return InstructionType::I_TYPE;
-    }
-}
-
-inline InstructionCategory get_instruction_category(uint8_t opcode) {
-    switch (opcode) {
-        case opcode::ADD:
-        case opcode::ADDI:
-        case opcode::SUB:
-        case opcode::SUBI:
-        case opcode::MUL:
-        case opcode::MULI:
-            return InstructionCategory::ARITHMETIC;
-
-        case opcode::OR:
-        case opcode::ORI:
-        case opcode::AND:
-        case opcode::ANDI:
-        case opcode::XOR:
-        case opcode::XORI:
-            return InstructionCategory::LOGICAL;
-
-        case opcode::LDW:
-        case opcode::STW:
-            return InstructionCategory::MEMORY_ACCESS;
-
-        case opcode::BZ:
-        case opcode::BEQ:
-        case opcode::JR:
-        case opcode::HALT:
-            return InstructionCategory::CONTROL_FLOW;
-
-        default:
-            throw std::invalid_argument("Invalid opcode for instruction category");
-    }
-}
-// Control Word Bit Positions
 // Control Word Bit Positions
 namespace control {
 // Example control signals - TODO: adjust based on what we decide to implement
@@ -163,95 +134,74 @@ constexpr uint16_t ALU_OP_XOR = 0x0500;   // Logical XOR
 constexpr uint16_t ALU_OP_MASK = 0x0F00;  // Mask for ALU operation bits
 }  // namespace control
 
-// Function to get control word based on opcode
-inline uint16_t get_control_word(uint8_t opcode) {
-    uint16_t control_word = 0;
-
-    switch (opcode) {
-        // R-type arithmetic operations
-        case opcode::ADD:
-            control_word = control::REG_DST | control::REG_WRITE | control::ALU_OP_ADD;
-            break;
-        case opcode::SUB:
-            control_word = control::REG_DST | control::REG_WRITE | control::ALU_OP_SUB;
-            break;
-        case opcode::MUL:
-            control_word = control::REG_DST | control::REG_WRITE | control::ALU_OP_MUL;
-            break;
-
-        // I-type arithmetic operations
-        case opcode::ADDI:
-            control_word = control::ALU_SRC | control::REG_WRITE | control::ALU_OP_ADD;
-            break;
-        case opcode::SUBI:
-            control_word = control::ALU_SRC | control::REG_WRITE | control::ALU_OP_SUB;
-            break;
-        case opcode::MULI:
-            control_word = control::ALU_SRC | control::REG_WRITE | control::ALU_OP_MUL;
-            break;
-
-        // R-type logical operations
-        case opcode::OR:
-            control_word = control::REG_DST | control::REG_WRITE | control::ALU_OP_OR;
-            break;
-        case opcode::AND:
-            control_word = control::REG_DST | control::REG_WRITE | control::ALU_OP_AND;
-            break;
-        case opcode::XOR:
-            control_word = control::REG_DST | control::REG_WRITE | control::ALU_OP_XOR;
-            break;
-
-        // I-type logical operations
-        case opcode::ORI:
-            control_word = control::ALU_SRC | control::REG_WRITE | control::ALU_OP_OR;
-            break;
-        case opcode::ANDI:
-            control_word = control::ALU_SRC | control::REG_WRITE | control::ALU_OP_AND;
-            break;
-        case opcode::XORI:
-            control_word = control::ALU_SRC | control::REG_WRITE | control::ALU_OP_XOR;
-            break;
-
-        // Memory access operations
-        case opcode::LDW:
-            control_word = control::ALU_SRC | control::MEM_READ | control::MEM_TO_REG |
-                           control::REG_WRITE | control::ALU_OP_ADD;
-            break;
-        case opcode::STW:
-            control_word = control::ALU_SRC | control::MEM_WRITE | control::ALU_OP_ADD;
-            break;
-
-        // Control flow operations
-        case opcode::BZ:
-            control_word = control::ALU_SRC | control::BRANCH | control::ALU_OP_SUB;
-            break;
-        case opcode::BEQ:
-            control_word = control::BRANCH | control::ALU_OP_SUB;
-            break;
-        case opcode::JR:
-            control_word = control::JUMP;
-            break;
-        case opcode::HALT:
-            // No control signals needed for HALT
-            break;
-
-        default:
-            // Invalid opcode
-            break;
-    }
+/**
+ * @brief Everything the simulators need to know about one opcode.
+ *
+ * Undefined opcodes have valid == false, I_TYPE format, no control signals and no operands.
+ */
+struct OpcodeInfo {
+    bool valid = false;  ///< The opcode is part of the ISA
+    InstructionType type = InstructionType::I_TYPE;
+    InstructionCategory category = InstructionCategory::ARITHMETIC;  ///< Meaningful if valid
+    uint16_t control_word = 0;  ///< Control signals, see namespace control
+    bool reads_rt = false;      ///< Rt is a source operand (R-type, BEQ, STW)
+    bool writes_reg = false;    ///< Writes Rd (R-type) or Rt (I-type); same as REG_WRITE
+    uint8_t latency = 0;        ///< Cycles from entering EX until the result can be forwarded
+};
+
+/// Number of opcodes the 6-bit opcode field can encode
+constexpr int NUM_OPCODES = 64;
+
+/// Build the opcode table from mips_lite_isa.def
+constexpr std::array<OpcodeInfo, NUM_OPCODES> make_opcode_table() {
+    using namespace control;
+    std::array<OpcodeInfo, NUM_OPCODES> table{};
+#define MIPS_LITE_OPCODE(name, value, type_, category_, control_word_, reads_rt_, latency_) \
+    table[value] = OpcodeInfo{true,                                                        \
+                              InstructionType::type_,                                      \
+                              InstructionCategory::category_,                              \
+                              static_cast<uint16_t>(control_word_),                        \
+                              (reads_rt_) != 0,                                            \
+                              ((control_word_) & REG_WRITE) != 0,                          \
+                              static_cast<uint8_t>(latency_)};
+#include "mips_lite_isa.def"
+#undef MIPS_LITE_OPCODE
+    return table;
+}
+
+/// Per-opcode metadata, indexed by the 6-bit opcode
+inline constexpr std::array<OpcodeInfo, NUM_OPCODES> OPCODE_TABLE = make_opcode_table();
 
-    return control_word;
+/// Metadata of an opcode, as extracted by get_opcode(); only the low 6 bits are used
+constexpr const OpcodeInfo& opcode_info(uint8_t opcode) {
+    return OPCODE_TABLE[opcode & (NUM_OPCODES - 1)];
 }
 
+// Get instruction type from opcode
+inline InstructionType get_instruction_type(uint8_t opcode) { return opcode_info(opcode).type; }
+
+inline InstructionCategory get_instruction_category(uint8_t opcode) {
+    const OpcodeInfo& info = opcode_info(opcode);
+    if (!info.valid) {
+        throw std::invalid_argument("Invalid opcode for instruction category");
+    }
+    return info.category;
+}
+
+// Function to get control word based on opcode
+inline uint16_t get_control_word(uint8_t opcode) { return opcode_info(opcode).control_word; }
+
 // Helper functions for control flow instructions
 inline bool is_branch_instruction(uint8_t opcode) {
-    return opcode == opcode::BZ || opcode == opcode::BEQ;
+    return (opcode_info(opcode).control_word & control::BRANCH) != 0;
 }
 
-inline bool is_jump_instruction(uint8_t opcode) { return opcode == opcode::JR; }
+inline bool is_jump_instruction(uint8_t opcode) {
+    return (opcode_info(opcode).control_word & control::JUMP) != 0;
+}
 
 inline bool is_memory_instruction(uint8_t opcode) {
-    return opcode == opcode::LDW || opcode == opcode::STW;
+    return (opcode_info(opcode).control_word & (control::MEM_READ | control::MEM_WRITE)) != 0;
 }
 inline bool is_halt_instruction(uint32_t instruction) {
     return get_opcode(instruction) == opcode::HALT;
@@ -5,56 +5,265 @@
  * This module provides an abstraction for memory operations in a MIPS processor
  * simulation. It handles reading from and writing to memory, with support for
  * program counter operations (read next instruction, jump) and general memory
- * access. The memory contents are stored in a vector for fast access, with the
- * ability to read from an input file and write to an output file.
+ * access. The memory contents are stored in a PagedMemory (MemoryParser) or a
+ * FlatMemory (FlatMemoryParser), with the ability to read from an input file and
+ * write to an output file.
  *
- * Memory is word-addressable (4 bytes per word) with a maximum size of 4 KiB.
- * The class provides bounds checking, alignment validation, and dynamic vector
- * expansion as needed.
+ * Memory is word-addressable (4 bytes per word) and spans the full 32-bit address
+ * space. Pages are only allocated when written, so reading untouched memory returns
+ * zero without using any. The class provides alignment validation and tracks how far
+ * into memory the program has written, which bounds instruction fetch and the dump.
+ *
+ * The loaded image is also predecoded once into a ProgramImage so the simulator
+ * can fetch decoded instructions directly. Stores invalidate the matching entry.
  *
  */
 
 #pragma once
 #include <cstdint>
+#include <future>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "dirty_page_map.h"
+#include "flat_memory.h"
+#include "hex_image.h"
 #include "memory_interface.h"
 #include "mips_lite_defs.h"
+#include "paged_memory.h"
+#include "program_image.h"
 
 constexpr uint32_t ADDR_TO_INDEX(uint32_t addr) { return (addr >> 2); }
 constexpr uint32_t INDEX_TO_ADDR(uint32_t index) { return (index << 2); }
-constexpr uint32_t MAX_MEMORY_SIZE = 4096;  // Maximum memory size in bytes (4 KiB)
-constexpr uint32_t MAX_VEC_SIZE = (MAX_MEMORY_SIZE / mips_lite::WORD_SIZE);
+constexpr uint64_t MAX_MEMORY_SIZE = 1ull << 32;  // Maximum memory size in bytes (4 GiB)
+constexpr uint32_t MAX_VEC_SIZE = static_cast<uint32_t>(MAX_MEMORY_SIZE / mips_lite::WORD_SIZE);
+
+class BinaryImage;
+
+/// What the output file holds
+enum class OutputFormat {
+    FULL,   ///< Every word reached, one 8-digit hex word per line, as in the input, then
+            ///< "ADDRESS: VALUE" for every word of the pages stored to beyond them, which
+            ///< loading the dump places back at their addresses
+    DIRTY,  ///< "ADDRESS: VALUE" for every word of the pages stored to
+    DIFF    ///< "ADDRESS: VALUE" for every word that differs from the input image
+};
 
-class MemoryParser : public IMemoryParser {
+/**
+ * @brief Word-addressed memory loaded from a hex image.
+ *
+ * The class is final and its accessors are defined inline, so code that holds a MemoryParser
+ * (rather than an IMemoryParser) gets them inlined with a single bounds check: an access that
+ * is word aligned and inside the words reached so far is served directly from the storage,
+ * and everything else (extending that range, errors) goes through an out-of-line slow path.
+ *
+ * The words reached so far are those loaded from the file, extended by stores at or just past
+ * their end: up to the highest word stored to, as long as it is in the page holding the first
+ * word not reached or the one after. Reads never extend them. A store further out leaves them
+ * alone and records its page as a far page instead, so a store to the top of memory or a stack
+ * far from the image costs a page, not a dump of every word in between. Instruction fetch is
+ * limited to the words reached and the far pages. The words reached are dumped to the output
+ * file one line per word, as in the input, followed by the words of the far pages.
+ *
+ * Every store also marks its page in a DirtyPageMap, so the pages changed since the image was
+ * loaded can be enumerated without scanning memory. Dump lines are fixed width, so once the
+ * output file has been written, later dumps only rewrite the dirty pages in place and append
+ * the words reached since.
+ *
+ * Dumps are formatted into one buffer and written with a few large writes. Besides the full
+ * dump, the output can list only the words of the dirty pages, or only the words that differ
+ * from the input image (see OutputFormat), both as "ADDRESS: VALUE" lines. The input image is
+ * kept for the diff: shared between copies for a hex trace, mapped in place for a binary one.
+ * writeOutputFileAsync() formats the dump and leaves the write to a background thread, which
+ * the next dump or the destructor waits for.
+ *
+ * @tparam Storage Where the words live: PagedMemory (a page table, copyable) or FlatMemory (one
+ *         host mapping of the whole address space, so a hit is a single base + offset access).
+ */
+template <typename Storage>
+class BasicMemoryParser final : public IMemoryParser {
    private:
     std::string input_filename_;            // Input file to read from
     std::string output_filename_;           // Output file to write to
-    std::vector<uint32_t> memory_content_;  // Vector to store file content
-    uint32_t current_line_count_;
-    // uint32_t program_counter_;
+    Storage memory_;                        // Memory content, committed a page at a time
+    uint32_t current_line_count_ = 0;       // Words reached so far (lines of the dump)
+    DirtyPageMap dirty_pages_;              // Pages stored to since the load or clearDirtyPages()
+    DirtyPageMap far_pages_;                // Pages stored to beyond the words reached
+    uint32_t dumped_line_count_ = 0;        // Lines in the output file from our last dump, if any
+    ProgramImage program_image_;  // Predecoded copy of the loaded image
     bool modified_;
     bool write_file_on_modified_;  // Flag to track if memory has been modified; if it has
                                    // the destructor will write to the output file
+    OutputFormat output_format_ = OutputFormat::FULL;
 
-    void ensureIndexExists(uint32_t lineNumber);  // Dynamic Vector Allicator
+    // The loaded image, for OutputFormat::DIFF: the words of a hex trace, or the mapped binary
+    // image. Shared so copies of the parser do not copy it.
+    std::shared_ptr<const std::vector<uint32_t>> input_words_;
+    std::shared_ptr<const BinaryImage> input_image_;
+    // The "ADDRESS: VALUE" lines of a hex trace, by address (see hex_image.h)
+    std::shared_ptr<const std::vector<hex_image::PlacedWord>> input_placed_;
+    std::shared_future<void> pending_output_;  // Background write started by the last dump
+
+    /// A formatted dump: text to put at file offsets, in a new file or over the previous dump
+    struct OutputJob {
+        std::string filename;
+        bool in_place = false;  // Patch the existing file rather than replace it
+        std::vector<std::pair<uint64_t, std::string>> pieces;
+    };
+
+    void ensureIndexExists(uint32_t lineNumber);  // Extend the words reached to lineNumber
+    bool isFarPage(uint32_t page) const;          // Far page wholly beyond the words reached
     void writeToFile();
+    OutputJob formatOutput();                 // Format the dump and record it as written
+    static void writeOutput(const OutputJob& job);
+    void loadInput();        // Load input_filename_ into the empty storage
+    void loadBinaryImage();  // Load input_filename_ as a BinaryImage
+
+    // Accesses that are unaligned, out of bounds or beyond the words loaded so far
+    uint32_t readInstructionSlow(uint32_t address);
+    uint32_t readMemorySlow(uint32_t address);
+    void writeMemorySlow(uint32_t address, uint32_t value);
+    mips_lite::TrapCause tryReadInstructionSlow(uint32_t address, uint32_t& word);
+    mips_lite::TrapCause tryReadMemorySlow(uint32_t address, uint32_t& value);
+    mips_lite::TrapCause tryWriteMemorySlow(uint32_t address, uint32_t value);
+
+    // Why an access to address faults, or NONE
+    mips_lite::TrapCause checkInstructionAccess(uint32_t address) const;
+    mips_lite::TrapCause checkDataAccess(uint32_t address) const;
+
+    // Throw the std::runtime_error that reports a fault
+    [[noreturn]] static void throwFault(mips_lite::TrapCause cause, uint32_t address);
 
    public:
-    explicit MemoryParser(const std::string& input_filename,
-                          const std::string& output_filename = "");
-    ~MemoryParser();
+    explicit BasicMemoryParser(const std::string& input_filename,
+                               const std::string& output_filename = "",
+                               Storage storage = Storage());
+    ~BasicMemoryParser();
+
+    /**
+     * @brief Load another image in place of this one, reusing the storage (see the definition).
+     * Simulators built over the parser keep pointing at it, but must be reset before they run
+     * the new image.
+     */
+    void load(const std::string& input_filename, const std::string& output_filename = "");
+
+    // Instruction Access
+    uint32_t readInstruction(uint32_t address) override {
+        uint32_t index = ADDR_TO_INDEX(address);
+        if ((address & 0x3) == 0 && index < current_line_count_) {
+            return memory_.read(address);
+        }
+        return readInstructionSlow(address);
+    }
+
+    // Data Memory Access (both storages read any aligned address, so only alignment is checked)
+    uint32_t readMemory(uint32_t address) override {
+        if ((address & 0x3) == 0) {
+            return memory_.read(address);
+        }
+        return readMemorySlow(address);
+    }
+
+    // Data Memory Access
+    void writeMemory(uint32_t address, uint32_t value) override {
+        uint32_t index = ADDR_TO_INDEX(address);
+        if ((address & 0x3) == 0 && index < current_line_count_) {
+            memory_.write(address, value);
+            program_image_.invalidate(address);  // Stored over a predecoded word
+            dirty_pages_.mark(address);
+            modified_ = true;
+            return;
+        }
+        writeMemorySlow(address, value);
+    }
+
+    // Non-throwing variants, for simulators that model faults as guest traps
+    mips_lite::TrapCause tryReadInstruction(uint32_t address, uint32_t& word) override {
+        uint32_t index = ADDR_TO_INDEX(address);
+        if ((address & 0x3) == 0 && index < current_line_count_) {
+            word = memory_.read(address);
+            return mips_lite::TrapCause::NONE;
+        }
+        return tryReadInstructionSlow(address, word);
+    }
+    mips_lite::TrapCause tryReadMemory(uint32_t address, uint32_t& value) override {
+        if ((address & 0x3) == 0) {
+            value = memory_.read(address);
+            return mips_lite::TrapCause::NONE;
+        }
+        return tryReadMemorySlow(address, value);
+    }
+    mips_lite::TrapCause tryWriteMemory(uint32_t address, uint32_t value) override {
+        uint32_t index = ADDR_TO_INDEX(address);
+        if ((address & 0x3) == 0 && index < current_line_count_) {
+            memory_.write(address, value);
+            program_image_.invalidate(address);
+            dirty_pages_.mark(address);
+            modified_ = true;
+            return mips_lite::TrapCause::NONE;
+        }
+        return tryWriteMemorySlow(address, value);
+    }
 
-    uint32_t readInstruction(uint32_t address) override;          // Instruction Access
-    uint32_t readMemory(uint32_t address) override;               // Data Memory Access
-    void writeMemory(uint32_t address, uint32_t value) override;  // Data Memory Access
     void printMemoryContent();                                    // For debugging
 
+    /**
+     * @brief Write the output file now rather than on destruction. After the first call, only
+     * the dirty pages and the words reached since are rewritten, so the output file must not be
+     * changed by anyone else in between.
+     * @throws std::runtime_error if the output file cannot be written
+     */
+    void writeOutputFile() { writeToFile(); }
+
+    /**
+     * @brief Like writeOutputFile(), but only the formatting happens now: the file is written by
+     * a background thread, so memory can change or the caller can move on meanwhile. The next
+     * dump and the destructor wait for it; waitForOutput() does so explicitly.
+     */
+    void writeOutputFileAsync();
+
+    /**
+     * @brief Wait for a write started by writeOutputFileAsync(), if any.
+     * @throws std::runtime_error if that write failed
+     */
+    void waitForOutput();
+
+    // Pages stored to since the image was loaded or clearDirtyPages() was last called. The
+    // incremental dump relies on them, so clearing them also makes the next dump a full one.
+    const DirtyPageMap& getDirtyPages() const { return dirty_pages_; }
+    void clearDirtyPages() {
+        dirty_pages_.clear();
+        dumped_line_count_ = 0;
+    }
+    const ProgramImage* getProgramImage() const override { return &program_image_; }
+
+    // The image loaded from the input file: its length in words, and its word at index (0 past
+    // the end). Memory differs from it only in the dirty pages.
+    uint32_t getInputImageSize() const;
+    uint32_t getInputWord(uint32_t index) const;
+
+    // Raw access for checkpoints. peekMemory() reads any aligned word; restoreWords() stores
+    // count words from address like writeMemory() (marking their pages dirty) but without
+    // extending the words reached, which reachMemoryElements() does. Pages restored wholly
+    // beyond the words reached become far pages, so reach them first.
+    uint32_t peekMemory(uint32_t address) const { return memory_.read(address & ~0x3u); }
+    void restoreWords(uint32_t address, const uint32_t* words, uint32_t count);
+    void reachMemoryElements(uint32_t count) {
+        if (count != 0) {
+            ensureIndexExists(count - 1);
+        }
+    }
+
     // Getters
     std::string getInputFilename() const { return input_filename_; }
     std::string getOutputFilename() const { return output_filename_; }
-    size_t getNumMemoryElements() const { return memory_content_.size(); }
+    size_t getNumMemoryElements() const { return current_line_count_; }
+    size_t getNumAllocatedPages() const { return memory_.numAllocatedPages(); }
+    size_t getNumFarPages() const { return far_pages_.count(); }
+    OutputFormat getOutputFormat() const { return output_format_; }
+    bool isModified() const { return modified_; }
 
     // Setters
     void setOutputFilename(const std::string& output_filename) {
@@ -63,4 +272,14 @@ class MemoryParser : public IMemoryParser {
         }
     }
     void setOutputFileOnModified(bool mode) { write_file_on_modified_ = mode; }
+    void setOutputFormat(OutputFormat format) { output_format_ = format; }
 };
+
+/// Memory parser over the sparse page table
+using MemoryParser = BasicMemoryParser<PagedMemory>;
+/// Memory parser over a reserved mapping of the whole address space
+using FlatMemoryParser = BasicMemoryParser<FlatMemory>;
+
+// Instantiated in mips_mem_parser.cpp
+extern template class BasicMemoryParser<PagedMemory>;
+extern template class BasicMemoryParser<FlatMemory>;
@@ -0,0 +1,108 @@
+/**
+ * @file paged_memory.h
+ * @brief Sparse word storage covering the full 32-bit address space.
+ *
+ * PagedMemory splits the address space into 4 KiB pages that are allocated on the first write
+ * to them. A flat table with one pointer per page (2^20 entries) maps an address to its page,
+ * so every access is a single table lookup. Pages that were never written have a null entry
+ * and read as zero without being allocated.
+ *
+ * The table itself is obtained with calloc, so the operating system only backs the parts of
+ * it that are touched: memory use stays proportional to the pages in use, not to the 8 MiB
+ * the table spans.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "mips_lite_defs.h"
+
+/**
+ * @class PagedMemory
+ * @brief Lazily allocated, page-granular memory of 32-bit words.
+ *
+ * Addresses passed to read() and write() must be word aligned; checking that (and reporting
+ * faults) is left to the caller, which already does it for its own error handling.
+ */
+class PagedMemory {
+   public:
+    /// log2 of the page size
+    static constexpr uint32_t PAGE_SHIFT = 12;
+    /// Bytes per page (4 KiB)
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+    /// Words per page
+    static constexpr uint32_t PAGE_WORDS = PAGE_SIZE / mips_lite::WORD_SIZE;
+    /// Pages in the 32-bit address space
+    static constexpr uint32_t NUM_PAGES = 1u << (32 - PAGE_SHIFT);
+
+    PagedMemory();
+    PagedMemory(const PagedMemory& other);
+    PagedMemory& operator=(const PagedMemory& other);
+    PagedMemory(PagedMemory&&) noexcept = default;
+    PagedMemory& operator=(PagedMemory&&) noexcept = default;
+    ~PagedMemory() = default;
+
+    /**
+     * @brief Read the word at an address.
+     * @param address Word-aligned byte address.
+     * @return The word, or 0 if its page has never been written.
+     */
+    uint32_t read(uint32_t address) const {
+        const uint32_t* page = table_[address >> PAGE_SHIFT];
+        return page != nullptr ? page[wordInPage(address)] : 0;
+    }
+
+    /**
+     * @brief Write the word at an address, allocating its page if needed.
+     * @param address Word-aligned byte address.
+     * @param value Word to store.
+     */
+    void write(uint32_t address, uint32_t value) {
+        uint32_t* page = table_[address >> PAGE_SHIFT];
+        if (page == nullptr) {
+            page = allocatePage(address >> PAGE_SHIFT);
+        }
+        page[wordInPage(address)] = value;
+    }
+
+    /**
+     * @brief Get the words of a page.
+     * @param page_number Page number (address >> PAGE_SHIFT).
+     * @return PAGE_WORDS words, or nullptr if the page has never been written.
+     */
+    const uint32_t* page(uint32_t page_number) const { return table_[page_number]; }
+
+    /// Numbers of the allocated pages, in the order they were allocated.
+    const std::vector<uint32_t>& allocatedPages() const { return page_numbers_; }
+
+    /// Number of allocated pages.
+    size_t numAllocatedPages() const { return pages_.size(); }
+
+    /// Release every page; all of memory reads as zero again.
+    void clear();
+
+    /// Like clear(), but the pages are kept and handed out again, zeroed, by later writes before
+    /// any new page is allocated. For reloading the same kind of image over and over.
+    void reset();
+
+   private:
+    struct FreeTable {
+        void operator()(uint32_t** table) const { std::free(table); }
+    };
+
+    static uint32_t wordInPage(uint32_t address) {
+        return (address & (PAGE_SIZE - 1)) >> 2;
+    }
+
+    // Allocate a zeroed page and enter it in the table
+    uint32_t* allocatePage(uint32_t page_number);
+
+    std::unique_ptr<uint32_t*[], FreeTable> table_;  // NUM_PAGES entries, null if unallocated
+    std::vector<std::unique_ptr<uint32_t[]>> pages_;  // Owned pages, in allocation order
+    std::vector<uint32_t> page_numbers_;              // Page number of each entry of pages_
+    std::vector<std::unique_ptr<uint32_t[]>> spare_pages_;  // Kept by reset(), not zeroed yet
+};
@@ -0,0 +1,97 @@
+/**
+ * @file program_image.h
+ * @brief Predecoded instruction image for the MIPS-lite simulator.
+ *
+ * The ProgramImage decodes every word of a loaded memory image once, at load time, into a
+ * dense array of compact DecodedOp entries indexed by (address >> 2). The fetch stage can then
+ * pick up an already decoded instruction instead of re-extracting its fields on every pass
+ * through a loop.
+ *
+ * Since MIPS-lite programs may store into their own text, a store that hits a predecoded word
+ * must call invalidate() on it. Invalidated entries are no longer returned by lookup(), so the
+ * caller falls back to reading and decoding the current word from memory.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mips_lite_defs.h"
+
+/**
+ * @struct DecodedOp
+ * @brief Compact, fully decoded form of a single instruction word (16 bytes).
+ */
+struct DecodedOp {
+    uint32_t word;          ///< Raw instruction word
+    int32_t immediate;      ///< Sign-extended immediate (0 for R-type)
+    uint16_t control_word;  ///< Control signals from mips_lite::get_control_word()
+    uint8_t opcode;         ///< Opcode field
+    uint8_t rs;             ///< Source register
+    uint8_t rt;             ///< Target register or second source register
+    uint8_t rd;             ///< Destination register (R-type only, 0 otherwise)
+    bool r_type;            ///< True if the instruction uses the R-type format
+    bool valid;             ///< False once a store has overwritten the word
+};
+
+/**
+ * @class ProgramImage
+ * @brief Dense array of predecoded instructions indexed by PC >> 2.
+ */
+class ProgramImage {
+   public:
+    ProgramImage() = default;
+
+    /**
+     * @brief Predecode a memory image.
+     * @param words Memory words, where words[i] lives at address i * 4.
+     */
+    explicit ProgramImage(const std::vector<uint32_t>& words);
+
+    /**
+     * @brief Predecode the first count words of a memory image.
+     * @param words Memory words, where words[i] lives at address i * 4.
+     * @param count Number of words.
+     */
+    ProgramImage(const uint32_t* words, size_t count);
+
+    /**
+     * @brief Decode a single instruction word.
+     * @param word Instruction word.
+     * @return DecodedOp with valid set.
+     */
+    static DecodedOp decode(uint32_t word);
+
+    /**
+     * @brief Look up the predecoded instruction at an address.
+     * @param address Byte address of the instruction.
+     * @return Pointer to the decoded op, or nullptr if the address is unaligned, outside of the
+     * image, or the entry has been invalidated by a store.
+     */
+    const DecodedOp* lookup(uint32_t address) const {
+        uint32_t index = address >> 2;
+        if ((address & 0x3) != 0 || index >= ops_.size() || !ops_[index].valid) {
+            return nullptr;
+        }
+        return &ops_[index];
+    }
+
+    /**
+     * @brief Invalidate the entry covering an address after it has been written.
+     * @param address Byte address that was stored to. Addresses outside the image are ignored.
+     */
+    void invalidate(uint32_t address) {
+        uint32_t index = address >> 2;
+        if (index < ops_.size()) {
+            ops_[index].valid = false;
+        }
+    }
+
+    /// Number of words covered by the image.
+    size_t size() const { return ops_.size(); }
+
+   private:
+    std::vector<DecodedOp> ops_;
+};
@@ -16,4 +16,7 @@ class RegisterFile {
             registers[reg] = value;
         }
     }
+
+    // Raw register storage for generated code, which must never write R0
+    inline uint32_t* data() { return registers; }
 };
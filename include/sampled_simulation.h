@@ -0,0 +1,122 @@
+/**
+ * @file sampled_simulation.h
+ * @brief SimPoint-style sampled simulation: estimates the pipeline timing of a long program by
+ * simulating only a few representative stretches of it cycle by cycle.
+ *
+ * The estimate is made in three steps:
+ *
+ *   1. Profile: the program runs once on the FastSimulator, split into intervals of a fixed
+ *      number of instructions, and a basic-block vector (instructions retired per block) is
+ *      collected for each.
+ *   2. Cluster: the vectors are normalized, reduced to a few dimensions by a fixed random
+ *      projection and grouped with k-means, trying every cluster count up to a maximum and
+ *      keeping the smallest whose Bayesian information criterion scores close to the best. The
+ *      interval closest to each cluster centre represents the cluster.
+ *   3. Simulate: a second fast run stops ahead of each representative, and the
+ *      FunctionalSimulator takes over from a copy of that state for a warm-up window followed by
+ *      the interval itself. Only the interval's cycles and stalls are kept, so the cold start of
+ *      the pipeline is not counted against it.
+ *
+ * Whole-program cycles and stalls are then extrapolated from each representative's CPI and
+ * stalls per instruction, weighted by the instructions its cluster covers. Everything is
+ * deterministic for a given configuration, seed included.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+
+namespace sampling {
+
+/// Cycles a full run spends on top of one per retired instruction at the pipeline's best
+/// throughput: the first instruction retires only after filling the other stages
+constexpr uint64_t PIPELINE_FILL_CYCLES = 4;
+
+/// Settings of a sampled simulation
+struct Config {
+    uint64_t interval_length = 100000;       ///< Instructions per interval
+    uint64_t warmup_length = 1000;           ///< Instructions simulated before a sample counts
+    uint32_t max_clusters = 10;              ///< Most representative intervals to simulate
+    uint32_t dimensions = 15;                ///< Dimensions block vectors are projected to
+    double bic_threshold = 0.9;              ///< Fraction of the best BIC score a k needs
+    uint64_t max_instructions = UINT64_MAX;  ///< Instructions to profile at most
+    bool forwarding = false;                 ///< Simulate the pipeline with data forwarding
+    uint64_t seed = 1;                       ///< Seed of the projection and of k-means
+};
+
+/// Instructions retired per block, keyed as in a BlockProfile, in ascending PC order
+using BlockVector = std::vector<std::pair<uint32_t, uint64_t>>;
+
+/// One interval of the profile
+struct Interval {
+    uint64_t first_instruction;  ///< Instructions retired before it
+    uint64_t num_instructions;   ///< Its length; less than the interval length only at the end
+    BlockVector blocks;
+};
+
+/// The profiling run
+struct Profile {
+    std::vector<Interval> intervals;
+    uint64_t total_instructions = 0;
+    bool halted = false;   ///< False if max_instructions ran out first or the program trapped
+    mips_lite::Trap trap;  ///< Trap that ended the program, with cause NONE if there was none
+};
+
+/// Grouping of the intervals
+struct Clustering {
+    std::vector<uint32_t> assignment;     ///< Cluster of each interval
+    std::vector<size_t> representatives;  ///< Interval representing each cluster
+};
+
+/// One representative interval, simulated cycle by cycle
+struct Sample {
+    size_t interval;               ///< Index into Profile::intervals
+    double weight;                 ///< Fraction of all instructions its cluster covers
+    uint64_t warmup_instructions;  ///< Instructions simulated before it, not counted
+    uint64_t instructions;         ///< Instructions measured
+    uint64_t clock_cycles;         ///< Cycles they took
+    uint64_t stalls;               ///< Stall cycles among them
+};
+
+/// Result of a sampled simulation
+struct Estimate {
+    uint64_t total_instructions = 0;
+    double clock_cycles = 0;  ///< Estimated cycles of a full FunctionalSimulator run
+    double stalls = 0;        ///< Estimated stalls of a full run
+    double cpi = 0;           ///< Estimated cycles per instruction, pipeline fill excluded
+    bool halted = false;      ///< False if the profile stopped at max_instructions or a trap
+    mips_lite::Trap trap;     ///< Trap that ended the program, with cause NONE if there was none
+    size_t num_intervals = 0;
+    /// Instructions simulated cycle by cycle, warm-ups included
+    uint64_t detailed_instructions = 0;
+    std::vector<Sample> samples;
+};
+
+/**
+ * @brief Run the program on the FastSimulator and collect a block vector per interval.
+ * @param image Parser loaded with the program; it is copied, not run. A guest fault ends the
+ * profile and is returned in Profile::trap.
+ * @throws std::invalid_argument if the configuration is invalid.
+ */
+Profile profile(const MemoryParser& image, const Config& config);
+
+/**
+ * @brief Group intervals with similar block vectors and pick a representative for each group.
+ * @throws std::invalid_argument if the configuration is invalid.
+ */
+Clustering cluster(const std::vector<Interval>& intervals, const Config& config);
+
+/**
+ * @brief Estimate the pipeline timing of a whole program from representative intervals.
+ * @param image Parser loaded with the program; it is copied, not run. A guest fault ends the
+ * estimate at the trapping instruction and is returned in Estimate::trap.
+ * @throws std::invalid_argument if the configuration is invalid.
+ */
+Estimate estimate(const MemoryParser& image, const Config& config);
+
+}  // namespace sampling
@@ -4,18 +4,24 @@
  *        for a MIPS-lite instruction-level simulator.
  *
  * The Stats class provides counters and tracking mechanisms for:
- * - Instruction categories executed
+ * - Instructions executed, per category and per opcode
  * - Registers and memory addresses accessed
  * - Pipeline stalls, clock cycles, and data hazards
+ *
+ * Every update is constant time: counters live in fixed arrays indexed by category or opcode,
+ * written registers in a 32-bit mask, and written memory words in a bitmap allocated 4 KiB of
+ * address space at a time. All counters are 64-bit.
  */
 
 #ifndef STATS_H
 #define STATS_H
 
+#include <array>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "mips_lite_defs.h"
 
@@ -28,24 +34,61 @@
  */
 class Stats {
    public:
+    /// Number of instruction categories (mips_lite::InstructionCategory values).
+    static constexpr int NUM_CATEGORIES = 4;
+
+    /// Number of opcodes (the 6-bit opcode field).
+    static constexpr int NUM_OPCODES = mips_lite::NUM_OPCODES;
+
     /// Constructs a Stats object and initializes all counters.
     Stats();
 
     /// Increments the count for a specific instruction category.
-    void incrementCategory(mips_lite::InstructionCategory category);
+    void incrementCategory(mips_lite::InstructionCategory category) {
+        ++instructionCounts[static_cast<int>(category)];
+    }
+
+    /// Adds `count` instructions to a specific instruction category.
+    void incrementCategory(mips_lite::InstructionCategory category, uint64_t count) {
+        instructionCounts[static_cast<int>(category)] += count;
+    }
 
     /// Returns the number of instructions seen for a given category.
-    uint32_t getCategoryCount(mips_lite::InstructionCategory category) const;
+    uint64_t getCategoryCount(mips_lite::InstructionCategory category) const;
 
     /// Returns the total number of instructions recorded across all categories.
-    uint32_t totalInstructions() const;
+    uint64_t totalInstructions() const;
+
+    /**
+     * @brief Increments the count for a specific opcode. Independent of the category counts:
+     * a simulator that tracks both calls incrementCategory() as well. Only the pipelined
+     * FunctionalSimulator records opcodes; the fast engines count categories only.
+     */
+    void incrementOpcode(uint8_t opcode) { ++opcodeCounts[opcode & (NUM_OPCODES - 1)]; }
+
+    /// Adds `count` instructions with a specific opcode.
+    void incrementOpcode(uint8_t opcode, uint64_t count) {
+        opcodeCounts[opcode & (NUM_OPCODES - 1)] += count;
+    }
+
+    /// Returns the number of instructions seen with a given opcode.
+    uint64_t getOpcodeCount(uint8_t opcode) const;
 
     /// Tracks a register that was accessed during execution.
-    void addRegister(uint8_t reg);
+    void addRegister(uint8_t reg) { registerMask |= 1u << (reg & 31); }
+
+    /// Tracks every register whose bit is set in `mask` (bit n for Rn).
+    void addRegisters(uint32_t mask) { registerMask |= mask; }
+
+    /// Returns the registers accessed so far as a mask (bit n for Rn).
+    uint32_t getRegisterMask() const { return registerMask; }
 
     /// Tracks a memory address that was accessed during execution.
     void addMemoryAddress(uint32_t addr);
 
+    /// Returns true if addMemoryAddress() was called with `addr`.
+    bool hasMemoryAddress(uint32_t addr) const;
+
     /// Returns the set of registers accessed so far.
     const std::unordered_set<uint8_t>& getRegisters() const;
 
@@ -53,41 +96,94 @@ class Stats {
     const std::unordered_set<uint32_t>& getMemoryAddresses() const;
 
     /// Increments the pipeline stall count.
-    void incrementStalls();
+    void incrementStalls() { ++stalls; }
+
+    /// Adds `count` stall cycles.
+    void incrementStalls(uint64_t count) { stalls += count; }
 
     /// Increments the total clock cycle count.
-    void incrementClockCycles();
+    void incrementClockCycles() { ++clockCycles; }
+
+    /// Adds `count` clock cycles.
+    void incrementClockCycles(uint64_t count) { clockCycles += count; }
 
     /// Increments the count of data hazards encountered.
-    void incrementDataHazards();
+    void incrementDataHazards() { ++dataHazards; }
+
+    /// Adds `count` data hazards.
+    void incrementDataHazards(uint64_t count) { dataHazards += count; }
 
     /// Returns the number of recorded stalls.
-    uint32_t getStalls() const;
+    uint64_t getStalls() const { return stalls; }
 
     /// Returns the total number of clock cycles.
-    uint32_t getClockCycles() const;
+    uint64_t getClockCycles() const { return clockCycles; }
 
     /// Returns the number of data hazards recorded.
-    uint32_t getDataHazards() const;
+    uint64_t getDataHazards() const { return dataHazards; }
 
     /// Computes the average number of stalls per data hazard.
     float averageStallsPerHazard() const;
 
-   private:
-    std::unordered_map<mips_lite::InstructionCategory, uint32_t> instructionCounts;
-
-    // The following 2 attributes (registers and memoryAddresses) use the unordered_set type
-    // in order to prevent duplication of values, since we only need to know which registers
-    // and memory addresses have ever been changed throughout the run of the program.
-    // Tracks all registers that have been accessed by an instruction.
-    std::unordered_set<uint8_t> registers;
+    /// Adds the counts, registers and memory addresses of another Stats, e.g. to total up the
+    /// parts of a run that were recorded separately.
+    void merge(const Stats& other);
 
-    // Tracks all memory addresses that have been accessed by an instruction.
-    std::unordered_set<uint32_t> memoryAddresses;
+   private:
+    /// Words of memory covered by one bitmap page (4 KiB of address space)
+    static constexpr uint32_t PAGE_SHIFT = 12;
+    static constexpr uint32_t WORDS_PER_PAGE = 1u << (PAGE_SHIFT - 2);
+    using PageBits = std::array<uint64_t, WORDS_PER_PAGE / 64>;
+
+    std::array<uint64_t, NUM_CATEGORIES> instructionCounts{};
+    std::array<uint64_t, NUM_OPCODES> opcodeCounts{};
+
+    // Registers that have been written, bit n for Rn
+    uint32_t registerMask = 0;
+
+    // Memory words that have been written: one bit per aligned word, in pages allocated on
+    // first use. memoryPageSlots maps a page number to its index in memoryPages, and the page
+    // of the previous access is remembered so runs of stores to one page skip the lookup.
+    std::unordered_map<uint32_t, uint32_t> memoryPageSlots;
+    std::vector<PageBits> memoryPages;
+    uint32_t lastPageNumber = UINT32_MAX;
+    uint32_t lastPageSlot = 0;
+
+    // Addresses that are not word aligned are kept as they are (nothing in the simulator
+    // produces them, but callers may record any address)
+    std::unordered_set<uint32_t> unalignedAddresses;
+
+    // The sets returned by getRegisters() and getMemoryAddresses(), rebuilt on demand from
+    // the mask and bitmap after they have changed
+    mutable std::unordered_set<uint8_t> registers;
+    mutable uint32_t registersBuiltFrom = 0;
+    mutable std::unordered_set<uint32_t> memoryAddresses;
+    mutable bool memoryAddressesStale = false;
+
+    uint64_t stalls = 0;
+    uint64_t clockCycles = 0;
+    uint64_t dataHazards = 0;
+};
 
-    uint32_t stalls;
-    uint32_t clockCycles;
-    uint32_t dataHazards;
+/**
+ * @brief Stats sink with the same update methods as Stats that discards everything, for
+ * simulations where nobody reads the statistics. Code templated on the sink type compiles
+ * every update away when instantiated with NullStats.
+ */
+struct NullStats {
+    void incrementCategory(mips_lite::InstructionCategory) {}
+    void incrementCategory(mips_lite::InstructionCategory, uint64_t) {}
+    void incrementOpcode(uint8_t) {}
+    void incrementOpcode(uint8_t, uint64_t) {}
+    void addRegister(uint8_t) {}
+    void addRegisters(uint32_t) {}
+    void addMemoryAddress(uint32_t) {}
+    void incrementStalls() {}
+    void incrementStalls(uint64_t) {}
+    void incrementClockCycles() {}
+    void incrementClockCycles(uint64_t) {}
+    void incrementDataHazards() {}
+    void incrementDataHazards(uint64_t) {}
 };
 
 #endif  // STATS_H
@@ -0,0 +1,87 @@
+/**
+ * @file timing_model.h
+ * @brief Analytic cycle and stall model for the 5-stage MIPS-lite pipeline.
+ *
+ * Instead of stepping every stage on every clock, the TimingModel derives the cycle in which
+ * each instruction enters EX from the committed instruction stream alone. Instruction j leaves
+ * decode one cycle after the previous instruction did, two cycles later if the previous one was
+ * a taken branch or jump (the wrong-path fetch is flushed), and never while it would stall:
+ *
+ * - Without forwarding, decode waits until every producer of a source register has left MEM,
+ *   i.e. it decodes no earlier than two cycles after the producer's EX cycle.
+ * - With forwarding, only a load in EX stalls a dependent instruction, for one cycle.
+ *
+ * These are the rules of FunctionalSimulator::detectStalls(), so for the same instruction
+ * stream the model reproduces its clock-cycle and stall counts exactly. The program ends two
+ * cycles after the last instruction (the HALT, or a taken branch with a HALT behind it) left EX.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "mips_lite_defs.h"
+#include "program_image.h"
+
+/**
+ * @class TimingModel
+ * @brief Computes pipeline clock cycles and stalls from retired instructions.
+ */
+class TimingModel {
+   public:
+    /**
+     * @brief Construct a model for a pipeline that is about to fetch its first instruction.
+     * @param enable_forwarding Model the pipeline with data forwarding.
+     */
+    explicit TimingModel(bool enable_forwarding = false) : forward(enable_forwarding) {}
+
+    bool isForwardingEnabled() const { return forward; }
+
+    /**
+     * @brief Account for the next instruction of the committed stream.
+     * @param op The instruction.
+     * @param taken True if it is a branch or jump that redirected fetch.
+     */
+    void retire(const DecodedOp& op, bool taken) {
+        const mips_lite::OpcodeInfo& info = mips_lite::opcode_info(op.opcode);
+        uint64_t decode = next_decode;
+        uint64_t ready = register_ready[op.rs];
+        if (info.reads_rt) {
+            ready = ready > register_ready[op.rt] ? ready : register_ready[op.rt];
+        }
+        if (ready > decode) {
+            stall_cycles += ready - decode;
+            decode = ready;
+        }
+        uint64_t execute = decode + 1;
+
+        // Writes to R0 never cause a hazard
+        if (info.writes_reg) {
+            uint8_t dest = op.r_type ? op.rd : op.rt;
+            if (dest != 0) {
+                // With forwarding a reader can decode latency - 1 cycles after the producer's EX
+                // cycle: in that same cycle for ALU results, one cycle later for loads
+                register_ready[dest] = forward ? execute + info.latency - 1 : execute + 2;
+            }
+        }
+
+        next_decode = taken ? execute + 2 : execute;
+        last_execute = execute;
+    }
+
+    /// Clock cycles until the pipeline has drained everything retired so far.
+    uint64_t clockCycles() const { return last_execute == 0 ? 0 : last_execute + 2; }
+
+    /// Stall cycles so far.
+    uint64_t stalls() const { return stall_cycles; }
+
+   private:
+    bool forward;
+    uint64_t next_decode = 2;   // Earliest cycle the next instruction can be in decode
+    uint64_t last_execute = 0;  // EX cycle of the latest instruction, 0 before the first
+    uint64_t stall_cycles = 0;
+
+    /// First cycle in which a reader of each register can decode without stalling
+    std::array<uint64_t, mips_lite::NUM_REGISTERS> register_ready{};
+};
@@ -10,6 +10,8 @@ import argparse
 import sys
 from enum import Enum
 
+from mips_lite_isa import loadISA
+
 
 # Class declaration for instruction types
 class TYPE(Enum):
@@ -57,30 +59,12 @@ class stats:
             f.write("Memory Access Count: " + str(self.memoryAccessCount) + "\n")
 
 
-# ISA Lookup Table
-ISAlist = {
-    # Arithmetic Instructions
-    "ADD": 0b000000,
-    "ADDI": 0b000001,
-    "SUB": 0b000010,
-    "SUBI": 0b000011,
-    "MUL": 0b000100,
-    "MULI": 0b000101,
-    "OR": 0b000110,
-    "ORI": 0b000111,
-    "AND": 0b001000,
-    "ANDI": 0b001001,
-    "XOR": 0b001010,
-    "XORI": 0b001011,
-    # Memory Access Instructions
-    "LDW": 0b001100,
-    "STW": 0b001101,
-    # Control Flow Instructions
-    "BZ": 0b001110,     # Uses 3/4 sections of the instruction
-    "BEQ": 0b001111,
-    "JR": 0b010000,     # Uses 2/4 sections of the instruction
-    "HALT": 0b010001,   # Uses 1/4 sections of the instruction
-}
+# ISA Lookup Table, from include/mips_lite_isa.def
+ISAlist, RTypes = loadISA()
+
+# Region-of-interest markers (mips_lite::roi in include/mips_lite_defs.h): pseudo-instructions
+# for the reserved no-op encodings XORI R0 R0 <immediate>
+ROIMarkers = {"ROI_BEGIN": 4097, "ROI_END": 4098}
 
 
 def twosComp(value, bits):
@@ -110,11 +94,9 @@ def instructtoType(opcode):
             print("Error: Invalid opcode string provided -> " + opcode)
             return -1
 
-    match opString:
-        case "ADD" | "SUB" | "MUL" | "OR" | "AND" | "XOR":
-            return TYPE.R_TYPE
-        case _:
-            return TYPE.I_TYPE
+    if opString in RTypes:
+        return TYPE.R_TYPE
+    return TYPE.I_TYPE
 
 
 # converttoInt - takes in 4-length array and strips any unnecessary characters to convert to int
@@ -196,6 +178,10 @@ def main():
         for index, segment in enumerate(line):
             line[index] = segment.strip()
 
+        # Expand region-of-interest markers into the XORI they are encoded as
+        if line[0] in ROIMarkers:
+            line = ["XORI", "R0", "R0", str(ROIMarkers[line[0]])]
+
         # Determine type of instruction
         check = instructtoType(line[0])
         if check == TYPE.R_TYPE:
@@ -1,31 +1,10 @@
 import argparse
 from enum import Enum
-ISAlist = {
-    # Arithmetic Instructions
-    "ADD"   : 0b000000, 
-    "ADDI"  : 0b000001,  
-    "SUB"   : 0b000010,   
-    "SUBI"  : 0b000011,  
-    "MUL"   : 0b000100,   
-    "MULI"  : 0b000101, 
 
-    "OR"    : 0b000110,
-    "ORI"   : 0b000111,
-    "AND"   : 0b001000,
-    "ANDI"  : 0b001001,
-    "XOR"   : 0b001010,
-    "XORI"  : 0b001011,
+from mips_lite_isa import loadISA
 
-    # Memory Access Instructions
-    "LDW"   : 0b001100,
-    "STW"   : 0b001101,
-
-    # Control Flow Instructions
-    "BZ"    : 0b001110,     # Usess 3/4 sections of the instruction
-    "BEQ"   : 0b001111,
-    "JR"    : 0b010000,     # Uses 2/4 sections of the instruction
-    "HALT"  : 0b010001      # Uses 1/4 sections of the instruction
-}
+# ISA Lookup Table, from include/mips_lite_isa.def
+ISAlist, RTypes = loadISA()
 
 def twosComp(value, bits):
     if (value & (1 << (bits - 1)) != 0):
@@ -119,12 +98,11 @@ def main():
                     case 2:
                         segment = f"Rt: R{int(segment, 2)}" + "\n"
                     case 3:
-                        match currInstruct:
-                            case "ADD" | "SUB" | "MUL" | "OR" | "AND" | "XOR":
-                                segment = f"Rd: R{int(segment[0:5], 2)}" + "\n\n"
-                            case _:
-                                temp = twosComp(int(segment, 2), 16)
-                                segment = f"Immediate: {temp}" + "\n\n"
+                        if currInstruct in RTypes:
+                            segment = f"Rd: R{int(segment[0:5], 2)}" + "\n\n"
+                        else:
+                            temp = twosComp(int(segment, 2), 16)
+                            segment = f"Immediate: {temp}" + "\n\n"
                 wfile.write(segment)
                 
                 
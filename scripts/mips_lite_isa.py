@@ -0,0 +1,33 @@
+"""
+mips_lite_isa.py
+
+Description: Reads the MIPS-lite instruction set from include/mips_lite_isa.def, the same
+description the simulator is built from, so the compiler and decompiler never fall out of
+step with it.
+"""
+
+import os
+import re
+
+ISA_DEF = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "include", "mips_lite_isa.def"
+)
+
+# MIPS_LITE_OPCODE(name, opcode, type, ...)
+_ENTRY = re.compile(r"^MIPS_LITE_OPCODE\(\s*(\w+)\s*,\s*(0b[01]+|0x[0-9a-fA-F]+|\d+)\s*,\s*(\w+)")
+
+
+def loadISA(path=ISA_DEF):
+    """Returns ({name: opcode}, {names of R-type instructions})"""
+    opcodes = {}
+    rTypes = set()
+    with open(path, "r") as f:
+        for line in f:
+            match = _ENTRY.match(line.strip())
+            if match is None:
+                continue
+            name, value, kind = match.groups()
+            opcodes[name] = int(value, 0)
+            if kind == "R_TYPE":
+                rTypes.add(name)
+    return opcodes, rTypes
@@ -0,0 +1,69 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Program Libraries
+#include "aot_translator.h"
+#include "mips_mem_parser.h"
+
+/**
+ * @brief main: ahead-of-time translator from a MIPS-lite memory image to C++
+ * @param -i: The filepath to the input trace file
+ * @param -o: Filename for the generated C++ source, printed to stdout if not passed
+ * @param -n: Program name, the input file stem by default
+ * @param --main: Emit a main() so the source builds into a standalone simulator
+ * @throws std::invalid_arguement if program is passed invalid values
+ */
+int main(int argc, char* argv[]) {
+    std::string input_tracename_, output_filename_;
+    AotOptions options_;
+
+    // Parse Input Arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-i" || arg == "-o" || arg == "-n") {
+            // Check if next arg exists and check if next arg is not an flag
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                throw std::invalid_argument("A value must be provided after " + arg +
+                                            " argument.");
+            }
+            std::string value = argv[++i];
+            if (arg == "-i") {
+                input_tracename_ = value;
+            } else if (arg == "-o") {
+                output_filename_ = value;
+            } else {
+                options_.name = value;
+            }
+        } else if (arg == "--main") {
+            options_.with_main = true;
+        } else {
+            throw std::invalid_argument("Argument \"" + arg +
+                                        "\" to program is invalid, try again.");
+        }
+    }
+
+    if (input_tracename_.empty() || !std::filesystem::exists(input_tracename_)) {
+        throw std::invalid_argument("An existing input file must be provided with -i.");
+    }
+    if (options_.name.empty()) {
+        options_.name = std::filesystem::path(input_tracename_).stem().string();
+    }
+    options_.source_path = std::filesystem::path(input_tracename_).filename().string();
+
+    MemoryParser mp(input_tracename_);
+    std::string source = AotTranslator::translate(*mp.getProgramImage(), options_);
+
+    if (output_filename_.empty()) {
+        std::cout << source;
+        return 0;
+    }
+    std::ofstream out(output_filename_);
+    if (!out) {
+        throw std::runtime_error("Unable to open output file: " + output_filename_);
+    }
+    out << source;
+    return 0;
+}
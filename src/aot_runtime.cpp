@@ -0,0 +1,188 @@
+/**
+ * @file aot_runtime.cpp
+ * @brief Implements the driver for ahead-of-time translated programs.
+ */
+
+#include "aot_runtime.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+
+namespace aot {
+
+namespace {
+std::vector<const Program*>& registry() {
+    static std::vector<const Program*> programs;
+    return programs;
+}
+
+void flush(Context& context, Stats& stats) {
+    for (int i = 0; i < 4; ++i) {
+        if (context.category_counts[i] != 0) {
+            stats.incrementCategory(static_cast<mips_lite::InstructionCategory>(i),
+                                    context.category_counts[i]);
+            context.category_counts[i] = 0;
+        }
+    }
+    stats.addRegisters(context.written_registers);
+    context.written_registers = 0;
+}
+}  // namespace
+
+bool registerProgram(const Program& program) {
+    registry().push_back(&program);
+    return true;
+}
+
+const std::vector<const Program*>& registeredPrograms() { return registry(); }
+
+Result run(const Program& program, RegisterFile& rf, Stats& stats, IMemoryParser& memory,
+           uint64_t max_instructions) {
+    // The blocks are only valid for the image they were translated from. The word behind a
+    // final branch may lie beyond the image, where it was translated as 0.
+    for (uint32_t i = 0; i < program.code_map_size; ++i) {
+        if (!program.code_map[i]) {
+            continue;
+        }
+        uint32_t word = 0;
+        memory.tryReadInstruction(i * 4, word);
+        if (word != program.code_words[i]) {
+            throw std::runtime_error(
+                std::string("Memory image does not match translated program ") + program.name);
+        }
+    }
+
+    Context context;
+    context.regs = rf.data();
+    context.memory = &memory;
+    context.stats = &stats;
+    context.code_map = program.code_map;
+    context.code_map_size = program.code_map_size;
+
+    // Plain interpreter for everything without a block; it always fetches the current words
+    FastSimulator fallback(&rf, &stats, &memory);
+    fallback.setBlockTranslation(false);
+
+    uint32_t pc = 0;
+    try {
+        while (!context.halted && context.retired < max_instructions) {
+            if (!context.code_modified && program.dispatch(context, pc)) {
+                continue;
+            }
+            // No block here, or the translated code is stale: interpret one instruction, or the
+            // rest of the run once code has been modified
+            fallback.setPC(pc);
+            uint64_t budget = context.code_modified ? max_instructions - context.retired : 1;
+            uint64_t interpreted = fallback.getInstructionCount();
+            fallback.run(budget);
+            context.retired += fallback.getInstructionCount() - interpreted;
+            pc = fallback.getPC();
+            if (fallback.isTrapped()) {
+                // The interpreter stopped at the faulting instruction, having counted the others
+                flush(context, stats);
+                return Result{pc, false, context.retired,
+                              mips_lite::trap_cause_name(fallback.getTrap().cause)};
+            }
+            context.halted = fallback.isHalted();
+        }
+    } catch (const std::exception& e) {
+        flush(context, stats);
+        return Result{context.faulted ? context.fault_pc : pc, false, context.retired, e.what()};
+    }
+    flush(context, stats);
+    return Result{pc, context.halted, context.retired, ""};
+}
+
+int standaloneMain(const Program& program, int argc, char* argv[]) {
+    std::string input_tracename, output_tracename;
+    bool enable_mem_save = false;
+    bool enable_mem_print = false;
+    uint64_t max_instructions = 100000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-i" || arg == "-o" || arg == "-l") && i + 1 >= argc) {
+            throw std::invalid_argument("A value must be provided after " + arg + " argument.");
+        }
+        if (arg == "-i") {
+            input_tracename = argv[++i];
+        } else if (arg == "-o") {
+            output_tracename = argv[++i];
+            enable_mem_save = true;
+        } else if (arg == "-l") {
+            max_instructions = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-m") {
+            enable_mem_print = true;
+        } else {
+            throw std::invalid_argument("Argument \"" + arg +
+                                        "\" to program is invalid, try again.");
+        }
+    }
+    if (input_tracename.empty() || !std::filesystem::exists(input_tracename)) {
+        throw std::invalid_argument("An existing input file must be provided with -i.");
+    }
+
+    Stats stats;
+    RegisterFile rf;
+    MemoryParser mp(input_tracename);
+    Result result = run(program, rf, stats, mp, max_instructions);
+    if (!result.trap.empty()) {
+        // As mips_simulator -s, which aborts on a trap by default
+        std::cerr << "Trap: " << result.trap << " at PC " << result.pc << "\n";
+        return 1;
+    }
+    if (!result.halted) {
+        std::cerr << "Simulator did not halt within " << max_instructions << " instructions"
+                  << "\n";
+    }
+
+    if (enable_mem_save) {
+        mp.setOutputFilename(output_tracename);
+        mp.setOutputFileOnModified(true);
+    }
+    if (enable_mem_print) {
+        mp.printMemoryContent();
+    }
+
+    // Same report as mips_simulator -s
+    using mips_lite::InstructionCategory;
+    std::cout << "\nInstruction Counts:\n\n";
+    std::cout << "\tTotal number of instructions:\t" << std::to_string(stats.totalInstructions())
+              << "\n";
+    std::cout << "\tArithmetic instructions:\t"
+              << std::to_string(stats.getCategoryCount(InstructionCategory::ARITHMETIC)) << "\n";
+    std::cout << "\tLogical instructions:\t\t"
+              << std::to_string(stats.getCategoryCount(InstructionCategory::LOGICAL)) << "\n";
+    std::cout << "\tMemory Access instructions:\t"
+              << std::to_string(stats.getCategoryCount(InstructionCategory::MEMORY_ACCESS))
+              << "\n";
+    std::cout << "\tControl Flow instructions:\t"
+              << std::to_string(stats.getCategoryCount(InstructionCategory::CONTROL_FLOW)) << "\n";
+
+    std::cout << "\nFinal Register State:\n\n";
+    std::cout << "\tProgram Counter:\t" << std::to_string(result.pc) << "\n";
+    std::set<uint8_t> registers(stats.getRegisters().begin(), stats.getRegisters().end());
+    for (uint8_t reg : registers) {
+        std::cout << "\tR" << std::to_string(reg) << ": "
+                  << std::to_string(static_cast<int32_t>(rf.read(reg))) << "\n";
+    }
+    std::set<uint32_t> addresses(stats.getMemoryAddresses().begin(),
+                                 stats.getMemoryAddresses().end());
+    for (uint32_t address : addresses) {
+        std::cout << "\tAddress: " << std::to_string(address)
+                  << ", Contents: " << std::to_string(mp.readMemory(address)) << "\n";
+    }
+    return 0;
+}
+
+}  // namespace aot
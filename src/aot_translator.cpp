@@ -0,0 +1,367 @@
+/**
+ * @file aot_translator.cpp
+ * @brief Implements C++ code generation for ahead-of-time translated programs.
+ */
+
+#include "aot_translator.h"
+
+#include <cctype>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "block_translator.h"
+#include "mips_lite_defs.h"
+#include "program_image.h"
+
+namespace {
+
+namespace opcode = mips_lite::opcode;
+
+const char* const MNEMONICS[] = {"ADD", "ADDI", "SUB", "SUBI", "MUL", "MULI",
+                                 "OR",  "ORI",  "AND", "ANDI", "XOR", "XORI",
+                                 "LDW", "STW",  "BZ",  "BEQ",  "JR",  "HALT"};
+
+std::string hex32(uint32_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << std::setw(8) << std::setfill('0') << value << "u";
+    return out.str();
+}
+
+std::string reg(uint8_t index) { return "r[" + std::to_string(index) + "]"; }
+
+std::string blockName(uint32_t pc) {
+    std::ostringstream out;
+    out << "block_" << std::hex << std::setw(8) << std::setfill('0') << pc;
+    return out.str();
+}
+
+/// Assembly-like comment for one instruction
+std::string describe(const BlockInstr& instr) {
+    std::ostringstream out;
+    out << MNEMONICS[instr.opcode];
+    switch (instr.opcode) {
+        case opcode::BZ:
+            out << " R" << int(instr.src1) << " -> " << hex32(instr.imm);
+            break;
+        case opcode::BEQ:
+            out << " R" << int(instr.src1) << " R" << int(instr.src2) << " -> "
+                << hex32(instr.imm);
+            break;
+        case opcode::JR:
+            out << " R" << int(instr.src1);
+            break;
+        case opcode::HALT:
+            break;
+        case opcode::STW:
+            out << " R" << int(instr.src2) << " R" << int(instr.src1) << " " << instr.imm;
+            break;
+        default:
+            if (instr.opcode < block_op::NUM_ALU_OPCODES && instr.opcode % 2 == 0) {
+                out << " R" << int(instr.dest) << " R" << int(instr.src1) << " R"
+                    << int(instr.src2);
+            } else {
+                out << " R" << int(instr.dest) << " R" << int(instr.src1) << " " << instr.imm;
+            }
+            break;
+    }
+    return out.str();
+}
+
+/// Right-hand side of an ALU instruction
+std::string aluExpression(const BlockInstr& instr) {
+    static const char* const OPERATORS[] = {"+", "+", "-", "-", "*", "*",
+                                            "|", "|", "&", "&", "^", "^"};
+    bool r_type = instr.opcode % 2 == 0;
+    std::string operand = r_type ? reg(instr.src2) : hex32(static_cast<uint32_t>(instr.imm));
+    return reg(instr.src1) + " " + OPERATORS[instr.opcode] + " " + operand;
+}
+
+std::string address(const BlockInstr& instr) {
+    return reg(instr.src1) + " + " + hex32(static_cast<uint32_t>(instr.imm));
+}
+
+std::string retireCall(const TranslatedBlock& block, size_t num_ops) {
+    uint64_t counts[4] = {0, 0, 0, 0};
+    uint32_t registers = 0;
+    BlockTranslator::accountPrefix(block, num_ops, counts, registers);
+    std::ostringstream out;
+    out << "c.retire(" << counts[0] << ", " << counts[1] << ", " << counts[2] << ", " << counts[3]
+        << ", " << hex32(registers) << ");";
+    return out.str();
+}
+
+class BlockWriter {
+   public:
+    BlockWriter(const ProgramImage& image, std::ostringstream& out) : image_(image), out_(out) {}
+
+    void write(const TranslatedBlock& block) {
+        body_.str("");
+        writeBody(block);
+        std::string body = body_.str();
+        out_ << "// " << hex32(block.start_pc) << " - " << hex32(block.end_pc) << ", "
+             << block.num_instructions << " instructions\n";
+        out_ << "uint32_t " << blockName(block.start_pc) << "(aot::Context& c) {\n";
+        if (body.find("r[") != std::string::npos) {
+            out_ << "    uint32_t* r = c.regs;\n";
+        }
+        out_ << body << "}\n\n";
+    }
+
+   private:
+    const ProgramImage& image_;
+    std::ostringstream& out_;
+    std::ostringstream body_;
+
+    void writeBody(const TranslatedBlock& block) {
+
+        uint32_t pc = block.start_pc;
+        for (size_t i = 0; i < block.ops.size(); ++i) {
+            const BlockOp& op = block.ops[i];
+            bool last = i + 1 == block.ops.size();
+            if (!last) {
+                statement(op.first, block, i, pc);
+                if (op.length == 2) {
+                    statement(op.second, block, i, pc + 4);
+                }
+                pc += 4 * op.length;
+                continue;
+            }
+
+            // Terminator: everything in the block retires, then pick the next PC
+            const BlockInstr* branch = &op.first;
+            if (op.kind >= block_op::ALU_BZ_BASE) {
+                statement(op.first, block, i, pc);
+                branch = &op.second;
+            }
+            line(retireCall(block, block.ops.size()));
+            terminator(op.kind == block_op::EXIT ? nullptr : branch, block);
+        }
+    }
+
+    void line(const std::string& text, const std::string& comment = "") {
+        body_ << "    " << text;
+        if (!comment.empty()) {
+            body_ << "  // " << comment;
+        }
+        body_ << "\n";
+    }
+
+    /// A straight-line instruction at pc, inside op number op_index of the block
+    void statement(const BlockInstr& instr, const TranslatedBlock& block, size_t op_index,
+                   uint32_t pc) {
+        if (instr.opcode == opcode::LDW) {
+            std::string load = "c.load(" + address(instr) + ")";
+            line("try {");
+            line(instr.dest != 0 ? "    " + reg(instr.dest) + " = " + load + ";"
+                                 : "    " + load + ";",
+                 describe(instr));
+            faultHandler(block, op_index, pc);
+        } else if (instr.opcode == opcode::STW) {
+            line("try {");
+            line("    if (c.store(" + address(instr) + ", " + reg(instr.src2) + ")) {",
+                 describe(instr));
+            // The store changed translated code: stop compiled execution after it
+            line("        " + retireCall(block, op_index + 1));
+            line("        return " + hex32(pc + 4) + ";");
+            line("    }");
+            faultHandler(block, op_index, pc);
+        } else if (instr.dest != 0) {
+            line(reg(instr.dest) + " = " + aluExpression(instr) + ";", describe(instr));
+        } else {
+            line("// " + describe(instr) + " writes R0");
+        }
+    }
+
+    /// Closes the try around a memory access at pc (always an op's first instruction): on a
+    /// fault, the ops before it retire and the PC stops at it
+    void faultHandler(const TranslatedBlock& block, size_t op_index, uint32_t pc) {
+        line("} catch (...) {");
+        line("    " + retireCall(block, op_index));
+        line("    c.faultAt(" + hex32(pc) + ");");
+        line("}");
+    }
+
+    /// The pipeline stops after a taken branch if the word behind it is HALT
+    std::string taken(const TranslatedBlock& block, const std::string& target) {
+        const DecodedOp* behind = image_.lookup(block.end_pc + 4);
+        if (behind && behind->opcode == opcode::HALT) {
+            return "c.haltAt(" + target + ")";
+        }
+        return target;
+    }
+
+    void terminator(const BlockInstr* branch, const TranslatedBlock& block) {
+        std::string fallthrough = hex32(block.end_pc + 4);
+        if (!branch) {
+            line("return " + hex32(block.end_pc) + ";", "continue in the next block");
+            return;
+        }
+        switch (branch->opcode) {
+            case opcode::BZ:
+            case opcode::BEQ: {
+                std::string target = taken(block, hex32(static_cast<uint32_t>(branch->imm)));
+                if (branch->opcode == opcode::BEQ && branch->src1 == branch->src2) {
+                    line("return " + target + ";", describe(*branch) + ", always taken");
+                    break;
+                }
+                std::string condition = branch->opcode == opcode::BZ
+                                            ? reg(branch->src1) + " == 0"
+                                            : reg(branch->src1) + " == " + reg(branch->src2);
+                line("if (" + condition + ") {", describe(*branch));
+                line("    return " + target + ";");
+                line("}");
+                line("return " + fallthrough + ";");
+                break;
+            }
+            case opcode::JR:
+                line("return " + taken(block, reg(branch->src1)) + ";", describe(*branch));
+                break;
+            default:  // HALT
+                line("return c.haltAt(" + fallthrough + ");", describe(*branch));
+                break;
+        }
+    }
+};
+
+/// Static successors of a block; JR targets are resolved at run time
+std::vector<uint32_t> successors(const TranslatedBlock& block) {
+    const BlockOp& last = block.ops.back();
+    const BlockInstr& branch = last.kind >= block_op::ALU_BZ_BASE ? last.second : last.first;
+    if (last.kind == block_op::EXIT) {
+        return {block.end_pc};
+    }
+    if (branch.opcode == opcode::BEQ && branch.src1 == branch.src2) {
+        return {static_cast<uint32_t>(branch.imm)};
+    }
+    if (branch.opcode == opcode::BZ || branch.opcode == opcode::BEQ) {
+        return {static_cast<uint32_t>(branch.imm), block.end_pc + 4};
+    }
+    return {};
+}
+
+/// True if the block ends in BZ or BEQ, whose taken path depends on the word behind the branch
+bool endsInBranch(const TranslatedBlock& block) {
+    const BlockOp& last = block.ops.back();
+    const BlockInstr& branch = last.kind >= block_op::ALU_BZ_BASE ? last.second : last.first;
+    return last.kind != block_op::EXIT &&
+           (branch.opcode == opcode::BZ || branch.opcode == opcode::BEQ);
+}
+
+template <typename T>
+void writeArray(std::ostringstream& out, const char* declaration, const std::vector<T>& values,
+                bool hex) {
+    out << declaration << " = {";
+    for (size_t i = 0; i < values.size(); ++i) {
+        out << (i % 8 == 0 ? "\n    " : " ");
+        if (hex) {
+            out << hex32(static_cast<uint32_t>(values[i]));
+        } else {
+            out << static_cast<uint32_t>(values[i]);
+        }
+        out << ",";
+    }
+    out << "\n};\n\n";
+}
+
+}  // namespace
+
+std::string AotTranslator::identifier(const std::string& name) {
+    std::string id;
+    for (char ch : name) {
+        id += std::isalnum(static_cast<unsigned char>(ch)) ? ch : '_';
+    }
+    if (id.empty() || std::isdigit(static_cast<unsigned char>(id[0]))) {
+        id = "_" + id;
+    }
+    return id;
+}
+
+std::string AotTranslator::translate(const ProgramImage& image, const AotOptions& options) {
+    // Find every block reachable from PC 0 without going through JR
+    BlockTranslator translator(&image);
+    std::map<uint32_t, const TranslatedBlock*> blocks;
+    std::vector<uint32_t> worklist = {0};
+    while (!worklist.empty()) {
+        uint32_t pc = worklist.back();
+        worklist.pop_back();
+        if (blocks.count(pc)) {
+            continue;
+        }
+        const TranslatedBlock* block = translator.lookup(pc);
+        if (!block) {
+            continue;  // Left to the interpreter fallback
+        }
+        blocks[pc] = block;
+        for (uint32_t next : successors(*block)) {
+            worklist.push_back(next);
+        }
+    }
+
+    // Words the blocks were translated from. A taken branch halts if the word behind it is HALT
+    // (see BlockWriter::taken()), so that word is part of the block too: a store into it must
+    // end compiled execution like a store into the block itself.
+    std::vector<uint8_t> code_map(1, 0);
+    for (const auto& entry : blocks) {
+        const TranslatedBlock& block = *entry.second;
+        uint32_t first = block.start_pc >> 2;
+        uint32_t count = block.num_instructions + (endsInBranch(block) ? 1 : 0);
+        if (code_map.size() < first + count) {
+            code_map.resize(first + count, 0);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            code_map[first + i] = 1;
+        }
+    }
+    std::vector<uint32_t> code_words(code_map.size(), 0);
+    for (uint32_t i = 0; i < code_map.size(); ++i) {
+        const DecodedOp* op = image.lookup(i * 4);
+        code_words[i] = op ? op->word : 0;
+    }
+
+    const std::string ns = "aot_" + identifier(options.name);
+    std::ostringstream out;
+    out << "// Generated by mips_aot";
+    if (!options.source_path.empty()) {
+        out << " from " << options.source_path;
+    }
+    out << ". Do not edit.\n";
+    out << "// " << blocks.size() << " basic blocks; see aot_runtime.h.\n\n";
+    out << "#include <cstdint>\n\n#include \"aot_runtime.h\"\n\n";
+    out << "namespace " << ns << " {\nnamespace {\n\n";
+
+    BlockWriter writer(image, out);
+    for (const auto& entry : blocks) {
+        writer.write(*entry.second);
+    }
+
+    out << "bool dispatch(aot::Context& c, uint32_t& pc) {\n";
+    out << "    switch (pc) {\n";
+    for (const auto& entry : blocks) {
+        out << "        case " << hex32(entry.first) << ":\n";
+        out << "            pc = " << blockName(entry.first) << "(c);\n";
+        out << "            return true;\n";
+    }
+    out << "        default:\n";
+    out << "            return false;\n";
+    out << "    }\n}\n\n";
+
+    writeArray(out, "const uint32_t code_words[]", code_words, true);
+    writeArray(out, "const uint8_t code_map[]", code_map, false);
+
+    out << "}  // namespace\n\n";
+    out << "const aot::Program program = {\"" << options.name << "\", &dispatch, code_words, "
+        << "code_map, " << code_map.size() << "};\n";
+    out << "const bool registered = aot::registerProgram(program);\n\n";
+    out << "}  // namespace " << ns << "\n";
+
+    if (options.with_main) {
+        out << "\nint main(int argc, char* argv[]) {\n";
+        out << "    return aot::standaloneMain(" << ns << "::program, argc, argv);\n";
+        out << "}\n";
+    }
+    return out.str();
+}
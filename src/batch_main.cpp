@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Program Libraries
+#include "batch_runner.h"
+
+/**
+ * @brief main: runs many traces on a work-stealing thread pool and prints one line per trace,
+ *          in the order the traces were given, as tab-separated columns: trace, configuration,
+ *          status, instructions, clock cycles, stalls, final PC and the trap or error if any
+ * @param -d: Directory whose files (other than .out dumps) are all run
+ * @param -m: Manifest with one trace per line, followed by its flags; relative paths are
+ *            relative to the manifest
+ * @param -n: Number of worker threads (default: one per hardware thread)
+ * @param -f, -s, -t, -H, -c <budget>: Configuration of every trace, as in mips_simulator;
+ *            manifest lines add their own flags to it
+ * @throws std::invalid_arguement if program is passed invalid values
+ * @return 1 if any trace could not be run, 0 otherwise
+ */
+int main(int argc, char* argv[]) {
+    std::string directory_, manifest_;
+    unsigned threads_ = 0;
+    std::vector<std::string> job_flags_;
+
+    // Parse Input Arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-d" || arg == "-m" || arg == "-n" || arg == "-c") {
+            // Check if next arg exists and check if next arg is not an flag
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                throw std::invalid_argument("A value must be provided after " + arg +
+                                            " argument.");
+            }
+            std::string value = argv[++i];
+            if (arg == "-d") {
+                directory_ = value;
+            } else if (arg == "-m") {
+                manifest_ = value;
+            } else if (arg == "-n") {
+                size_t parsed = 0;
+                unsigned long threads = 0;
+                try {
+                    threads = std::stoul(value, &parsed);
+                } catch (const std::exception&) {
+                    parsed = 0;
+                }
+                if (parsed == 0 || parsed != value.size() || threads == 0 || threads > 1024) {
+                    throw std::invalid_argument("Invalid thread count \"" + value +
+                                                "\" after -n argument.");
+                }
+                threads_ = static_cast<unsigned>(threads);
+            } else {
+                job_flags_.push_back(arg);
+                job_flags_.push_back(value);
+            }
+        } else if (arg == "-f" || arg == "-s" || arg == "-t" || arg == "-H") {
+            job_flags_.push_back(arg);
+        } else {
+            throw std::invalid_argument("Argument \"" + arg +
+                                        "\" to program is invalid, try again.");
+        }
+    }
+
+    if (directory_.empty() == manifest_.empty()) {
+        throw std::invalid_argument("Either a directory (-d) or a manifest (-m) must be given.");
+    }
+
+    batch::Job defaults;
+    batch::parseFlags(job_flags_, defaults);
+    std::vector<batch::Job> jobs = manifest_.empty() ? batch::jobsInDirectory(directory_, defaults)
+                                                     : batch::readManifest(manifest_, defaults);
+
+    // Each line is printed as soon as it and every line before it are known
+    std::cout << "# trace\tconfig\tstatus\tinstructions\tcycles\tstalls\tpc\tmessage\n";
+    auto print = [&jobs](size_t index, const batch::Result& result) {
+        std::string config = batch::describeConfig(jobs[index]);
+        std::cout << jobs[index].trace << "\t" << (config.empty() ? "-" : config) << "\t"
+                  << batch::statusName(result.status) << "\t" << result.instructions << "\t";
+        if (result.timed) {
+            std::cout << result.cycles << "\t" << result.stalls;
+        } else {
+            std::cout << "-\t-";
+        }
+        std::cout << "\t" << result.pc << "\t" << result.message << std::endl;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<batch::Result> results = batch::run(jobs, threads_, print);
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The summary goes to stderr, so stdout stays the same from run to run
+    uint64_t counts[4] = {0, 0, 0, 0};
+    for (const batch::Result& result : results) {
+        ++counts[static_cast<int>(result.status)];
+    }
+    std::cerr << "Ran " << jobs.size() << " traces in " << seconds << " s: " << counts[0]
+              << " halted, " << counts[1] << " out of budget, " << counts[2] << " trapped, "
+              << counts[3] << " failed\n";
+    return counts[static_cast<int>(batch::Result::Status::ERROR)] != 0 ? 1 : 0;
+}
@@ -0,0 +1,400 @@
+/**
+ * @file batch_runner.cpp
+ * @brief Implements batch jobs, the per-worker simulation objects and the work-stealing pool.
+ */
+
+#include "batch_runner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "mips_lite_defs.h"
+
+namespace batch {
+
+namespace {
+
+/// Parse a -c budget, as strictly as mips_simulator does
+uint64_t parseBudget(const std::string& value) {
+    size_t parsed = 0;
+    uint64_t budget = 0;
+    try {
+        budget = std::stoull(value, &parsed);
+    } catch (const std::exception&) {
+        parsed = 0;
+    }
+    if (parsed == 0 || parsed != value.size() || value[0] == '-' || budget == 0) {
+        throw std::invalid_argument("Invalid budget \"" + value + "\" after -c argument.");
+    }
+    return budget;
+}
+
+std::string describeTrap(const mips_lite::Trap& trap) {
+    return std::string(mips_lite::trap_cause_name(trap.cause)) + " at PC " +
+           std::to_string(trap.pc) + ", address " + std::to_string(trap.address);
+}
+
+/// One worker's jobs; the owner and thieves both take from the front
+struct JobQueue {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+};
+
+}  // namespace
+
+void parseFlags(const std::vector<std::string>& args, Job& job) {
+    bool fast = false;
+    bool hybrid = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "-f") {
+            job.forwarding = true;
+        } else if (arg == "-s") {
+            fast = true;
+            job.mode = Mode::FAST;
+        } else if (arg == "-H") {
+            hybrid = true;
+            job.mode = Mode::HYBRID;
+        } else if (arg == "-t") {
+            job.timing = true;
+        } else if (arg == "-c") {
+            if (i + 1 >= args.size()) {
+                throw std::invalid_argument("A value must be provided after -c argument.");
+            }
+            job.budget = parseBudget(args[++i]);
+        } else {
+            throw std::invalid_argument("Argument \"" + arg + "\" is invalid.");
+        }
+    }
+    if (fast && hybrid) {
+        throw std::invalid_argument("-H cannot be combined with -s.");
+    }
+}
+
+std::vector<Job> readManifest(const std::string& path, const Job& defaults) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open manifest: " + path);
+    }
+    const std::filesystem::path base = std::filesystem::path(path).parent_path();
+
+    std::vector<Job> jobs;
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::vector<std::string> args;
+        for (std::string field; fields >> field;) {
+            args.push_back(field);
+        }
+        if (args.empty()) {
+            continue;
+        }
+
+        Job job = defaults;
+        std::filesystem::path trace(args[0]);
+        job.trace = (trace.is_relative() ? base / trace : trace).string();
+        try {
+            parseFlags(std::vector<std::string>(args.begin() + 1, args.end()), job);
+        } catch (const std::invalid_argument& e) {
+            throw std::invalid_argument(path + ":" + std::to_string(line_number) + ": " +
+                                        e.what());
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+std::vector<Job> jobsInDirectory(const std::string& path, const Job& defaults) {
+    std::vector<std::string> traces;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+        // Memory dumps the simulator left next to the traces are not traces themselves
+        if (entry.is_regular_file() && entry.path().extension() != ".out") {
+            traces.push_back(entry.path().string());
+        }
+    }
+    if (error) {
+        throw std::runtime_error("Failed to read directory " + path + ": " + error.message());
+    }
+    std::sort(traces.begin(), traces.end());
+
+    std::vector<Job> jobs;
+    for (const std::string& trace : traces) {
+        Job job = defaults;
+        job.trace = trace;
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+uint64_t expectedCost(const Job& job) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(job.trace, error);
+    if (error) {
+        return 0;  // Fails at once
+    }
+    // Rough cost per instruction of each simulator relative to the fast engine
+    switch (job.mode) {
+        case Mode::PIPELINE:
+            return size * 8;
+        case Mode::HYBRID:
+            return size * 2;
+        case Mode::FAST:
+            break;
+    }
+    return size;
+}
+
+std::string describeConfig(const Job& job) {
+    std::string flags;
+    auto add = [&flags](const std::string& flag) {
+        flags += flags.empty() ? flag : " " + flag;
+    };
+    if (job.mode == Mode::FAST) {
+        add("-s");
+        if (job.timing) {
+            add("-t");
+        }
+    } else if (job.mode == Mode::HYBRID) {
+        add("-H");
+    }
+    if (job.forwarding) {
+        add("-f");
+    }
+    if (job.budget != DEFAULT_BUDGET) {
+        add("-c " + std::to_string(job.budget));
+    }
+    return flags;
+}
+
+const char* statusName(Result::Status status) {
+    switch (status) {
+        case Result::Status::HALTED:
+            return "halted";
+        case Result::Status::BUDGET:
+            return "budget";
+        case Result::Status::TRAPPED:
+            return "trap";
+        case Result::Status::ERROR:
+            return "error";
+    }
+    return "unknown";
+}
+
+Result Worker::run(const Job& job) {
+    try {
+        prepare(job);
+        switch (job.mode) {
+            case Mode::PIPELINE:
+                return runPipeline(job);
+            case Mode::FAST:
+                return runFast(job);
+            case Mode::HYBRID:
+                return runHybrid(job);
+        }
+        throw std::invalid_argument("Invalid simulation mode");
+    } catch (const std::exception& e) {
+        Result result;
+        result.status = Result::Status::ERROR;
+        result.message = e.what();
+        return result;
+    }
+}
+
+void Worker::prepare(const Job& job) {
+    if (memory) {
+        memory->load(job.trace);
+        ++reuses;
+    } else {
+        memory.emplace(job.trace);
+        memory->setOutputFileOnModified(false);
+    }
+    registers = RegisterFile();
+    stats = Stats();
+    roi_stats = Stats();
+}
+
+Result Worker::runPipeline(const Job& job) {
+    if (!pipeline) {
+        pipeline = std::make_unique<FunctionalSimulator>(&registers, &stats, &*memory);
+        initial_state = pipeline->getState();
+    }
+    SimulatorState state = initial_state;
+    state.forward = job.forwarding;
+    pipeline->setState(state);
+
+    FunctionalSimulator::RunResult run = pipeline->run(job.budget);
+    Result result;
+    result.status = Result::Status::BUDGET;
+    if (run.reason == FunctionalSimulator::StopReason::HALTED) {
+        result.status = Result::Status::HALTED;
+    } else if (run.reason == FunctionalSimulator::StopReason::TRAPPED) {
+        result.status = Result::Status::TRAPPED;
+        result.message = describeTrap(pipeline->getTrap());
+    }
+    result.instructions = stats.totalInstructions();
+    result.cycles = stats.getClockCycles();
+    result.stalls = stats.getStalls();
+    result.timed = true;
+    result.pc = pipeline->getPC();
+    return result;
+}
+
+Result Worker::runFast(const Job& job) {
+    if (fast) {
+        fast->reset();
+    } else {
+        fast = std::make_unique<FastSimulator>(&registers, &stats, &*memory);
+    }
+    fast->setTiming(job.timing, job.forwarding);
+
+    fast->run(job.budget);
+    Result result;
+    result.status = Result::Status::BUDGET;
+    if (fast->isHalted()) {
+        result.status = Result::Status::HALTED;
+    } else if (fast->isTrapped()) {
+        result.status = Result::Status::TRAPPED;
+        result.message = describeTrap(fast->getTrap());
+    }
+    result.instructions = stats.totalInstructions();
+    result.cycles = stats.getClockCycles();
+    result.stalls = stats.getStalls();
+    result.timed = job.timing;
+    result.pc = fast->getPC();
+    return result;
+}
+
+Result Worker::runHybrid(const Job& job) {
+    if (hybrid) {
+        hybrid->reset(job.forwarding);
+    } else {
+        hybrid = std::make_unique<HybridSimulator>(&registers, &stats, &roi_stats, &*memory,
+                                                   job.forwarding);
+    }
+
+    hybrid->run(job.budget);
+    Result result;
+    result.status = Result::Status::BUDGET;
+    if (hybrid->isTrapped()) {
+        result.status = Result::Status::TRAPPED;
+        result.message = describeTrap(hybrid->getTrap());
+    } else if (hybrid->isProgramFinished()) {
+        result.status = Result::Status::HALTED;
+    }
+    result.instructions = stats.totalInstructions() + roi_stats.totalInstructions();
+    result.cycles = roi_stats.getClockCycles();
+    result.stalls = roi_stats.getStalls();
+    result.timed = true;
+    result.pc = hybrid->getPC();
+    return result;
+}
+
+std::vector<Result> run(const std::vector<Job>& jobs, unsigned num_threads,
+                        const std::function<void(size_t, const Result&)>& on_result) {
+    std::vector<Result> results(jobs.size());
+    if (jobs.empty()) {
+        return results;
+    }
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t num_workers = std::min<size_t>(num_threads, jobs.size());
+
+    // Longest expected first; equal estimates keep job order, so the schedule is deterministic
+    std::vector<uint64_t> costs(jobs.size());
+    std::vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        costs[i] = expectedCost(jobs[i]);
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+
+    // Dealt round robin, so every deque is in descending order too
+    std::vector<JobQueue> queues(num_workers);
+    for (size_t i = 0; i < order.size(); ++i) {
+        queues[i % num_workers].jobs.push_back(order[i]);
+    }
+
+    // Next job for worker self: its own, else the longest at the front of another deque. No jobs
+    // are added once the pool runs, so finding every deque empty means the batch is done.
+    auto take = [&](size_t self, size_t& job) {
+        {
+            std::lock_guard<std::mutex> lock(queues[self].mutex);
+            if (!queues[self].jobs.empty()) {
+                job = queues[self].jobs.front();
+                queues[self].jobs.pop_front();
+                return true;
+            }
+        }
+        while (true) {
+            size_t victim = num_workers;
+            uint64_t victim_cost = 0;
+            for (size_t i = 1; i < num_workers; ++i) {
+                size_t candidate = (self + i) % num_workers;
+                std::lock_guard<std::mutex> lock(queues[candidate].mutex);
+                const std::deque<size_t>& waiting = queues[candidate].jobs;
+                if (!waiting.empty() &&
+                    (victim == num_workers || costs[waiting.front()] > victim_cost)) {
+                    victim = candidate;
+                    victim_cost = costs[waiting.front()];
+                }
+            }
+            if (victim == num_workers) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(queues[victim].mutex);
+            if (!queues[victim].jobs.empty()) {
+                job = queues[victim].jobs.front();
+                queues[victim].jobs.pop_front();
+                return true;
+            }
+            // Its owner or another thief got there first; look again
+        }
+    };
+
+    // Results are passed on in job order: whoever completes the oldest outstanding job also
+    // reports the finished jobs behind it
+    std::mutex report_mutex;
+    std::vector<bool> finished(jobs.size(), false);
+    size_t next_to_report = 0;
+
+    auto work = [&](size_t self) {
+        Worker worker;
+        size_t job = 0;
+        while (take(self, job)) {
+            results[job] = worker.run(jobs[job]);
+            std::lock_guard<std::mutex> lock(report_mutex);
+            finished[job] = true;
+            for (; next_to_report < jobs.size() && finished[next_to_report]; ++next_to_report) {
+                if (on_result) {
+                    on_result(next_to_report, results[next_to_report]);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_workers; ++i) {
+        threads.emplace_back(work, i);
+    }
+    work(0);  // The calling thread is a worker too
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+}  // namespace batch
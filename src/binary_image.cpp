@@ -0,0 +1,202 @@
+#include "binary_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static_assert(sizeof(BinaryImage::Header) == 32, "Header layout is part of the file format");
+static_assert(sizeof(BinaryImage::Segment) == 16, "Segment layout is part of the file format");
+
+namespace {
+
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+
+uint32_t fnv1a(uint32_t hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/// Checksum of a segment table and the data it points at
+uint32_t checksum(const BinaryImage::Segment* segments, uint32_t num_segments,
+                  const std::vector<const uint32_t*>& data) {
+    uint32_t hash = fnv1a(FNV_OFFSET, segments, num_segments * sizeof(BinaryImage::Segment));
+    for (uint32_t i = 0; i < num_segments; ++i) {
+        if (data[i] != nullptr) {
+            hash = fnv1a(hash, data[i], segments[i].num_words * sizeof(uint32_t));
+        }
+    }
+    return hash;
+}
+
+}  // namespace
+
+BinaryImage::BinaryImage(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open input file: " + path);
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("Invalid binary image " + path + ": truncated header");
+    }
+    void* base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Failed to map input file: " + path);
+    }
+    base_ = static_cast<const char*>(base);
+    size_ = static_cast<size_t>(st.st_size);
+    header_ = reinterpret_cast<const Header*>(base_);
+    segments_ = reinterpret_cast<const Segment*>(base_ + sizeof(Header));
+
+    auto fail = [&](const std::string& reason) {
+        munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        throw std::runtime_error("Invalid binary image " + path + ": " + reason);
+    };
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        fail("bad magic");
+    }
+    if (header_->version != VERSION) {
+        fail("unsupported version " + std::to_string(header_->version));
+    }
+    if (header_->byte_order != BYTE_ORDER_TAG) {
+        fail("written with the other byte order");
+    }
+    if (sizeof(Header) + uint64_t(header_->num_segments) * sizeof(Segment) > size_) {
+        fail("truncated segment table");
+    }
+
+    // Segments must tile [0, num_words) in order, with their data inside the file
+    uint64_t next_word = 0;
+    std::vector<const uint32_t*> data(header_->num_segments);
+    for (uint32_t i = 0; i < header_->num_segments; ++i) {
+        const Segment& segment = segments_[i];
+        if (segment.num_words == 0 || segment.address != next_word * 4) {
+            fail("segment " + std::to_string(i) + " is out of order");
+        }
+        next_word += segment.num_words;
+        if (segment.data_offset != 0) {
+            if (segment.data_offset % DATA_ALIGNMENT != 0 ||
+                segment.data_offset + uint64_t(segment.num_words) * 4 > size_) {
+                fail("segment " + std::to_string(i) + " data is outside the file");
+            }
+            data[i] = this->data(segment);
+        }
+    }
+    if (next_word != header_->num_words) {
+        fail("segments do not cover the image");
+    }
+    if (checksum(segments_, header_->num_segments, data) != header_->checksum) {
+        fail("checksum mismatch");
+    }
+}
+
+BinaryImage::~BinaryImage() {
+    if (base_ != nullptr) {
+        munmap(const_cast<char*>(base_), size_);
+    }
+}
+
+bool BinaryImage::isBinaryImage(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MAGIC)] = {};
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void BinaryImage::write(const std::string& path, const std::vector<uint32_t>& words,
+                        uint32_t min_zero_run) {
+    if (words.size() > (uint64_t(1) << 30)) {
+        throw std::runtime_error("Image exceeds maximum memory size of 4GiB");
+    }
+
+    // Split the words into data segments and zero runs long enough to elide
+    std::vector<Segment> segments;
+    std::vector<const uint32_t*> data;
+    const uint32_t num_words = static_cast<uint32_t>(words.size());
+    uint32_t start = 0;  // First word not yet in a segment
+    uint32_t i = 0;
+    while (i < num_words) {
+        uint32_t run_end = i;
+        while (min_zero_run != 0 && run_end < num_words && words[run_end] == 0) {
+            ++run_end;
+        }
+        if (min_zero_run != 0 && run_end - i >= min_zero_run) {
+            if (start < i) {
+                segments.push_back({start * 4, i - start, 1});  // Offset assigned below
+                data.push_back(&words[start]);
+            }
+            segments.push_back({i * 4, run_end - i, 0});
+            data.push_back(nullptr);
+            start = run_end;
+        }
+        i = std::max(run_end, i + 1);
+    }
+    if (start < num_words) {
+        segments.push_back({start * 4, num_words - start, 1});
+        data.push_back(&words[start]);
+    }
+
+    // Data starts at the first aligned offset after the table, one aligned block per segment
+    auto align = [](uint64_t offset) {
+        return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    };
+    uint64_t offset = align(sizeof(Header) + segments.size() * sizeof(Segment));
+    for (Segment& segment : segments) {
+        if (segment.data_offset != 0) {
+            segment.data_offset = offset;
+            offset = align(offset + uint64_t(segment.num_words) * 4);
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_TAG;
+    header.num_words = num_words;
+    header.num_segments = static_cast<uint32_t>(segments.size());
+    header.checksum = checksum(segments.data(), header.num_segments, data);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open output file for writing: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(segments.data()),
+               static_cast<std::streamsize>(segments.size() * sizeof(Segment)));
+    for (size_t s = 0; s < segments.size(); ++s) {
+        if (data[s] != nullptr) {
+            file.seekp(static_cast<std::streamoff>(segments[s].data_offset));
+            file.write(reinterpret_cast<const char*>(data[s]),
+                       static_cast<std::streamsize>(segments[s].num_words * sizeof(uint32_t)));
+        }
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write output file: " + path);
+    }
+}
+
+std::vector<uint32_t> BinaryImage::words() const {
+    std::vector<uint32_t> result(header_->num_words, 0);
+    for (uint32_t i = 0; i < header_->num_segments; ++i) {
+        if (const uint32_t* words = data(segments_[i])) {
+            std::copy_n(words, segments_[i].num_words, &result[segments_[i].address / 4]);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file block_translator.cpp
+ * @brief Implements basic-block translation and the translation cache.
+ */
+
+#include "block_translator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "mips_lite_defs.h"
+#include "program_image.h"
+
+namespace {
+
+bool isTerminator(uint8_t opcode) {
+    return opcode == mips_lite::opcode::BZ || opcode == mips_lite::opcode::BEQ ||
+           opcode == mips_lite::opcode::JR || opcode == mips_lite::opcode::HALT;
+}
+
+bool isAlu(uint8_t opcode) { return opcode < block_op::NUM_ALU_OPCODES; }
+
+// Valid instructions other than region-of-interest markers, which are always interpreted so a
+// HybridSimulator sees them
+bool isTranslatable(const DecodedOp* op) {
+    return op && op->opcode <= mips_lite::opcode::HALT && !mips_lite::roi::is_marker(op->word);
+}
+
+BlockInstr toBlockInstr(const DecodedOp& op, uint32_t address) {
+    BlockInstr instr{};
+    instr.opcode = op.opcode;
+    instr.src1 = op.rs;
+    if (op.r_type) {
+        instr.dest = op.rd;
+        instr.src2 = op.rt;
+    } else if (op.control_word & mips_lite::control::REG_WRITE) {
+        instr.dest = op.rt;
+    } else if (op.opcode == mips_lite::opcode::BEQ || op.opcode == mips_lite::opcode::STW) {
+        instr.src2 = op.rt;
+    }
+
+    if (op.opcode == mips_lite::opcode::BZ || op.opcode == mips_lite::opcode::BEQ) {
+        // Branch offsets are relative to the branch itself
+        instr.imm = static_cast<int32_t>(address + static_cast<uint32_t>(op.immediate) * 4);
+    } else {
+        instr.imm = op.immediate;
+    }
+    return instr;
+}
+
+void accumulate(const BlockInstr& instr, uint64_t* category_counts, uint32_t& written_registers) {
+    ++category_counts[static_cast<int>(mips_lite::get_instruction_category(instr.opcode))];
+    if (mips_lite::opcode_info(instr.opcode).writes_reg) {
+        written_registers |= 1u << instr.dest;
+    }
+}
+
+}  // namespace
+
+BlockTranslator::BlockTranslator(const ProgramImage* image) : image_(image) { clear(); }
+
+void BlockTranslator::clear() {
+    // Sized to the image again, which may have been reloaded with another program
+    blocks_.clear();
+    blocks_.resize(image_->size());
+    coverage_.assign(image_->size(), 0);
+    page_blocks_.assign((image_->size() >> PAGE_WORDS_SHIFT) + 1, 0);
+    num_blocks_ = 0;
+}
+
+bool BlockTranslator::dropStale() {
+    // Only the pages holding cached blocks are visited
+    bool dropped = false;
+    for (uint32_t page = 0; page < page_blocks_.size(); ++page) {
+        if (page_blocks_[page] == 0) {
+            continue;
+        }
+        uint32_t end = std::min<uint32_t>((page + 1) << PAGE_WORDS_SHIFT, blocks_.size());
+        for (uint32_t first = page << PAGE_WORDS_SHIFT; first < end; ++first) {
+            const auto& block = blocks_[first];
+            if (!block) {
+                continue;
+            }
+            bool stale = false;
+            for (uint32_t i = 0; i < block->num_instructions && !stale; ++i) {
+                stale = image_->lookup((first + i) << 2) == nullptr;
+            }
+            if (stale) {
+                dropBlock(first);
+                dropped = true;
+            }
+        }
+    }
+    return dropped;
+}
+
+size_t BlockTranslator::numBlocks() const { return num_blocks_; }
+
+uint32_t BlockTranslator::accountPrefix(const TranslatedBlock& block, size_t num_ops,
+                                        uint64_t* category_counts, uint32_t& written_registers) {
+    uint32_t instructions = 0;
+    for (size_t i = 0; i < num_ops; ++i) {
+        const BlockOp& op = block.ops[i];
+        if (op.length >= 1) {
+            accumulate(op.first, category_counts, written_registers);
+        }
+        if (op.length == 2) {
+            accumulate(op.second, category_counts, written_registers);
+        }
+        instructions += op.length;
+    }
+    return instructions;
+}
+
+std::unique_ptr<TranslatedBlock> BlockTranslator::translate(uint32_t pc) {
+    if (!isTranslatable(image_->lookup(pc))) {
+        return nullptr;
+    }
+
+    auto block = std::make_unique<TranslatedBlock>();
+    block->start_pc = pc;
+    block->category_counts = {0, 0, 0, 0};
+    block->written_registers = 0;
+
+    uint32_t address = pc;
+    uint32_t count = 0;
+    while (true) {
+        const DecodedOp* cur = image_->lookup(address);
+        if (!isTranslatable(cur) || count == MAX_BLOCK_INSTRUCTIONS) {
+            // Leave the rest to the next lookup (or to the interpreter)
+            BlockOp exit{};
+            exit.kind = block_op::EXIT;
+            exit.length = 0;
+            block->ops.push_back(exit);
+            block->end_pc = address;
+            break;
+        }
+
+        BlockOp op{};
+        op.first = toBlockInstr(*cur, address);
+        op.kind = cur->opcode;
+        op.length = 1;
+
+        if (isTerminator(cur->opcode)) {
+            block->ops.push_back(op);
+            block->end_pc = address;
+            count += 1;
+            break;
+        }
+
+        const DecodedOp* next =
+            count + 2 <= MAX_BLOCK_INSTRUCTIONS ? image_->lookup(address + 4) : nullptr;
+        if (!isTranslatable(next)) {
+            next = nullptr;
+        }
+        if (next && cur->opcode == mips_lite::opcode::LDW && isAlu(next->opcode)) {
+            op.second = toBlockInstr(*next, address + 4);
+            op.kind = block_op::LDW_ALU_BASE + next->opcode;
+            op.length = 2;
+        } else if (next && isAlu(cur->opcode) && next->opcode == mips_lite::opcode::BZ) {
+            op.second = toBlockInstr(*next, address + 4);
+            op.kind = block_op::ALU_BZ_BASE + cur->opcode;
+            op.length = 2;
+            block->ops.push_back(op);
+            block->end_pc = address + 4;
+            count += 2;
+            break;
+        }
+
+        block->ops.push_back(op);
+        address += 4 * op.length;
+        count += op.length;
+    }
+
+    block->num_instructions = count;
+    accountPrefix(*block, block->ops.size(), block->category_counts.data(),
+                  block->written_registers);
+
+    // Record the words this block was translated from
+    for (uint32_t i = 0; i < count; ++i) {
+        ++coverage_[(pc >> 2) + i];
+    }
+    ++page_blocks_[pc >> (2 + PAGE_WORDS_SHIFT)];
+    ++num_blocks_;
+    return block;
+}
+
+void BlockTranslator::dropBlocksCovering(uint32_t index) {
+    // Only blocks starting at most MAX_BLOCK_INSTRUCTIONS - 1 words before can reach the word
+    uint32_t first = index >= MAX_BLOCK_INSTRUCTIONS ? index - (MAX_BLOCK_INSTRUCTIONS - 1) : 0;
+    for (uint32_t start = first; start <= index; ++start) {
+        const auto& block = blocks_[start];
+        if (block && index < start + block->num_instructions) {
+            dropBlock(start);
+        }
+    }
+}
+
+void BlockTranslator::dropBlock(uint32_t index) {
+    std::unique_ptr<TranslatedBlock>& block = blocks_[index];
+    for (uint32_t i = 0; i < block->num_instructions; ++i) {
+        --coverage_[index + i];
+    }
+    --page_blocks_[index >> PAGE_WORDS_SHIFT];
+    --num_blocks_;
+    block.reset();
+}
@@ -0,0 +1,324 @@
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace checkpoint {
+
+static_assert(sizeof(Header) == 64, "Header layout is part of the file format");
+static_assert(sizeof(SlotRecord) == 32, "SlotRecord layout is part of the file format");
+static_assert(sizeof(CpuRecord) == 328, "CpuRecord layout is part of the file format");
+static_assert(sizeof(StatsRecord) == 576, "StatsRecord layout is part of the file format");
+
+namespace {
+
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+constexpr uint8_t MAX_TRAP_CAUSE = static_cast<uint8_t>(mips_lite::TrapCause::INVALID_OPCODE);
+
+uint32_t fnv1a(uint32_t hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/// Checksum of the input image, identifying the base of the memory delta
+template <typename Storage>
+uint32_t imageChecksum(const BasicMemoryParser<Storage>& memory) {
+    uint32_t hash = FNV_OFFSET;
+    for (uint32_t i = 0; i < memory.getInputImageSize(); ++i) {
+        uint32_t word = memory.getInputWord(i);
+        hash = fnv1a(hash, &word, sizeof(word));
+    }
+    return hash;
+}
+
+uint64_t alignPage(uint64_t offset) {
+    return (offset + PAGE_ALIGNMENT - 1) / PAGE_ALIGNMENT * PAGE_ALIGNMENT;
+}
+
+/// Offset of the page data for a checkpoint with the given counts
+uint64_t pagesOffset(uint32_t num_addresses, uint32_t num_pages) {
+    return alignPage(sizeof(Header) + sizeof(CpuRecord) + sizeof(StatsRecord) +
+                     uint64_t(num_addresses) * 4 + uint64_t(num_pages) * 4);
+}
+
+/// A checkpoint file mapped read-only
+class MappedCheckpoint {
+   public:
+    explicit MappedCheckpoint(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open checkpoint: " + path);
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error("Invalid checkpoint " + path + ": truncated header");
+        }
+        void* base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map checkpoint: " + path);
+        }
+        base_ = static_cast<const char*>(base);
+        size_ = static_cast<size_t>(st.st_size);
+    }
+    MappedCheckpoint(const MappedCheckpoint&) = delete;
+    MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+    ~MappedCheckpoint() { munmap(const_cast<char*>(base_), size_); }
+
+    const char* data() const { return base_; }
+    size_t size() const { return size_; }
+
+   private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace
+
+template <typename Storage>
+void save(const std::string& path, const FunctionalSimulator& simulator,
+          const RegisterFile& registers, const Stats& stats,
+          const BasicMemoryParser<Storage>& memory) {
+    SimulatorState state = simulator.getState();
+    CpuRecord cpu{};
+    cpu.retired_instructions = state.retired_instructions;
+    cpu.pc = state.pc;
+    cpu.last_retired_pc = state.last_retired_pc;
+    cpu.trap_pc = state.trap.pc;
+    cpu.trap_address = state.trap.address;
+    for (uint8_t reg = 0; reg < 32; ++reg) {
+        cpu.registers[reg] = registers.read(reg);
+    }
+    for (int slot = 0; slot < SimulatorState::NUM_SLOTS; ++slot) {
+        const PipelineStageData& data = state.slots[slot];
+        SlotRecord& record = cpu.slots[slot];
+        record.instruction = data.instruction.getInstruction();
+        record.pc = data.pc;
+        record.rs_value = data.rs_value;
+        record.rt_value = data.rt_value;
+        record.alu_result = data.alu_result;
+        record.memory_data = data.memory_data;
+        record.branch_target = data.branch_target;
+        record.valid = data.valid;
+        record.has_dest_reg = data.dest_reg.has_value();
+        record.dest_reg = data.dest_reg.value_or(0);
+        record.fault = static_cast<uint8_t>(data.fault);
+        cpu.stage_slot[slot] = state.stage_slot[slot];
+    }
+    cpu.trap_cause = static_cast<uint8_t>(state.trap.cause);
+    cpu.branch_taken = state.branch_taken;
+    cpu.forward = state.forward;
+    cpu.halt_pipeline = state.halt_pipeline;
+    cpu.stall = state.stall;
+
+    StatsRecord counters{};
+    for (int category = 0; category < Stats::NUM_CATEGORIES; ++category) {
+        counters.categories[category] =
+            stats.getCategoryCount(static_cast<mips_lite::InstructionCategory>(category));
+    }
+    for (int opcode = 0; opcode < Stats::NUM_OPCODES; ++opcode) {
+        counters.opcodes[opcode] = stats.getOpcodeCount(static_cast<uint8_t>(opcode));
+    }
+    counters.stalls = stats.getStalls();
+    counters.clock_cycles = stats.getClockCycles();
+    counters.data_hazards = stats.getDataHazards();
+    counters.register_mask = stats.getRegisterMask();
+    std::vector<uint32_t> addresses(stats.getMemoryAddresses().begin(),
+                                    stats.getMemoryAddresses().end());
+    std::sort(addresses.begin(), addresses.end());
+
+    std::vector<uint32_t> pages;
+    for (const DirtyPageMap::Range& range : memory.getDirtyPages().ranges()) {
+        for (uint32_t page = range.begin; page < range.end; ++page) {
+            pages.push_back(page);
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_TAG;
+    header.image_words = memory.getInputImageSize();
+    header.image_checksum = imageChecksum(memory);
+    header.words_reached = static_cast<uint32_t>(memory.getNumMemoryElements());
+    header.num_pages = static_cast<uint32_t>(pages.size());
+    header.num_addresses = static_cast<uint32_t>(addresses.size());
+    header.pages_offset = pagesOffset(header.num_addresses, header.num_pages);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open checkpoint for writing: " + path);
+    }
+    uint32_t hash = FNV_OFFSET;
+    auto put = [&](const void* data, size_t size) {
+        hash = fnv1a(hash, data, size);
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));  // Checksum comes last
+    put(&cpu, sizeof(cpu));
+    put(&counters, sizeof(counters));
+    put(addresses.data(), addresses.size() * sizeof(uint32_t));
+    put(pages.data(), pages.size() * sizeof(uint32_t));
+    const std::vector<char> padding(header.pages_offset - static_cast<uint64_t>(file.tellp()), 0);
+    put(padding.data(), padding.size());
+    uint32_t words[WORDS_PER_PAGE];
+    for (uint32_t page : pages) {
+        uint32_t address = page << DirtyPageMap::PAGE_SHIFT;
+        for (uint32_t i = 0; i < WORDS_PER_PAGE; ++i) {
+            words[i] = memory.peekMemory(address + INDEX_TO_ADDR(i));
+        }
+        put(words, sizeof(words));
+    }
+    header.checksum = hash;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write checkpoint: " + path);
+    }
+}
+
+template <typename Storage>
+void restore(const std::string& path, FunctionalSimulator& simulator, RegisterFile& registers,
+             Stats& stats, BasicMemoryParser<Storage>& memory) {
+    MappedCheckpoint file(path);
+    auto fail = [&](const std::string& reason) {
+        throw std::runtime_error("Invalid checkpoint " + path + ": " + reason);
+    };
+
+    // Validate everything before changing anything
+    const auto* header = reinterpret_cast<const Header*>(file.data());
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        fail("bad magic");
+    }
+    if (header->version != VERSION) {
+        fail("unsupported version " + std::to_string(header->version));
+    }
+    if (header->byte_order != BYTE_ORDER_TAG) {
+        fail("written with the other byte order");
+    }
+    if (header->pages_offset != pagesOffset(header->num_addresses, header->num_pages) ||
+        header->pages_offset + uint64_t(header->num_pages) * PAGE_ALIGNMENT != file.size()) {
+        fail("truncated");
+    }
+    if (fnv1a(FNV_OFFSET, file.data() + sizeof(Header), file.size() - sizeof(Header)) !=
+        header->checksum) {
+        fail("checksum mismatch");
+    }
+    if (header->image_words != memory.getInputImageSize() ||
+        header->image_checksum != imageChecksum(memory)) {
+        throw std::runtime_error("Checkpoint " + path + " was taken from a different image than " +
+                                 memory.getInputFilename());
+    }
+
+    const auto* cpu = reinterpret_cast<const CpuRecord*>(file.data() + sizeof(Header));
+    const auto* counters = reinterpret_cast<const StatsRecord*>(cpu + 1);
+    const auto* addresses = reinterpret_cast<const uint32_t*>(counters + 1);
+    const uint32_t* pages = addresses + header->num_addresses;
+    const auto* page_words = reinterpret_cast<const uint32_t*>(file.data() + header->pages_offset);
+
+    uint8_t owned = 0;
+    for (int slot = 0; slot < SimulatorState::NUM_SLOTS; ++slot) {
+        const SlotRecord& record = cpu->slots[slot];
+        if (cpu->stage_slot[slot] >= SimulatorState::NUM_SLOTS ||
+            (owned & (1u << cpu->stage_slot[slot])) != 0) {
+            fail("invalid pipeline slot assignment");
+        }
+        owned |= static_cast<uint8_t>(1u << cpu->stage_slot[slot]);
+        if (record.dest_reg >= 32 || record.fault > MAX_TRAP_CAUSE) {
+            fail("invalid pipeline slot " + std::to_string(slot));
+        }
+    }
+    if (cpu->trap_cause > MAX_TRAP_CAUSE) {
+        fail("invalid trap cause");
+    }
+    for (uint32_t i = 1; i < header->num_pages; ++i) {
+        if (pages[i] <= pages[i - 1]) {
+            fail("page table out of order");
+        }
+    }
+    if (header->num_pages != 0 && pages[header->num_pages - 1] >= DirtyPageMap::NUM_PAGES) {
+        fail("page table out of range");
+    }
+
+    SimulatorState state;
+    state.retired_instructions = cpu->retired_instructions;
+    state.pc = cpu->pc;
+    state.last_retired_pc = cpu->last_retired_pc;
+    state.trap.cause = static_cast<mips_lite::TrapCause>(cpu->trap_cause);
+    state.trap.pc = cpu->trap_pc;
+    state.trap.address = cpu->trap_address;
+    for (int slot = 0; slot < SimulatorState::NUM_SLOTS; ++slot) {
+        const SlotRecord& record = cpu->slots[slot];
+        PipelineStageData& data = state.slots[slot];
+        data = PipelineStageData(Instruction(record.instruction), record.pc);
+        data.valid = record.valid != 0;
+        data.rs_value = record.rs_value;
+        data.rt_value = record.rt_value;
+        data.alu_result = record.alu_result;
+        data.memory_data = record.memory_data;
+        data.branch_target = record.branch_target;
+        data.dest_reg =
+            record.has_dest_reg ? std::optional<uint8_t>(record.dest_reg) : std::nullopt;
+        data.fault = static_cast<mips_lite::TrapCause>(record.fault);
+        state.stage_slot[slot] = cpu->stage_slot[slot];
+    }
+    state.branch_taken = cpu->branch_taken != 0;
+    state.forward = cpu->forward != 0;
+    state.halt_pipeline = cpu->halt_pipeline != 0;
+    state.stall = cpu->stall != 0;
+    simulator.setState(state);
+
+    for (uint8_t reg = 1; reg < 32; ++reg) {
+        registers.write(reg, cpu->registers[reg]);
+    }
+
+    stats = Stats();
+    for (int category = 0; category < Stats::NUM_CATEGORIES; ++category) {
+        stats.incrementCategory(static_cast<mips_lite::InstructionCategory>(category),
+                                counters->categories[category]);
+    }
+    for (int opcode = 0; opcode < Stats::NUM_OPCODES; ++opcode) {
+        stats.incrementOpcode(static_cast<uint8_t>(opcode), counters->opcodes[opcode]);
+    }
+    stats.incrementStalls(counters->stalls);
+    stats.incrementClockCycles(counters->clock_cycles);
+    stats.incrementDataHazards(counters->data_hazards);
+    stats.addRegisters(counters->register_mask);
+    for (uint32_t i = 0; i < header->num_addresses; ++i) {
+        stats.addMemoryAddress(addresses[i]);
+    }
+
+    memory.reachMemoryElements(header->words_reached);
+    for (uint32_t i = 0; i < header->num_pages; ++i) {
+        memory.restoreWords(pages[i] << DirtyPageMap::PAGE_SHIFT,
+                            page_words + uint64_t(i) * WORDS_PER_PAGE, WORDS_PER_PAGE);
+    }
+}
+
+template void save(const std::string&, const FunctionalSimulator&, const RegisterFile&,
+                   const Stats&, const MemoryParser&);
+template void save(const std::string&, const FunctionalSimulator&, const RegisterFile&,
+                   const Stats&, const FlatMemoryParser&);
+template void restore(const std::string&, FunctionalSimulator&, RegisterFile&, Stats&,
+                      MemoryParser&);
+template void restore(const std::string&, FunctionalSimulator&, RegisterFile&, Stats&,
+                      FlatMemoryParser&);
+
+}  // namespace checkpoint
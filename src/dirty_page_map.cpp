@@ -0,0 +1,51 @@
+#include "dirty_page_map.h"
+
+#include <cstdint>
+#include <vector>
+
+std::vector<DirtyPageMap::Range> DirtyPageMap::ranges() const {
+    std::vector<Range> result;
+    for (uint32_t s = 0; s < summary_.size(); ++s) {
+        if (summary_[s] == 0) {
+            continue;
+        }
+        for (uint32_t n = 0; n < 64; ++n) {
+            if (((summary_[s] >> n) & 1) == 0) {
+                continue;
+            }
+            uint32_t w = s * 64 + n;
+            for (uint32_t bit = 0; bit < 64; ++bit) {
+                if (((bits_[w] >> bit) & 1) == 0) {
+                    continue;
+                }
+                uint32_t page = w * 64 + bit;
+                if (!result.empty() && result.back().end == page) {
+                    result.back().end = page + 1;  // Extends the previous run
+                } else {
+                    result.push_back({page, page + 1});
+                }
+            }
+        }
+    }
+    return result;
+}
+
+uint32_t DirtyPageMap::count() const {
+    uint32_t total = 0;
+    for (const Range& range : ranges()) {
+        total += range.end - range.begin;
+    }
+    return total;
+}
+
+void DirtyPageMap::clear() {
+    // Only the words the summary flags can be nonzero
+    for (uint32_t s = 0; s < summary_.size(); ++s) {
+        for (uint32_t n = 0; summary_[s] != 0 && n < 64; ++n) {
+            if ((summary_[s] >> n) & 1) {
+                bits_[s * 64 + n] = 0;
+            }
+        }
+        summary_[s] = 0;
+    }
+}
@@ -0,0 +1,619 @@
+/**
+ * @file fast_simulator.cpp
+ * @brief Implements the pipeline-free functional simulator.
+ */
+
+#include "fast_simulator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "block_translator.h"
+#include "jit_compiler.h"
+#include "memory_interface.h"
+#include "mips_lite_defs.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+
+// Use labels-as-values (computed goto) dispatch where the compiler supports it
+#if defined(__GNUC__)
+#define MIPS_LITE_COMPUTED_GOTO 1
+#endif
+
+using mips_lite::InstructionCategory;
+using mips_lite::TrapCause;
+
+FastSimulator::FastSimulator(RegisterFile* rf, Stats* st, IMemoryParser* mem) {
+    // Validate dependencies
+    if (!rf) {
+        throw std::invalid_argument("RegisterFile instance cannot be null");
+    }
+    if (!st) {
+        throw std::invalid_argument("Stats instance cannot be null");
+    }
+    if (!mem) {
+        throw std::invalid_argument("MemoryParser instance cannot be null");
+    }
+    register_file = rf;
+    stats = st;
+    memory_parser = mem;
+    program_image = mem->getProgramImage();
+    setBlockTranslation(true);
+}
+
+void FastSimulator::setBlockTranslation(bool enabled) {
+    if (enabled && program_image) {
+        if (!translator) {
+            translator = std::make_unique<BlockTranslator>(program_image);
+        }
+    } else {
+        jit.reset();
+        translator.reset();
+    }
+}
+
+bool FastSimulator::setNativeCompilation(bool enabled) {
+    if (!enabled || !program_image || !JitCompiler::isSupported()) {
+        jit.reset();
+        return false;
+    }
+    setBlockTranslation(true);
+    if (!jit) {
+        try {
+            jit = std::make_unique<JitCompiler>();
+        } catch (const std::runtime_error&) {
+            return false;  // No executable memory; keep interpreting blocks
+        }
+        jit_context.regs = register_file->data();
+        jit_context.memory = memory_parser;
+        jit_context.stats = stats;
+        jit_context.translator = translator.get();
+        // Blocks compiled by an earlier JitCompiler point into its freed arena
+        translator->clear();
+    }
+    return true;
+}
+
+void FastSimulator::setTiming(bool enabled, bool enable_forwarding) {
+    timing = enabled ? std::make_unique<TimingModel>(enable_forwarding) : nullptr;
+    reported_cycles = 0;
+    reported_stalls = 0;
+}
+
+void FastSimulator::reset() {
+    pc = 0;
+    halted = false;
+    trap = mips_lite::Trap();
+    instructions_retired = 0;
+    at_roi_begin = false;
+    leader_pc = 0;
+    leader_retired = 0;
+    leader_offset = 0;
+    if (jit) {
+        jit->reset();  // Its code belongs to the blocks dropped below
+    }
+    invalidateTranslations();
+    if (timing) {
+        setTiming(true, timing->isForwardingEnabled());
+    }
+}
+
+void FastSimulator::setBlockProfile(BlockProfile* profile) {
+    block_profile = profile;
+    leader_pc = pc;
+    leader_retired = instructions_retired;
+    leader_offset = 0;
+}
+
+void FastSimulator::countBlock(uint64_t retired) {
+    // Count the instructions run since leader_retired, piece by piece
+    uint64_t end = leader_offset + (retired - leader_retired);
+    while (leader_offset < end) {
+        uint64_t piece = leader_offset / PROFILE_PIECE_LENGTH;
+        uint64_t piece_end = std::min(end, (piece + 1) * PROFILE_PIECE_LENGTH);
+        (*block_profile)[leader_pc + static_cast<uint32_t>(piece * PROFILE_PIECE_LENGTH * 4)] +=
+            piece_end - leader_offset;
+        leader_offset = piece_end;
+    }
+    leader_retired = retired;
+}
+
+void FastSimulator::enterBlock(uint32_t target_pc, uint64_t retired) {
+    countBlock(retired);
+    leader_pc = target_pc;
+    leader_offset = 0;
+}
+
+void FastSimulator::invalidateTranslations() {
+    if (translator) {
+        translator->clear();
+    }
+}
+
+void FastSimulator::dropStaleTranslations() {
+    if (translator) {
+        translator->dropStale();
+    }
+}
+
+void FastSimulator::flushRun(const RunState& state) {
+    pc = state.pc;
+    instructions_retired += state.retired;
+    for (int i = 0; i < NUM_CATEGORIES; ++i) {
+        if (state.category_counts[i] != 0) {
+            stats->incrementCategory(static_cast<InstructionCategory>(i),
+                                     state.category_counts[i]);
+        }
+    }
+    stats->addRegisters(state.written_registers);
+    if (block_profile) {
+        countBlock(instructions_retired);  // The next run continues the same block
+    }
+    if (timing) {
+        stats->incrementClockCycles(timing->clockCycles() - reported_cycles);
+        stats->incrementStalls(timing->stalls() - reported_stalls);
+        reported_cycles = timing->clockCycles();
+        reported_stalls = timing->stalls();
+    }
+}
+
+uint64_t FastSimulator::run(uint64_t max_instructions) {
+    return timing ? runLoop<true>(max_instructions) : runLoop<false>(max_instructions);
+}
+
+template <bool TIMED>
+uint64_t FastSimulator::runLoop(uint64_t max_instructions) {
+    at_roi_begin = false;
+    if (halted || isTrapped()) {
+        return 0;
+    }
+
+    RegisterFile& rf = *register_file;
+    RunState state;
+    state.pc = pc;
+    DecodedOp scratch;
+    const DecodedOp* op = nullptr;
+
+#ifdef MIPS_LITE_COMPUTED_GOTO
+#define HANDLER(name) op_##name
+#define HANDLER_INVALID op_invalid
+#define DISPATCH_BEGIN goto* dispatch_table[op->opcode];
+#define DISPATCH_END
+#define INVALID8                                                                       \
+    &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, \
+        &&op_invalid, &&op_invalid
+    // Indexed by the 6-bit opcode
+    static void* const dispatch_table[64] = {
+        &&op_ADD,     &&op_ADDI,    &&op_SUB,     &&op_SUBI,    &&op_MUL,     &&op_MULI,
+        &&op_OR,      &&op_ORI,     &&op_AND,     &&op_ANDI,    &&op_XOR,     &&op_XORI,
+        &&op_LDW,     &&op_STW,     &&op_BZ,      &&op_BEQ,     &&op_JR,      &&op_HALT,
+        &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid,
+        INVALID8,     INVALID8,     INVALID8,     INVALID8,     INVALID8};
+#else
+#define HANDLER(name) case mips_lite::opcode::name
+#define HANDLER_INVALID default
+#define DISPATCH_BEGIN switch (op->opcode) {
+#define DISPATCH_END }
+#endif
+
+// Retire the current instruction and continue with the next sequential one
+#define RETIRE(category)                                             \
+    if constexpr (TIMED) timing->retire(*op, false);                 \
+    ++state.category_counts[static_cast<int>(InstructionCategory::category)]; \
+    ++state.retired;                                                       \
+    state.pc += 4;                                                     \
+    goto next
+
+// Retire the current instruction after it wrote register `reg`
+#define RETIRE_WRITE(reg, category)    \
+    state.written_registers |= 1u << (reg); \
+    RETIRE(category)
+
+// Retire a taken branch or jump. A HALT right behind it has already been fetched by the
+// pipeline at this point, which then stops fetching, so the program ends at the target.
+#define RETIRE_TAKEN(target)                                                 \
+    {                                                                        \
+        uint32_t target_pc = (target);                                       \
+        if constexpr (TIMED) timing->retire(*op, true);                      \
+        ++state.category_counts[static_cast<int>(InstructionCategory::CONTROL_FLOW)]; \
+        ++state.retired;                                                           \
+        bool halt_fetched = haltFollows(state.pc);                           \
+        state.pc = target_pc;                                                  \
+        if (block_profile) enterBlock(target_pc, instructions_retired + state.retired); \
+        if (halt_fetched) {                                                  \
+            halted = true;                                                   \
+            goto done;                                                       \
+        }                                                                    \
+        goto next;                                                           \
+    }
+
+// Stop the run at the current instruction, which faulted
+#define TRAP(cause, address)              \
+    raiseTrap((cause), (address), state); \
+    goto done
+
+next:
+    if (state.retired == max_instructions) {
+        goto done;
+    }
+    if (!TIMED && translator) {
+        // Run whole translated blocks while they fit in the remaining budget
+        const TranslatedBlock* block = translator->lookup(state.pc);
+        if (block && block->num_instructions <= max_instructions - state.retired) {
+            if (jit ? executeNative(*block, state) : executeBlock(*block, state)) {
+                goto done;
+            }
+            goto next;
+        }
+    }
+    op = fetch(state.pc, scratch);
+
+    DISPATCH_BEGIN
+    // Arithmetic Operations (two's complement wraparound)
+    HANDLER(ADD): {
+        rf.write(op->rd, rf.read(op->rs) + rf.read(op->rt));
+        RETIRE_WRITE(op->rd, ARITHMETIC);
+    }
+    HANDLER(ADDI): {
+        rf.write(op->rt, rf.read(op->rs) + static_cast<uint32_t>(op->immediate));
+        RETIRE_WRITE(op->rt, ARITHMETIC);
+    }
+    HANDLER(SUB): {
+        rf.write(op->rd, rf.read(op->rs) - rf.read(op->rt));
+        RETIRE_WRITE(op->rd, ARITHMETIC);
+    }
+    HANDLER(SUBI): {
+        rf.write(op->rt, rf.read(op->rs) - static_cast<uint32_t>(op->immediate));
+        RETIRE_WRITE(op->rt, ARITHMETIC);
+    }
+    HANDLER(MUL): {
+        rf.write(op->rd, rf.read(op->rs) * rf.read(op->rt));
+        RETIRE_WRITE(op->rd, ARITHMETIC);
+    }
+    HANDLER(MULI): {
+        rf.write(op->rt, rf.read(op->rs) * static_cast<uint32_t>(op->immediate));
+        RETIRE_WRITE(op->rt, ARITHMETIC);
+    }
+
+    // Logical Operations (immediates are sign extended, as in the pipeline)
+    HANDLER(OR): {
+        rf.write(op->rd, rf.read(op->rs) | rf.read(op->rt));
+        RETIRE_WRITE(op->rd, LOGICAL);
+    }
+    HANDLER(ORI): {
+        rf.write(op->rt, rf.read(op->rs) | static_cast<uint32_t>(op->immediate));
+        RETIRE_WRITE(op->rt, LOGICAL);
+    }
+    HANDLER(AND): {
+        rf.write(op->rd, rf.read(op->rs) & rf.read(op->rt));
+        RETIRE_WRITE(op->rd, LOGICAL);
+    }
+    HANDLER(ANDI): {
+        rf.write(op->rt, rf.read(op->rs) & static_cast<uint32_t>(op->immediate));
+        RETIRE_WRITE(op->rt, LOGICAL);
+    }
+    HANDLER(XOR): {
+        rf.write(op->rd, rf.read(op->rs) ^ rf.read(op->rt));
+        RETIRE_WRITE(op->rd, LOGICAL);
+    }
+    HANDLER(XORI): {
+        if (op->rt == 0 && stop_at_roi_begin && op->word == mips_lite::roi::BEGIN) {
+            at_roi_begin = true;  // Leave the marker to the caller
+            goto done;
+        }
+        rf.write(op->rt, rf.read(op->rs) ^ static_cast<uint32_t>(op->immediate));
+        RETIRE_WRITE(op->rt, LOGICAL);
+    }
+
+    // Memory Access
+    HANDLER(LDW): {
+        uint32_t addr = rf.read(op->rs) + static_cast<uint32_t>(op->immediate);
+        uint32_t value = 0;
+        if (TrapCause fault = memory_parser->tryReadMemory(addr, value);
+            fault != TrapCause::NONE) {
+            TRAP(fault, addr);
+        }
+        rf.write(op->rt, value);
+        RETIRE_WRITE(op->rt, MEMORY_ACCESS);
+    }
+    HANDLER(STW): {
+        uint32_t addr = rf.read(op->rs) + static_cast<uint32_t>(op->immediate);
+        if (TrapCause fault = memory_parser->tryWriteMemory(addr, rf.read(op->rt));
+            fault != TrapCause::NONE) {
+            TRAP(fault, addr);
+        }
+        stats->addMemoryAddress(addr);
+        if (translator) {
+            translator->invalidate(addr);
+        }
+        RETIRE(MEMORY_ACCESS);
+    }
+
+    // Control Flow (branch offsets are relative to the branch itself)
+    HANDLER(BZ): {
+        if (rf.read(op->rs) == 0) {
+            RETIRE_TAKEN(state.pc + static_cast<uint32_t>(op->immediate) * 4);
+        }
+        RETIRE(CONTROL_FLOW);
+    }
+    HANDLER(BEQ): {
+        if (rf.read(op->rs) == rf.read(op->rt)) {
+            RETIRE_TAKEN(state.pc + static_cast<uint32_t>(op->immediate) * 4);
+        }
+        RETIRE(CONTROL_FLOW);
+    }
+    HANDLER(JR): { RETIRE_TAKEN(rf.read(op->rs)); }
+    HANDLER(HALT): {
+        if constexpr (TIMED) timing->retire(*op, false);
+        ++state.category_counts[static_cast<int>(InstructionCategory::CONTROL_FLOW)];
+        ++state.retired;
+        state.pc += 4;  // PC ends one instruction beyond HALT, as in the pipeline
+        halted = true;
+        goto done;
+    }
+
+    HANDLER_INVALID: {
+        // Either the opcode is not part of the ISA or fetch() could not read the word
+        uint32_t word = 0;
+        TrapCause fault = memory_parser->tryReadInstruction(state.pc, word);
+        TRAP(fault != TrapCause::NONE ? fault : TrapCause::INVALID_OPCODE, state.pc);
+    }
+    DISPATCH_END
+
+done:
+    flushRun(state);
+    return state.retired;
+
+#undef HANDLER
+#undef HANDLER_INVALID
+#undef DISPATCH_BEGIN
+#undef DISPATCH_END
+#undef RETIRE
+#undef RETIRE_WRITE
+#undef RETIRE_TAKEN
+#undef TRAP
+#ifdef INVALID8
+#undef INVALID8
+#endif
+}
+
+bool FastSimulator::executeBlock(const TranslatedBlock& block, RunState& state) {
+    RegisterFile& rf = *register_file;
+    const BlockOp* o = block.ops.data();
+
+#ifdef MIPS_LITE_COMPUTED_GOTO
+#define BLOCK_HANDLER(label, kind) label
+#define BLOCK_DISPATCH goto* block_table[o->kind]
+#define BLOCK_DISPATCH_BEGIN BLOCK_DISPATCH;
+#define BLOCK_DISPATCH_END
+    // Indexed by BlockOp::kind
+    static void* const block_table[block_op::NUM_KINDS] = {
+        &&blk_ADD,      &&blk_ADDI,      &&blk_SUB,      &&blk_SUBI,      &&blk_MUL,
+        &&blk_MULI,     &&blk_OR,        &&blk_ORI,      &&blk_AND,       &&blk_ANDI,
+        &&blk_XOR,      &&blk_XORI,      &&blk_LDW,      &&blk_STW,       &&blk_BZ,
+        &&blk_BEQ,      &&blk_JR,        &&blk_HALT,     &&blk_EXIT,      &&blk_LDW_ADD,
+        &&blk_LDW_ADDI, &&blk_LDW_SUB,   &&blk_LDW_SUBI, &&blk_LDW_MUL,   &&blk_LDW_MULI,
+        &&blk_LDW_OR,   &&blk_LDW_ORI,   &&blk_LDW_AND,  &&blk_LDW_ANDI,  &&blk_LDW_XOR,
+        &&blk_LDW_XORI, &&blk_ADD_BZ,    &&blk_ADDI_BZ,  &&blk_SUB_BZ,    &&blk_SUBI_BZ,
+        &&blk_MUL_BZ,   &&blk_MULI_BZ,   &&blk_OR_BZ,    &&blk_ORI_BZ,    &&blk_AND_BZ,
+        &&blk_ANDI_BZ,  &&blk_XOR_BZ,    &&blk_XORI_BZ};
+#else
+#define BLOCK_HANDLER(label, kind) case kind
+#define BLOCK_DISPATCH continue
+#define BLOCK_DISPATCH_BEGIN \
+    for (;;) {               \
+        switch (o->kind) {
+#define BLOCK_DISPATCH_END                                        \
+    default:                                                      \
+        throw std::logic_error("Invalid translated block op");   \
+        }                                                         \
+        }
+#endif
+
+#define REG_OPERAND(instr) rf.read((instr).src2)
+#define IMM_OPERAND(instr) static_cast<uint32_t>((instr).imm)
+#define ALU(instr, OPER, OPERAND) \
+    rf.write((instr).dest, rf.read((instr).src1) OPER OPERAND(instr))
+
+// Stop at the current op, which faulted; everything before it has retired
+#define BLOCK_TRAP(cause, address)                                            \
+    leaveBlockEarly(block, static_cast<size_t>(o - block.ops.data()), state); \
+    raiseTrap((cause), (address), state);                                     \
+    return true
+
+#define LOAD(instr)                                                         \
+    {                                                                       \
+        uint32_t address = rf.read((instr).src1) + IMM_OPERAND(instr);      \
+        uint32_t value = 0;                                                 \
+        if (TrapCause fault = memory_parser->tryReadMemory(address, value); \
+            fault != TrapCause::NONE) {                                     \
+            BLOCK_TRAP(fault, address);                                     \
+        }                                                                   \
+        rf.write((instr).dest, value);                                      \
+    }
+
+#define BLOCK_ACCOUNT() accountBlock(block, state)
+
+#define BLOCK_COMPLETE(next_pc) \
+    BLOCK_ACCOUNT();            \
+    state.pc = (next_pc);       \
+    return false
+
+#define BLOCK_TAKEN(target)                         \
+    {                                               \
+        uint32_t target_pc = (target);              \
+        BLOCK_ACCOUNT();                            \
+        return finishTaken(block, target_pc, state); \
+    }
+
+#define BRANCH_IF(cond, target) \
+    if (cond) {                 \
+        BLOCK_TAKEN(target);    \
+    }                           \
+    BLOCK_COMPLETE(block.end_pc + 4)
+
+// A plain ALU op, LDW fused with it, and it fused with a following BZ
+#define ALU_HANDLERS(NAME, OPER, OPERAND)                                                  \
+    BLOCK_HANDLER(blk_##NAME, mips_lite::opcode::NAME) : {                                 \
+        ALU(o->first, OPER, OPERAND);                                                      \
+        ++o;                                                                               \
+        BLOCK_DISPATCH;                                                                    \
+    }                                                                                      \
+    BLOCK_HANDLER(blk_LDW_##NAME, block_op::LDW_ALU_BASE + mips_lite::opcode::NAME) : {    \
+        LOAD(o->first);                                                                    \
+        ALU(o->second, OPER, OPERAND);                                                     \
+        ++o;                                                                               \
+        BLOCK_DISPATCH;                                                                    \
+    }                                                                                      \
+    BLOCK_HANDLER(blk_##NAME##_BZ, block_op::ALU_BZ_BASE + mips_lite::opcode::NAME) : {    \
+        ALU(o->first, OPER, OPERAND);                                                      \
+        BRANCH_IF(rf.read(o->second.src1) == 0, static_cast<uint32_t>(o->second.imm));     \
+    }
+
+    BLOCK_DISPATCH_BEGIN
+    ALU_HANDLERS(ADD, +, REG_OPERAND)
+    ALU_HANDLERS(ADDI, +, IMM_OPERAND)
+    ALU_HANDLERS(SUB, -, REG_OPERAND)
+    ALU_HANDLERS(SUBI, -, IMM_OPERAND)
+    ALU_HANDLERS(MUL, *, REG_OPERAND)
+    ALU_HANDLERS(MULI, *, IMM_OPERAND)
+    ALU_HANDLERS(OR, |, REG_OPERAND)
+    ALU_HANDLERS(ORI, |, IMM_OPERAND)
+    ALU_HANDLERS(AND, &, REG_OPERAND)
+    ALU_HANDLERS(ANDI, &, IMM_OPERAND)
+    ALU_HANDLERS(XOR, ^, REG_OPERAND)
+    ALU_HANDLERS(XORI, ^, IMM_OPERAND)
+
+    BLOCK_HANDLER(blk_LDW, mips_lite::opcode::LDW) : {
+        LOAD(o->first);
+        ++o;
+        BLOCK_DISPATCH;
+    }
+    BLOCK_HANDLER(blk_STW, mips_lite::opcode::STW) : {
+        uint32_t addr = rf.read(o->first.src1) + IMM_OPERAND(o->first);
+        if (TrapCause fault = memory_parser->tryWriteMemory(addr, rf.read(o->first.src2));
+            fault != TrapCause::NONE) {
+            BLOCK_TRAP(fault, addr);
+        }
+        stats->addMemoryAddress(addr);
+        if (translator->covers(addr)) {
+            // Self-modifying store: stop here; the stored word is interpreted from now on
+            leaveBlockEarly(block, static_cast<size_t>(o - block.ops.data()) + 1, state);
+            translator->invalidate(addr);
+            return false;
+        }
+        ++o;
+        BLOCK_DISPATCH;
+    }
+    BLOCK_HANDLER(blk_BZ, mips_lite::opcode::BZ) : {
+        BRANCH_IF(rf.read(o->first.src1) == 0, static_cast<uint32_t>(o->first.imm));
+    }
+    BLOCK_HANDLER(blk_BEQ, mips_lite::opcode::BEQ) : {
+        BRANCH_IF(rf.read(o->first.src1) == rf.read(o->first.src2),
+                  static_cast<uint32_t>(o->first.imm));
+    }
+    BLOCK_HANDLER(blk_JR, mips_lite::opcode::JR) : { BLOCK_TAKEN(rf.read(o->first.src1)); }
+    BLOCK_HANDLER(blk_HALT, mips_lite::opcode::HALT) : {
+        BLOCK_ACCOUNT();
+        state.pc = block.end_pc + 4;  // PC ends one instruction beyond HALT
+        halted = true;
+        return true;
+    }
+    BLOCK_HANDLER(blk_EXIT, block_op::EXIT) : { BLOCK_COMPLETE(block.end_pc); }
+    BLOCK_DISPATCH_END
+
+#ifndef MIPS_LITE_COMPUTED_GOTO
+    return false;  // Not reached
+#endif
+
+#undef BLOCK_HANDLER
+#undef BLOCK_DISPATCH
+#undef BLOCK_DISPATCH_BEGIN
+#undef BLOCK_DISPATCH_END
+#undef REG_OPERAND
+#undef IMM_OPERAND
+#undef ALU
+#undef BLOCK_TRAP
+#undef LOAD
+#undef BLOCK_ACCOUNT
+#undef BLOCK_COMPLETE
+#undef BLOCK_TAKEN
+#undef BRANCH_IF
+#undef ALU_HANDLERS
+}
+
+bool FastSimulator::executeNative(const TranslatedBlock& block, RunState& state) {
+    if (!block.native_code) {
+        block.native_code = jit->compile(block);
+        if (!block.native_code) {
+            // Code arena is full: run this block interpreted, then start over with empty caches
+            bool stopped = executeBlock(block, state);
+            translator->clear();
+            jit->reset();
+            return stopped;
+        }
+    }
+
+    jit_context.status = 0;
+    switch (block.native_code(&jit_context)) {
+        case jit_exit::FALLTHROUGH:
+            accountBlock(block, state);
+            state.pc = jit_context.next_pc;
+            return false;
+        case jit_exit::TAKEN:
+            accountBlock(block, state);
+            return finishTaken(block, jit_context.next_pc, state);
+        case jit_exit::HALT:
+            accountBlock(block, state);
+            state.pc = block.end_pc + 4;  // PC ends one instruction beyond HALT
+            halted = true;
+            return true;
+        case jit_exit::STORE_INTO_CODE:
+            // Self-modifying store: stop after it; the stored word is interpreted from now on
+            leaveBlockEarly(block, jit_context.op_index + 1, state);
+            translator->invalidate(jit_context.store_address);
+            return false;
+        default:
+            // A memory access faulted; everything before the faulting op has retired
+            leaveBlockEarly(block, jit_context.op_index, state);
+            raiseTrap(jit_context.fault, jit_context.fault_address, state);
+            jit_context.fault = TrapCause::NONE;
+            return true;
+    }
+}
+
+void FastSimulator::accountBlock(const TranslatedBlock& block, RunState& state) {
+    // Counts were precomputed at translation time
+    for (int i = 0; i < NUM_CATEGORIES; ++i) {
+        state.category_counts[i] += block.category_counts[i];
+    }
+    state.written_registers |= block.written_registers;
+    state.retired += block.num_instructions;
+    state.pc = block.end_pc;
+}
+
+void FastSimulator::leaveBlockEarly(const TranslatedBlock& block, size_t num_ops,
+                                    RunState& state) {
+    uint32_t n = BlockTranslator::accountPrefix(block, num_ops, state.category_counts,
+                                                state.written_registers);
+    state.retired += n;
+    state.pc = block.start_pc + 4 * n;
+}
+
+bool FastSimulator::finishTaken(const TranslatedBlock& block, uint32_t target_pc,
+                                RunState& state) {
+    // Same HALT-behind-a-taken-branch rule as the interpreter's RETIRE_TAKEN
+    bool halt_fetched = haltFollows(block.end_pc);
+    state.pc = target_pc;
+    if (block_profile) {
+        enterBlock(target_pc, instructions_retired + state.retired);
+    }
+    if (halt_fetched) {
+        halted = true;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,88 @@
+#include "flat_memory.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+FlatMemory::FlatMemory(bool huge_pages)
+    : committed_(SPACE_SIZE >> COMMIT_SHIFT, 0), huge_pages_(huge_pages) {
+    // Read-only, so nothing is charged up front even where MAP_NORESERVE is ignored; chunks
+    // are charged as commit() makes them writable
+    void* base = mmap(nullptr, SPACE_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                      -1, 0);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Failed to reserve 4GiB of guest memory: " +
+                                 std::string(std::strerror(errno)));
+    }
+    words_ = static_cast<uint32_t*>(base);
+#ifdef MADV_HUGEPAGE
+    if (huge_pages_) {
+        // Advisory only: without transparent huge page support the mapping stays at 4 KiB pages
+        madvise(base, SPACE_SIZE, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+FlatMemory::FlatMemory(FlatMemory&& other) noexcept
+    : words_(std::exchange(other.words_, nullptr)),
+      committed_(std::move(other.committed_)),
+      huge_pages_(other.huge_pages_) {}
+
+FlatMemory& FlatMemory::operator=(FlatMemory&& other) noexcept {
+    if (this != &other) {
+        if (words_ != nullptr) {
+            munmap(words_, SPACE_SIZE);
+        }
+        words_ = std::exchange(other.words_, nullptr);
+        committed_ = std::move(other.committed_);
+        huge_pages_ = other.huge_pages_;
+    }
+    return *this;
+}
+
+FlatMemory::~FlatMemory() {
+    if (words_ != nullptr) {
+        munmap(words_, SPACE_SIZE);
+    }
+}
+
+size_t FlatMemory::numAllocatedPages() const {
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> resident(SPACE_SIZE / page_size);
+    if (mincore(words_, SPACE_SIZE, resident.data()) != 0) {
+        return 0;
+    }
+    size_t count = 0;
+    for (unsigned char page : resident) {
+        count += page & 1;
+    }
+    return count;
+}
+
+void FlatMemory::commit(uint32_t address) {
+    uint32_t chunk = address >> COMMIT_SHIFT;
+    void* start = reinterpret_cast<char*>(words_) + (uint64_t(chunk) << COMMIT_SHIFT);
+    if (mprotect(start, COMMIT_SIZE, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("Failed to commit guest memory at address " +
+                                 std::to_string(address) + ": " +
+                                 std::string(std::strerror(errno)));
+    }
+    committed_[chunk] = 1;
+}
+
+void FlatMemory::clear() {
+    // Private anonymous pages read as zero again after MADV_DONTNEED, and going back to
+    // read-only returns the commit charge of the chunks written so far
+    madvise(words_, SPACE_SIZE, MADV_DONTNEED);
+    mprotect(words_, SPACE_SIZE, PROT_READ);
+    std::fill(committed_.begin(), committed_.end(), 0);
+}
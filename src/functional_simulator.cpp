@@ -2,14 +2,17 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <type_traits>
 
 #include "iostream"
 #include "memory_interface.h"
 #include "mips_instruction.h"
 #include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
 #include "register_file.h"
 #include "stats.h"
 
@@ -29,9 +32,59 @@ FunctionalSimulator::FunctionalSimulator(RegisterFile* rf, Stats* st, IMemoryPar
     register_file = rf;
     stats = st;
     memory_parser = mem;
+    program_image = mem->getProgramImage();
+    if (dynamic_cast<MemoryParser*>(mem) != nullptr) {
+        concrete_memory = ConcreteMemory::PAGED;
+    } else if (dynamic_cast<FlatMemoryParser*>(mem) != nullptr) {
+        concrete_memory = ConcreteMemory::FLAT;
+    }
+
+    // Each stage starts out owning the slot with the same index; all slots begin as bubbles
+    for (int stage = 0; stage < NUM_STAGES; ++stage) {
+        stage_slot[stage] = static_cast<uint8_t>(stage);
+    }
+}
 
-    for (auto& stage : pipeline) {
-        stage = nullptr;  // Initialize all pipeline stages to nullptr
+namespace {
+
+/// Call fn with the PipelinePolicy over Memory that matches forward and collect_stats
+template <typename Memory, typename Fn>
+decltype(auto) dispatchOver(bool forward, bool collect_stats, Fn& fn) {
+    if (forward) {
+        return collect_stats ? fn(PipelinePolicy<true, Stats, Memory>()) :
+                             fn(PipelinePolicy<true, NullStats, Memory>());
+    }
+    return collect_stats ? fn(PipelinePolicy<false, Stats, Memory>()) :
+                         fn(PipelinePolicy<false, NullStats, Memory>());
+}
+
+}  // namespace
+
+/// Word that stands in for an instruction whose fetch faulted: an opcode outside the ISA, so
+/// execute() raises the trap recorded with it
+constexpr uint32_t FETCH_FAULT_WORD = 0xFC000000;
+static_assert(!mips_lite::opcode_info(FETCH_FAULT_WORD >> 26).valid,
+              "FETCH_FAULT_WORD must not decode to an instruction");
+
+template <typename Fn>
+decltype(auto) FunctionalSimulator::dispatch(Fn&& fn) {
+    switch (concrete_memory) {
+        case ConcreteMemory::PAGED:
+            return dispatchOver<MemoryParser>(forward, collect_stats, fn);
+        case ConcreteMemory::FLAT:
+            return dispatchOver<FlatMemoryParser>(forward, collect_stats, fn);
+        default:
+            return dispatchOver<IMemoryParser>(forward, collect_stats, fn);
+    }
+}
+
+template <typename Policy>
+typename Policy::Sink& FunctionalSimulator::sink() {
+    if constexpr (std::is_same_v<typename Policy::Sink, Stats>) {
+        return *stats;
+    } else {
+        static typename Policy::Sink discard;
+        return discard;
     }
 }
 
@@ -45,78 +98,99 @@ const PipelineStageData* FunctionalSimulator::getPipelineStage(int stage) const
     if (stage < 0 || stage >= NUM_STAGES) {
         throw std::out_of_range("Pipeline stage index out of range");
     }
-    return pipeline[stage].get();  // Use .get() to return the raw pointer
+    const PipelineStageData& data = stageData(stage);
+    return data.valid ? &data : nullptr;
 }
 
 bool FunctionalSimulator::isStageEmpty(int stage) const {
     if (stage < 0 || stage >= NUM_STAGES) {
         throw std::out_of_range("Pipeline stage index out of range");
     }
-    return pipeline[stage] == nullptr;
+    return !stageData(stage).valid;
 }
 
 void FunctionalSimulator::instructionFetch() {
-    auto& fetch_data = pipeline[PipelineStage::FETCH];
+    auto& fetch_data = stageData(PipelineStage::FETCH);
 
-    if (fetch_data || halt_pipeline) {
+    if (fetch_data.valid || halt_pipeline) {
         return;  // Fetch stage already has an instruciton, do nothing
                  // pipeline is likely stalled or halt instruction encountered
     }
 
-    uint32_t instruction_word = memory_parser->readInstruction(pc);
-
-    halt_pipeline = mips_lite::is_halt_instruction(instruction_word);
-
-    // Create next instruction for pipeline
-    auto instruction = std::make_unique<Instruction>(instruction_word);
-    auto stage_data = std::make_unique<PipelineStageData>();
-    stage_data->instruction = std::move(instruction);
-    stage_data->pc = pc;
-
-    fetch_data = std::move(stage_data);
+    // Use the predecoded instruction if there is one, otherwise read and decode the word
+    const DecodedOp* op = program_image ? program_image->lookup(pc) : nullptr;
+    if (op) {
+        halt_pipeline = op->opcode == mips_lite::opcode::HALT;
+        fetch_data = PipelineStageData(Instruction(*op), pc);
+    } else {
+        uint32_t instruction_word = 0;
+        mips_lite::TrapCause fault = memory_parser->tryReadInstruction(pc, instruction_word);
+        if (fault != mips_lite::TrapCause::NONE) {
+            // Carried as an invalid opcode; it only traps if it reaches EX unflushed
+            instruction_word = FETCH_FAULT_WORD;
+        }
+        halt_pipeline = mips_lite::is_halt_instruction(instruction_word);
+        fetch_data = PipelineStageData(Instruction(instruction_word), pc);
+        fetch_data.fault = fault;
+    }
+    const mips_lite::OpcodeInfo& info = mips_lite::opcode_info(fetch_data.instruction.getOpcode());
+    SlotRegisters& registers = slot_registers[stage_slot[PipelineStage::FETCH]];
+    registers.reads = registerBit(fetch_data.instruction.getRs());
+    if (info.reads_rt) {
+        registers.reads |= registerBit(fetch_data.instruction.getRt());
+    }
+    registers.writes = 0;
+    registers.load = info.latency > 1;
+    ++occupied_stages;
     pc += 4;
 }
 
 void FunctionalSimulator::instructionDecode() {
-    auto& id_data = pipeline[PipelineStage::DECODE];
+    dispatch([this](auto policy) { instructionDecodeImpl<decltype(policy)>(); });
+}
 
-    if (!id_data || stall) {
+template <typename Policy>
+void FunctionalSimulator::instructionDecodeImpl() {
+    auto& id_data = stageData(PipelineStage::DECODE);
+
+    if (!id_data.valid || stall) {
         return;  // Nothing to decode, or pipeline is stalled
     }
 
-    uint8_t rs = id_data->instruction->getRs();
-    uint8_t rt = id_data->instruction->getRt();
+    uint8_t rs = id_data.instruction.getRs();
+    uint8_t rt = id_data.instruction.getRt();
+    const mips_lite::OpcodeInfo& info = mips_lite::opcode_info(id_data.instruction.getOpcode());
 
     // Source register
-    id_data->rs_value = readRegisterValue(rs);
+    id_data.rs_value = readRegisterValue<Policy>(rs);
     // (Optional) Second source register
-    if (needsRtValue(id_data->instruction.get())) {
-        id_data->rt_value = readRegisterValue(rt);
+    if (info.reads_rt) {
+        id_data.rt_value = readRegisterValue<Policy>(rt);
     }
 
     // Determine destination register, if writeback is needed
-    bool writeback_needed = isRegisterWriteInstruction(id_data->instruction.get());
-
-    if (writeback_needed) {
-        if (id_data->instruction->hasRd()) {
+    if (info.writes_reg) {
+        if (id_data.instruction.hasRd()) {
             // R-type instruction (always has Rd)
-            id_data->dest_reg = id_data->instruction->getRd();
+            id_data.dest_reg = id_data.instruction.getRd();
         } else {
             // I-type instruction that writes to a register (e.g., ADDI, LDW)
-            id_data->dest_reg = id_data->instruction->getRt();
+            id_data.dest_reg = id_data.instruction.getRt();
         }
     } else {
-        id_data->dest_reg = std::nullopt;  // No destination register
+        id_data.dest_reg = std::nullopt;  // No destination register
     }
+    slot_registers[stage_slot[PipelineStage::DECODE]].writes =
+        info.writes_reg ? registerBit(id_data.dest_reg.value()) : 0;
 }
 
 void FunctionalSimulator::execute() {
-    auto& ex_data = pipeline[PipelineStage::EXECUTE];
-    if (!ex_data) {
+    auto* ex_data = &stageData(PipelineStage::EXECUTE);
+    if (!ex_data->valid) {
         return;  // Nothing to execute, NOP or Bubble inserted
     }
 
-    switch (ex_data->instruction->getOpcode()) {
+    switch (ex_data->instruction.getOpcode()) {
         // Arithmetic Operations
         // Operands are always signed
         case mips_lite::opcode::ADD:
@@ -124,7 +198,7 @@ void FunctionalSimulator::execute() {
             break;
         case mips_lite::opcode::ADDI:
             ex_data->alu_result =
-                ex_data->getRsValueSigned() + ex_data->instruction->getImmediate();
+                ex_data->getRsValueSigned() + ex_data->instruction.getImmediate();
             break;
 
         case mips_lite::opcode::SUB:
@@ -132,7 +206,7 @@ void FunctionalSimulator::execute() {
             break;
         case mips_lite::opcode::SUBI:
             ex_data->alu_result =
-                ex_data->getRsValueSigned() - ex_data->instruction->getImmediate();
+                ex_data->getRsValueSigned() - ex_data->instruction.getImmediate();
             break;
 
         case mips_lite::opcode::MUL:
@@ -140,7 +214,7 @@ void FunctionalSimulator::execute() {
             break;
         case mips_lite::opcode::MULI:
             ex_data->alu_result =
-                ex_data->getRsValueSigned() * ex_data->instruction->getImmediate();
+                ex_data->getRsValueSigned() * ex_data->instruction.getImmediate();
             break;
 
         // Logical Operations
@@ -149,21 +223,21 @@ void FunctionalSimulator::execute() {
             ex_data->alu_result = ex_data->rs_value | ex_data->rt_value;
             break;
         case mips_lite::opcode::ORI:
-            ex_data->alu_result = ex_data->rs_value | ex_data->instruction->getImmediate();
+            ex_data->alu_result = ex_data->rs_value | ex_data->instruction.getImmediate();
             break;
 
         case mips_lite::opcode::AND:
             ex_data->alu_result = ex_data->rs_value & ex_data->rt_value;
             break;
         case mips_lite::opcode::ANDI:
-            ex_data->alu_result = ex_data->rs_value & ex_data->instruction->getImmediate();
+            ex_data->alu_result = ex_data->rs_value & ex_data->instruction.getImmediate();
             break;
 
         case mips_lite::opcode::XOR:
             ex_data->alu_result = ex_data->rs_value ^ ex_data->rt_value;
             break;
         case mips_lite::opcode::XORI:
-            ex_data->alu_result = ex_data->rs_value ^ ex_data->instruction->getImmediate();
+            ex_data->alu_result = ex_data->rs_value ^ ex_data->instruction.getImmediate();
             break;
 
         // Memory Effective Address Calculation -> Load and Store
@@ -171,18 +245,18 @@ void FunctionalSimulator::execute() {
         case mips_lite::opcode::LDW:
             // Load word - calculate effective address
             ex_data->alu_result =
-                ex_data->getRsValueSigned() + ex_data->instruction->getImmediate();
+                ex_data->getRsValueSigned() + ex_data->instruction.getImmediate();
             break;
 
         case mips_lite::opcode::STW:
             ex_data->alu_result =
-                ex_data->getRsValueSigned() + ex_data->instruction->getImmediate();
+                ex_data->getRsValueSigned() + ex_data->instruction.getImmediate();
             break;
 
         // Control Flow Ops
         case mips_lite::opcode::BZ:
             if (ex_data->rs_value == 0) {
-                ex_data->alu_result = ex_data->pc + (ex_data->instruction->getImmediate() * 4);
+                ex_data->alu_result = ex_data->pc + (ex_data->instruction.getImmediate() * 4);
                 branch_taken = true;  // Indicate that a branch was taken
                                       // TODO: Controller will need to clear this flag after the
                                       // branch is taken
@@ -196,7 +270,7 @@ void FunctionalSimulator::execute() {
             if (ex_data->rs_value == ex_data->rt_value) {
                 // Branch if equal - calculate target address
 
-                ex_data->alu_result = ex_data->pc + (ex_data->instruction->getImmediate() * 4);
+                ex_data->alu_result = ex_data->pc + (ex_data->instruction.getImmediate() * 4);
                 branch_taken = true;  // Indicate that a branch was taken
             } else {
                 // No branch, PC will be updated normally
@@ -227,7 +301,13 @@ void FunctionalSimulator::execute() {
             break;
 
         default:
-            throw std::invalid_argument("Invalid opcode for execute stage");
+            // Invalid opcode, or an instruction whose fetch faulted
+            raiseTrap(PipelineStage::EXECUTE,
+                      ex_data->fault != mips_lite::TrapCause::NONE
+                          ? ex_data->fault
+                          : mips_lite::TrapCause::INVALID_OPCODE,
+                      ex_data->pc);
+            break;
     }
 }
 
@@ -241,31 +321,45 @@ void FunctionalSimulator::execute() {
  * to the computed memory address and logs the access in the stats.
  */
 void FunctionalSimulator::memory() {
+    dispatch([this](auto policy) { memoryImpl<decltype(policy)>(); });
+}
+
+template <typename Policy>
+void FunctionalSimulator::memoryImpl() {
     // Get reference to PipelineStageData pointer in memory stage
     // using auto to automatically deduce the type
-    auto& mem_data = pipeline[MEMORY];
+    auto* mem_data = &stageData(MEMORY);
 
     // In the case of a stall cycle or no instruction in
     // the memory stage, just return
-    if (!mem_data || mem_data->isEmpty()) {
+    if (mem_data->isEmpty()) {
         return;
     }
 
-    uint8_t opcode = mem_data->instruction->getOpcode();
+    uint8_t opcode = mem_data->instruction.getOpcode();
     uint32_t addr = mem_data->alu_result;
 
     switch (opcode) {
         // Load word from memory
         case mips_lite::opcode::LDW:
-            mem_data->memory_data = memory_parser->readMemory(addr);
+            if (mips_lite::TrapCause fault = memory<Policy>().tryReadMemory(
+                    addr, mem_data->memory_data);
+                fault != mips_lite::TrapCause::NONE) {
+                raiseTrap(MEMORY, fault, addr);
+            }
             break;
 
         // Store word in memory
         case mips_lite::opcode::STW:
             // Write the value to memory and add the address to the stats tracking
             // of modified memory locations
-            memory_parser->writeMemory(addr, mem_data->rt_value);
-            stats->addMemoryAddress(addr);
+            if (mips_lite::TrapCause fault = memory<Policy>().tryWriteMemory(
+                    addr, mem_data->rt_value);
+                fault != mips_lite::TrapCause::NONE) {
+                raiseTrap(MEMORY, fault, addr);
+                break;
+            }
+            sink<Policy>().addMemoryAddress(addr);
             break;
 
         // All other instruction do not access memory
@@ -287,19 +381,28 @@ void FunctionalSimulator::memory() {
  * is performed.
  */
 void FunctionalSimulator::writeBack() {
+    dispatch([this](auto policy) { writeBackImpl<decltype(policy)>(); });
+}
+
+template <typename Policy>
+void FunctionalSimulator::writeBackImpl() {
     // Get reference to PipelineStageData pointer in WB stage
     // using auto to automatically deduce the type
-    auto& wb_data = pipeline[WRITEBACK];
+    auto* wb_data = &stageData(WRITEBACK);
 
     // In the case of a stall cycle or no instruction in
     // the WB stage, just return
-    if (!wb_data || wb_data->isEmpty()) {
+    if (wb_data->isEmpty()) {
         return;
     }
     // Record instruction category for stats
     mips_lite::InstructionCategory category =
-        mips_lite::get_instruction_category(wb_data->instruction->getOpcode());
-    stats->incrementCategory(category);
+        mips_lite::get_instruction_category(wb_data->instruction.getOpcode());
+    sink<Policy>().incrementCategory(category);
+    sink<Policy>().incrementOpcode(wb_data->instruction.getOpcode());
+    ++retired_instructions;
+    last_retired_pc = wb_data->pc;
+    last_retired_word = wb_data->instruction.getInstruction();
 
     // If there is a destination register value, write the
     // ALU result value to it.
@@ -308,7 +411,7 @@ void FunctionalSimulator::writeBack() {
     // not an instruction has produced any alu_result.
     if (wb_data->dest_reg.has_value()) {
         uint8_t dest = wb_data->dest_reg.value();
-        uint8_t opcode = wb_data->instruction->getOpcode();
+        uint8_t opcode = wb_data->instruction.getOpcode();
 
         // For load, use memory_data, otherwise use alu_result
         uint32_t value =
@@ -318,90 +421,245 @@ void FunctionalSimulator::writeBack() {
         register_file->write(dest, value);
 
         // Add this to the stats tracking modified registers
-        stats->addRegister(dest);
+        sink<Policy>().addRegister(dest);
     }
 }
 
 void FunctionalSimulator::advancePipeline() {
-    // Release writeback stage
-    pipeline[PipelineStage::WRITEBACK].reset();  // Smart pointer will delete the object
-    pipeline[PipelineStage::WRITEBACK] =
-        std::move(pipeline[PipelineStage::MEMORY]);  // Move MEM to WB
-    pipeline[PipelineStage::MEMORY] =
-        std::move(pipeline[PipelineStage::EXECUTE]);  // Move EXE to MEM
+    dispatch([this](auto policy) { advancePipelineImpl<decltype(policy)>(); });
+}
+
+template <typename Policy>
+void FunctionalSimulator::advancePipelineImpl() {
+    if (stall) {
+        sink<Policy>().incrementStalls();
+    }
+    rotateStages();
+}
+
+void FunctionalSimulator::rotateStages() {
+    // Release writeback stage; its slot is recycled as the new bubble
+    uint8_t free_slot = stage_slot[PipelineStage::WRITEBACK];
+    if (pipeline[free_slot].valid) {
+        pipeline[free_slot].valid = false;
+        slot_registers[free_slot] = SlotRegisters();
+        --occupied_stages;
+    }
+
+    stage_slot[PipelineStage::WRITEBACK] = stage_slot[PipelineStage::MEMORY];  // Move MEM to WB
+    stage_slot[PipelineStage::MEMORY] = stage_slot[PipelineStage::EXECUTE];    // Move EXE to MEM
     if (stall) {
-        stats->incrementStalls();
         // bubble insert
-        pipeline[PipelineStage::EXECUTE].reset();
+        stage_slot[PipelineStage::EXECUTE] = free_slot;
         // Do not advance ID or IF stages
     } else {
-        pipeline[PipelineStage::EXECUTE] =
-            std::move(pipeline[PipelineStage::DECODE]);  // Move ID to EXE
-        pipeline[PipelineStage::DECODE] =
-            std::move(pipeline[PipelineStage::FETCH]);  // Move IF to ID
+        stage_slot[PipelineStage::EXECUTE] = stage_slot[PipelineStage::DECODE];  // Move ID to EXE
+        stage_slot[PipelineStage::DECODE] = stage_slot[PipelineStage::FETCH];    // Move IF to ID
+        stage_slot[PipelineStage::FETCH] = free_slot;
         // Note: IF is now empty, so we can fetch a new instruction next cycle
     }
 }
 
 void FunctionalSimulator::cycle() {
+    dispatch([this](auto policy) { cycleImpl<decltype(policy)>(); });
+}
+
+template <typename Policy>
+void FunctionalSimulator::cycleImpl() {
     // Execute stages in reverse order since writeback should happen first
     if (checkProgramCompletion()) {
         return;
     }
-    stats->incrementClockCycles();
-    writeBack();
-    memory();
+    sink<Policy>().incrementClockCycles();
+    writeBackImpl<Policy>();
+    memoryImpl<Policy>();
     execute();
 
     // Check for branch taken which would get set in EXE stage
     if (isBranchTaken()) {
         // Get reference to the EXE stage data
-        auto& ex_data = pipeline[PipelineStage::EXECUTE];
-        if (!ex_data) {
+        auto& ex_data = stageData(PipelineStage::EXECUTE);
+        if (!ex_data.valid) {
             throw std::runtime_error(
                 "Branch taken but EXE stage is empty. This should never happen.");
         }
         // Update PC to the branch target
-        setPC(ex_data->alu_result);
+        setPC(ex_data.alu_result);
         // Flush IF and ID stages
-        pipeline[PipelineStage::FETCH].reset();
-        pipeline[PipelineStage::DECODE].reset();
+        flushStage(PipelineStage::FETCH);
+        flushStage(PipelineStage::DECODE);
         // Reset control signals
         stall = false;
         branch_taken = false;
-        advancePipeline();
+        advancePipelineImpl<Policy>();
         return;
     } else {
         // If no branch taken, continue with normal pipeline operation
         // Check for stalls and set stall signal
         // if stall is set, we will not advance IF or ID stages
-        stall = detectStalls();
+        stall = detectStalls<Policy>();
 
-        instructionDecode();
+        instructionDecodeImpl<Policy>();
         instructionFetch();
-        advancePipeline();
+        advancePipelineImpl<Policy>();
     }
 }
 
-bool FunctionalSimulator::isRegisterWriteInstruction(const Instruction* instr) const {
-    if (instr == nullptr) {
-        return false;
+uint64_t FunctionalSimulator::advance(uint64_t max_cycles) {
+    return dispatch([&](auto policy) { return advanceImpl<decltype(policy)>(max_cycles); });
+}
+
+template <typename Policy>
+uint64_t FunctionalSimulator::advanceImpl(uint64_t max_cycles) {
+    uint64_t elapsed = 0;
+    while (elapsed < max_cycles && !checkProgramCompletion()) {
+        uint64_t remaining = max_cycles - elapsed;
+        if (int stalls = pendingStallCycles<Policy>()) {
+            // ID waits on a producer in EX or MEM: only the stages below it do any work, and
+            // fetch can only fill an empty IF slot in the first of these cycles
+            uint64_t k = std::min<uint64_t>(stalls, remaining);
+            uint64_t stalled = 0;
+            stall = true;
+            for (uint64_t i = 0; i < k; ++i) {
+                writeBackImpl<Policy>();
+                memoryImpl<Policy>();
+                execute();
+                if (isTrapped()) {
+                    // The squash cleared ID, so this cycle does not stall; the rest is a drain
+                    rotateStages();
+                    k = i + 1;
+                    break;
+                }
+                if (i == 0) {
+                    instructionFetch();
+                }
+                rotateStages();
+                ++stalled;
+            }
+            sink<Policy>().incrementClockCycles(k);
+            sink<Policy>().incrementStalls(stalled);
+            elapsed += k;
+        } else if (int drain = pendingDrainCycles()) {
+            // Nothing left to fetch or decode: retire what is in EX, MEM and WB
+            uint64_t k = std::min<uint64_t>(drain, remaining);
+            bool was_trapped = isTrapped();
+            stall = false;
+            for (uint64_t i = 0; i < k; ++i) {
+                writeBackImpl<Policy>();
+                memoryImpl<Policy>();
+                execute();
+                rotateStages();
+                if (isTrapped() != was_trapped) {
+                    k = i + 1;  // The squash shortened the drain; count it again
+                    break;
+                }
+            }
+            sink<Policy>().incrementClockCycles(k);
+            elapsed += k;
+        } else {
+            cycleImpl<Policy>();
+            ++elapsed;
+        }
     }
+    return elapsed;
+}
+
+FunctionalSimulator::RunResult FunctionalSimulator::run(uint64_t max_cycles) {
+    RunLimits limits;
+    limits.max_cycles = max_cycles;
+    return runUntil(limits);
+}
 
-    uint8_t opcode = instr->getOpcode();
+FunctionalSimulator::RunResult FunctionalSimulator::runUntil(const RunLimits& limits) {
+    return dispatch([&](auto policy) { return runUntilImpl<decltype(policy)>(limits); });
+}
 
-    // R-type instructions always write to a register
-    if (instr->getInstructionType() == mips_lite::InstructionType::R_TYPE) {
-        return true;
+template <typename Policy>
+FunctionalSimulator::RunResult FunctionalSimulator::runUntilImpl(const RunLimits& limits) {
+    const uint64_t start_instructions = retired_instructions;
+    RunResult result{StopReason::HALTED, 0, 0};
+    if (limits.max_instructions == UINT64_MAX && !limits.stop_pc && !limits.stop_word) {
+        result.cycles = advanceImpl<Policy>(limits.max_cycles);
+        result.instructions = retired_instructions - start_instructions;
+        result.reason = checkProgramCompletion() ? finishReason() : StopReason::CYCLE_LIMIT;
+        return result;
     }
 
-    // Only some I-type instructions write to a register
-    return opcode == mips_lite::opcode::ADDI || opcode == mips_lite::opcode::SUBI ||
-           opcode == mips_lite::opcode::MULI || opcode == mips_lite::opcode::ORI ||
-           opcode == mips_lite::opcode::ANDI || opcode == mips_lite::opcode::XORI ||
-           opcode == mips_lite::opcode::LDW;
+    while (!checkProgramCompletion()) {
+        if (result.cycles >= limits.max_cycles) {
+            result.reason = StopReason::CYCLE_LIMIT;
+            break;
+        }
+        if (retired_instructions - start_instructions >= limits.max_instructions) {
+            result.reason = StopReason::INSTRUCTION_LIMIT;
+            break;
+        }
+        uint64_t retired_before = retired_instructions;
+        cycleImpl<Policy>();
+        ++result.cycles;
+        if (limits.stop_pc && retired_instructions != retired_before &&
+            last_retired_pc == *limits.stop_pc) {
+            result.reason = StopReason::PC_REACHED;
+            break;
+        }
+        if (limits.stop_word && retired_instructions != retired_before &&
+            last_retired_word == *limits.stop_word) {
+            result.reason = StopReason::WORD_RETIRED;
+            break;
+        }
+    }
+    if (checkProgramCompletion()) {
+        result.reason = finishReason();
+    }
+    result.instructions = retired_instructions - start_instructions;
+    return result;
 }
 
+template <typename Policy>
+int FunctionalSimulator::pendingStallCycles() const {
+    if (isStageEmpty(PipelineStage::DECODE)) {
+        return 0;
+    }
+    // A branch in EX is resolved before hazards are checked, and may flush ID instead; an
+    // invalid opcode traps and squashes ID
+    const auto& ex_data = stageData(PipelineStage::EXECUTE);
+    const mips_lite::OpcodeInfo& ex_info = mips_lite::opcode_info(ex_data.instruction.getOpcode());
+    if (ex_data.valid &&
+        (!ex_info.valid || ex_info.category == mips_lite::InstructionCategory::CONTROL_FLOW)) {
+        return 0;
+    }
+
+    // Same checks as detectStalls(); the producer then moves on one stage per cycle
+    if constexpr (Policy::forwarding) {
+        return executeHazards() && stageRegisters(PipelineStage::EXECUTE).load ? 1 : 0;
+    }
+    if (executeHazards()) {
+        return 2;  // Waits for the producer to leave EX and then MEM
+    }
+    return memoryHazards() ? 1 : 0;
+}
+
+int FunctionalSimulator::pendingDrainCycles() const {
+    if (!halt_pipeline || !isStageEmpty(PipelineStage::FETCH) ||
+        !isStageEmpty(PipelineStage::DECODE)) {
+        return 0;
+    }
+    const auto& ex_data = stageData(PipelineStage::EXECUTE);
+    const mips_lite::OpcodeInfo& ex_info = mips_lite::opcode_info(ex_data.instruction.getOpcode());
+    if (ex_data.valid && ex_data.instruction.getOpcode() != mips_lite::opcode::HALT &&
+        (!ex_info.valid || ex_info.category == mips_lite::InstructionCategory::CONTROL_FLOW)) {
+        return 0;
+    }
+    // The youngest instruction needs one cycle per stage it has left
+    for (int stage = PipelineStage::EXECUTE; stage < NUM_STAGES; ++stage) {
+        if (!isStageEmpty(stage)) {
+            return NUM_STAGES - stage;
+        }
+    }
+    return 0;
+}
+
+template <typename Policy>
 uint32_t FunctionalSimulator::readRegisterValue(uint8_t reg_num) {
     if (reg_num == 0) {
         return 0;  // $0 register always returns 0
@@ -412,28 +670,24 @@ uint32_t FunctionalSimulator::readRegisterValue(uint8_t reg_num) {
             "never "
             "attempt to read during a stall");
     }
-    // Check EXE stages for forwarding if necessary
-    if (!isStageEmpty(PipelineStage::EXECUTE)) {
-        PipelineStageData* ex_data = pipeline[PipelineStage::EXECUTE].get();
-        if (ex_data->dest_reg.has_value() && ex_data->dest_reg.value() == reg_num) {
-            // Hazard detected, return the ALU result from EX stage
-            if (ex_data->instruction->getOpcode() == mips_lite::opcode::LDW) {
-                throw std::runtime_error(
-                    "Hazard detected in EX stage for LDW instruction. Controller should have "
-                    "stalled pipeline...");
-            }
-            return ex_data->alu_result;
-        }
+    if constexpr (!Policy::forwarding) {
+        return register_file->read(reg_num);
     }
-    // Check MEM stage for forwarding if necessary
-    if (!isStageEmpty(PipelineStage::MEMORY)) {
-        PipelineStageData* mem_data = pipeline[PipelineStage::MEMORY].get();
-        if (mem_data->dest_reg.has_value() && mem_data->dest_reg.value() == reg_num) {
-            // Hazard detected, return the ALU result from MEM stage
-            return (mem_data->instruction->getOpcode() == mips_lite::opcode::LDW)
-                       ? mem_data->memory_data  // If load word, return memory data
-                       : mem_data->alu_result;  // Otherwise, return ALU result
+    // Forward from the youngest producer still in flight: EX first, then MEM
+    uint32_t bit = registerBit(reg_num);
+    if (stageRegisters(PipelineStage::EXECUTE).writes & bit) {
+        if (stageRegisters(PipelineStage::EXECUTE).load) {
+            throw std::runtime_error(
+                "Hazard detected in EX stage for LDW instruction. Controller should have "
+                "stalled pipeline...");
         }
+        return stageData(PipelineStage::EXECUTE).alu_result;
+    }
+    if (stageRegisters(PipelineStage::MEMORY).writes & bit) {
+        const PipelineStageData& mem_data = stageData(PipelineStage::MEMORY);
+        return stageRegisters(PipelineStage::MEMORY).load
+                   ? mem_data.memory_data  // If load word, return memory data
+                   : mem_data.alu_result;  // Otherwise, return ALU result
     }
     // No hazard, read from register file
     return register_file->read(reg_num);
@@ -448,130 +702,91 @@ uint32_t FunctionalSimulator::readRegisterValue(uint8_t reg_num) {
  *
  * @return returns ture if a hazard is detected, false otherwise. Takes into account forwarding.
  */
-bool FunctionalSimulator::detectStalls(void) {
-    if (isStageEmpty(PipelineStage::DECODE)) {
-        return false;  // No instruction to decode, no stalls needed
-    }
-
-    const auto& decode_stage = pipeline[PipelineStage::DECODE];
-    uint8_t rs = decode_stage->instruction->getRs();
-    uint8_t rt = decode_stage->instruction->getRt();
-    bool needs_rt = needsRtValue(decode_stage->instruction.get());
-
-    // Early exit if no meaningful source registers
-    if (rs == 0 && (!needs_rt || rt == 0)) {
-        return false;  // No hazard possible with only R0 sources
-    }
-
-    // Check for hazards with both stages
-    if (checkExecuteStageForHazard(rs, rt, needs_rt)) {
-        return true;
-    }
-
-    if (checkMemoryStageForHazard(rs, rt, needs_rt)) {
-        return true;
-    }
-
-    return false;  // No hazards detected
-}
-
-// Helper function to check if a register causes a hazard
-// R0 never causes hazards since it's always 0
-bool FunctionalSimulator::causesHazard(uint8_t reg, uint8_t dest_reg) const {
-    return reg != 0 && reg == dest_reg;
+template <typename Policy>
+bool FunctionalSimulator::detectStalls() const {
+    // The decode slot's reads mask is clear if it holds a bubble or reads only R0
+    if constexpr (Policy::forwarding) {
+        // [Special Case] Load-use hazard: forwarding can't resolve it until the load is in MEM
+        return executeHazards() && stageRegisters(PipelineStage::EXECUTE).load;
+    }
+    return (executeHazards() | memoryHazards()) != 0;
 }
 
-bool FunctionalSimulator::checkExecuteStageForHazard(uint8_t rs, uint8_t rt, bool needs_rt) const {
-    if (isStageEmpty(PipelineStage::EXECUTE)) {
-        return false;
+void FunctionalSimulator::flushStage(int stage) {
+    if (stageData(stage).valid) {
+        stageData(stage).valid = false;
+        slot_registers[stage_slot[stage]] = SlotRegisters();
+        --occupied_stages;
     }
-
-    const auto& ex_data = pipeline[PipelineStage::EXECUTE];
-    if (!ex_data->dest_reg.has_value()) {
-        return false;
-    }
-
-    uint8_t dest_reg = ex_data->dest_reg.value();
-
-    // Check if any source register causes a hazard
-    bool rs_hazard = causesHazard(rs, dest_reg);
-    bool rt_hazard = needs_rt && causesHazard(rt, dest_reg);
-
-    if (rs_hazard || rt_hazard) {
-        if (forward) {
-            if (ex_data->instruction &&
-                ex_data->instruction->getOpcode() == mips_lite::opcode::LDW) {
-                // [Special Case] Load-use hazard with forwarding
-                return true;  // Forwarding can't resolve this, so return true until
-                              // load is done in MEM stage
-            }
-            return false;  // No stalls needed with forwarding
-        } else {
-            return true;  // EX stage hazard without forwarding
-        }
-    }
-
-    return false;
 }
 
-bool FunctionalSimulator::checkMemoryStageForHazard(uint8_t rs, uint8_t rt, bool needs_rt) const {
-    if (isStageEmpty(PipelineStage::MEMORY)) {
-        return false;
-    }
-
-    const auto& mem_data = pipeline[PipelineStage::MEMORY];
-    if (!mem_data->dest_reg.has_value()) {
-        return false;
+void FunctionalSimulator::raiseTrap(int stage, mips_lite::TrapCause cause, uint32_t address) {
+    trap = mips_lite::Trap{cause, stageData(stage).pc, address};
+    pc = trap.pc;
+    for (int younger = PipelineStage::FETCH; younger <= stage; ++younger) {
+        flushStage(younger);
     }
-
-    uint8_t dest_reg = mem_data->dest_reg.value();
-
-    // Check if any source register causes a hazard
-    bool rs_hazard = causesHazard(rs, dest_reg);
-    bool rt_hazard = needs_rt && causesHazard(rt, dest_reg);
-
-    if (rs_hazard || rt_hazard) {
-        return !forward;  // Return true if forwarding is disabled
-    }
-
-    return false;
+    halt_pipeline = true;  // Fetch nothing more; what is left drains as after a HALT
+    branch_taken = false;
+    stall = false;
 }
 
-/**
- * @brief Helper function to determine if instruction needs Rt register value (source operand).
- * @param instr Instruction to check
- * @return true if Rt value is needed as a source operand
- */
-bool FunctionalSimulator::needsRtValue(const Instruction* instr) const {
-    if (!instr) return false;
-
-    uint8_t opcode = instr->getOpcode();
-
-    // R-type instructions use both Rs and Rt as source operands
-    if (instr->getInstructionType() == mips_lite::InstructionType::R_TYPE) {
-        return true;
-    }
+static_assert(SimulatorState::NUM_SLOTS == FunctionalSimulator::getNumStages(),
+              "SimulatorState holds every pipeline slot");
+
+SimulatorState FunctionalSimulator::getState() const {
+    SimulatorState state;
+    state.pc = pc;
+    state.slots = pipeline;
+    state.stage_slot = stage_slot;
+    state.branch_taken = branch_taken;
+    state.forward = forward;
+    state.halt_pipeline = halt_pipeline;
+    state.stall = stall;
+    state.trap = trap;
+    state.retired_instructions = retired_instructions;
+    state.last_retired_pc = last_retired_pc;
+    return state;
+}
 
-    // I-type instructions that use Rt as source operand
-    switch (opcode) {
-        case mips_lite::opcode::BEQ:  // BEQ compares Rs and Rt
-        case mips_lite::opcode::STW:  // STW stores value from Rt
-            return true;
-        default:
-            return false;  // Most I-type instructions only use Rs
-    }
+void FunctionalSimulator::setState(const SimulatorState& state) {
+    // Every stage must own a distinct slot, or rotating the stages would lose one
+    uint8_t owned = 0;
+    for (uint8_t slot : state.stage_slot) {
+        if (slot >= NUM_STAGES || (owned & (1u << slot)) != 0) {
+            throw std::invalid_argument("Invalid pipeline slot assignment");
+        }
+        owned |= static_cast<uint8_t>(1u << slot);
+    }
+    pc = state.pc;
+    pipeline = state.slots;
+    stage_slot = state.stage_slot;
+    branch_taken = state.branch_taken;
+    forward = state.forward;
+    halt_pipeline = state.halt_pipeline;
+    stall = state.stall;
+    trap = state.trap;
+    retired_instructions = state.retired_instructions;
+    last_retired_pc = state.last_retired_pc;
+    resyncPipelineState();
 }
 
-bool FunctionalSimulator::checkProgramCompletion() {
-    if (!halt_pipeline) {
-        return false;  // Halt instruction not encountered, program not finished
-    }
-    // If halt instruction was encountered, check if the pipeline is empty
-    for (const auto& stage : pipeline) {
-        if (stage && !stage->isEmpty()) {
-            return false;  // Pipeline is not empty, program still running
+void FunctionalSimulator::resyncPipelineState() {
+    occupied_stages = 0;
+    for (int slot = 0; slot < NUM_STAGES; ++slot) {
+        const PipelineStageData& data = pipeline[slot];
+        SlotRegisters& registers = slot_registers[slot];
+        registers = SlotRegisters();
+        if (!data.valid) {
+            continue;
+        }
+        ++occupied_stages;
+        const mips_lite::OpcodeInfo& info = mips_lite::opcode_info(data.instruction.getOpcode());
+        registers.reads = registerBit(data.instruction.getRs());
+        if (info.reads_rt) {
+            registers.reads |= registerBit(data.instruction.getRt());
         }
+        registers.writes = data.dest_reg ? registerBit(*data.dest_reg) : 0;
+        registers.load = info.latency > 1;
     }
-    // If we reach here, pipeline is empty and halt encountered
-    return true;
 }
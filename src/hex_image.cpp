@@ -0,0 +1,194 @@
+#include "hex_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint8_t INVALID_DIGIT = 0x80;
+
+/// Value of each character as a hex digit, or INVALID_DIGIT
+constexpr std::array<uint8_t, 256> makeDigitTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        table[c] = INVALID_DIGIT;
+    }
+    for (int d = 0; d < 10; ++d) {
+        table['0' + d] = static_cast<uint8_t>(d);
+    }
+    for (int d = 0; d < 6; ++d) {
+        table['A' + d] = static_cast<uint8_t>(10 + d);
+        table['a' + d] = static_cast<uint8_t>(10 + d);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> DIGITS = makeDigitTable();
+
+/// Characters trimmed from both ends of a line
+bool isTrimmed(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+/// Decode a word of one to eight hex digits; false if [begin, end) is anything else
+bool parseCanonical(const char* begin, const char* end, uint32_t& value) {
+    size_t length = static_cast<size_t>(end - begin);
+    if (length == 0 || length > 8) {
+        return false;
+    }
+    uint32_t result = 0;
+    uint8_t invalid = 0;
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t digit = DIGITS[static_cast<unsigned char>(begin[i])];
+        invalid |= digit;
+        result = (result << 4) | (digit & 0xF);
+    }
+    value = result;
+    return (invalid & INVALID_DIGIT) == 0;
+}
+
+/// Parse a trimmed line as the stream loader did, throwing its error if that fails
+uint32_t parseWithStream(const std::string& line) {
+    uint32_t value = 0;
+    std::stringstream ss;
+    ss << std::hex << line;
+    if (!(ss >> value)) {
+        throw std::runtime_error("Failed to parse instruction: " + line);
+    }
+    return value;
+}
+
+/// Parse a trimmed "ADDRESS: VALUE" line, colon pointing at its ':', into placed
+void parsePlaced(const char* begin, const char* colon, const char* end,
+                 std::vector<hex_image::PlacedWord>* placed) {
+    std::string line(begin, end);
+    if (placed == nullptr) {
+        throw std::runtime_error("Addressed line not allowed in this image: " + line);
+    }
+    const char* value_begin = colon + 1;
+    while (value_begin < end && isTrimmed(*value_begin)) {
+        ++value_begin;
+    }
+    hex_image::PlacedWord word{};
+    if (!parseCanonical(begin, colon, word.address) ||
+        !parseCanonical(value_begin, end, word.value)) {
+        throw std::runtime_error("Failed to parse instruction: " + line);
+    }
+    if (word.address % 4 != 0) {
+        throw std::runtime_error("Unaligned address in image: " + line);
+    }
+    placed->push_back(word);
+}
+
+/// Read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+   public:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Map path; data() is nullptr if the file can be opened but not mapped (empty, a pipe)
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open input file: " + path);
+        }
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE,
+                              fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(data);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+   private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace
+
+namespace hex_image {
+
+std::vector<uint32_t> parse(const char* data, size_t size, size_t max_words,
+                            std::vector<PlacedWord>* placed) {
+    std::vector<uint32_t> words;
+    words.reserve(size / 9);  // Typical line: 8 digits and a newline
+
+    const char* pos = data;
+    const char* end = data + size;
+    while (pos < end) {
+        const char* newline =
+            static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        const char* line_begin = pos;
+        const char* line_end = newline != nullptr ? newline : end;
+        pos = newline != nullptr ? newline + 1 : end;
+
+        while (line_begin < line_end && isTrimmed(*line_begin)) {
+            ++line_begin;
+        }
+        while (line_end > line_begin && isTrimmed(line_end[-1])) {
+            --line_end;
+        }
+        if (line_begin == line_end) {
+            continue;
+        }
+
+        uint32_t value = 0;
+        if (!parseCanonical(line_begin, line_end, value)) {
+            const char* colon = static_cast<const char*>(
+                std::memchr(line_begin, ':', static_cast<size_t>(line_end - line_begin)));
+            if (colon != nullptr) {
+                parsePlaced(line_begin, colon, line_end, placed);
+                continue;
+            }
+            value = parseWithStream(std::string(line_begin, line_end));
+        }
+        if (words.size() == max_words) {
+            throw std::runtime_error("File exceeds maximum memory size of 4GiB");
+        }
+        words.push_back(value);
+    }
+    return words;
+}
+
+std::vector<uint32_t> load(const std::string& path, size_t max_words,
+                           std::vector<PlacedWord>* placed) {
+    MappedFile file(path);
+    if (file.data() != nullptr) {
+        return parse(file.data(), file.size(), max_words, placed);
+    }
+
+    // Nothing to map: an empty file, or one that is not a regular file
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Failed to open input file: " + path);
+    }
+    std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return parse(text.data(), text.size(), max_words, placed);
+}
+
+}  // namespace hex_image
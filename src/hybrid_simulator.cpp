@@ -0,0 +1,96 @@
+/**
+ * @file hybrid_simulator.cpp
+ * @brief Implements switching between the fast and the pipelined simulator at
+ * region-of-interest markers.
+ */
+
+#include "hybrid_simulator.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+
+HybridSimulator::HybridSimulator(RegisterFile* rf, Stats* outside_stats, Stats* roi_stats,
+                                 IMemoryParser* mem, bool enable_forwarding)
+    : register_file(rf),
+      roi_stats(roi_stats),
+      memory_parser(mem),
+      forwarding(enable_forwarding),
+      fast(rf, outside_stats, mem) {
+    if (!roi_stats) {
+        throw std::invalid_argument("Stats instance cannot be null");
+    }
+    fast.setStopAtRoiBegin(true);
+}
+
+uint64_t HybridSimulator::run(uint64_t max_instructions) {
+    uint64_t retired = 0;
+    while (!finished && retired < max_instructions) {
+        if (!pipeline) {
+            retired += fast.run(max_instructions - retired);
+            if (fast.isHalted()) {
+                finished = true;
+            } else if (fast.isTrapped()) {
+                trap = fast.getTrap();
+                finished = true;
+            } else if (fast.isAtRoiBegin()) {
+                enterRegion();
+            } else {
+                break;  // Budget used up
+            }
+            continue;
+        }
+
+        FunctionalSimulator::RunLimits limits;
+        limits.max_instructions = max_instructions - retired;
+        limits.stop_word = mips_lite::roi::END;
+        FunctionalSimulator::RunResult result = pipeline->runUntil(limits);
+        retired += result.instructions;
+        region_instructions += result.instructions;
+        switch (result.reason) {
+            case FunctionalSimulator::StopReason::WORD_RETIRED:
+                leaveRegion();
+                break;
+            case FunctionalSimulator::StopReason::HALTED:
+                finished = true;
+                break;
+            case FunctionalSimulator::StopReason::TRAPPED:
+                trap = pipeline->getTrap();
+                finished = true;
+                break;
+            default:
+                break;  // Budget used up
+        }
+    }
+    return retired;
+}
+
+void HybridSimulator::reset(bool enable_forwarding) {
+    forwarding = enable_forwarding;
+    fast.reset();
+    pipeline.reset();
+    finished = false;
+    trap = mips_lite::Trap();
+    region_entries = 0;
+    region_instructions = 0;
+}
+
+void HybridSimulator::enterRegion() {
+    pipeline =
+        std::make_unique<FunctionalSimulator>(register_file, roi_stats, memory_parser, forwarding);
+    pipeline->setPC(fast.getPC());
+    ++region_entries;
+}
+
+void HybridSimulator::leaveRegion() {
+    // END is not a branch, so execution continues right behind it
+    fast.setPC(pipeline->getLastRetiredPC() + 4);
+    pipeline.reset();
+    // Stores made by the pipeline went through the memory parser, which invalidated any
+    // predecoded words they hit
+    fast.dropStaleTranslations();
+}
@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Program Libraries
+#include "binary_image.h"
+#include "hex_image.h"
+#include "mips_mem_parser.h"
+
+/**
+ * @brief main: converts memory images between the hex trace format and the binary image format
+ * @param -i: The filepath to the input image; a binary image is converted to hex, anything else
+ *            is read as a hex trace and converted to a binary image
+ * @param -o: The filepath to the output image
+ * @param -z: Shortest run of zero words stored without data in a binary image (default 256,
+ *            0 stores every word)
+ * @throws std::invalid_arguement if program is passed invalid values
+ */
+int main(int argc, char* argv[]) {
+    std::string input_filename_, output_filename_;
+    uint32_t min_zero_run_ = BinaryImage::DEFAULT_MIN_ZERO_RUN;
+
+    // Parse Input Arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-i" || arg == "-o" || arg == "-z") {
+            // Check if next arg exists and check if next arg is not an flag
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                throw std::invalid_argument("A value must be provided after " + arg +
+                                            " argument.");
+            }
+            std::string value = argv[++i];
+            if (arg == "-i") {
+                input_filename_ = value;
+            } else if (arg == "-o") {
+                output_filename_ = value;
+            } else {
+                size_t parsed = 0;
+                unsigned long run = 0;
+                try {
+                    run = std::stoul(value, &parsed);
+                } catch (const std::exception&) {
+                    parsed = 0;
+                }
+                if (parsed == 0 || parsed != value.size() || run > UINT32_MAX) {
+                    throw std::invalid_argument("Invalid zero run \"" + value +
+                                                "\" after -z argument.");
+                }
+                min_zero_run_ = static_cast<uint32_t>(run);
+            }
+        } else {
+            throw std::invalid_argument("Argument \"" + arg +
+                                        "\" to program is invalid, try again.");
+        }
+    }
+
+    if (input_filename_.empty() || !std::filesystem::exists(input_filename_)) {
+        throw std::invalid_argument("An existing input file must be provided with -i.");
+    }
+    if (output_filename_.empty()) {
+        throw std::invalid_argument("An output file must be provided with -o.");
+    }
+
+    if (BinaryImage::isBinaryImage(input_filename_)) {
+        // Binary to hex: one 8-digit word per line, zero runs written out
+        BinaryImage image(input_filename_);
+        std::ofstream file(output_filename_);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open output file for writing: " +
+                                     output_filename_);
+        }
+        file << std::uppercase << std::hex << std::setfill('0');
+        for (uint32_t word : image.words()) {
+            file << std::setw(8) << word << "\n";
+        }
+        std::cout << "Wrote " << image.numWords() << " words to " << output_filename_ << "\n";
+    } else {
+        std::vector<uint32_t> words = hex_image::load(input_filename_, MAX_VEC_SIZE);
+        BinaryImage::write(output_filename_, words, min_zero_run_);
+        std::cout << "Wrote " << words.size() << " words ("
+                  << std::filesystem::file_size(output_filename_) << " bytes) to "
+                  << output_filename_ << "\n";
+    }
+    return 0;
+}
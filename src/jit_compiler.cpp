@@ -0,0 +1,350 @@
+/**
+ * @file jit_compiler.cpp
+ * @brief Implements the x86-64 block compiler.
+ *
+ * Register usage inside a compiled block:
+ *  - rbx: guest register array (JitContext::regs)
+ *  - r12: JitContext
+ *  - eax, ecx, edx, esi, rdi: scratch and helper arguments
+ * rbx, r12 and r13 are saved in the prologue; the three pushes also keep the stack 16-byte
+ * aligned for helper calls.
+ */
+
+#include "jit_compiler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "block_translator.h"
+#include "mips_lite_defs.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define MIPS_LITE_JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+static_assert(std::is_standard_layout<JitContext>::value, "JitContext is accessed by offset");
+
+#ifdef MIPS_LITE_JIT_X86_64
+
+namespace {
+
+constexpr uint8_t CTX_NEXT_PC = offsetof(JitContext, next_pc);
+constexpr uint8_t CTX_STATUS = offsetof(JitContext, status);
+constexpr uint8_t CTX_OP_INDEX = offsetof(JitContext, op_index);
+static_assert(offsetof(JitContext, regs) == 0, "regs is loaded from [rdi]");
+static_assert(offsetof(JitContext, store_address) < 128, "context fields use 8-bit offsets");
+
+// Host register numbers
+constexpr uint8_t EAX = 0;
+constexpr uint8_t ECX = 1;
+constexpr uint8_t EDX = 2;
+constexpr uint8_t ESI = 6;
+
+/// Called by LDW; returns the loaded word
+uint32_t loadHelper(JitContext* ctx, uint32_t address) {
+    uint32_t value = 0;
+    if (mips_lite::TrapCause fault = ctx->memory->tryReadMemory(address, value);
+        fault != mips_lite::TrapCause::NONE) {
+        ctx->fault = fault;
+        ctx->fault_address = address;
+        ctx->status = jit_exit::FAULT;
+        return 0;
+    }
+    return value;
+}
+
+/// Called by STW; returns 0 to continue or a jit_exit code
+uint32_t storeHelper(JitContext* ctx, uint32_t address, uint32_t value) {
+    if (mips_lite::TrapCause fault = ctx->memory->tryWriteMemory(address, value);
+        fault != mips_lite::TrapCause::NONE) {
+        ctx->fault = fault;
+        ctx->fault_address = address;
+        return jit_exit::FAULT;
+    }
+    ctx->stats->addMemoryAddress(address);
+    if (ctx->translator->covers(address)) {
+        ctx->store_address = address;
+        return jit_exit::STORE_INTO_CODE;
+    }
+    return 0;
+}
+
+/**
+ * @class Emitter
+ * @brief Appends x86-64 instructions for one block to a byte buffer.
+ */
+class Emitter {
+   public:
+    std::vector<uint8_t> code;
+
+    void prologue() {
+        bytes({0x53});              // push rbx
+        bytes({0x41, 0x54});        // push r12
+        bytes({0x41, 0x55});        // push r13
+        bytes({0x49, 0x89, 0xFC});  // mov r12, rdi
+        bytes({0x48, 0x8B, 0x1F});  // mov rbx, [rdi]
+    }
+
+    /// Return eax to the caller
+    void epilogue() {
+        bytes({0x41, 0x5D});  // pop r13
+        bytes({0x41, 0x5C});  // pop r12
+        bytes({0x5B});        // pop rbx
+        bytes({0xC3});        // ret
+    }
+
+    void exitWith(uint32_t exit_code) {
+        movImm(EAX, exit_code);
+        epilogue();
+    }
+
+    /// Set next_pc and return exit_code
+    void exitTo(uint32_t next_pc, uint32_t exit_code) {
+        storeCtxImm(CTX_NEXT_PC, next_pc);
+        exitWith(exit_code);
+    }
+
+    /// op r32, [rbx + 4 * guest_reg]
+    void regOp(std::initializer_list<uint8_t> opcode, uint8_t host_reg, uint8_t guest_reg) {
+        bytes(opcode);
+        bytes({static_cast<uint8_t>(0x43 | (host_reg << 3)), static_cast<uint8_t>(guest_reg * 4)});
+    }
+    void loadGuest(uint8_t host_reg, uint8_t guest_reg) { regOp({0x8B}, host_reg, guest_reg); }
+    void storeGuest(uint8_t guest_reg, uint8_t host_reg) { regOp({0x89}, host_reg, guest_reg); }
+
+    /// mov r32, imm32
+    void movImm(uint8_t host_reg, uint32_t value) {
+        bytes({static_cast<uint8_t>(0xB8 + host_reg)});
+        imm32(value);
+    }
+
+    /// mov dword [r12 + offset], imm32
+    void storeCtxImm(uint8_t offset, uint32_t value) {
+        bytes({0x41, 0xC7, 0x44, 0x24, offset});
+        imm32(value);
+    }
+
+    /// mov [r12 + offset], r32
+    void storeCtx(uint8_t offset, uint8_t host_reg) {
+        bytes({0x41, 0x89, static_cast<uint8_t>(0x44 | (host_reg << 3)), 0x24, offset});
+    }
+
+    /// mov r32, [r12 + offset]
+    void loadCtx(uint8_t host_reg, uint8_t offset) {
+        bytes({0x41, 0x8B, static_cast<uint8_t>(0x44 | (host_reg << 3)), 0x24, offset});
+    }
+
+    /// Call a C++ helper with the context as its first argument
+    void callHelper(const void* helper) {
+        bytes({0x4C, 0x89, 0xE7});  // mov rdi, r12
+        bytes({0x48, 0xB8});        // mov rax, imm64
+        uint64_t address = reinterpret_cast<uint64_t>(helper);
+        for (int i = 0; i < 8; ++i) {
+            code.push_back(static_cast<uint8_t>(address >> (8 * i)));
+        }
+        bytes({0xFF, 0xD0});  // call rax
+    }
+
+    /// Emit a short forward jump and return the position of its displacement
+    size_t jumpShort(uint8_t opcode) {
+        bytes({opcode, 0x00});
+        return code.size() - 1;
+    }
+
+    /// Point a short jump at the current position
+    void bindShort(size_t displacement_pos) {
+        size_t distance = code.size() - (displacement_pos + 1);
+        if (distance > 127) {
+            throw std::logic_error("JIT short jump out of range");
+        }
+        code[displacement_pos] = static_cast<uint8_t>(distance);
+    }
+
+    void bytes(std::initializer_list<uint8_t> values) {
+        code.insert(code.end(), values.begin(), values.end());
+    }
+
+    void imm32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+};
+
+constexpr uint8_t JZ_SHORT = 0x74;
+constexpr uint8_t JNZ_SHORT = 0x75;
+
+/**
+ * @brief Emit an ALU instruction, leaving its result in eax.
+ * @return False if nothing was emitted because the result goes to R0.
+ */
+bool emitAlu(Emitter& e, const BlockInstr& instr) {
+    if (instr.dest == 0) {
+        return false;  // No architectural effect
+    }
+    namespace op = mips_lite::opcode;
+    e.loadGuest(EAX, instr.src1);
+    uint32_t imm = static_cast<uint32_t>(instr.imm);
+    switch (instr.opcode) {
+        case op::ADD: e.regOp({0x03}, EAX, instr.src2); break;
+        case op::SUB: e.regOp({0x2B}, EAX, instr.src2); break;
+        case op::MUL: e.regOp({0x0F, 0xAF}, EAX, instr.src2); break;
+        case op::OR: e.regOp({0x0B}, EAX, instr.src2); break;
+        case op::AND: e.regOp({0x23}, EAX, instr.src2); break;
+        case op::XOR: e.regOp({0x33}, EAX, instr.src2); break;
+        case op::ADDI: e.bytes({0x05}); e.imm32(imm); break;
+        case op::SUBI: e.bytes({0x2D}); e.imm32(imm); break;
+        case op::MULI: e.bytes({0x69, 0xC0}); e.imm32(imm); break;  // imul eax, eax, imm32
+        case op::ORI: e.bytes({0x0D}); e.imm32(imm); break;
+        case op::ANDI: e.bytes({0x25}); e.imm32(imm); break;
+        case op::XORI: e.bytes({0x35}); e.imm32(imm); break;
+        default: throw std::logic_error("JIT: not an ALU opcode");
+    }
+    e.storeGuest(instr.dest, EAX);
+    return true;
+}
+
+/// esi = src1 + imm
+void emitAddress(Emitter& e, const BlockInstr& instr) {
+    e.loadGuest(ESI, instr.src1);
+    e.bytes({0x81, 0xC6});  // add esi, imm32
+    e.imm32(static_cast<uint32_t>(instr.imm));
+}
+
+void emitLoad(Emitter& e, const BlockInstr& instr, uint32_t op_index) {
+    e.storeCtxImm(CTX_OP_INDEX, op_index);
+    emitAddress(e, instr);
+    e.callHelper(reinterpret_cast<const void*>(&loadHelper));
+    e.loadCtx(ECX, CTX_STATUS);
+    e.bytes({0x85, 0xC9});  // test ecx, ecx
+    size_t ok = e.jumpShort(JZ_SHORT);
+    e.bytes({0x89, 0xC8});  // mov eax, ecx
+    e.epilogue();
+    e.bindShort(ok);
+    if (instr.dest != 0) {
+        e.storeGuest(instr.dest, EAX);
+    }
+}
+
+void emitStore(Emitter& e, const BlockInstr& instr, uint32_t op_index) {
+    e.storeCtxImm(CTX_OP_INDEX, op_index);
+    emitAddress(e, instr);
+    e.loadGuest(EDX, instr.src2);
+    e.callHelper(reinterpret_cast<const void*>(&storeHelper));
+    e.bytes({0x85, 0xC0});  // test eax, eax
+    size_t ok = e.jumpShort(JZ_SHORT);
+    e.epilogue();  // eax holds the exit code
+    e.bindShort(ok);
+}
+
+/// Exit to target if the flags say "equal", otherwise fall through past the branch
+void emitConditionalExit(Emitter& e, uint32_t target, uint32_t not_taken_pc) {
+    size_t not_taken = e.jumpShort(JNZ_SHORT);
+    e.exitTo(target, jit_exit::TAKEN);
+    e.bindShort(not_taken);
+    e.exitTo(not_taken_pc, jit_exit::FALLTHROUGH);
+}
+
+}  // namespace
+
+bool JitCompiler::isSupported() { return true; }
+
+JitCompiler::JitCompiler(size_t code_capacity) : code_capacity_(code_capacity) {
+    void* arena = mmap(nullptr, code_capacity_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED) {
+        throw std::runtime_error("Failed to map JIT code arena");
+    }
+    code_ = static_cast<uint8_t*>(arena);
+}
+
+JitCompiler::~JitCompiler() { munmap(code_, code_capacity_); }
+
+void JitCompiler::reset() { code_size_ = 0; }
+
+JitCompiler::BlockFunction JitCompiler::compile(const TranslatedBlock& block) {
+    namespace op = mips_lite::opcode;
+    Emitter e;
+    e.prologue();
+
+    for (size_t i = 0; i < block.ops.size(); ++i) {
+        const BlockOp& o = block.ops[i];
+        const uint32_t index = static_cast<uint32_t>(i);
+        const uint32_t fallthrough_pc = block.end_pc + 4;
+
+        if (o.kind < block_op::NUM_ALU_OPCODES) {
+            emitAlu(e, o.first);
+        } else if (o.kind >= block_op::LDW_ALU_BASE && o.kind < block_op::ALU_BZ_BASE) {
+            emitLoad(e, o.first, index);
+            emitAlu(e, o.second);
+        } else if (o.kind >= block_op::ALU_BZ_BASE) {
+            // The BZ tests the ALU result directly when it reads the register just written
+            bool in_eax = emitAlu(e, o.first) && o.second.src1 == o.first.dest;
+            if (!in_eax) {
+                e.loadGuest(EAX, o.second.src1);
+            }
+            e.bytes({0x85, 0xC0});  // test eax, eax
+            emitConditionalExit(e, static_cast<uint32_t>(o.second.imm), fallthrough_pc);
+        } else {
+            switch (o.kind) {
+                case op::LDW: emitLoad(e, o.first, index); break;
+                case op::STW: emitStore(e, o.first, index); break;
+                case op::BZ:
+                    e.loadGuest(EAX, o.first.src1);
+                    e.bytes({0x85, 0xC0});  // test eax, eax
+                    emitConditionalExit(e, static_cast<uint32_t>(o.first.imm), fallthrough_pc);
+                    break;
+                case op::BEQ:
+                    e.loadGuest(EAX, o.first.src1);
+                    e.regOp({0x3B}, EAX, o.first.src2);  // cmp eax, [src2]
+                    emitConditionalExit(e, static_cast<uint32_t>(o.first.imm), fallthrough_pc);
+                    break;
+                case op::JR:
+                    e.loadGuest(EAX, o.first.src1);
+                    e.storeCtx(CTX_NEXT_PC, EAX);
+                    e.exitWith(jit_exit::TAKEN);
+                    break;
+                case op::HALT: e.exitWith(jit_exit::HALT); break;
+                case block_op::EXIT: e.exitTo(block.end_pc, jit_exit::FALLTHROUGH); break;
+                default: throw std::logic_error("JIT: unknown block op");
+            }
+        }
+    }
+
+    if (code_size_ + e.code.size() > code_capacity_) {
+        return nullptr;
+    }
+
+    // Keep the arena writable only while copying code in
+    if (mprotect(code_, code_capacity_, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("Failed to unprotect JIT code arena");
+    }
+    uint8_t* entry = code_ + code_size_;
+    std::memcpy(entry, e.code.data(), e.code.size());
+    code_size_ += e.code.size();
+    if (mprotect(code_, code_capacity_, PROT_READ | PROT_EXEC) != 0) {
+        throw std::runtime_error("Failed to protect JIT code arena");
+    }
+    return reinterpret_cast<BlockFunction>(entry);
+}
+
+#else  // No native backend on this host
+
+bool JitCompiler::isSupported() { return false; }
+
+JitCompiler::JitCompiler(size_t code_capacity) : code_capacity_(code_capacity) {
+    throw std::runtime_error("The JIT is only supported on x86-64 Linux");
+}
+
+JitCompiler::~JitCompiler() = default;
+
+void JitCompiler::reset() { code_size_ = 0; }
+
+JitCompiler::BlockFunction JitCompiler::compile(const TranslatedBlock&) { return nullptr; }
+
+#endif
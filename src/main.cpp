@@ -1,19 +1,26 @@
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <unordered_set>
 
 // Program Libraries
+#include "checkpoint.h"
+#include "fast_simulator.h"
 #include "functional_simulator.h"
+#include "hybrid_simulator.h"
 #include "mips_instruction.h"
 #include "mips_lite_defs.h"
 #include "mips_mem_parser.h"
 #include "register_file.h"
+#include "sampled_simulation.h"
 #include "stats.h"
 
-const uint32_t timeout_cycles_ = 100000;
+const uint64_t default_budget_ = 100000;
 
 /**
  * @brief main: main program for MIPS-lite simulator
@@ -22,6 +29,33 @@ const uint32_t timeout_cycles_ = 100000;
  * @param -m: Enables printing of memory content to stdout
  * @param -t: Enables printing of timing information for functional simulator
  * @param -f: Enables forwarding for functional simulator
+ * @param -s: Runs the fast functional simulator instead of the pipeline; with -t, timing comes
+ *            from the analytic pipeline model
+ * @param -j: Like -s, with translated blocks compiled to native x86-64 code where supported
+ * @param -c: Budget before the run is abandoned: clock cycles for the pipeline, instructions with
+ *            -s/-j/-P/-H (default 100000)
+ * @param -e: What to do when the program traps (faults): "abort" (default) reports the trap and
+ *            exits with status 1; "continue" reports it with the final state and exits with 0, so
+ *            a batch of runs carries on
+ * @param -M: Guest memory backend: "paged" (default) allocates 4 KiB pages through a page table;
+ *            "flat" maps the whole 32-bit address space once so every access is a single host
+ *            load or store; "huge" is "flat" with transparent huge pages requested
+ * @param -S: Save a checkpoint of the pipeline simulation to this file when the run stops, e.g.
+ *            at the -c budget (not with -s/-j)
+ * @param -R: Restore a checkpoint saved with -S from this file before running, continuing
+ *            exactly where it stopped; the input must be the image it was taken from
+ * @param -O: What -o writes: "full" (default) every word, one hex word per line as in the input;
+ *            "dirty" "ADDRESS: VALUE" lines for the words of every page stored to; "diff" only
+ *            the words that differ from the input image, in the same form
+ * @param -P: Estimate the pipeline's clock cycles, stalls and CPI by sampled simulation with
+ *            intervals of this many instructions, instead of simulating every cycle; with -f the
+ *            pipeline forwards. Only the estimate is reported (paged memory only, not with
+ *            -s/-j/-S/-R)
+ * @param -H: Hybrid simulation: the fast functional simulator outside the program's region of
+ *            interest (ROI_BEGIN/ROI_END markers) and the pipeline inside it, with -f forwarding.
+ *            Region statistics are reported separately; clock cycles and stalls cover the region
+ *            only (not with -s/-j/-P/-S/-R)
+ * @return 0, or 1 if the program trapped under -e abort
  * @throws std::invalid_arguement if program is passed invalid values
  */
 int main(int argc, char* argv[]) {
@@ -32,8 +66,17 @@ int main(int argc, char* argv[]) {
     output_tracename_ = "output/traceout.txt";
     bool time_info_ = false;
     bool forward_ = false;
+    bool fast_mode_ = false;
+    bool native_mode_ = false;
     bool enable_mem_save_ = false;
     bool enable_mem_print_ = false;
+    uint64_t budget_ = default_budget_;
+    bool abort_on_trap_ = true;
+    std::string memory_backend_ = "paged";
+    std::string output_format_ = "full";
+    std::string save_checkpoint_, restore_checkpoint_;
+    uint64_t sample_interval_ = 0;  // Sampled simulation if nonzero
+    bool hybrid_mode_ = false;
 
     // Parse Input Arguments
     for (int i = 1; i < argc; i++) {
@@ -65,18 +108,116 @@ int main(int argc, char* argv[]) {
             output_tracename_ = argv[i + 1];  // Saves output filepath into outFile
             enable_mem_save_ = true;          // Enable memory save to file
             i++;                              // Skips arg with filepath
+        } else if (arg == "-c") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Budget must be provided after -c argument.");
+            }
+            std::string value = argv[i + 1];
+            size_t parsed = 0;
+            try {
+                budget_ = std::stoull(value, &parsed);
+            } catch (const std::exception&) {
+                parsed = 0;
+            }
+            if (parsed == 0 || parsed != value.size() || value[0] == '-' || budget_ == 0) {
+                throw std::invalid_argument("Invalid budget \"" + value + "\" after -c argument.");
+            }
+            i++;  // Skips arg with budget
+        } else if (arg == "-P") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Interval length must be provided after -P argument.");
+            }
+            std::string value = argv[i + 1];
+            size_t parsed = 0;
+            try {
+                sample_interval_ = std::stoull(value, &parsed);
+            } catch (const std::exception&) {
+                parsed = 0;
+            }
+            if (parsed == 0 || parsed != value.size() || value[0] == '-' ||
+                sample_interval_ == 0) {
+                throw std::invalid_argument("Invalid interval length \"" + value +
+                                            "\" after -P argument.");
+            }
+            i++;  // Skips arg with interval length
+        } else if (arg == "-e") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Trap mode must be provided after -e argument.");
+            }
+            std::string mode = argv[i + 1];
+            if (mode == "abort") {
+                abort_on_trap_ = true;
+            } else if (mode == "continue") {
+                abort_on_trap_ = false;
+            } else {
+                throw std::invalid_argument("Invalid trap mode \"" + mode +
+                                            "\" after -e argument, expected abort or continue.");
+            }
+            i++;  // Skips arg with mode
+        } else if (arg == "-M") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Memory backend must be provided after -M argument.");
+            }
+            memory_backend_ = argv[i + 1];
+            if (memory_backend_ != "paged" && memory_backend_ != "flat" &&
+                memory_backend_ != "huge") {
+                throw std::invalid_argument("Invalid memory backend \"" + memory_backend_ +
+                                            "\" after -M argument, expected paged, flat or huge.");
+            }
+            i++;  // Skips arg with backend
+        } else if (arg == "-S" || arg == "-R") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Checkpoint filepath must be provided after " + arg +
+                                            " argument.");
+            } else if (argv[i + 1][0] == '-') {
+                throw std::invalid_argument("Missing filepath after " + arg + " argument.");
+            }
+            (arg == "-S" ? save_checkpoint_ : restore_checkpoint_) = argv[i + 1];
+            i++;  // Skips arg with filepath
+        } else if (arg == "-O") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Output format must be provided after -O argument.");
+            }
+            output_format_ = argv[i + 1];
+            if (output_format_ != "full" && output_format_ != "dirty" && output_format_ != "diff") {
+                throw std::invalid_argument("Invalid output format \"" + output_format_ +
+                                            "\" after -O argument, expected full, dirty or diff.");
+            }
+            i++;  // Skips arg with format
         } else if (arg == "-m") {
             enable_mem_print_ = true;  // Enable memory print to stdout
         } else if (arg == "-t") {
             time_info_ = true;  // Enable printing of timing information
         } else if (arg == "-f") {
             forward_ = true;  // Enable forwarding for functional simulator
+        } else if (arg == "-s") {
+            fast_mode_ = true;  // Skip pipeline timing, run the fast functional simulator
+        } else if (arg == "-j") {
+            fast_mode_ = true;  // Fast functional simulator with native code for hot blocks
+            native_mode_ = true;
+        } else if (arg == "-H") {
+            hybrid_mode_ = true;  // Pipeline inside the region of interest, fast outside
         } else {
             throw std::invalid_argument("Argument \"" + arg +
                                         "\" to program is invalid, try again.");
         }
     }
 
+    if (fast_mode_ && (!save_checkpoint_.empty() || !restore_checkpoint_.empty())) {
+        throw std::invalid_argument("Checkpoints (-S, -R) need the pipeline simulator, not -s/-j.");
+    }
+    if (sample_interval_ != 0 && (fast_mode_ || !save_checkpoint_.empty() ||
+                                  !restore_checkpoint_.empty() || memory_backend_ != "paged")) {
+        throw std::invalid_argument(
+            "Sampled simulation (-P) needs paged memory (-M) and cannot be combined with -s/-j, "
+            "-S or -R.");
+    }
+    if (hybrid_mode_ && (fast_mode_ || sample_interval_ != 0 || !save_checkpoint_.empty() ||
+                         !restore_checkpoint_.empty())) {
+        throw std::invalid_argument(
+            "Hybrid simulation (-H) cannot be combined with -s/-j, -P, -S or -R.");
+    }
+
 // Print Current Settings to stdout
 #ifdef DEBUG_MODE
     std::cout << "Current Settings: " << "\n";
@@ -86,91 +227,231 @@ int main(int argc, char* argv[]) {
               << "\n";
     std::cout << "\t Print Timing Info:\t" << (time_info_ ? "ENABLED" : "DISABLED") << "\n";
     std::cout << "\t Forwarding:\t\t" << (forward_ ? "ENABLED" : "DISABLED") << "\n";
+    std::cout << "\t Fast Mode:\t\t" << (fast_mode_ ? "ENABLED" : "DISABLED") << "\n";
+    std::cout << "\t Native Code (JIT):\t" << (native_mode_ ? "ENABLED" : "DISABLED") << "\n";
+    std::cout << "\t Budget:\t\t" << budget_ << "\n";
+    std::cout << "\t On Trap:\t\t" << (abort_on_trap_ ? "ABORT" : "CONTINUE") << "\n";
+    std::cout << "\t Memory Backend:\t" << memory_backend_ << "\n";
+    std::cout << "\t Output Format:\t\t" << output_format_ << "\n";
+    std::cout << "\t Save Checkpoint:\t" << save_checkpoint_ << "\n";
+    std::cout << "\t Restore Checkpoint:\t" << restore_checkpoint_ << "\n";
+    std::cout << "\t Sample Interval:\t" << sample_interval_ << "\n";
+    std::cout << "\t Hybrid Mode:\t\t" << (hybrid_mode_ ? "ENABLED" : "DISABLED") << "\n";
 #endif
 
-    // Create Stats, Register File, and Memory Parser class instance
-    Stats stats;
-    RegisterFile rf;
-    MemoryParser mp(input_tracename_);
+    auto describe_trap = [](const mips_lite::Trap& trap) {
+        return std::string(mips_lite::trap_cause_name(trap.cause)) + " at PC " +
+               std::to_string(trap.pc) + ", address " + std::to_string(trap.address);
+    };
+
+    // Sampled simulation: estimate the pipeline timing from representative intervals
+    if (sample_interval_ != 0) {
+        MemoryParser mp(input_tracename_);
+        mp.setOutputFileOnModified(false);
+        sampling::Config config;
+        config.interval_length = sample_interval_;
+        config.warmup_length = std::min(config.warmup_length, sample_interval_);
+        config.max_instructions = budget_;
+        config.forwarding = forward_;
+        sampling::Estimate estimate = sampling::estimate(mp, config);
+        std::string trap_;  // Description of the trap the program took, if any
+        if (estimate.trap.cause != mips_lite::TrapCause::NONE) {
+            trap_ = describe_trap(estimate.trap);
+        } else if (!estimate.halted) {
+            std::cerr << "Simulator did not halt within " << budget_ << " instructions"
+                      << "\n";
+        }
+        if (!trap_.empty() && abort_on_trap_) {
+            std::cerr << "Trap: " << trap_ << "\n";
+            return 1;
+        }
+        if (!trap_.empty()) {
+            std::cout << "\nTrap: " << trap_ << "\n";
+        }
+        std::cout << "\nSampled Simulation:\n\n";
+        std::cout << "\tTotal number of instructions:\t" << estimate.total_instructions << " ("
+                  << estimate.num_intervals << " intervals of " << sample_interval_ << ")\n";
+        std::cout << "\tSimulated intervals:\t\t" << estimate.samples.size() << " ("
+                  << estimate.detailed_instructions << " instructions with warm-up)\n";
+        std::cout << "\tEstimated clock cycles:\t\t" << std::llround(estimate.clock_cycles)
+                  << "\n";
+        std::cout << "\tEstimated stalls:\t\t" << std::llround(estimate.stalls) << "\n";
+        std::cout << "\tEstimated CPI:\t\t\t" << estimate.cpi << "\n";
+        return 0;
+    }
+
+    // Simulate and report over the Memory Parser of the chosen backend; both are final types, so
+    // the pipeline reaches either without virtual calls
+    auto simulate = [&](auto& mp) -> int {
+        // Create Stats and Register File; mp is the Memory Parser for the chosen backend
+        Stats stats;
+        RegisterFile rf;
+        Stats roi_stats;  // Region of interest of a hybrid run
+        uint64_t region_entries_ = 0;
+
+        uint32_t final_pc_ = 0;
+        std::string trap_;  // Description of the trap the program took, if any
+        if (fast_mode_) {
+            // Fast functional simulation: no pipeline, so the budget counts instructions
+            FastSimulator iss(&rf, &stats, &mp);
+            if (native_mode_ && !iss.setNativeCompilation(true)) {
+                std::cerr << "Native code generation is not available, interpreting instead"
+                          << "\n";
+            }
+            if (time_info_) {
+                iss.setTiming(true, forward_);  // Derive cycles and stalls from the retired stream
+            }
+            iss.run(budget_);
+            if (iss.isTrapped()) {
+                trap_ = describe_trap(iss.getTrap());
+            } else if (!iss.isHalted()) {
+                std::cerr << "Simulator did not halt within " << budget_ << " instructions"
+                          << "\n";
+            }
+            final_pc_ = iss.getPC();
+        } else if (hybrid_mode_) {
+            // Fast outside the region of interest, so the budget counts instructions
+            HybridSimulator hybrid(&rf, &stats, &roi_stats, &mp, forward_);
+            hybrid.run(budget_);
+            if (hybrid.isTrapped()) {
+                trap_ = describe_trap(hybrid.getTrap());
+            } else if (!hybrid.isProgramFinished()) {
+                std::cerr << "Simulator did not halt within " << budget_ << " instructions"
+                          << "\n";
+            }
+            final_pc_ = hybrid.getPC();
+            region_entries_ = hybrid.getRegionEntries();
+            stats.merge(roi_stats);  // The report below covers the whole program
+        } else {
+            // Pass to Functional Simulator
+            std::unique_ptr<FunctionalSimulator> fs;
+            fs = std::make_unique<FunctionalSimulator>(&rf, &stats, &mp, forward_);
+            if (!restore_checkpoint_.empty()) {
+                checkpoint::restore(restore_checkpoint_, *fs, rf, stats, mp);
+            }
+
+            FunctionalSimulator::RunResult result = fs->run(budget_);
+            if (!save_checkpoint_.empty()) {
+                checkpoint::save(save_checkpoint_, *fs, rf, stats, mp);
+            }
+            if (result.reason == FunctionalSimulator::StopReason::TRAPPED) {
+                trap_ = describe_trap(fs->getTrap());
+            } else if (result.reason != FunctionalSimulator::StopReason::HALTED) {
+                std::cerr << "Simulator did not halt within " << budget_ << " cycles"
+                          << "\n";
+            }
+            final_pc_ = fs->getPC();
+        }
 
-    // Pass to Functional Simulator
-    std::unique_ptr<FunctionalSimulator> fs;
-    fs = std::make_unique<FunctionalSimulator>(&rf, &stats, &mp, forward_);
+        if (!trap_.empty() && abort_on_trap_) {
+            std::cerr << "Trap: " << trap_ << "\n";
+            return 1;
+        }
 
-    while (!fs->isProgramFinished()) {
-        fs->cycle();
+        // If memory save is enabled
+        if (enable_mem_save_) {
+            mp.setOutputFilename(output_tracename_);
+            mp.setOutputFormat(output_format_ == "dirty" ? OutputFormat::DIRTY :
+                               output_format_ == "diff"  ? OutputFormat::DIFF :
+                                                           OutputFormat::FULL);
+            mp.setOutputFileOnModified(true);
+            // Written in the background while the report is printed; the parser waits for it
+            if (mp.isModified()) {
+                mp.writeOutputFileAsync();
+            }
+        }
 
-        if (stats.getClockCycles() >= timeout_cycles_) {
-            std::cerr << "Simulator did not halt within " << timeout_cycles_ << " cycles" << "\n";
-            break;
+        // If printing to stdout is desired
+        if (enable_mem_print_) {
+            mp.printMemoryContent();
         }
-    }
 
-    // If memory save is enabled
-    if (enable_mem_save_) {
-        mp.setOutputFilename(output_tracename_);
-        mp.setOutputFileOnModified(true);
-    }
+        // Report the trap along with the state the program left behind
+        if (!trap_.empty()) {
+            std::cout << "\nTrap: " << trap_ << "\n";
+        }
 
-    // If printing to stdout is desired
-    if (enable_mem_print_) {
-        mp.printMemoryContent();
-    }
+        // Print Instruction Counts
+        std::cout << "\nInstruction Counts:\n\n";
+        std::cout << "\tTotal number of instructions:\t"
+                  << std::to_string(stats.totalInstructions()) << "\n";
+        std::cout << "\tArithmetic instructions:\t"
+                  << std::to_string(
+                         stats.getCategoryCount(mips_lite::InstructionCategory::ARITHMETIC))
+                  << "\n";
+        std::cout << "\tLogical instructions:\t\t"
+                  << std::to_string(stats.getCategoryCount(mips_lite::InstructionCategory::LOGICAL))
+                  << "\n";
+        std::cout << "\tMemory Access instructions:\t"
+                  << std::to_string(
+                         stats.getCategoryCount(mips_lite::InstructionCategory::MEMORY_ACCESS))
+                  << "\n";
+        std::cout << "\tControl Flow instructions:\t"
+                  << std::to_string(
+                         stats.getCategoryCount(mips_lite::InstructionCategory::CONTROL_FLOW))
+                  << "\n";
 
-    // Print Instruction Counts
-    std::cout << "\nInstruction Counts:\n\n";
-    std::cout << "\tTotal number of instructions:\t" << std::to_string(stats.totalInstructions())
-              << "\n";
-    std::cout << "\tArithmetic instructions:\t"
-              << std::to_string(stats.getCategoryCount(mips_lite::InstructionCategory::ARITHMETIC))
-              << "\n";
-    std::cout << "\tLogical instructions:\t\t"
-              << std::to_string(stats.getCategoryCount(mips_lite::InstructionCategory::LOGICAL))
-              << "\n";
-    std::cout << "\tMemory Access instructions:\t"
-              << std::to_string(
-                     stats.getCategoryCount(mips_lite::InstructionCategory::MEMORY_ACCESS))
-              << "\n";
-    std::cout << "\tControl Flow instructions:\t"
-              << std::to_string(
-                     stats.getCategoryCount(mips_lite::InstructionCategory::CONTROL_FLOW))
-              << "\n";
+        // Print Final Register State
+        std::set<uint8_t> final_registers_(stats.getRegisters().begin(),
+                                           stats.getRegisters().end());
 
-    // Print Final Register State
-    std::set<uint8_t> final_registers_(stats.getRegisters().begin(), stats.getRegisters().end());
+        std::cout << "\nFinal Register State:\n\n";
 
-    std::cout << "\nFinal Register State:\n\n";
+        // Print Program Counter
+        std::cout << "\tProgram Counter:\t" << std::to_string(final_pc_) << "\n";
 
-    // Print Program Counter
-    std::cout << "\tProgram Counter:\t" << std::to_string(fs->getPC()) << "\n";
+        // Print registers that have been used
+        for (auto item = final_registers_.begin(); item != final_registers_.end(); item++) {
+            std::cout << "\tR" << std::to_string(*item) << ": "
+                      << std::to_string(static_cast<int32_t>(rf.read(*item))) << "\n";
+        }
 
-    // Print registers that have been used
-    for (auto item = final_registers_.begin(); item != final_registers_.end(); item++) {
-        std::cout << "\tR" << std::to_string(*item) << ": "
-                  << std::to_string(static_cast<int32_t>(rf.read(*item))) << "\n";
-    }
+        // Print Total Number of Stalls
+        if (time_info_) {
+            std::cout << "\tTotal Stalls:\t" << std::to_string(stats.getStalls()) << "\n";
+        }
 
-    // Print Total Number of Stalls
-    if (time_info_) {
-        std::cout << "\tTotal Stalls:\t" << std::to_string(stats.getStalls()) << "\n";
-    }
+        // Print Final Memory State
+        std::set<uint32_t> final_memory_(stats.getMemoryAddresses().begin(),
+                                         stats.getMemoryAddresses().end());
 
-    // Print Final Memory State
-    std::set<uint32_t> final_memory_(stats.getMemoryAddresses().begin(),
-                                     stats.getMemoryAddresses().end());
+        // Print memory locations and values that have been accessed
+        for (auto item = final_memory_.begin(); item != final_memory_.end(); item++) {
+            std::cout << "\tAddress: " << std::to_string(*item)
+                      << ", Contents: " << std::to_string(mp.readMemory(*item)) << "\n";
+        }
 
-    // Print memory locations and values that have been accessed
-    for (auto item = final_memory_.begin(); item != final_memory_.end(); item++) {
-        std::cout << "\tAddress: " << std::to_string(*item)
-                  << ", Contents: " << std::to_string(mp.readMemory(*item)) << "\n";
-    }
+        // Print timing info if enabled
+        if (time_info_) {
+            std::cout << "\nTiming Simulator:\n\n";
+            std::cout << "\tTotal number of clock cycles: "
+                      << std::to_string(stats.getClockCycles()) << "\n";
+        }
 
-    // Print timing info if enabled
-    if (time_info_) {
-        std::cout << "\nTiming Simulator:\n\n";
-        std::cout << "\tTotal number of clock cycles: " << std::to_string(stats.getClockCycles())
-                  << "\n";
-    }
+        // Print the region of interest apart from the rest of a hybrid run
+        if (hybrid_mode_) {
+            uint64_t roi_instructions = roi_stats.totalInstructions();
+            std::cout << "\nRegion of Interest:\n\n";
+            std::cout << "\tTimes entered:\t\t\t" << region_entries_ << "\n";
+            std::cout << "\tInstructions inside:\t\t" << roi_instructions << "\n";
+            std::cout << "\tInstructions outside:\t\t"
+                      << stats.totalInstructions() - roi_instructions << "\n";
+            std::cout << "\tClock cycles:\t\t\t" << roi_stats.getClockCycles() << "\n";
+            std::cout << "\tStalls:\t\t\t\t" << roi_stats.getStalls() << "\n";
+            if (roi_instructions != 0) {
+                std::cout << "\tCPI:\t\t\t\t"
+                          << static_cast<double>(roi_stats.getClockCycles()) / roi_instructions
+                          << "\n";
+            }
+        }
 
-    return 0;
+        return 0;
+    };
+
+    if (memory_backend_ == "paged") {
+        MemoryParser mp(input_tracename_);
+        return simulate(mp);
+    }
+    FlatMemoryParser mp(input_tracename_, "", FlatMemory(memory_backend_ == "huge"));
+    return simulate(mp);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include "program_image.h"
+
 Instruction::Instruction(uint32_t instruction) : instruction_(instruction) {
     opcode_ = mips_lite::get_opcode(instruction_);
     instruction_type_ = mips_lite::get_instruction_type(opcode_);
@@ -20,3 +22,18 @@ Instruction::Instruction(uint32_t instruction) : instruction_(instruction) {
         immediate_ = static_cast<int32_t>(mips_lite::get_immediate(instruction_));
     }
 }
+
+Instruction::Instruction(const DecodedOp& op)
+    : instruction_(op.word),
+      opcode_(op.opcode),
+      rs_(op.rs),
+      rt_(op.rt),
+      control_word_(op.control_word),
+      instruction_type_(op.r_type ? mips_lite::InstructionType::R_TYPE
+                                  : mips_lite::InstructionType::I_TYPE) {
+    if (op.r_type) {
+        rd_ = op.rd;
+    } else {
+        immediate_ = op.immediate;
+    }
+}
@@ -2,104 +2,416 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
+#include <charconv>
 #include <cstdint>
+#include <filesystem>
 #include <fstream>
-#include <iomanip>
+#include <future>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "binary_image.h"
+#include "hex_image.h"
+
+namespace {
+
+constexpr uint64_t DUMP_LINE_SIZE = 9;         // 8 hex digits and a newline
+constexpr size_t DIFF_LINE_SIZE = 19;          // "AAAAAAAA: VVVVVVVV\n"
+constexpr size_t OUTPUT_CHUNK_SIZE = 1 << 20;  // Bytes buffered before writing to stdout
+constexpr char UPPER_HEX[] = "0123456789ABCDEF";
+constexpr char LOWER_HEX[] = "0123456789abcdef";
+constexpr uint32_t WORD_PAGE_SHIFT = DirtyPageMap::PAGE_SHIFT - 2;  // Word index to page
+constexpr uint32_t WORDS_PER_PAGE = 1u << WORD_PAGE_SHIFT;
+
+/// Write value as 8 hex digits at out; returns the end of them
+char* formatHex(char* out, uint32_t value, const char* digits) {
+    for (int d = 7; d >= 0; --d) {
+        out[d] = digits[value & 0xF];
+        value >>= 4;
+    }
+    return out + 8;
+}
+
+/// Dump lines for words [begin, end) of memory, in one buffer
+template <typename Storage>
+std::string formatLines(const Storage& memory, uint32_t begin, uint32_t end) {
+    std::string text(uint64_t(end - begin) * DUMP_LINE_SIZE, '\n');
+    char* out = text.data();
+    for (uint32_t i = begin; i < end; ++i, out += DUMP_LINE_SIZE) {
+        formatHex(out, memory.read(INDEX_TO_ADDR(i)), UPPER_HEX);
+    }
+    return text;
+}
+
+}  // namespace
+
 /**
- * @brief MemoryParser: constructor that reads the entire file into a vector
+ * @brief MemoryParser: constructor that reads the entire file into a vector. The file is either
+ *          a hex trace or a binary image (see binary_image.h), told apart by its first bytes.
  * @param input_filename: The name/relative path to the input file to be parsed
  * @param output_filename: The name/relative path to the output file (optional)
- * @throws std::runtime_error if the file cannot be opened
+ * @param storage: The storage to load the image into (optional)
+ * @throws std::runtime_error if the file cannot be opened or a line is not a hex word
  */
-MemoryParser::MemoryParser(const std::string& input_filename, const std::string& output_filename)
+template <typename Storage>
+BasicMemoryParser<Storage>::BasicMemoryParser(const std::string& input_filename,
+                                              const std::string& output_filename, Storage storage)
     : input_filename_(input_filename),
-      output_filename_(output_filename.empty() ? input_filename + ".out" : output_filename) {
-    // Open input file in read mode
-    std::ifstream file(input_filename_);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open input file: " + input_filename_);
-    }
-
-    // Read file content into memory_content_ vector
-    std::string line;
-    while (std::getline(file, line)) {
-        // Trim whitespace
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-
-        if (!line.empty()) {
-            // Convert hex string to uint32_t
-            uint32_t value = 0;
-            std::stringstream ss;
-            ss << std::hex << line;
-            if (!(ss >> value)) {
-                throw std::runtime_error("Failed to parse instruction: " + line);
+      output_filename_(output_filename.empty() ? input_filename + ".out" : output_filename),
+      memory_(std::move(storage)) {
+    loadInput();
+    modified_ = false;
+    write_file_on_modified_ = true;
+}
+
+/**
+ * @brief Replaces the loaded image with another file, as if the parser had been constructed
+ *          anew, but keeps its storage, page table and dirty page map: PagedMemory hands its
+ *          pages out again rather than allocating new ones. The output settings (write on
+ *          modified, format) are kept; a pending dump is waited for and, if memory was modified
+ *          and writing on modification is enabled, the old image's output file is written first.
+ * @param input_filename: The name/relative path to the input file to be parsed
+ * @param output_filename: The name/relative path to the output file (optional)
+ * @throws std::runtime_error if the file cannot be opened or a line is not a hex word, leaving
+ *          the parser with an empty image
+ */
+template <typename Storage>
+void BasicMemoryParser<Storage>::load(const std::string& input_filename,
+                                      const std::string& output_filename) {
+    waitForOutput();
+    if (modified_ && write_file_on_modified_) {
+        writeToFile();
+    }
+    memory_.reset();
+    dirty_pages_.clear();
+    far_pages_.clear();
+    dumped_line_count_ = 0;
+    current_line_count_ = 0;
+    program_image_ = ProgramImage();
+    input_words_.reset();
+    input_image_.reset();
+    input_placed_.reset();
+    modified_ = false;
+
+    input_filename_ = input_filename;
+    output_filename_ = output_filename.empty() ? input_filename + ".out" : output_filename;
+    loadInput();
+}
+
+template <typename Storage>
+void BasicMemoryParser<Storage>::loadInput() {
+    if (BinaryImage::isBinaryImage(input_filename_)) {
+        loadBinaryImage();
+        return;
+    }
+    // Read file content into a vector, which is predecoded and then copied into memory; the
+    // vector is kept for diffs against the input
+    auto placed = std::make_shared<std::vector<hex_image::PlacedWord>>();
+    auto words = std::make_shared<std::vector<uint32_t>>(
+        hex_image::load(input_filename_, MAX_VEC_SIZE, placed.get()));
+
+    for (uint32_t i = 0; i < words->size(); ++i) {
+        memory_.write(INDEX_TO_ADDR(i), (*words)[i]);
+    }
+    current_line_count_ = static_cast<uint32_t>(words->size());
+    program_image_ = ProgramImage(*words);
+    input_words_ = std::move(words);
+
+    // Words placed by address, as a dump writes the far pages: the page holding the first word
+    // not reached extends the words reached, pages wholly beyond it are far pages again
+    std::stable_sort(placed->begin(), placed->end(),
+                     [](const hex_image::PlacedWord& a, const hex_image::PlacedWord& b) {
+                         return a.address < b.address;
+                     });
+    for (const hex_image::PlacedWord& word : *placed) {
+        uint32_t index = ADDR_TO_INDEX(word.address);
+        if (index >= current_line_count_) {
+            if ((index >> WORD_PAGE_SHIFT) == (current_line_count_ >> WORD_PAGE_SHIFT)) {
+                current_line_count_ = index + 1;
+            } else {
+                far_pages_.mark(word.address);
             }
-            memory_content_.push_back(value);
         }
+        memory_.write(word.address, word.value);
     }
+    if (!placed->empty()) {
+        input_placed_ = std::move(placed);
+    }
+}
 
-    if (memory_content_.size() > MAX_VEC_SIZE) {
-        throw std::runtime_error("File exceeds maximum memory size of 4KiB");
+/**
+ * @brief Loads a binary image: the data segments are copied into memory straight from the
+ *          mapped file, and zero runs are left unallocated. Only the first segment is
+ *          predecoded, so a large elided region does not cost a ProgramImage entry per word;
+ *          fetches beyond it decode from memory.
+ */
+template <typename Storage>
+void BasicMemoryParser<Storage>::loadBinaryImage() {
+    auto mapped = std::make_shared<const BinaryImage>(input_filename_);
+    const BinaryImage& image = *mapped;
+    for (uint32_t s = 0; s < image.numSegments(); ++s) {
+        const BinaryImage::Segment& segment = image.segments()[s];
+        if (const uint32_t* words = image.data(segment)) {
+            for (uint32_t i = 0; i < segment.num_words; ++i) {
+                memory_.write(segment.address + INDEX_TO_ADDR(i), words[i]);
+            }
+        }
     }
-    modified_ = false;
-    write_file_on_modified_ = true;
+    current_line_count_ = image.numWords();
+    if (image.numSegments() > 0 && image.data(image.segments()[0]) != nullptr) {
+        program_image_ =
+            ProgramImage(image.data(image.segments()[0]), image.segments()[0].num_words);
+    }
+    input_image_ = std::move(mapped);  // Stays mapped for diffs against the input
+}
 
-    file.close();
+template <typename Storage>
+uint32_t BasicMemoryParser<Storage>::getInputImageSize() const {
+    if (input_words_) {
+        return static_cast<uint32_t>(input_words_->size());
+    }
+    return input_image_ ? input_image_->numWords() : 0;
+}
+
+/**
+ * @brief Word of the input image at index, including words placed by "ADDRESS: VALUE" lines,
+ *          or 0 where the image gives none.
+ */
+template <typename Storage>
+uint32_t BasicMemoryParser<Storage>::getInputWord(uint32_t index) const {
+    if (input_words_) {
+        if (index < input_words_->size()) {
+            return (*input_words_)[index];
+        }
+        if (input_placed_) {
+            // Last line placing the word, as that is the one loaded
+            auto placed = std::upper_bound(input_placed_->begin(), input_placed_->end(),
+                                           INDEX_TO_ADDR(index),
+                                           [](uint32_t address, const hex_image::PlacedWord& w) {
+                                               return address < w.address;
+                                           });
+            if (placed != input_placed_->begin() && (--placed)->address == INDEX_TO_ADDR(index)) {
+                return placed->value;
+            }
+        }
+        return 0;
+    }
+    if (input_image_ && index < input_image_->numWords()) {
+        // Last segment starting at or before the word
+        const BinaryImage::Segment* begin = input_image_->segments();
+        const BinaryImage::Segment* end = begin + input_image_->numSegments();
+        const BinaryImage::Segment* segment =
+            std::upper_bound(begin, end, INDEX_TO_ADDR(index),
+                             [](uint32_t address, const BinaryImage::Segment& s) {
+                                 return address < s.address;
+                             }) -
+            1;
+        const uint32_t* data = input_image_->data(*segment);
+        return data == nullptr ? 0 : data[index - ADDR_TO_INDEX(segment->address)];
+    }
+    return 0;
 }
 
 /**
  * MemoryParser destructor
- * Writes back to output file if content was modified and write_file_on_modified_ is true
+ * Waits for a background write, then writes back to output file if content was modified and
+ * write_file_on_modified_ is true
  */
-MemoryParser::~MemoryParser() {
+template <typename Storage>
+BasicMemoryParser<Storage>::~BasicMemoryParser() {
+    try {
+        waitForOutput();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+    }
     if (modified_ && write_file_on_modified_) {
         writeToFile();
     }
 }
 
 /**
- * @brief Ensures that the vector has enough space for the requested index by resizing vec if
- *          necessary
+ * @brief Extends the words reached so far to cover the requested index. The words in between
+ *          read as zero; no memory is allocated for them until they are written. A far page the
+ *          new end falls in is taken in whole, so no far page straddles the end.
  * @param index: the index that will be requested
  */
-void MemoryParser::ensureIndexExists(uint32_t index) {
-    if (index >= MAX_VEC_SIZE) {
-        throw std::runtime_error("Line number exceeds maximum memory size of 4KiB");
+template <typename Storage>
+void BasicMemoryParser<Storage>::ensureIndexExists(uint32_t index) {
+    if (index >= current_line_count_) {
+        uint32_t page = index >> WORD_PAGE_SHIFT;
+        current_line_count_ = far_pages_.isDirty(page) ? (page + 1) << WORD_PAGE_SHIFT : index + 1;
+        modified_ = true;
     }
+}
 
-    // Expand the vector if necessary by adding zeros
-    if (index >= memory_content_.size()) {
-        memory_content_.resize(index + 1, 0);
-        current_line_count_ = memory_content_.size();
-        modified_ = true;
+template <typename Storage>
+bool BasicMemoryParser<Storage>::isFarPage(uint32_t page) const {
+    return far_pages_.isDirty(page) && page << WORD_PAGE_SHIFT >= current_line_count_;
+}
+
+/**
+ * @brief Writes memory content to an output file, after any background write has finished.
+ */
+template <typename Storage>
+void BasicMemoryParser<Storage>::writeToFile() {
+    waitForOutput();
+    writeOutput(formatOutput());
+}
+
+template <typename Storage>
+void BasicMemoryParser<Storage>::writeOutputFileAsync() {
+    waitForOutput();
+    pending_output_ =
+        std::async(std::launch::async, [job = formatOutput()] { writeOutput(job); }).share();
+}
+
+template <typename Storage>
+void BasicMemoryParser<Storage>::waitForOutput() {
+    if (pending_output_.valid()) {
+        std::shared_future<void> pending = std::move(pending_output_);
+        pending_output_ = std::shared_future<void>();
+        pending.get();  // Rethrows what the write threw
+    }
+}
+
+/**
+ * @brief Formats the dump for output_format_. A full dump writes every word reached the first
+ *          time; later ones overwrite the lines of the dirty pages in place and append the rest.
+ *          The words of far pages follow as "ADDRESS: VALUE" lines, and a dump that had them is
+ *          rewritten whole next time. The other formats list words of the dirty pages, so they
+ *          are rewritten whole.
+ * @return The text to write and where, for writeOutput()
+ */
+template <typename Storage>
+typename BasicMemoryParser<Storage>::OutputJob BasicMemoryParser<Storage>::formatOutput() {
+    OutputJob job;
+    job.filename = output_filename_;
+    char line[DIFF_LINE_SIZE];
+    line[8] = ':';
+    line[9] = ' ';
+    line[18] = '\n';
+
+    if (output_format_ == OutputFormat::FULL) {
+        uint32_t first_new_line = 0;
+        if (dumped_line_count_ != 0 && std::filesystem::exists(output_filename_) &&
+            std::filesystem::file_size(output_filename_) == dumped_line_count_ * DUMP_LINE_SIZE) {
+            job.in_place = true;
+            first_new_line = dumped_line_count_;
+
+            // Lines of pages stored to since the load; the others still match the file
+            for (const DirtyPageMap::Range& range : dirty_pages_.ranges()) {
+                uint32_t begin = range.begin * WORDS_PER_PAGE;
+                uint32_t end =
+                    std::min<uint64_t>(uint64_t(range.end) * WORDS_PER_PAGE, first_new_line);
+                if (begin < end) {
+                    job.pieces.emplace_back(begin * DUMP_LINE_SIZE,
+                                            formatLines(memory_, begin, end));
+                }
+            }
+        }
+        std::string text = formatLines(memory_, first_new_line, current_line_count_);
+        for (const DirtyPageMap::Range& range : far_pages_.ranges()) {
+            for (uint32_t page = range.begin; page < range.end; ++page) {
+                if (!isFarPage(page)) {
+                    continue;
+                }
+                for (uint32_t i = page << WORD_PAGE_SHIFT; i < (page + 1) << WORD_PAGE_SHIFT;
+                     ++i) {
+                    formatHex(line, INDEX_TO_ADDR(i), UPPER_HEX);
+                    formatHex(line + 10, memory_.read(INDEX_TO_ADDR(i)), UPPER_HEX);
+                    text.append(line, DIFF_LINE_SIZE);
+                }
+            }
+        }
+        job.pieces.emplace_back(first_new_line * DUMP_LINE_SIZE, std::move(text));
+        dumped_line_count_ = current_line_count_;
+    } else {
+        std::string text;
+        for (const DirtyPageMap::Range& range : dirty_pages_.ranges()) {
+            for (uint32_t page = range.begin; page < range.end; ++page) {
+                // The words reached of the page, or all of a far page
+                uint32_t begin = page << WORD_PAGE_SHIFT;
+                uint32_t end = isFarPage(page) ? begin + WORDS_PER_PAGE
+                                               : std::min(begin + WORDS_PER_PAGE,
+                                                          std::max(begin, current_line_count_));
+                for (uint32_t i = begin; i < end; ++i) {
+                    uint32_t value = memory_.read(INDEX_TO_ADDR(i));
+                    if (output_format_ == OutputFormat::DIFF && value == getInputWord(i)) {
+                        continue;
+                    }
+                    formatHex(line, INDEX_TO_ADDR(i), UPPER_HEX);
+                    formatHex(line + 10, value, UPPER_HEX);
+                    text.append(line, DIFF_LINE_SIZE);
+                }
+            }
+        }
+        job.pieces.emplace_back(0, std::move(text));
+        dumped_line_count_ = 0;  // Not a full dump to patch
     }
+    modified_ = false;  // Reset modified flag
+    return job;
 }
 
 /**
- * @brief Writes memory content to an output file
+ * @brief Writes a formatted dump, one large write per piece.
+ * @throws std::runtime_error if the file cannot be written
  */
-void MemoryParser::writeToFile() {
-    std::ofstream file(output_filename_);
+template <typename Storage>
+void BasicMemoryParser<Storage>::writeOutput(const OutputJob& job) {
+    std::fstream file;
+    if (job.in_place) {
+        file.open(job.filename, std::ios::in | std::ios::out | std::ios::binary);
+    } else {
+        file.open(job.filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    }
     if (!file.is_open()) {
-        throw std::runtime_error("Failed to open output file for writing: " + output_filename_);
+        throw std::runtime_error("Failed to open output file for writing: " + job.filename);
+    }
+    for (const auto& [offset, text] : job.pieces) {
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write output file: " + job.filename);
     }
+}
 
-    // Write each memory line as an 8-digit hex string
-    for (const auto& value : memory_content_) {
-        std::stringstream ss;
-        ss << std::uppercase << std::hex << std::setw(8) << std::setfill('0') << value;
-        file << ss.str() << std::endl;
+template <typename Storage>
+mips_lite::TrapCause BasicMemoryParser<Storage>::checkInstructionAccess(uint32_t address) const {
+    if (address % 4 != 0) {
+        return mips_lite::TrapCause::UNALIGNED_ACCESS;
     }
+    if (ADDR_TO_INDEX(address) >= current_line_count_ &&
+        !far_pages_.isDirty(address >> DirtyPageMap::PAGE_SHIFT)) {
+        return mips_lite::TrapCause::INVALID_INSTRUCTION_ADDRESS;
+    }
+    return mips_lite::TrapCause::NONE;
+}
 
-    file.close();
-    modified_ = false;  // Reset modified flag
+template <typename Storage>
+mips_lite::TrapCause BasicMemoryParser<Storage>::checkDataAccess(uint32_t address) const {
+    if (address % 4 != 0) {
+        return mips_lite::TrapCause::UNALIGNED_ACCESS;
+    }
+    return mips_lite::TrapCause::NONE;
+}
+
+template <typename Storage>
+void BasicMemoryParser<Storage>::throwFault(mips_lite::TrapCause cause, uint32_t address) {
+    switch (cause) {
+        case mips_lite::TrapCause::UNALIGNED_ACCESS:
+            throw std::runtime_error("Unaligned memory access: " + std::to_string(address));
+        case mips_lite::TrapCause::INVALID_INSTRUCTION_ADDRESS:
+            throw std::runtime_error("Invalid instruction address: " + std::to_string(address));
+        default:
+            throw std::runtime_error("Memory address out of bounds: " + std::to_string(address));
+    }
 }
 
 /**
@@ -107,18 +419,13 @@ void MemoryParser::writeToFile() {
  * @param address Memory address to read from
  * @return uint32_t instruction read from memory
  */
-uint32_t MemoryParser::readInstruction(uint32_t address) {
-    if (address % 4 != 0) {
-        throw std::runtime_error("Unaligned memory access: " + std::to_string(address));
-    }
-
-    uint32_t index = ADDR_TO_INDEX(address);
-
-    if (index >= memory_content_.size()) {
-        throw std::runtime_error("Invalid instruction address: " + std::to_string(address));
-    } else {
-        return memory_content_[index];
+template <typename Storage>
+uint32_t BasicMemoryParser<Storage>::readInstructionSlow(uint32_t address) {
+    mips_lite::TrapCause cause = checkInstructionAccess(address);
+    if (cause != mips_lite::TrapCause::NONE) {
+        throwFault(cause, address);
     }
+    return memory_.read(address);
 }
 
 /**
@@ -126,48 +433,116 @@ uint32_t MemoryParser::readInstruction(uint32_t address) {
  * @param address Memory address to read from
  * @return The 32-bit value at the specified address
  */
-uint32_t MemoryParser::readMemory(uint32_t address) {
-    if (address % 4 != 0) {
-        throw std::runtime_error("Unaligned memory access: " + std::to_string(address));
+template <typename Storage>
+uint32_t BasicMemoryParser<Storage>::readMemorySlow(uint32_t address) {
+    mips_lite::TrapCause cause = checkDataAccess(address);
+    if (cause != mips_lite::TrapCause::NONE) {
+        throwFault(cause, address);
     }
-    if (address >= MAX_MEMORY_SIZE) {
-        throw std::runtime_error("Memory address out of bounds: " + std::to_string(address));
-    }
-
-    uint32_t index = ADDR_TO_INDEX(address);
-    ensureIndexExists(index);
-
-    return memory_content_[index];
+    return memory_.read(address);
 }
 
 /**
- * @brief Write a 32-bit value to a specific memory address
+ * @brief Write a 32-bit value to a specific memory address. A store beyond the words reached
+ *          extends them if it is in the page holding the first word not reached or the next;
+ *          further out, its page becomes a far page.
  * @param address Memory address to write to
  * @param value The 32-bit value to write
  * @throws std::runtime_error if address is invalid
  */
-void MemoryParser::writeMemory(uint32_t address, uint32_t value) {
-    if (address % 4 != 0) {
-        throw std::runtime_error("Unaligned memory access: " + std::to_string(address));
+template <typename Storage>
+void BasicMemoryParser<Storage>::writeMemorySlow(uint32_t address, uint32_t value) {
+    mips_lite::TrapCause cause = tryWriteMemorySlow(address, value);
+    if (cause != mips_lite::TrapCause::NONE) {
+        throwFault(cause, address);
+    }
+}
+
+template <typename Storage>
+mips_lite::TrapCause BasicMemoryParser<Storage>::tryReadInstructionSlow(
+    uint32_t address, uint32_t& word) {
+    mips_lite::TrapCause cause = checkInstructionAccess(address);
+    if (cause == mips_lite::TrapCause::NONE) {
+        word = memory_.read(address);
     }
-    if (address >= MAX_MEMORY_SIZE) {
-        throw std::runtime_error("Memory address out of bounds: " + std::to_string(address));
+    return cause;
+}
+
+template <typename Storage>
+mips_lite::TrapCause BasicMemoryParser<Storage>::tryReadMemorySlow(
+    uint32_t address, uint32_t& value) {
+    mips_lite::TrapCause cause = checkDataAccess(address);
+    if (cause == mips_lite::TrapCause::NONE) {
+        value = memory_.read(address);
     }
+    return cause;
+}
 
-    uint32_t index = ADDR_TO_INDEX(address);
-    ensureIndexExists(index);
+template <typename Storage>
+mips_lite::TrapCause BasicMemoryParser<Storage>::tryWriteMemorySlow(
+    uint32_t address, uint32_t value) {
+    mips_lite::TrapCause cause = checkDataAccess(address);
+    if (cause == mips_lite::TrapCause::NONE) {
+        uint32_t index = ADDR_TO_INDEX(address);
+        if ((index >> WORD_PAGE_SHIFT) <= (current_line_count_ >> WORD_PAGE_SHIFT) + 1) {
+            ensureIndexExists(index);
+        } else {
+            far_pages_.mark(address);
+        }
+        memory_.write(address, value);
+        program_image_.invalidate(address);  // Stored over a predecoded word
+        dirty_pages_.mark(address);
+        modified_ = true;                    // Mark as modified
+    }
+    return cause;
+}
 
-    memory_content_[index] = value;
-    modified_ = true;  // Mark as modified
+template <typename Storage>
+void BasicMemoryParser<Storage>::restoreWords(uint32_t address, const uint32_t* words,
+                                              uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i, address += 4) {
+        memory_.write(address, words[i]);
+        program_image_.invalidate(address);
+        dirty_pages_.mark(address);
+        if ((address >> DirtyPageMap::PAGE_SHIFT) << WORD_PAGE_SHIFT >= current_line_count_) {
+            far_pages_.mark(address);
+        }
+    }
+    modified_ = true;
 }
 
-void MemoryParser::printMemoryContent() {
-    std::cout << "Memory Content: Vec Index (dec)   :   Hex Address   :   Hex Value   "
-              << std::endl;
-    for (size_t i = 0; i < memory_content_.size(); ++i) {
+template <typename Storage>
+void BasicMemoryParser<Storage>::printMemoryContent() {
+    std::string text = "Memory Content: Vec Index (dec)   :   Hex Address   :   Hex Value   \n";
+    char line[48];
+    auto print = [&](uint32_t i) {
         // Print each memory line as an 8-digit hex string
-        std::cout << std::dec << i << " : " << "0x" << std::setw(8) << std::setfill('0') << std::hex
-                  << INDEX_TO_ADDR(i) << ": 0x" << std::setw(8) << std::setfill('0')
-                  << memory_content_[i] << std::endl;
+        char* out = std::to_chars(line, line + 10, i).ptr;
+        out = std::copy_n(" : 0x", 5, out);
+        out = formatHex(out, INDEX_TO_ADDR(i), LOWER_HEX);
+        out = std::copy_n(": 0x", 4, out);
+        out = formatHex(out, memory_.read(INDEX_TO_ADDR(i)), LOWER_HEX);
+        *out++ = '\n';
+        text.append(line, out);
+        if (text.size() >= OUTPUT_CHUNK_SIZE) {
+            std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+            text.clear();
+        }
+    };
+    for (uint32_t i = 0; i < current_line_count_; ++i) {
+        print(i);
     }
+    for (const DirtyPageMap::Range& range : far_pages_.ranges()) {
+        for (uint32_t page = range.begin; page < range.end; ++page) {
+            for (uint32_t i = page << WORD_PAGE_SHIFT;
+                 isFarPage(page) && i < (page + 1) << WORD_PAGE_SHIFT; ++i) {
+                print(i);
+            }
+        }
+    }
+    std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    std::cout.flush();
 }
+
+template class BasicMemoryParser<PagedMemory>;
+template class BasicMemoryParser<FlatMemory>;
@@ -0,0 +1,75 @@
+#include "paged_memory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace {
+uint32_t** allocateTable() {
+    // calloc rather than new[]: a large calloc is served by fresh zero pages, so only the parts
+    // of the table that get written are ever backed by memory
+    auto* table = static_cast<uint32_t**>(std::calloc(PagedMemory::NUM_PAGES, sizeof(uint32_t*)));
+    if (table == nullptr) {
+        throw std::bad_alloc();
+    }
+    return table;
+}
+}  // namespace
+
+PagedMemory::PagedMemory() : table_(allocateTable()) {}
+
+/**
+ * @brief Deep copy: every allocated page of other is duplicated.
+ */
+PagedMemory::PagedMemory(const PagedMemory& other) : table_(allocateTable()) {
+    pages_.reserve(other.pages_.size());
+    page_numbers_.reserve(other.page_numbers_.size());
+    for (size_t i = 0; i < other.pages_.size(); ++i) {
+        uint32_t* page = allocatePage(other.page_numbers_[i]);
+        std::copy_n(other.pages_[i].get(), PAGE_WORDS, page);
+    }
+}
+
+PagedMemory& PagedMemory::operator=(const PagedMemory& other) {
+    if (this != &other) {
+        PagedMemory copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+void PagedMemory::clear() {
+    for (uint32_t page_number : page_numbers_) {
+        table_[page_number] = nullptr;
+    }
+    pages_.clear();
+    page_numbers_.clear();
+    spare_pages_.clear();
+}
+
+void PagedMemory::reset() {
+    for (uint32_t page_number : page_numbers_) {
+        table_[page_number] = nullptr;
+    }
+    // Zeroed when reused, so pages that are not needed again cost nothing
+    for (auto& page : pages_) {
+        spare_pages_.push_back(std::move(page));
+    }
+    pages_.clear();
+    page_numbers_.clear();
+}
+
+uint32_t* PagedMemory::allocatePage(uint32_t page_number) {
+    if (!spare_pages_.empty()) {
+        pages_.push_back(std::move(spare_pages_.back()));
+        spare_pages_.pop_back();
+        std::fill_n(pages_.back().get(), PAGE_WORDS, 0u);
+    } else {
+        pages_.emplace_back(new uint32_t[PAGE_WORDS]());
+    }
+    page_numbers_.push_back(page_number);
+    table_[page_number] = pages_.back().get();
+    return table_[page_number];
+}
@@ -0,0 +1,41 @@
+/**
+ * @file program_image.cpp
+ * @brief Implements the predecoded instruction image.
+ */
+
+#include "program_image.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "mips_lite_defs.h"
+
+ProgramImage::ProgramImage(const std::vector<uint32_t>& words)
+    : ProgramImage(words.data(), words.size()) {}
+
+ProgramImage::ProgramImage(const uint32_t* words, size_t count) {
+    ops_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        ops_.push_back(decode(words[i]));
+    }
+}
+
+DecodedOp ProgramImage::decode(uint32_t word) {
+    DecodedOp op{};
+    op.word = word;
+    op.opcode = mips_lite::get_opcode(word);
+    op.rs = mips_lite::get_rs(word);
+    op.rt = mips_lite::get_rt(word);
+    op.control_word = mips_lite::get_control_word(op.opcode);
+    op.r_type = mips_lite::get_instruction_type(op.opcode) == mips_lite::InstructionType::R_TYPE;
+
+    if (op.r_type) {
+        op.rd = mips_lite::get_rd(word);
+        op.immediate = 0;
+    } else {
+        op.rd = 0;
+        op.immediate = static_cast<int32_t>(mips_lite::get_immediate(word));
+    }
+    op.valid = true;
+    return op;
+}
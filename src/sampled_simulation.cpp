@@ -0,0 +1,381 @@
+/**
+ * @file sampled_simulation.cpp
+ * @brief Implements SimPoint-style sampled simulation.
+ */
+
+#include "sampled_simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+namespace sampling {
+
+namespace {
+
+constexpr int MAX_KMEANS_ITERATIONS = 100;
+/// Variance assumed for a clustering that fits its points exactly, so the BIC stays finite
+constexpr double MIN_VARIANCE = 1e-12;
+constexpr double TWO_PI = 6.283185307179586;
+
+using Point = std::vector<double>;
+
+void validate(const Config& config) {
+    if (config.interval_length == 0) {
+        throw std::invalid_argument("Sampling interval length must be positive");
+    }
+    if (config.max_clusters == 0) {
+        throw std::invalid_argument("Sampling needs at least one cluster");
+    }
+    if (config.dimensions == 0) {
+        throw std::invalid_argument("Sampling needs at least one projected dimension");
+    }
+    if (!(config.bic_threshold >= 0.0 && config.bic_threshold <= 1.0)) {
+        throw std::invalid_argument("Sampling BIC threshold must be between 0 and 1");
+    }
+}
+
+/// SplitMix64 finalizer: a well-mixed 64-bit hash of x
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/// Uniform double in [0, 1) from random bits, the same on every platform
+double unitInterval(uint64_t bits) { return static_cast<double>(bits >> 11) * 0x1.0p-53; }
+
+/// Small deterministic generator for k-means seeding
+class Random {
+   public:
+    explicit Random(uint64_t seed) : state_(seed) {}
+    uint64_t next() { return mix(state_++); }
+    double uniform() { return unitInterval(next()); }
+
+   private:
+    uint64_t state_;
+};
+
+/**
+ * Normalize an interval's block vector to fractions of its instructions and project it onto
+ * config.dimensions random directions. The direction components of a block are a hash of its
+ * leader PC, so the same block projects the same way in every interval.
+ */
+Point project(const Interval& interval, const Config& config) {
+    Point point(config.dimensions, 0.0);
+    if (interval.num_instructions == 0) {
+        return point;
+    }
+    uint64_t seed = mix(config.seed);
+    for (const auto& [leader, count] : interval.blocks) {
+        double fraction = static_cast<double>(count) / interval.num_instructions;
+        for (uint32_t d = 0; d < config.dimensions; ++d) {
+            uint64_t bits = mix(seed ^ ((uint64_t(leader) << 32) | d));
+            point[d] += fraction * (2.0 * unitInterval(bits) - 1.0);
+        }
+    }
+    return point;
+}
+
+double distanceSquared(const Point& a, const Point& b) {
+    double sum = 0.0;
+    for (size_t d = 0; d < a.size(); ++d) {
+        double diff = a[d] - b[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+struct KMeans {
+    std::vector<uint32_t> assignment;
+    std::vector<Point> centroids;
+    std::vector<size_t> sizes;
+    double sse = 0.0;  // Sum of squared distances to the assigned centroids
+};
+
+/// Lloyd's k-means from a k-means++ seeding
+KMeans kmeans(const std::vector<Point>& points, uint32_t k, uint64_t seed) {
+    const size_t n = points.size();
+    Random random(mix(seed) + k);
+    KMeans result;
+
+    // k-means++: each further centre is drawn in proportion to its squared distance from the
+    // nearest centre so far
+    result.centroids.push_back(points[random.next() % n]);
+    std::vector<double> nearest(n);
+    for (size_t i = 0; i < n; ++i) {
+        nearest[i] = distanceSquared(points[i], result.centroids[0]);
+    }
+    while (result.centroids.size() < k) {
+        double total = 0.0;
+        for (double d : nearest) {
+            total += d;
+        }
+        size_t chosen = 0;
+        if (total > 0.0) {
+            double target = random.uniform() * total;
+            while (chosen + 1 < n && (target -= nearest[chosen]) >= 0.0) {
+                ++chosen;
+            }
+        } else {
+            chosen = random.next() % n;  // Every point is already a centre
+        }
+        result.centroids.push_back(points[chosen]);
+        for (size_t i = 0; i < n; ++i) {
+            nearest[i] = std::min(nearest[i], distanceSquared(points[i], result.centroids.back()));
+        }
+    }
+
+    result.assignment.assign(n, 0);
+    for (int iteration = 0; iteration < MAX_KMEANS_ITERATIONS; ++iteration) {
+        bool changed = iteration == 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t best = 0;
+            double best_distance = std::numeric_limits<double>::infinity();
+            for (uint32_t c = 0; c < k; ++c) {
+                double distance = distanceSquared(points[i], result.centroids[c]);
+                if (distance < best_distance) {
+                    best = c;
+                    best_distance = distance;
+                }
+            }
+            if (result.assignment[i] != best) {
+                result.assignment[i] = best;
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+        // Move each centre to the mean of its points; an emptied one stays where it was
+        std::vector<Point> sums(k, Point(points[0].size(), 0.0));
+        result.sizes.assign(k, 0);
+        for (size_t i = 0; i < n; ++i) {
+            ++result.sizes[result.assignment[i]];
+            for (size_t d = 0; d < points[i].size(); ++d) {
+                sums[result.assignment[i]][d] += points[i][d];
+            }
+        }
+        for (uint32_t c = 0; c < k; ++c) {
+            if (result.sizes[c] != 0) {
+                for (size_t d = 0; d < sums[c].size(); ++d) {
+                    result.centroids[c][d] = sums[c][d] / result.sizes[c];
+                }
+            }
+        }
+    }
+
+    result.sizes.assign(k, 0);
+    for (size_t i = 0; i < n; ++i) {
+        ++result.sizes[result.assignment[i]];
+        result.sse += distanceSquared(points[i], result.centroids[result.assignment[i]]);
+    }
+    return result;
+}
+
+/// Bayesian information criterion of a clustering under identical spherical Gaussians
+/// (Pelleg and Moore, X-means); higher is better
+double bic(const KMeans& clustering, size_t num_points, size_t dimensions) {
+    const double r = static_cast<double>(num_points);
+    const double m = static_cast<double>(dimensions);
+    const double k = static_cast<double>(clustering.centroids.size());
+    double variance = MIN_VARIANCE;
+    if (num_points > clustering.centroids.size()) {
+        variance = std::max(variance, clustering.sse / (m * (r - k)));
+    }
+
+    double likelihood = 0.0;
+    for (size_t size : clustering.sizes) {
+        if (size == 0) {
+            continue;
+        }
+        const double rn = static_cast<double>(size);
+        likelihood += rn * std::log(rn) - rn * std::log(r) -
+                      rn * m / 2.0 * std::log(TWO_PI * variance) - (rn - k) / 2.0;
+    }
+    const double parameters = k * (m + 1.0);  // Mixing weights, centres and the variance
+    return likelihood - parameters / 2.0 * std::log(r);
+}
+
+}  // namespace
+
+Profile profile(const MemoryParser& image, const Config& config) {
+    validate(config);
+    MemoryParser memory(image);
+    memory.setOutputFileOnModified(false);
+    RegisterFile registers;
+    Stats stats;
+    FastSimulator simulator(&registers, &stats, &memory);
+    BlockProfile blocks;
+    simulator.setBlockProfile(&blocks);
+
+    Profile result;
+    while (!simulator.isHalted() && result.total_instructions < config.max_instructions) {
+        uint64_t retired = simulator.run(
+            std::min(config.interval_length, config.max_instructions - result.total_instructions));
+        if (retired == 0) {
+            break;  // Halted behind a taken branch, or trapped
+        }
+        Interval interval{result.total_instructions, retired,
+                          BlockVector(blocks.begin(), blocks.end())};
+        std::sort(interval.blocks.begin(), interval.blocks.end());
+        result.intervals.push_back(std::move(interval));
+        result.total_instructions += retired;
+        blocks.clear();
+    }
+    result.halted = simulator.isHalted();
+    result.trap = simulator.getTrap();
+    return result;
+}
+
+Clustering cluster(const std::vector<Interval>& intervals, const Config& config) {
+    validate(config);
+    Clustering result;
+    if (intervals.empty()) {
+        return result;
+    }
+
+    std::vector<Point> points;
+    points.reserve(intervals.size());
+    for (const Interval& interval : intervals) {
+        points.push_back(project(interval, config));
+    }
+
+    // Cluster with every k, then keep the smallest k that scores close enough to the best
+    uint32_t max_k = static_cast<uint32_t>(std::min<size_t>(config.max_clusters, points.size()));
+    std::vector<KMeans> candidates;
+    std::vector<double> scores;
+    for (uint32_t k = 1; k <= max_k; ++k) {
+        candidates.push_back(kmeans(points, k, config.seed));
+        scores.push_back(bic(candidates.back(), points.size(), config.dimensions));
+    }
+    auto [lowest, highest] = std::minmax_element(scores.begin(), scores.end());
+    double threshold = *lowest + config.bic_threshold * (*highest - *lowest);
+    size_t chosen = 0;
+    while (scores[chosen] < threshold) {
+        ++chosen;
+    }
+    const KMeans& best = candidates[chosen];
+
+    // Number the clusters that kept points, each represented by the point nearest its centre
+    std::vector<uint32_t> renumber(best.centroids.size(), 0);
+    std::vector<double> nearest;
+    for (size_t c = 0; c < best.centroids.size(); ++c) {
+        if (best.sizes[c] != 0) {
+            renumber[c] = static_cast<uint32_t>(result.representatives.size());
+            result.representatives.push_back(0);
+            nearest.push_back(std::numeric_limits<double>::infinity());
+        }
+    }
+    result.assignment.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        uint32_t c = best.assignment[i];
+        result.assignment[i] = renumber[c];
+        double distance = distanceSquared(points[i], best.centroids[c]);
+        if (distance < nearest[renumber[c]]) {
+            nearest[renumber[c]] = distance;
+            result.representatives[renumber[c]] = i;
+        }
+    }
+    return result;
+}
+
+Estimate estimate(const MemoryParser& image, const Config& config) {
+    Profile program = profile(image, config);
+    Clustering clusters = cluster(program.intervals, config);
+
+    Estimate result;
+    result.total_instructions = program.total_instructions;
+    result.halted = program.halted;
+    result.trap = program.trap;
+    result.num_intervals = program.intervals.size();
+    if (program.total_instructions == 0) {
+        return result;
+    }
+
+    std::vector<uint64_t> covered(clusters.representatives.size(), 0);
+    for (size_t i = 0; i < program.intervals.size(); ++i) {
+        covered[clusters.assignment[i]] += program.intervals[i].num_instructions;
+    }
+
+    // Visit the representatives in program order, so one fast run reaches them all
+    std::vector<size_t> order(clusters.representatives.size());
+    for (size_t c = 0; c < order.size(); ++c) {
+        order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return clusters.representatives[a] < clusters.representatives[b];
+    });
+
+    MemoryParser memory(image);
+    memory.setOutputFileOnModified(false);
+    RegisterFile registers;
+    Stats stats;
+    FastSimulator fast(&registers, &stats, &memory);
+
+    double weights = 0.0, cpi = 0.0, stalls_per_instruction = 0.0;
+    for (size_t c : order) {
+        const Interval& interval = program.intervals[clusters.representatives[c]];
+        uint64_t warmup = std::min(config.warmup_length, interval.first_instruction);
+        fast.run(interval.first_instruction - warmup - fast.getInstructionCount());
+
+        // Simulate the warm-up and the interval cycle by cycle, on a copy of the fast state
+        MemoryParser detailed_memory(memory);
+        detailed_memory.setOutputFileOnModified(false);
+        RegisterFile detailed_registers(registers);
+        Stats detailed_stats;
+        FunctionalSimulator pipeline(&detailed_registers, &detailed_stats, &detailed_memory,
+                                     config.forwarding);
+        pipeline.setPC(fast.getPC());
+        FunctionalSimulator::RunLimits limits;
+        if (warmup != 0) {
+            limits.max_instructions = warmup;
+            pipeline.runUntil(limits);
+        }
+        uint64_t start_cycles = detailed_stats.getClockCycles();
+        uint64_t start_stalls = detailed_stats.getStalls();
+        limits.max_instructions = interval.num_instructions;
+        uint64_t measured = pipeline.runUntil(limits).instructions;
+
+        Sample sample;
+        sample.interval = clusters.representatives[c];
+        sample.weight = static_cast<double>(covered[c]) / program.total_instructions;
+        sample.warmup_instructions = warmup;
+        sample.instructions = measured;
+        sample.clock_cycles = detailed_stats.getClockCycles() - start_cycles;
+        sample.stalls = detailed_stats.getStalls() - start_stalls;
+        result.samples.push_back(sample);
+        result.detailed_instructions += warmup + measured;
+
+        if (measured != 0) {
+            // The first interval starts the pipeline cold; the fill is added back once below
+            uint64_t cycles = sample.clock_cycles;
+            if (interval.first_instruction == 0) {
+                cycles -= std::min(cycles, PIPELINE_FILL_CYCLES);
+            }
+            weights += sample.weight;
+            cpi += sample.weight * cycles / measured;
+            stalls_per_instruction += sample.weight * sample.stalls / measured;
+        }
+    }
+
+    if (weights > 0.0) {
+        result.cpi = cpi / weights;
+        result.clock_cycles = result.cpi * program.total_instructions + PIPELINE_FILL_CYCLES;
+        result.stalls = stalls_per_instruction / weights * program.total_instructions;
+    }
+    return result;
+}
+
+}  // namespace sampling
@@ -3,7 +3,7 @@
  * @brief Implements the Stats class used to track runtime metrics
  *        for a MIPS-lite instruction-level simulator.
  *
- * This includes instruction category counts, registers accessed,
+ * This includes instruction category and opcode counts, registers accessed,
  * memory addresses used, and performance-related metrics such as
  * stalls, clock cycles, and data hazards.
  */
@@ -14,63 +14,97 @@
 
 using mips_lite::InstructionCategory;
 
-// Constructor: Initializes all counters and sets up default categories.
-Stats::Stats() : stalls(0), clockCycles(0), dataHazards(0) {
-    // Initialize all instruction categories with 0 count
-    for (InstructionCategory category :
-         {InstructionCategory::ARITHMETIC, InstructionCategory::LOGICAL,
-          InstructionCategory::MEMORY_ACCESS, InstructionCategory::CONTROL_FLOW}) {
-        instructionCounts[category] = 0;
-    }
-}
+Stats::Stats() = default;
 
-void Stats::incrementCategory(InstructionCategory category) { instructionCounts[category]++; }
-
-uint32_t Stats::getCategoryCount(InstructionCategory category) const {
-    auto inst = instructionCounts.find(category);
-    return (inst != instructionCounts.end()) ? inst->second : 0;
+uint64_t Stats::getCategoryCount(InstructionCategory category) const {
+    int index = static_cast<int>(category);
+    return (index >= 0 && index < NUM_CATEGORIES) ? instructionCounts[index] : 0;
 }
 
 /**
  * @brief Returns the total number of instructions recorded across all categories.
  */
-uint32_t Stats::totalInstructions() const {
-    uint32_t total = 0;
-    for (const auto& pair : instructionCounts) {
-        total += pair.second;
+uint64_t Stats::totalInstructions() const {
+    uint64_t total = 0;
+    for (uint64_t count : instructionCounts) {
+        total += count;
     }
     return total;
 }
 
-/**
- * @brief Tracks a register that was accessed by an instruction.
- *
- * @param reg The register number (0-31).
- */
-void Stats::addRegister(uint8_t reg) { registers.insert(reg); }
+uint64_t Stats::getOpcodeCount(uint8_t opcode) const {
+    return opcode < NUM_OPCODES ? opcodeCounts[opcode] : 0;
+}
 
 /**
  * @brief Tracks a memory address accessed by an instruction.
  *
  * @param addr The 32-bit memory address.
  */
-void Stats::addMemoryAddress(uint32_t addr) { memoryAddresses.insert(addr); }
-
-const std::unordered_set<uint8_t>& Stats::getRegisters() const { return registers; }
-
-const std::unordered_set<uint32_t>& Stats::getMemoryAddresses() const { return memoryAddresses; }
-
-void Stats::incrementStalls() { stalls++; }
-
-void Stats::incrementClockCycles() { clockCycles++; }
-
-void Stats::incrementDataHazards() { dataHazards++; }
+void Stats::addMemoryAddress(uint32_t addr) {
+    if (addr & 3) {
+        memoryAddressesStale |= unalignedAddresses.insert(addr).second;
+        return;
+    }
+    uint32_t page = addr >> PAGE_SHIFT;
+    if (page != lastPageNumber) {
+        auto [slot, inserted] =
+            memoryPageSlots.try_emplace(page, static_cast<uint32_t>(memoryPages.size()));
+        if (inserted) {
+            memoryPages.emplace_back();
+        }
+        lastPageNumber = page;
+        lastPageSlot = slot->second;
+    }
+    uint32_t word = (addr >> 2) & (WORDS_PER_PAGE - 1);
+    uint64_t& bits = memoryPages[lastPageSlot][word / 64];
+    uint64_t bit = uint64_t(1) << (word % 64);
+    if (!(bits & bit)) {
+        bits |= bit;
+        memoryAddressesStale = true;
+    }
+}
 
-uint32_t Stats::getStalls() const { return stalls; }
+bool Stats::hasMemoryAddress(uint32_t addr) const {
+    if (addr & 3) {
+        return unalignedAddresses.count(addr) != 0;
+    }
+    auto slot = memoryPageSlots.find(addr >> PAGE_SHIFT);
+    if (slot == memoryPageSlots.end()) {
+        return false;
+    }
+    uint32_t word = (addr >> 2) & (WORDS_PER_PAGE - 1);
+    return (memoryPages[slot->second][word / 64] >> (word % 64)) & 1;
+}
 
-uint32_t Stats::getClockCycles() const { return clockCycles; }
+const std::unordered_set<uint8_t>& Stats::getRegisters() const {
+    if (registersBuiltFrom != registerMask) {
+        for (uint8_t reg = 0; reg < mips_lite::NUM_REGISTERS; ++reg) {
+            if (registerMask & (1u << reg)) {
+                registers.insert(reg);
+            }
+        }
+        registersBuiltFrom = registerMask;
+    }
+    return registers;
+}
 
-uint32_t Stats::getDataHazards() const { return dataHazards; }
+const std::unordered_set<uint32_t>& Stats::getMemoryAddresses() const {
+    if (memoryAddressesStale) {
+        memoryAddresses.clear();
+        memoryAddresses.insert(unalignedAddresses.begin(), unalignedAddresses.end());
+        for (const auto& [page, slot] : memoryPageSlots) {
+            const PageBits& bits = memoryPages[slot];
+            for (uint32_t word = 0; word < WORDS_PER_PAGE; ++word) {
+                if ((bits[word / 64] >> (word % 64)) & 1) {
+                    memoryAddresses.insert((page << PAGE_SHIFT) | (word << 2));
+                }
+            }
+        }
+        memoryAddressesStale = false;
+    }
+    return memoryAddresses;
+}
 
 /**
  * @brief Computes the average number of stalls per data hazard.
@@ -83,3 +117,19 @@ float Stats::averageStallsPerHazard() const {
     }
     return static_cast<float>(stalls) / dataHazards;
 }
+
+void Stats::merge(const Stats& other) {
+    for (int i = 0; i < NUM_CATEGORIES; ++i) {
+        instructionCounts[i] += other.instructionCounts[i];
+    }
+    for (int i = 0; i < NUM_OPCODES; ++i) {
+        opcodeCounts[i] += other.opcodeCounts[i];
+    }
+    registerMask |= other.registerMask;
+    for (uint32_t addr : other.getMemoryAddresses()) {
+        addMemoryAddress(addr);
+    }
+    stalls += other.stalls;
+    clockCycles += other.clockCycles;
+    dataHazards += other.dataHazards;
+}
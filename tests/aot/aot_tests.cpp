@@ -0,0 +1,219 @@
+/**
+ * @file aot_tests.cpp
+ * @brief Checker for the ahead-of-time translator. Every image under traces/hex and the fixtures
+ * in this directory are translated by mips_aot at build time; each generated program is compared
+ * against the cycle-accurate FunctionalSimulator.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "aot_runtime.h"
+#include "aot_translator.h"
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+using mips_lite::InstructionCategory;
+
+namespace {
+struct RunResult {
+    RegisterFile rf;
+    Stats stats;
+    std::vector<uint32_t> stored_values;
+    uint32_t pc = 0;
+};
+
+void expectSameResult(const RunResult& a, const RunResult& b) {
+    EXPECT_EQ(a.pc, b.pc);
+    expectSameArchitecturalState(a.rf, a.stats, b.rf, b.stats);
+    EXPECT_EQ(a.stored_values, b.stored_values);
+}
+
+void readStoredValues(MemoryParser& mem, RunResult& result) {
+    for (uint32_t address : result.stats.getMemoryAddresses()) {
+        result.stored_values.push_back(mem.readMemory(address));
+    }
+}
+
+void runPipeline(const std::string& path, RunResult& result) {
+    MemoryParser mem(path);
+    mem.setOutputFileOnModified(false);
+    FunctionalSimulator sim(&result.rf, &result.stats, &mem, true);
+    while (!sim.isProgramFinished() && result.stats.getClockCycles() < 100000) {
+        sim.cycle();
+    }
+    EXPECT_TRUE(sim.isProgramFinished());
+    result.pc = sim.isTrapped() ? sim.getTrap().pc : sim.getPC();
+    readStoredValues(mem, result);
+}
+
+void runTranslated(const aot::Program& program, const std::string& path, RunResult& result) {
+    MemoryParser mem(path);
+    mem.setOutputFileOnModified(false);
+    aot::Result run = aot::run(program, result.rf, result.stats, mem, 100000);
+    EXPECT_TRUE(run.halted || !run.trap.empty());
+    EXPECT_EQ(run.instructions, result.stats.totalInstructions());
+    result.pc = run.pc;
+    readStoredValues(mem, result);
+}
+
+/// Image a generated program was translated from
+std::string imagePath(const aot::Program& program) {
+    std::filesystem::path here = std::filesystem::path(__FILE__).parent_path();
+    std::filesystem::path fixture = here / (std::string(program.name) + ".txt");
+    if (std::filesystem::exists(fixture)) {
+        return fixture.string();
+    }
+    return (here / ".." / ".." / "traces" / "hex" / (std::string(program.name) + ".txt")).string();
+}
+
+const aot::Program* findProgram(const std::string& name) {
+    for (const aot::Program* program : aot::registeredPrograms()) {
+        if (name == program->name) {
+            return program;
+        }
+    }
+    return nullptr;
+}
+}  // namespace
+
+// Differential test: every translated image against the pipeline
+TEST(AotTest, MatchesFunctionalSimulatorOnEveryImage) {
+    ASSERT_EQ(aot::registeredPrograms().size(), static_cast<size_t>(AOT_NUM_IMAGES));
+    for (const aot::Program* program : aot::registeredPrograms()) {
+        SCOPED_TRACE(program->name);
+        std::string path = imagePath(*program);
+        ASSERT_TRUE(std::filesystem::exists(path));
+        RunResult pipeline, translated;
+        runPipeline(path, pipeline);
+        runTranslated(*program, path, translated);
+        expectSameResult(translated, pipeline);
+    }
+}
+
+// aot_control.txt: a JR into the middle of a translated block, a loop, a write to R0 and a taken
+// branch with HALT behind it
+TEST(AotTest, IndirectJumpFallsBackToInterpreter) {
+    const aot::Program* program = findProgram("aot_control");
+    ASSERT_NE(program, nullptr);
+    RunResult translated;
+    runTranslated(*program, imagePath(*program), translated);
+    EXPECT_EQ(translated.rf.read(2), 0u);
+    EXPECT_EQ(translated.rf.read(4), 48u);
+    EXPECT_EQ(translated.rf.read(8), 0u);  // Skipped: the pipeline halts at the branch target
+    EXPECT_EQ(translated.rf.read(9), 0u);
+    EXPECT_EQ(translated.pc, 56u);
+    EXPECT_EQ(translated.stats.getCategoryCount(InstructionCategory::CONTROL_FLOW), 10u);
+}
+
+// aot_self_modify.txt: a store rewrites an instruction inside the block that is running
+TEST(AotTest, StoreIntoTranslatedCodeIsSeen) {
+    const aot::Program* program = findProgram("aot_self_modify");
+    ASSERT_NE(program, nullptr);
+    RunResult translated;
+    runTranslated(*program, imagePath(*program), translated);
+    EXPECT_EQ(translated.rf.read(5), 7u);
+    EXPECT_EQ(translated.rf.read(6), 5u);
+    EXPECT_EQ(translated.pc, 52u);
+}
+
+// aot_halt_behind.txt: a store writes HALT behind an always-taken branch, into a word no block
+// was translated from; the branch must still see it and halt at its target
+TEST(AotTest, StoreOfHaltBehindATakenBranchIsSeen) {
+    const aot::Program* program = findProgram("aot_halt_behind");
+    ASSERT_NE(program, nullptr);
+    RunResult translated;
+    runTranslated(*program, imagePath(*program), translated);
+    EXPECT_EQ(translated.rf.read(5), 7u);
+    EXPECT_EQ(translated.rf.read(3), 0u);  // Skipped: the pipeline halts at the branch target
+    EXPECT_EQ(translated.rf.read(8), 0u);
+    EXPECT_EQ(translated.pc, 32u);
+}
+
+// aot_load_fault.txt: an unaligned load in the middle of a block; the instructions before it
+// retire and the PC stops at it, as in the pipeline and the interpreter
+TEST(AotTest, FaultInTheMiddleOfABlockStopsAtTheFaultingInstruction) {
+    const aot::Program* program = findProgram("aot_load_fault");
+    ASSERT_NE(program, nullptr);
+    RunResult result;
+    MemoryParser mem(imagePath(*program));
+    mem.setOutputFileOnModified(false);
+    aot::Result run = aot::run(*program, result.rf, result.stats, mem, 100000);
+    EXPECT_FALSE(run.halted);
+    EXPECT_NE(run.trap.find("Unaligned"), std::string::npos) << run.trap;
+    EXPECT_EQ(run.pc, 12u);
+    EXPECT_EQ(run.instructions, 3u);
+    EXPECT_EQ(result.stats.totalInstructions(), 3u);
+    EXPECT_EQ(result.rf.read(4), 7u);
+    EXPECT_EQ(result.rf.read(5), 0u);
+
+    // The interpreter leaves its block at the same point
+    RegisterFile rf;
+    Stats stats;
+    MemoryParser interpreted(imagePath(*program));
+    interpreted.setOutputFileOnModified(false);
+    FastSimulator fast(&rf, &stats, &interpreted);
+    fast.run(100000);
+    EXPECT_TRUE(fast.isTrapped());
+    EXPECT_EQ(fast.getPC(), run.pc);
+    EXPECT_EQ(fast.getInstructionCount(), run.instructions);
+}
+
+TEST(AotTest, RejectsADifferentImage) {
+    const aot::Program* program = findProgram("aot_control");
+    ASSERT_NE(program, nullptr);
+    const aot::Program* other = findProgram("aot_self_modify");
+    ASSERT_NE(other, nullptr);
+    RunResult result;
+    MemoryParser mem(imagePath(*other));
+    mem.setOutputFileOnModified(false);
+    EXPECT_THROW(aot::run(*program, result.rf, result.stats, mem, 100000), std::runtime_error);
+}
+
+TEST(AotTest, BudgetIsCheckedBetweenBlocks) {
+    const aot::Program* program = findProgram("aot_control");
+    ASSERT_NE(program, nullptr);
+    RunResult result;
+    MemoryParser mem(imagePath(*program));
+    mem.setOutputFileOnModified(false);
+    aot::Result run = aot::run(*program, result.rf, result.stats, mem, 1);
+    EXPECT_FALSE(run.halted);
+    EXPECT_EQ(run.instructions, 3u);  // The whole first block
+    EXPECT_EQ(run.pc, 12u);
+    EXPECT_EQ(result.stats.totalInstructions(), 3u);
+}
+
+TEST(AotTranslatorTest, GeneratesBlocksAndDispatcher) {
+    // ADDI R1 R0 1; BZ R0 -> 0; HALT
+    ProgramImage image({0x04010001, 0x3800ffff, 0x44000000});
+    AotOptions options;
+    options.name = "3-loop";
+    std::string source = AotTranslator::translate(image, options);
+    EXPECT_NE(source.find("namespace aot__3_loop"), std::string::npos);
+    EXPECT_NE(source.find("uint32_t block_00000000(aot::Context& c)"), std::string::npos);
+    EXPECT_NE(source.find("uint32_t block_00000008(aot::Context& c)"), std::string::npos);
+    EXPECT_NE(source.find("case 0x00000008u:"), std::string::npos);
+    EXPECT_EQ(source.find("int main("), std::string::npos);
+
+    options.with_main = true;
+    source = AotTranslator::translate(image, options);
+    EXPECT_NE(source.find("aot::standaloneMain(aot__3_loop::program, argc, argv)"),
+              std::string::npos);
+}
+
+TEST(AotTranslatorTest, Identifier) {
+    EXPECT_EQ(AotTranslator::identifier("raw-haz-load"), "raw_haz_load");
+    EXPECT_EQ(AotTranslator::identifier("1st"), "_1st");
+    EXPECT_EQ(AotTranslator::identifier(""), "_");
+}
@@ -0,0 +1,22 @@
+# Runs mips_simulator -s and a standalone translated simulator on the same image and fails if
+# their reports differ. The image is copied first because MemoryParser writes <image>.out next
+# to its input when memory is modified.
+configure_file(${IMAGE} ${WORK_DIR}/standalone_image.txt COPYONLY)
+
+execute_process(
+    COMMAND ${EXPECTED} -s -m -i ${WORK_DIR}/standalone_image.txt
+    OUTPUT_VARIABLE EXPECTED_OUTPUT
+    RESULT_VARIABLE EXPECTED_RESULT
+)
+execute_process(
+    COMMAND ${ACTUAL} -m -i ${WORK_DIR}/standalone_image.txt
+    OUTPUT_VARIABLE ACTUAL_OUTPUT
+    RESULT_VARIABLE ACTUAL_RESULT
+)
+
+if(NOT EXPECTED_RESULT EQUAL 0 OR NOT ACTUAL_RESULT EQUAL 0)
+    message(FATAL_ERROR "Simulator failed: ${EXPECTED_RESULT} / ${ACTUAL_RESULT}")
+endif()
+if(NOT EXPECTED_OUTPUT STREQUAL ACTUAL_OUTPUT)
+    message(FATAL_ERROR "Reports differ.\nExpected:\n${EXPECTED_OUTPUT}\nActual:\n${ACTUAL_OUTPUT}")
+endif()
@@ -0,0 +1,271 @@
+/**
+ * @file batch_runner_tests.cpp
+ * @brief Unit tests for batch runs: manifests and directories become the expected jobs, a worker
+ * that reuses its objects gives the same results as fresh ones, and results are reported in job
+ * order whatever the number of threads.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch_runner.h"
+#include "functional_simulator.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+using batch::Job;
+using batch::Mode;
+using batch::Result;
+
+namespace {
+/// Every trace of traces/hex in every configuration
+std::vector<Job> allConfigurations() {
+    std::vector<Job> jobs;
+    for (const Job& trace : batch::jobsInDirectory(traceDir().string())) {
+        for (const std::vector<std::string>& flags :
+             std::vector<std::vector<std::string>>{{}, {"-f"}, {"-s"}, {"-s", "-t", "-f"}, {"-H"},
+                                                   {"-H", "-f"}, {"-c", "20"}}) {
+            Job job = trace;
+            batch::parseFlags(flags, job);
+            jobs.push_back(job);
+        }
+    }
+    return jobs;
+}
+
+void expectSameResult(const Result& actual, const Result& expected, const std::string& what) {
+    EXPECT_EQ(actual.status, expected.status) << what;
+    EXPECT_EQ(actual.message, expected.message) << what;
+    EXPECT_EQ(actual.instructions, expected.instructions) << what;
+    EXPECT_EQ(actual.cycles, expected.cycles) << what;
+    EXPECT_EQ(actual.stalls, expected.stalls) << what;
+    EXPECT_EQ(actual.timed, expected.timed) << what;
+    EXPECT_EQ(actual.pc, expected.pc) << what;
+}
+
+class BatchRunnerTest : public ::testing::Test {
+   protected:
+    std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / ("mips_batch_test_" + std::to_string(getpid()));
+
+    void SetUp() override { std::filesystem::create_directories(dir); }
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    void writeFile(const std::filesystem::path& path, const std::string& text) {
+        std::ofstream file(path);
+        file << text;
+    }
+};
+}  // namespace
+
+TEST_F(BatchRunnerTest, ManifestLinesAddToTheDefaults) {
+    writeFile(dir / "jobs.txt",
+              "# Traces to run\n"
+              "add.txt\n"
+              "\n"
+              "sub/mul.txt -s -t   # fast, timed\n"
+              "/abs/roi.txt -H -f -c 500\n");
+    Job defaults;
+    defaults.forwarding = true;
+    std::vector<Job> jobs = batch::readManifest((dir / "jobs.txt").string(), Job());
+    ASSERT_EQ(jobs.size(), 3u);
+    EXPECT_EQ(jobs[0].trace, (dir / "add.txt").string());
+    EXPECT_EQ(jobs[0].mode, Mode::PIPELINE);
+    EXPECT_EQ(jobs[0].budget, batch::DEFAULT_BUDGET);
+    EXPECT_EQ(jobs[1].trace, (dir / "sub" / "mul.txt").string());
+    EXPECT_EQ(jobs[1].mode, Mode::FAST);
+    EXPECT_TRUE(jobs[1].timing);
+    EXPECT_FALSE(jobs[1].forwarding);
+    EXPECT_EQ(jobs[2].trace, "/abs/roi.txt");
+    EXPECT_EQ(jobs[2].mode, Mode::HYBRID);
+    EXPECT_TRUE(jobs[2].forwarding);
+    EXPECT_EQ(jobs[2].budget, 500u);
+    EXPECT_EQ(batch::describeConfig(jobs[0]), "");
+    EXPECT_EQ(batch::describeConfig(jobs[1]), "-s -t");
+    EXPECT_EQ(batch::describeConfig(jobs[2]), "-H -f -c 500");
+
+    jobs = batch::readManifest((dir / "jobs.txt").string(), defaults);
+    EXPECT_TRUE(jobs[0].forwarding);
+    EXPECT_TRUE(jobs[1].forwarding);
+}
+
+TEST_F(BatchRunnerTest, InvalidManifestLinesAreReported) {
+    writeFile(dir / "jobs.txt", "add.txt\nadd.txt -x\n");
+    try {
+        batch::readManifest((dir / "jobs.txt").string());
+        FAIL() << "Expected std::invalid_argument";
+    } catch (const std::invalid_argument& e) {
+        EXPECT_NE(std::string(e.what()).find("jobs.txt:2:"), std::string::npos) << e.what();
+    }
+    writeFile(dir / "jobs.txt", "add.txt -s -H\n");
+    EXPECT_THROW(batch::readManifest((dir / "jobs.txt").string()), std::invalid_argument);
+    writeFile(dir / "jobs.txt", "add.txt -c 0\n");
+    EXPECT_THROW(batch::readManifest((dir / "jobs.txt").string()), std::invalid_argument);
+    writeFile(dir / "jobs.txt", "add.txt -c\n");
+    EXPECT_THROW(batch::readManifest((dir / "jobs.txt").string()), std::invalid_argument);
+    EXPECT_THROW(batch::readManifest((dir / "missing.txt").string()), std::runtime_error);
+}
+
+TEST_F(BatchRunnerTest, DirectoryJobsAreSortedAndSkipDumps) {
+    writeFile(dir / "b.txt", "44000000\n");
+    writeFile(dir / "a.txt", "44000000\n");
+    writeFile(dir / "a.txt.out", "44000000\n");
+    std::filesystem::create_directories(dir / "nested");
+    Job defaults;
+    defaults.mode = Mode::FAST;
+
+    std::vector<Job> jobs = batch::jobsInDirectory(dir.string(), defaults);
+    ASSERT_EQ(jobs.size(), 2u);
+    EXPECT_EQ(jobs[0].trace, (dir / "a.txt").string());
+    EXPECT_EQ(jobs[1].trace, (dir / "b.txt").string());
+    EXPECT_EQ(jobs[1].mode, Mode::FAST);
+    EXPECT_THROW(batch::jobsInDirectory((dir / "missing").string()), std::runtime_error);
+}
+
+TEST_F(BatchRunnerTest, ExpectedCostRanksSizeAndMode) {
+    writeFile(dir / "small.txt", "44000000\n");
+    writeFile(dir / "large.txt", std::string(100, '\n') + "44000000\n");
+    Job small, large, large_fast;
+    small.trace = (dir / "small.txt").string();
+    large.trace = large_fast.trace = (dir / "large.txt").string();
+    large_fast.mode = Mode::FAST;
+    EXPECT_GT(batch::expectedCost(large), batch::expectedCost(small));
+    EXPECT_GT(batch::expectedCost(large), batch::expectedCost(large_fast));
+    Job missing;
+    missing.trace = (dir / "missing.txt").string();
+    EXPECT_EQ(batch::expectedCost(missing), 0u);
+}
+
+// The pipeline result is what a FunctionalSimulator constructed for the trace reports
+TEST_F(BatchRunnerTest, PipelineJobsMatchADirectRun) {
+    batch::Worker worker;
+    for (const Job& trace : batch::jobsInDirectory(traceDir().string())) {
+        for (bool forwarding : {false, true}) {
+            Job job = trace;
+            job.forwarding = forwarding;
+            Result result = worker.run(job);
+
+            MemoryParser memory(job.trace);
+            memory.setOutputFileOnModified(false);
+            RegisterFile rf;
+            Stats stats;
+            FunctionalSimulator sim(&rf, &stats, &memory, forwarding);
+            FunctionalSimulator::RunResult run = sim.run(job.budget);
+            ASSERT_EQ(run.reason, FunctionalSimulator::StopReason::HALTED) << job.trace;
+            EXPECT_EQ(result.status, Result::Status::HALTED) << job.trace;
+            EXPECT_EQ(result.instructions, stats.totalInstructions()) << job.trace;
+            EXPECT_EQ(result.cycles, stats.getClockCycles()) << job.trace;
+            EXPECT_EQ(result.stalls, stats.getStalls()) << job.trace;
+            EXPECT_EQ(result.pc, sim.getPC()) << job.trace;
+        }
+    }
+}
+
+// One worker running every job in turn gives the results of a new worker per job
+TEST_F(BatchRunnerTest, ReusedWorkerMatchesFreshWorkers) {
+    std::vector<Job> jobs = allConfigurations();
+    batch::Worker reused;
+    for (const Job& job : jobs) {
+        Result result = reused.run(job);
+        batch::Worker fresh;
+        expectSameResult(result, fresh.run(job), job.trace + " " + batch::describeConfig(job));
+    }
+    EXPECT_EQ(reused.getReuses(), jobs.size() - 1);
+}
+
+TEST_F(BatchRunnerTest, ResultsAreReportedInJobOrder) {
+    std::vector<Job> jobs = allConfigurations();
+    std::vector<Result> serial = batch::run(jobs, 1);
+    ASSERT_EQ(serial.size(), jobs.size());
+
+    for (unsigned threads : {2u, 4u, 0u}) {
+        std::vector<size_t> reported;
+        std::vector<Result> parallel =
+            batch::run(jobs, threads, [&](size_t index, const Result& result) {
+                reported.push_back(index);
+                expectSameResult(result, serial[index], jobs[index].trace);
+            });
+        ASSERT_EQ(reported.size(), jobs.size());
+        for (size_t i = 0; i < reported.size(); ++i) {
+            EXPECT_EQ(reported[i], i);
+            expectSameResult(parallel[i], serial[i], jobs[i].trace);
+        }
+    }
+}
+
+TEST_F(BatchRunnerTest, FailedJobsDoNotStopTheBatch) {
+    writeFile(dir / "bad.txt", "not hex\n");
+    Job missing, bad, good;
+    missing.trace = (dir / "missing.txt").string();
+    bad.trace = (dir / "bad.txt").string();
+    good.trace = (traceDir() / "add.txt").string();
+    std::vector<Result> results = batch::run({good, missing, bad, good}, 2);
+    ASSERT_EQ(results.size(), 4u);
+    EXPECT_EQ(results[0].status, Result::Status::HALTED);
+    EXPECT_EQ(results[1].status, Result::Status::ERROR);
+    EXPECT_FALSE(results[1].message.empty());
+    EXPECT_EQ(results[2].status, Result::Status::ERROR);
+    expectSameResult(results[3], results[0], "add.txt after failures");
+    EXPECT_STREQ(batch::statusName(results[1].status), "error");
+    EXPECT_TRUE(batch::run({}, 4).empty());
+}
+
+TEST_F(BatchRunnerTest, BudgetAndTrapsAreReported) {
+    // Loads from an unaligned address
+    writeFile(dir / "trap.txt", "04010002\n30220000\n44000000\n");
+    Job pipeline, fast, short_budget;
+    pipeline.trace = fast.trace = (dir / "trap.txt").string();
+    fast.mode = Mode::FAST;
+    short_budget.trace = (traceDir() / "random.txt").string();
+    short_budget.budget = 10;
+
+    batch::Worker worker;
+    Result result = worker.run(pipeline);
+    EXPECT_EQ(result.status, Result::Status::TRAPPED);
+    EXPECT_NE(result.message.find("unaligned"), std::string::npos) << result.message;
+    result = worker.run(fast);
+    EXPECT_EQ(result.status, Result::Status::TRAPPED);
+    EXPECT_NE(result.message.find("unaligned"), std::string::npos) << result.message;
+    result = worker.run(short_budget);
+    EXPECT_EQ(result.status, Result::Status::BUDGET);
+    EXPECT_EQ(result.cycles, 10u);
+}
+
+// A guest fault is TRAPPED with the same message in every mode, a trace that cannot be loaded is
+// ERROR in every mode
+TEST_F(BatchRunnerTest, TrapsReadTheSameInEveryMode) {
+    writeFile(dir / "load.txt", "04010002\n30220000\n44000000\n");  // Unaligned load at PC 4
+    writeFile(dir / "opcode.txt", "04010002\nfc000000\n44000000\n");  // Opcode 63 at PC 4
+    writeFile(dir / "bad.txt", "not hex\n");
+
+    batch::Worker worker;
+    for (const char* name : {"load.txt", "opcode.txt", "bad.txt"}) {
+        Job pipeline, fast, hybrid;
+        pipeline.trace = fast.trace = hybrid.trace = (dir / name).string();
+        fast.mode = Mode::FAST;
+        hybrid.mode = Mode::HYBRID;
+        Result expected = worker.run(pipeline);
+        EXPECT_EQ(expected.status, std::string(name) == "bad.txt" ? Result::Status::ERROR
+                                                                  : Result::Status::TRAPPED)
+            << name;
+        for (const Job& job : {fast, hybrid}) {
+            Result result = worker.run(job);
+            EXPECT_EQ(result.status, expected.status) << name;
+            EXPECT_EQ(result.message, expected.message) << name;
+            EXPECT_EQ(result.instructions, expected.instructions) << name;
+            EXPECT_EQ(result.pc, expected.pc) << name;
+        }
+    }
+    EXPECT_EQ(worker.run(Job{(dir / "opcode.txt").string()}).message,
+              "invalid opcode at PC 4, address 4");
+}
@@ -0,0 +1,150 @@
+/**
+ * @file binary_image_tests.cpp
+ * @brief Unit tests for the binary image format: round trips with the hex traces, zero-run
+ * elision, rejection of damaged files, and loading through MemoryParser.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "binary_image.h"
+#include "hex_image.h"
+#include "mips_mem_parser.h"
+#include "test_helpers.h"
+
+namespace {
+class BinaryImageTest : public ::testing::Test {
+   protected:
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("binary_image_test_" + std::to_string(getpid()) + ".bin"))
+                          .string();
+
+    void TearDown() override { std::filesystem::remove(path); }
+
+    /// Flip one byte of the file at offset
+    void corrupt(std::streamoff offset) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        char byte = 0;
+        file.read(&byte, 1);
+        byte = static_cast<char>(byte ^ 0x5A);
+        file.seekp(offset);
+        file.write(&byte, 1);
+    }
+};
+}  // namespace
+
+// Every hex trace survives hex -> binary -> words, and loads into the same machine
+TEST_F(BinaryImageTest, TracesRoundTrip) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().filename().string());
+        std::vector<uint32_t> words = hex_image::load(entry.path().string(), MAX_VEC_SIZE);
+        for (uint32_t min_zero_run : {0u, 4u, BinaryImage::DEFAULT_MIN_ZERO_RUN}) {
+            BinaryImage::write(path, words, min_zero_run);
+            ASSERT_TRUE(BinaryImage::isBinaryImage(path));
+            BinaryImage image(path);
+            EXPECT_EQ(image.numWords(), words.size());
+            EXPECT_EQ(image.words(), words);
+        }
+
+        Machine hex(entry.path().string(), true);
+        Machine binary(path, true);
+        ASSERT_EQ(binary.mem.getNumMemoryElements(), hex.mem.getNumMemoryElements());
+        EXPECT_EQ(binary.sim.run(100000).cycles, hex.sim.run(100000).cycles);
+        expectSameState(binary, hex);
+    }
+}
+
+// Long zero runs take no space in the file and no pages in memory
+TEST_F(BinaryImageTest, ZeroRunsAreElided) {
+    std::vector<uint32_t> words(1 << 20, 0);  // 4 MiB image
+    words[0] = 0x040103E8;
+    words[1] = 0x040204B0;
+    words[300000] = 0xDEADBEEF;
+    BinaryImage::write(path, words);
+
+    EXPECT_LT(std::filesystem::file_size(path), 4 * BinaryImage::DATA_ALIGNMENT);
+    BinaryImage image(path);
+    ASSERT_EQ(image.numSegments(), 4u);  // data, zeros, data, zeros
+    EXPECT_EQ(image.segments()[0].num_words, 2u);
+    EXPECT_EQ(image.data(image.segments()[1]), nullptr);
+    EXPECT_EQ(image.segments()[2].address, 300000u * 4);
+    EXPECT_EQ(image.data(image.segments()[2])[0], 0xDEADBEEFu);
+    EXPECT_EQ(image.words(), words);
+
+    MemoryParser parser(path);
+    parser.setOutputFileOnModified(false);
+    EXPECT_EQ(parser.getNumMemoryElements(), words.size());
+    EXPECT_EQ(parser.getNumAllocatedPages(), 2u);
+    EXPECT_EQ(parser.readMemory(300000 * 4), 0xDEADBEEFu);
+    EXPECT_EQ(parser.readMemory(500000 * 4), 0u);
+    EXPECT_EQ(parser.getProgramImage()->size(), 2u);
+}
+
+TEST_F(BinaryImageTest, EmptyImage) {
+    BinaryImage::write(path, {});
+    BinaryImage image(path);
+    EXPECT_EQ(image.numWords(), 0u);
+    EXPECT_EQ(image.numSegments(), 0u);
+    EXPECT_TRUE(image.words().empty());
+}
+
+TEST_F(BinaryImageTest, DamagedFilesAreRejected) {
+    std::vector<uint32_t> words = {1, 2, 3, 4, 5};
+
+    BinaryImage::write(path, words);
+    corrupt(BinaryImage::DATA_ALIGNMENT + 8);  // A data word
+    EXPECT_THROW(BinaryImage image(path), std::runtime_error);
+
+    BinaryImage::write(path, words);
+    corrupt(sizeof(BinaryImage::Header) + 4);  // The segment length
+    EXPECT_THROW(BinaryImage image(path), std::runtime_error);
+
+    BinaryImage::write(path, words);
+    corrupt(8);  // The version
+    EXPECT_THROW(BinaryImage image(path), std::runtime_error);
+
+    BinaryImage::write(path, words);
+    std::filesystem::resize_file(path, BinaryImage::DATA_ALIGNMENT + 4);  // Truncated data
+    EXPECT_THROW(BinaryImage image(path), std::runtime_error);
+
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << "040103E8\n";
+    }
+    EXPECT_FALSE(BinaryImage::isBinaryImage(path));
+    EXPECT_THROW(BinaryImage image(path), std::runtime_error);
+}
+
+// Diffs compare against the mapped image, zero runs included
+TEST_F(BinaryImageTest, DiffAgainstBinaryImage) {
+    std::vector<uint32_t> words(4096, 0);
+    words[0] = 0x040103E8;
+    words[3000] = 0xDEADBEEF;
+    BinaryImage::write(path, words);
+
+    std::string out = path + ".diff";
+    {
+        MemoryParser parser(path, out);
+        parser.setOutputFormat(OutputFormat::DIFF);
+        parser.writeMemory(0, 0x040103E8);         // Unchanged
+        parser.writeMemory(3000 * 4, 0xDEADBEEF);  // Unchanged, in a later data segment
+        parser.writeMemory(2000 * 4, 0x12345678);  // In the zero run
+        parser.writeMemory(3001 * 4, 0x00000001);
+    }
+    std::ifstream file(out);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(file), {}),
+              "00001F40: 12345678\n00002EE4: 00000001\n");
+    std::filesystem::remove(out);
+}
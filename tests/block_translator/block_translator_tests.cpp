@@ -0,0 +1,219 @@
+/**
+ * @file block_translator_tests.cpp
+ * @brief Unit tests for basic-block translation, superinstruction fusion and invalidation
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "block_translator.h"
+#include "mips_lite_defs.h"
+#include "program_image.h"
+#include "test_helpers.h"
+
+using mips_lite::InstructionCategory;
+namespace opcode = mips_lite::opcode;
+
+namespace {
+int count(const TranslatedBlock& block, InstructionCategory category) {
+    return block.category_counts[static_cast<int>(category)];
+}
+}  // namespace
+
+TEST(BlockTranslatorTest, SplitsAtTerminators) {
+    ProgramImage image({
+        encodeI(opcode::ADDI, 1, 0, 5),  //  0
+        encodeR(opcode::ADD, 2, 1, 1),   //  4
+        encodeI(opcode::BEQ, 2, 1, 3),   //  8: -> 20
+        encodeR(opcode::OR, 3, 1, 2),    // 12
+        encodeI(opcode::JR, 0, 3, 0),    // 16
+        encodeI(opcode::HALT, 0, 0, 0),  // 20
+    });
+    BlockTranslator translator(&image);
+
+    const TranslatedBlock* first = translator.lookup(0);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->start_pc, 0);
+    EXPECT_EQ(first->end_pc, 8);
+    EXPECT_EQ(first->num_instructions, 3);
+    ASSERT_EQ(first->ops.size(), 3);
+    EXPECT_EQ(first->ops[2].kind, opcode::BEQ);
+    EXPECT_EQ(static_cast<uint32_t>(first->ops[2].first.imm), 20);  // Absolute target
+    EXPECT_EQ(count(*first, InstructionCategory::ARITHMETIC), 2);
+    EXPECT_EQ(count(*first, InstructionCategory::CONTROL_FLOW), 1);
+    EXPECT_EQ(first->written_registers, (1u << 1) | (1u << 2));
+
+    const TranslatedBlock* second = translator.lookup(12);
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(second->end_pc, 16);
+    EXPECT_EQ(second->ops.back().kind, opcode::JR);
+
+    const TranslatedBlock* last = translator.lookup(20);
+    ASSERT_NE(last, nullptr);
+    EXPECT_EQ(last->num_instructions, 1);
+    EXPECT_EQ(last->ops.back().kind, opcode::HALT);
+
+    EXPECT_EQ(translator.numBlocks(), 3);
+    EXPECT_EQ(translator.lookup(0), first);  // Cached
+}
+
+TEST(BlockTranslatorTest, FusesSuperinstructions) {
+    ProgramImage image({
+        encodeI(opcode::LDW, 3, 1, 0),    //  0: LDW R3 R1 0
+        encodeR(opcode::SUB, 5, 3, 4),    //  4: SUB R5 R3 R4   -> LDW_SUB
+        encodeR(opcode::ADD, 6, 6, 5),    //  8: ADD R6 R6 R5
+        encodeI(opcode::SUBI, 1, 1, 1),   // 12: SUBI R1 R1 1
+        encodeI(opcode::BZ, 0, 1, -4),    // 16: BZ R1 -4       -> SUBI_BZ
+        encodeI(opcode::HALT, 0, 0, 0),   // 20
+    });
+    BlockTranslator translator(&image);
+
+    const TranslatedBlock* block = translator.lookup(0);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->num_instructions, 5);
+    EXPECT_EQ(block->end_pc, 16);
+    ASSERT_EQ(block->ops.size(), 3);
+
+    EXPECT_EQ(block->ops[0].kind, block_op::LDW_ALU_BASE + opcode::SUB);
+    EXPECT_EQ(block->ops[0].length, 2);
+    EXPECT_EQ(block->ops[0].first.dest, 3);
+    EXPECT_EQ(block->ops[0].second.dest, 5);
+    EXPECT_EQ(block->ops[1].kind, opcode::ADD);
+    EXPECT_EQ(block->ops[2].kind, block_op::ALU_BZ_BASE + opcode::SUBI);
+    EXPECT_EQ(static_cast<uint32_t>(block->ops[2].second.imm), 0);  // 16 + (-4 * 4)
+
+    EXPECT_EQ(count(*block, InstructionCategory::ARITHMETIC), 3);
+    EXPECT_EQ(count(*block, InstructionCategory::MEMORY_ACCESS), 1);
+    EXPECT_EQ(count(*block, InstructionCategory::CONTROL_FLOW), 1);
+}
+
+TEST(BlockTranslatorTest, StopsBeforeUntranslatableWords) {
+    ProgramImage image({
+        encodeI(opcode::ADDI, 1, 0, 1),  // 0
+        encodeI(opcode::ADDI, 2, 0, 2),  // 4
+        0xFC000000,                      // 8: invalid opcode
+    });
+    BlockTranslator translator(&image);
+
+    const TranslatedBlock* block = translator.lookup(0);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->num_instructions, 2);
+    EXPECT_EQ(block->end_pc, 8);
+    EXPECT_EQ(block->ops.back().kind, block_op::EXIT);
+
+    EXPECT_EQ(translator.lookup(8), nullptr);   // Left to the interpreter
+    EXPECT_EQ(translator.lookup(12), nullptr);  // Outside of the image
+    EXPECT_EQ(translator.lookup(2), nullptr);   // Unaligned
+}
+
+TEST(BlockTranslatorTest, LimitsBlockLength) {
+    std::vector<uint32_t> words(BlockTranslator::MAX_BLOCK_INSTRUCTIONS + 8,
+                                encodeI(opcode::ADDI, 1, 1, 1));
+    ProgramImage image(words);
+    BlockTranslator translator(&image);
+
+    const TranslatedBlock* block = translator.lookup(0);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->num_instructions, BlockTranslator::MAX_BLOCK_INSTRUCTIONS);
+    EXPECT_EQ(block->ops.back().kind, block_op::EXIT);
+    EXPECT_EQ(block->end_pc, BlockTranslator::MAX_BLOCK_INSTRUCTIONS * 4);
+}
+
+TEST(BlockTranslatorTest, InvalidateDropsEveryCoveringBlock) {
+    ProgramImage image({
+        encodeI(opcode::ADDI, 1, 0, 1),  //  0
+        encodeI(opcode::ADDI, 2, 0, 2),  //  4
+        encodeI(opcode::ADDI, 3, 0, 3),  //  8
+        encodeI(opcode::HALT, 0, 0, 0),  // 12
+        0x00000000,                      // 16: data
+    });
+    BlockTranslator translator(&image);
+    ASSERT_NE(translator.lookup(0), nullptr);
+    ASSERT_NE(translator.lookup(4), nullptr);  // Overlaps the block at 0
+    ASSERT_NE(translator.lookup(12), nullptr);
+    EXPECT_EQ(translator.numBlocks(), 3);
+
+    EXPECT_FALSE(translator.covers(16));
+    EXPECT_FALSE(translator.invalidate(16));  // Data word, nothing translated from it
+    EXPECT_EQ(translator.numBlocks(), 3);
+
+    EXPECT_TRUE(translator.covers(8));
+    EXPECT_TRUE(translator.invalidate(8));
+    EXPECT_EQ(translator.numBlocks(), 1);  // Only the HALT block is left
+    EXPECT_FALSE(translator.covers(0));
+    EXPECT_TRUE(translator.covers(12));
+
+    translator.clear();
+    EXPECT_EQ(translator.numBlocks(), 0);
+    EXPECT_FALSE(translator.covers(12));
+}
+
+// Overlapping blocks in a long straight-line run: a store drops exactly those covering it
+TEST(BlockTranslatorTest, InvalidateDropsOnlyTheBlocksInReach) {
+    const uint32_t max = BlockTranslator::MAX_BLOCK_INSTRUCTIONS;
+    std::vector<uint32_t> words(4 * max, encodeI(opcode::ADDI, 1, 1, 1));
+    ProgramImage image(words);
+    BlockTranslator translator(&image);
+    ASSERT_NE(translator.lookup(0), nullptr);              // Words 0 .. max - 1
+    ASSERT_NE(translator.lookup(40), nullptr);             // Words 10 .. max + 9
+    ASSERT_NE(translator.lookup(4 * max), nullptr);        // Words max .. 2 * max - 1
+    ASSERT_NE(translator.lookup(4 * (3 * max)), nullptr);  // Words 3 * max ..
+    EXPECT_EQ(translator.numBlocks(), 4);
+
+    EXPECT_TRUE(translator.invalidate(4 * (max + 5)));
+    EXPECT_EQ(translator.numBlocks(), 2);
+    EXPECT_TRUE(translator.covers(0));
+    EXPECT_FALSE(translator.covers(4 * (max + 5)));
+    EXPECT_TRUE(translator.covers(4 * (3 * max)));
+
+    EXPECT_TRUE(translator.invalidate(4 * (4 * max - 1)));
+    EXPECT_EQ(translator.numBlocks(), 1);
+    EXPECT_TRUE(translator.covers(4 * (max - 1)));
+}
+
+// Region-of-interest markers are left to the interpreter, also as the second half of a pair
+TEST(BlockTranslatorTest, StopsBeforeRoiMarkers) {
+    ProgramImage image({
+        encodeI(opcode::ADDI, 1, 0, 1),  //  0
+        encodeI(opcode::LDW, 2, 0, 24),  //  4
+        mips_lite::roi::BEGIN,           //  8
+        encodeI(opcode::ADDI, 3, 0, 3),  // 12
+        mips_lite::roi::END,             // 16
+        encodeI(opcode::HALT, 0, 0, 0),  // 20
+        0x00000000,                      // 24: data
+    });
+    BlockTranslator translator(&image);
+
+    const TranslatedBlock* block = translator.lookup(0);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->num_instructions, 2);
+    EXPECT_EQ(block->end_pc, 8);
+    EXPECT_EQ(block->ops[1].kind, opcode::LDW);  // Not fused with the marker
+    EXPECT_EQ(translator.lookup(8), nullptr);
+    ASSERT_NE(translator.lookup(12), nullptr);
+    EXPECT_EQ(translator.lookup(12)->end_pc, 16);
+    EXPECT_EQ(translator.lookup(16), nullptr);
+}
+
+// Stores the translator was not told about are picked up from the image
+TEST(BlockTranslatorTest, DropStaleFollowsTheImage) {
+    ProgramImage image({
+        encodeI(opcode::ADDI, 1, 0, 1),  //  0
+        encodeI(opcode::HALT, 0, 0, 0),  //  4
+        encodeI(opcode::ADDI, 2, 0, 2),  //  8
+        encodeI(opcode::HALT, 0, 0, 0),  // 12
+    });
+    BlockTranslator translator(&image);
+    ASSERT_NE(translator.lookup(0), nullptr);
+    ASSERT_NE(translator.lookup(8), nullptr);
+    EXPECT_FALSE(translator.dropStale());
+
+    image.invalidate(8);
+    EXPECT_TRUE(translator.dropStale());
+    EXPECT_EQ(translator.numBlocks(), 1);
+    EXPECT_TRUE(translator.covers(0));
+    EXPECT_FALSE(translator.covers(8));
+    EXPECT_FALSE(translator.covers(12));
+}
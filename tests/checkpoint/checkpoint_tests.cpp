@@ -0,0 +1,147 @@
+/**
+ * @file checkpoint_tests.cpp
+ * @brief Unit tests for checkpoints: a restored simulation continues cycle for cycle like the
+ * original from any point of every trace, and damaged or mismatched checkpoints are rejected.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "mips_mem_parser.h"
+#include "test_helpers.h"
+
+namespace {
+constexpr uint64_t BUDGET = 100000;
+
+class CheckpointTest : public ::testing::Test {
+   protected:
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("checkpoint_test_" + std::to_string(getpid()) + ".ckpt"))
+                          .string();
+
+    void TearDown() override { std::filesystem::remove(path); }
+
+    void corrupt(std::streamoff offset) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        char byte = 0;
+        file.read(&byte, 1);
+        byte = static_cast<char>(byte ^ 0x5A);
+        file.seekp(offset);
+        file.write(&byte, 1);
+    }
+};
+}  // namespace
+
+// Stopping anywhere, saving, and restoring into a fresh machine changes nothing about the rest
+// of the run, in the pipeline or out of it
+TEST_F(CheckpointTest, RestoredRunsMatchUninterrupted) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        for (bool forwarding : {false, true}) {
+            SCOPED_TRACE(entry.path().filename().string() + (forwarding ? " forwarding" : ""));
+            const std::string image = entry.path().string();
+            Machine<MemoryParser> reference(image, forwarding);
+            uint64_t total = reference.sim.run(BUDGET).cycles;
+
+            std::vector<uint64_t> splits = {total / 3, total / 2, total - 1, total};
+            for (uint64_t cycles = 1; cycles <= std::min<uint64_t>(total, 24); ++cycles) {
+                splits.push_back(cycles);
+            }
+            for (uint64_t split : splits) {
+                SCOPED_TRACE("split at cycle " + std::to_string(split));
+                Machine<MemoryParser> original(image, forwarding);
+                original.sim.run(split);
+                checkpoint::save(path, original.sim, original.rf, original.stats, original.mem);
+
+                Machine<MemoryParser> restored(image, !forwarding);  // Taken from the checkpoint
+                checkpoint::restore(path, restored.sim, restored.rf, restored.stats, restored.mem);
+                EXPECT_EQ(restored.sim.isForwardingEnabled(), forwarding);
+                expectSameState(original, restored);
+
+                original.sim.run(BUDGET);
+                restored.sim.run(BUDGET);
+                expectSameState(reference, original);
+                expectSameState(reference, restored);
+            }
+        }
+    }
+}
+
+// The format does not depend on the memory backend
+TEST_F(CheckpointTest, RestoresAcrossBackends) {
+    const std::string image = (traceDir() / "mem_access_output.txt").string();
+    Machine<MemoryParser> reference(image, true);
+    reference.sim.run(BUDGET);
+
+    Machine<MemoryParser> original(image, true);
+    original.sim.run(12);
+    checkpoint::save(path, original.sim, original.rf, original.stats, original.mem);
+    Machine<FlatMemoryParser> restored(image, true);
+    checkpoint::restore(path, restored.sim, restored.rf, restored.stats, restored.mem);
+    restored.sim.run(BUDGET);
+    expectSameState(reference, restored);
+}
+
+// Only the pages stored to are kept, and restoring marks them dirty again
+TEST_F(CheckpointTest, MemoryIsADelta) {
+    const std::string image = (traceDir() / "randomtrace.txt").string();
+    Machine<MemoryParser> original(image, false);
+    original.mem.writeMemory(0x10000, 0x12345678);
+    original.mem.writeMemory(0x30004, 0x9ABCDEF0);
+    checkpoint::save(path, original.sim, original.rf, original.stats, original.mem);
+    EXPECT_EQ(std::filesystem::file_size(path), checkpoint::PAGE_ALIGNMENT * 3);
+
+    Machine<MemoryParser> restored(image, false);
+    checkpoint::restore(path, restored.sim, restored.rf, restored.stats, restored.mem);
+    EXPECT_EQ(restored.mem.readMemory(0x10000), 0x12345678u);
+    EXPECT_EQ(restored.mem.readMemory(0x30004), 0x9ABCDEF0u);
+    EXPECT_EQ(restored.mem.getNumMemoryElements(), original.mem.getNumMemoryElements());
+    EXPECT_EQ(restored.mem.getDirtyPages().count(), 2u);
+}
+
+TEST_F(CheckpointTest, DamagedCheckpointsAreRejected) {
+    const std::string image = (traceDir() / "mem_access_output.txt").string();
+    Machine<MemoryParser> original(image, false);
+    original.sim.run(10);
+    auto save = [&] {
+        checkpoint::save(path, original.sim, original.rf, original.stats, original.mem);
+    };
+    auto restore = [&] {
+        Machine<MemoryParser> restored(image, false);
+        checkpoint::restore(path, restored.sim, restored.rf, restored.stats, restored.mem);
+    };
+
+    save();
+    corrupt(sizeof(checkpoint::Header) + 12);  // The PC
+    EXPECT_THROW(restore(), std::runtime_error);
+
+    save();
+    corrupt(8);  // The version
+    EXPECT_THROW(restore(), std::runtime_error);
+
+    save();
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    EXPECT_THROW(restore(), std::runtime_error);
+
+    // Taken from another image
+    save();
+    Machine<MemoryParser> other((traceDir() / "add.txt").string(), false);
+    EXPECT_THROW(checkpoint::restore(path, other.sim, other.rf, other.stats, other.mem),
+                 std::runtime_error);
+
+    EXPECT_THROW(
+        checkpoint::restore(path + ".missing", other.sim, other.rf, other.stats, other.mem),
+        std::runtime_error);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file dirty_page_map_tests.cpp
+ * @brief Unit tests for DirtyPageMap
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "dirty_page_map.h"
+
+namespace {
+using PageRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+PageRanges asPairs(const std::vector<DirtyPageMap::Range>& ranges) {
+    PageRanges pairs;
+    for (const DirtyPageMap::Range& range : ranges) {
+        pairs.emplace_back(range.begin, range.end);
+    }
+    return pairs;
+}
+}  // namespace
+
+TEST(DirtyPageMapTest, StartsClean) {
+    DirtyPageMap map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.count(), 0u);
+    EXPECT_TRUE(map.ranges().empty());
+    EXPECT_FALSE(map.isDirty(0));
+}
+
+TEST(DirtyPageMapTest, MarksMergeIntoRanges) {
+    DirtyPageMap map;
+    map.mark(0x1000);
+    map.mark(0x1FFC);      // Same page
+    map.mark(0x2000);      // Next page, extends the run
+    map.mark(0x0003F000);  // Page 63, last of the first bitmap word
+    map.mark(0x00040000);  // Page 64, continues the run into the next word
+    map.mark(0xFFFFF000);
+
+    EXPECT_FALSE(map.empty());
+    EXPECT_TRUE(map.isDirty(0x1));
+    EXPECT_TRUE(map.isDirty(0x2));
+    EXPECT_FALSE(map.isDirty(0x3));
+    EXPECT_EQ(map.count(), 5u);
+    EXPECT_EQ(asPairs(map.ranges()), (PageRanges{{0x1, 0x3}, {0x3F, 0x41}, {0xFFFFF, 0x100000}}));
+}
+
+TEST(DirtyPageMapTest, ClearMarksEveryPageClean) {
+    DirtyPageMap map;
+    map.mark(0x10);
+    map.mark(0x12340000);
+    map.clear();
+
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.isDirty(0x12340));
+    map.mark(0x10);
+    EXPECT_EQ(map.count(), 1u);
+}
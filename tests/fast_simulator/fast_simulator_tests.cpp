@@ -0,0 +1,506 @@
+/**
+ * @file fast_simulator_tests.cpp
+ * @brief Tests for the pipeline-free FastSimulator, including a differential check against
+ * the cycle-accurate FunctionalSimulator on every trace in traces/hex.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "hybrid_simulator.h"
+#include "memory_interface.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+using mips_lite::InstructionCategory;
+using ::testing::NiceMock;
+
+// Mocked memory has no program image, so this exercises the decode-on-fetch path
+class MockMemoryParser : public IMemoryParser {
+   public:
+    MOCK_METHOD(uint32_t, readInstruction, (uint32_t address), (override));
+    MOCK_METHOD(uint32_t, readMemory, (uint32_t address), (override));
+    MOCK_METHOD(void, writeMemory, (uint32_t address, uint32_t value), (override));
+};
+
+class FastSimulatorTest : public ::testing::Test {
+   protected:
+    RegisterFile rf;
+    Stats stats;
+    NiceMock<MockMemoryParser> mem;
+
+    void setupProgram(const std::vector<uint32_t>& program) {
+        ON_CALL(mem, readInstruction(::testing::_))
+            .WillByDefault([program](uint32_t addr) { return program.at(addr / 4); });
+    }
+};
+
+// Runs the cycle-accurate simulator to completion
+void runPipeline(FunctionalSimulator& sim, Stats& stats) {
+    while (!sim.isProgramFinished()) {
+        sim.cycle();
+        if (stats.getClockCycles() >= 100000) {
+            ADD_FAILURE() << "Simulator did not halt within 100000 cycles";
+            break;
+        }
+    }
+}
+
+TEST_F(FastSimulatorTest, NullDependenciesThrow) {
+    EXPECT_THROW(FastSimulator(nullptr, &stats, &mem), std::invalid_argument);
+    EXPECT_THROW(FastSimulator(&rf, nullptr, &mem), std::invalid_argument);
+    EXPECT_THROW(FastSimulator(&rf, &stats, nullptr), std::invalid_argument);
+}
+
+TEST_F(FastSimulatorTest, RunsProgramFromMockedMemory) {
+    setupProgram({
+        0x04010005,  // ADDI R1 R0 5
+        0x0402fffa,  // ADDI R2 R0 -6
+        0x00221800,  // ADD R3 R1 R2
+        0x10222000,  // MUL R4 R1 R2
+        0x44000000,  // HALT
+    });
+    FastSimulator iss(&rf, &stats, &mem);
+
+    EXPECT_EQ(iss.run(1000), 5);
+    EXPECT_TRUE(iss.isHalted());
+    EXPECT_EQ(iss.getPC(), 20);  // One instruction beyond HALT
+    EXPECT_EQ(static_cast<int32_t>(rf.read(3)), -1);
+    EXPECT_EQ(static_cast<int32_t>(rf.read(4)), -30);
+    EXPECT_EQ(stats.getCategoryCount(InstructionCategory::ARITHMETIC), 4);
+    EXPECT_EQ(stats.getCategoryCount(InstructionCategory::CONTROL_FLOW), 1);
+    EXPECT_EQ(stats.getRegisters().size(), 4);
+    EXPECT_EQ(stats.getClockCycles(), 0);  // No timing in fast mode
+}
+
+TEST_F(FastSimulatorTest, StepAndBudget) {
+    setupProgram({0x04010001, 0x04210001, 0x04210001, 0x44000000});  // R1 += 1 x3, HALT
+    FastSimulator iss(&rf, &stats, &mem);
+
+    EXPECT_TRUE(iss.step());
+    EXPECT_EQ(iss.getPC(), 4);
+    EXPECT_EQ(rf.read(1), 1);
+
+    EXPECT_EQ(iss.run(1), 1);
+    EXPECT_EQ(rf.read(1), 2);
+    EXPECT_FALSE(iss.isHalted());
+
+    EXPECT_EQ(iss.run(100), 2);
+    EXPECT_TRUE(iss.isHalted());
+    EXPECT_FALSE(iss.step());
+    EXPECT_EQ(iss.getInstructionCount(), 4);
+    EXPECT_EQ(stats.totalInstructions(), 4);
+}
+
+TEST_F(FastSimulatorTest, LoadStoreGoThroughMemory) {
+    setupProgram({
+        0x040103E8,  // ADDI R1 R0 1000
+        0x0402002A,  // ADDI R2 R0 42
+        0x34220000,  // STW R2 R1 0
+        0x30230000,  // LDW R3 R1 0
+        0x44000000,  // HALT
+    });
+    EXPECT_CALL(mem, writeMemory(1000, 42)).Times(1);
+    EXPECT_CALL(mem, readMemory(1000)).WillOnce(::testing::Return(42));
+    FastSimulator iss(&rf, &stats, &mem);
+
+    iss.run(100);
+
+    EXPECT_EQ(rf.read(3), 42);
+    EXPECT_EQ(stats.getCategoryCount(InstructionCategory::MEMORY_ACCESS), 2);
+    EXPECT_TRUE(stats.getMemoryAddresses().count(1000));
+}
+
+// The pipeline fetches the word behind a taken branch before flushing it; if that word is a
+// HALT the pipeline stops fetching, and the fast simulator must end the same way
+TEST_F(FastSimulatorTest, HaltBehindTakenBranchMatchesPipeline) {
+    std::vector<uint32_t> program = {
+        0x04010003,  //  0: ADDI R1 R0 3
+        0x3C000002,  //  4: BEQ R0 R0 2   -> 12
+        0x44000000,  //  8: HALT (fetched behind the taken branch)
+        0x04020007,  // 12: ADDI R2 R0 7
+        0x44000000,  // 16: HALT
+    };
+    setupProgram(program);
+    FastSimulator iss(&rf, &stats, &mem);
+    iss.run(100);
+
+    RegisterFile pipe_rf;
+    Stats pipe_stats;
+    FunctionalSimulator pipe(&pipe_rf, &pipe_stats, &mem, true);
+    runPipeline(pipe, pipe_stats);
+
+    EXPECT_TRUE(iss.isHalted());
+    EXPECT_EQ(iss.getPC(), pipe.getPC());
+    expectSameArchitecturalState(rf, stats, pipe_rf, pipe_stats);
+}
+
+TEST_F(FastSimulatorTest, InvalidOpcodeTraps) {
+    setupProgram({0x04010001, 0xFC000000});  // ADDI, then opcode 63
+    FastSimulator iss(&rf, &stats, &mem);
+
+    EXPECT_EQ(iss.run(100), 1);
+    EXPECT_TRUE(iss.isTrapped());
+    EXPECT_TRUE(iss.isProgramFinished());
+    EXPECT_FALSE(iss.isHalted());
+    EXPECT_EQ(iss.getTrap().cause, mips_lite::TrapCause::INVALID_OPCODE);
+    EXPECT_EQ(iss.getTrap().pc, 4);
+    EXPECT_EQ(iss.getPC(), 4);  // Stopped at the faulting instruction
+    EXPECT_EQ(stats.totalInstructions(), 1);
+    EXPECT_EQ(iss.run(100), 0);  // A trapped program stays finished
+}
+
+// Writes a program to a temporary hex file so it can be loaded (and predecoded) by MemoryParser
+class FastSimulatorImageTest : public ::testing::Test {
+   protected:
+    std::string test_filename = (std::filesystem::path(__FILE__).parent_path() /
+                                 ("test_fast_simulator_" + std::to_string(getpid()) + ".txt"))
+                                   .string();
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(test_filename);
+        ASSERT_TRUE(file.is_open()) << "Failed to create test file";
+        for (uint32_t word : words) {
+            file << std::hex << std::setw(8) << std::setfill('0') << word << std::endl;
+        }
+    }
+
+    void TearDown() override { std::filesystem::remove(test_filename); }
+};
+
+// The loop body is translated, then patched by a store and run once more
+TEST_F(FastSimulatorImageTest, StoreIntoTranslatedBlockIsSeen) {
+    writeImage({
+        0x04010002,  //  0: ADDI R1 R0 2     ; loop counter
+        0x3003003C,  //  4: LDW R3 R0 60     ; R3 = replacement instruction
+        0x04420001,  //  8: loop: ADDI R2 R2 1 ; patched to ADDI R2 R2 100
+        0x0C210001,  // 12: SUBI R1 R1 1
+        0x38200003,  // 16: BZ R1 3          ; -> 28
+        0x3C00FFFD,  // 20: BEQ R0 R0 -3     ; -> 8
+        0x00000000,  // 24: ADD R0 R0 R0
+        0x38800003,  // 28: BZ R4 3          ; first exit -> 40
+        0x00000000,  // 32: ADD R0 R0 R0
+        0x44000000,  // 36: HALT
+        0x04040001,  // 40: ADDI R4 R0 1
+        0x34030008,  // 44: STW R3 R0 8      ; patch the translated loop body
+        0x04010001,  // 48: ADDI R1 R0 1
+        0x3C00FFF5,  // 52: BEQ R0 R0 -11    ; -> 8
+        0x00000000,  // 56: ADD R0 R0 R0
+        0x04420064,  // 60: data: ADDI R2 R2 100
+    });
+
+    MemoryParser fast_mem(test_filename);
+    fast_mem.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FastSimulator iss(&rf, &stats, &fast_mem);
+    ASSERT_TRUE(iss.usesBlockTranslation());
+    iss.run(1000);
+
+    MemoryParser pipe_mem(test_filename);
+    pipe_mem.setOutputFileOnModified(false);
+    RegisterFile pipe_rf;
+    Stats pipe_stats;
+    FunctionalSimulator pipe(&pipe_rf, &pipe_stats, &pipe_mem, true);
+    runPipeline(pipe, pipe_stats);
+
+    EXPECT_TRUE(iss.isHalted());
+    EXPECT_EQ(rf.read(2), 102);
+    EXPECT_EQ(iss.getPC(), pipe.getPC());
+    expectSameArchitecturalState(rf, stats, pipe_rf, pipe_stats);
+}
+
+// The word behind a taken branch in the last word of the image is past its end; the pipeline
+// squashes that fetch, so no fast mode may fault on it
+TEST_F(FastSimulatorImageTest, BranchInLastWordMatchesPipeline) {
+    writeImage({
+        0x38000003,  //  0: BZ R0 3          ; -> 12
+        0x04010001,  //  4: ADDI R1 R0 1     ; skipped
+        0x44000000,  //  8: HALT
+        0x3800FFFF,  // 12: BZ R0 -1         ; -> 8, last word of the image
+    });
+
+    MemoryParser pipe_mem(test_filename);
+    pipe_mem.setOutputFileOnModified(false);
+    RegisterFile pipe_rf;
+    Stats pipe_stats;
+    FunctionalSimulator pipe(&pipe_rf, &pipe_stats, &pipe_mem, true);
+    runPipeline(pipe, pipe_stats);
+    ASSERT_FALSE(pipe.isTrapped());
+    ASSERT_EQ(pipe.getPC(), 12u);
+
+    enum class Mode { INTERPRETER, TRANSLATION, NATIVE, TIMING, HYBRID };
+    for (Mode mode :
+         {Mode::INTERPRETER, Mode::TRANSLATION, Mode::NATIVE, Mode::TIMING, Mode::HYBRID}) {
+        SCOPED_TRACE(static_cast<int>(mode));
+        MemoryParser fast_mem(test_filename);
+        fast_mem.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats, roi_stats;
+        uint32_t pc = 0;
+        if (mode == Mode::HYBRID) {
+            HybridSimulator hybrid(&rf, &stats, &roi_stats, &fast_mem, true);
+            ASSERT_NO_THROW(hybrid.run(1000));
+            EXPECT_TRUE(hybrid.isProgramFinished());
+            pc = hybrid.getPC();
+        } else {
+            FastSimulator iss(&rf, &stats, &fast_mem);
+            iss.setBlockTranslation(mode != Mode::INTERPRETER);
+            iss.setNativeCompilation(mode == Mode::NATIVE);
+            iss.setTiming(mode == Mode::TIMING, true);
+            ASSERT_NO_THROW(iss.run(1000));
+            EXPECT_TRUE(iss.isHalted());
+            pc = iss.getPC();
+            if (mode == Mode::TIMING) {
+                EXPECT_EQ(stats.getClockCycles(), pipe_stats.getClockCycles());
+            }
+        }
+        EXPECT_EQ(pc, pipe.getPC());
+        expectSameArchitecturalState(rf, stats, pipe_rf, pipe_stats);
+    }
+}
+
+// A guest fault traps in every fast mode at the same instruction as in the pipeline, with
+// everything before it retired; the faulting load sits inside a block, fused with an ALU op
+TEST_F(FastSimulatorImageTest, GuestFaultsTrapLikeThePipeline) {
+    const std::vector<std::vector<uint32_t>> images = {
+        // ADDI R1 R0 1; ADDI R2 R1 2; LDW R3 R0 8194 (unaligned); ADD R4 R3 R3; HALT
+        {0x04010001, 0x04220002, 0x30032002, 0x00632000, 0x44000000},
+        // ADDI R1 R0 7; STW R1 R0 18 (unaligned); ADDI R2 R0 2; HALT; data
+        {0x04010007, 0x34010012, 0x04020002, 0x44000000, 0x00000000},
+        // ADDI R1 R0 1; opcode 63; ADDI R2 R0 2; HALT
+        {0x04010001, 0xFC000000, 0x04020002, 0x44000000},
+        // ADDI R1 R0 1; ADDI R2 R0 2; then off the end of the image
+        {0x04010001, 0x04020002},
+    };
+    for (size_t i = 0; i < images.size(); ++i) {
+        SCOPED_TRACE("image " + std::to_string(i));
+        writeImage(images[i]);
+
+        MemoryParser pipe_mem(test_filename);
+        pipe_mem.setOutputFileOnModified(false);
+        RegisterFile pipe_rf;
+        Stats pipe_stats;
+        FunctionalSimulator pipe(&pipe_rf, &pipe_stats, &pipe_mem, true);
+        runPipeline(pipe, pipe_stats);
+        ASSERT_TRUE(pipe.isTrapped());
+
+        enum class Mode { INTERPRETER, TRANSLATION, NATIVE, TIMING, HYBRID };
+        for (Mode mode :
+             {Mode::INTERPRETER, Mode::TRANSLATION, Mode::NATIVE, Mode::TIMING, Mode::HYBRID}) {
+            SCOPED_TRACE(static_cast<int>(mode));
+            MemoryParser fast_mem(test_filename);
+            fast_mem.setOutputFileOnModified(false);
+            RegisterFile rf;
+            Stats stats, roi_stats;
+            mips_lite::Trap trap;
+            uint32_t pc = 0;
+            if (mode == Mode::HYBRID) {
+                HybridSimulator hybrid(&rf, &stats, &roi_stats, &fast_mem, true);
+                ASSERT_NO_THROW(hybrid.run(1000));
+                EXPECT_TRUE(hybrid.isProgramFinished());
+                trap = hybrid.getTrap();
+                pc = hybrid.getPC();
+            } else {
+                FastSimulator iss(&rf, &stats, &fast_mem);
+                iss.setBlockTranslation(mode != Mode::INTERPRETER);
+                iss.setNativeCompilation(mode == Mode::NATIVE);
+                iss.setTiming(mode == Mode::TIMING, true);
+                ASSERT_NO_THROW(iss.run(1000));
+                EXPECT_TRUE(iss.isProgramFinished());
+                EXPECT_FALSE(iss.isHalted());
+                trap = iss.getTrap();
+                pc = iss.getPC();
+            }
+            EXPECT_EQ(trap.cause, pipe.getTrap().cause);
+            EXPECT_EQ(trap.pc, pipe.getTrap().pc);
+            EXPECT_EQ(trap.address, pipe.getTrap().address);
+            EXPECT_EQ(stats.totalInstructions(), pipe_stats.totalInstructions());
+            EXPECT_EQ(pc, pipe.getPC());
+            expectSameArchitecturalState(rf, stats, pipe_rf, pipe_stats);
+        }
+    }
+}
+
+// A budget smaller than a block must still be honoured exactly
+TEST_F(FastSimulatorImageTest, BudgetIsExactWithTranslation) {
+    writeImage({
+        0x04010003,  //  0: ADDI R1 R0 3
+        0x04420002,  //  4: loop: ADDI R2 R2 2
+        0x0C210001,  //  8: SUBI R1 R1 1
+        0x38200003,  // 12: BZ R1 3       ; -> 24
+        0x3C00FFFD,  // 16: BEQ R0 R0 -3  ; -> 4
+        0x00000000,  // 20: ADD R0 R0 R0
+        0x44000000,  // 24: HALT
+    });
+    MemoryParser mem(test_filename);
+    mem.setOutputFileOnModified(false);
+
+    RegisterFile rf_ref;
+    Stats stats_ref;
+    FastSimulator reference(&rf_ref, &stats_ref, &mem);
+    reference.setBlockTranslation(false);
+    ASSERT_FALSE(reference.usesBlockTranslation());
+
+    RegisterFile rf;
+    Stats stats;
+    FastSimulator iss(&rf, &stats, &mem);
+    iss.run(100);  // Warm the translation cache on a separate copy of the state
+    ASSERT_GT(iss.getBlockTranslator()->numBlocks(), 0);
+
+    RegisterFile rf_step;
+    Stats stats_step;
+    FastSimulator stepped(&rf_step, &stats_step, &mem);
+    while (!reference.isHalted()) {
+        ASSERT_EQ(stepped.run(2), reference.run(2));
+        EXPECT_EQ(stepped.getPC(), reference.getPC());
+        EXPECT_EQ(rf_step.read(1), rf_ref.read(1));
+        EXPECT_EQ(rf_step.read(2), rf_ref.read(2));
+    }
+    EXPECT_TRUE(stepped.isHalted());
+    EXPECT_EQ(stepped.getInstructionCount(), reference.getInstructionCount());
+}
+
+// Blocks are counted by leader however the run is split and whichever engine runs them
+TEST_F(FastSimulatorImageTest, BlockProfileCountsByLeader) {
+    writeImage({
+        0x04010003,  //  0: ADDI R1 R0 3
+        0x04420002,  //  4: loop: ADDI R2 R2 2
+        0x0C210001,  //  8: SUBI R1 R1 1
+        0x38200003,  // 12: BZ R1 3       ; -> 24
+        0x3C00FFFD,  // 16: BEQ R0 R0 -3  ; -> 4
+        0x00000000,  // 20: ADD R0 R0 R0
+        0x44000000,  // 24: HALT
+    });
+    const BlockProfile expected = {{0, 5}, {4, 7}, {24, 1}};
+
+    for (int engine = 0; engine < 3; ++engine) {
+        for (uint64_t chunk : {1, 2, 3, 100}) {
+            SCOPED_TRACE("engine " + std::to_string(engine) + ", chunk " + std::to_string(chunk));
+            MemoryParser mem(test_filename);
+            mem.setOutputFileOnModified(false);
+            RegisterFile rf;
+            Stats stats;
+            FastSimulator iss(&rf, &stats, &mem);
+            iss.setBlockTranslation(engine != 0);
+            iss.setNativeCompilation(engine == 2);
+            BlockProfile profile;
+            iss.setBlockProfile(&profile);
+            while (!iss.isHalted()) {
+                iss.run(chunk);
+            }
+            EXPECT_EQ(profile, expected);
+        }
+    }
+}
+
+// Long straight-line code is counted in pieces, even when a run stops inside one
+TEST_F(FastSimulatorImageTest, BlockProfileSplitsLongBlocks) {
+    std::vector<uint32_t> program(20, 0x04420001);  // ADDI R2 R2 1
+    program.push_back(0x44000000);                   // 80: HALT
+    writeImage(program);
+    MemoryParser mem(test_filename);
+    mem.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FastSimulator iss(&rf, &stats, &mem);
+    BlockProfile profile;
+    iss.setBlockProfile(&profile);
+    iss.run(10);
+    EXPECT_EQ(profile, (BlockProfile{{0, 10}}));
+    iss.run(100);
+    EXPECT_EQ(profile, (BlockProfile{{0, 16}, {64, 5}}));
+}
+
+// Markers are no-ops unless the simulator is asked to stop at BEGIN, which it leaves unexecuted
+TEST_F(FastSimulatorImageTest, StopsAtRoiBeginWhenAsked) {
+    writeImage({
+        0x04010001,             //  0: ADDI R1 R0 1
+        mips_lite::roi::BEGIN,  //  4
+        0x04020002,             //  8: ADDI R2 R0 2
+        mips_lite::roi::END,    // 12
+        0x44000000,             // 16: HALT
+    });
+    for (bool translate : {false, true}) {
+        SCOPED_TRACE(translate ? "block translation" : "interpreter");
+        MemoryParser mem(test_filename);
+        mem.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FastSimulator plain(&rf, &stats, &mem);
+        plain.setBlockTranslation(translate);
+        EXPECT_EQ(plain.run(100), 5u);
+        EXPECT_TRUE(plain.isHalted());
+        EXPECT_EQ(rf.read(0), 0u);
+
+        FastSimulator iss(&rf, &stats, &mem);
+        iss.setBlockTranslation(translate);
+        iss.setStopAtRoiBegin(true);
+        EXPECT_EQ(iss.run(100), 1u);
+        EXPECT_TRUE(iss.isAtRoiBegin());
+        EXPECT_EQ(iss.getPC(), 4u);
+        EXPECT_EQ(iss.run(100), 0u);  // Still in front of it
+        EXPECT_TRUE(iss.isAtRoiBegin());
+
+        iss.setPC(8);
+        EXPECT_FALSE(iss.isAtRoiBegin());
+        EXPECT_EQ(iss.run(100), 3u);  // END does not stop
+        EXPECT_TRUE(iss.isHalted());
+        EXPECT_FALSE(iss.isAtRoiBegin());
+    }
+}
+
+// Differential test: every trace must end in the same state in both simulators, with and
+// without block translation
+TEST(FastSimulatorTraceTest, MatchesFunctionalSimulatorOnTraces) {
+    std::filesystem::path trace_dir = traceDir();
+    ASSERT_TRUE(std::filesystem::exists(trace_dir));
+
+    int traces_checked = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(trace_dir)) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().filename().string());
+
+        MemoryParser pipe_mem(entry.path().string());
+        pipe_mem.setOutputFileOnModified(false);
+        RegisterFile pipe_rf;
+        Stats pipe_stats;
+        FunctionalSimulator pipe(&pipe_rf, &pipe_stats, &pipe_mem, true);
+        runPipeline(pipe, pipe_stats);
+
+        for (bool translate : {false, true}) {
+            SCOPED_TRACE(translate ? "block translation" : "interpreter");
+            MemoryParser fast_mem(entry.path().string());
+            fast_mem.setOutputFileOnModified(false);
+            RegisterFile fast_rf;
+            Stats fast_stats;
+            FastSimulator iss(&fast_rf, &fast_stats, &fast_mem);
+            iss.setBlockTranslation(translate);
+            iss.run(100000);
+
+            EXPECT_TRUE(iss.isHalted());
+            EXPECT_EQ(iss.getPC(), pipe.getPC());
+            expectSameArchitecturalState(fast_rf, fast_stats, pipe_rf, pipe_stats);
+            for (uint32_t addr : pipe_stats.getMemoryAddresses()) {
+                EXPECT_EQ(fast_mem.readMemory(addr), pipe_mem.readMemory(addr));
+            }
+        }
+        ++traces_checked;
+    }
+    EXPECT_GT(traces_checked, 0);
+}
@@ -0,0 +1,144 @@
+/**
+ * @file flat_memory_tests.cpp
+ * @brief Unit tests for FlatMemory and the FlatMemoryParser built on it
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flat_memory.h"
+#include "mips_mem_parser.h"
+
+TEST(FlatMemoryTest, UntouchedMemoryReadsZero) {
+    FlatMemory memory;
+    EXPECT_EQ(memory.read(0), 0u);
+    EXPECT_EQ(memory.read(0x80000000), 0u);
+    EXPECT_EQ(memory.read(0xFFFFFFFC), 0u);
+}
+
+TEST(FlatMemoryTest, WritesAnywhereInTheAddressSpace) {
+    FlatMemory memory;
+    memory.write(0x1000, 1);
+    memory.write(0x1FFC, 2);
+    memory.write(0xFFFFFFFC, 3);
+    memory.write(0x0, 4);
+
+    EXPECT_EQ(memory.read(0x1000), 1u);
+    EXPECT_EQ(memory.read(0x1FFC), 2u);
+    EXPECT_EQ(memory.read(0xFFFFFFFC), 3u);
+    EXPECT_EQ(memory.read(0x0), 4u);
+    EXPECT_EQ(memory.read(0x1004), 0u);
+
+    // Only the written pages are committed, not the 4 GiB mapped
+    EXPECT_GE(memory.numAllocatedPages(), 3u);
+    EXPECT_LT(memory.numAllocatedPages(), 4096u);
+}
+
+TEST(FlatMemoryTest, WritesOnBothSidesOfACommitChunkBoundary) {
+    FlatMemory memory;
+    const uint32_t boundary = static_cast<uint32_t>(FlatMemory::COMMIT_SIZE);
+    memory.write(boundary - 4, 1);
+    EXPECT_EQ(memory.read(boundary), 0u);  // The next chunk is still read-only, and reads zero
+    memory.write(boundary, 2);
+
+    EXPECT_EQ(memory.read(boundary - 4), 1u);
+    EXPECT_EQ(memory.read(boundary), 2u);
+}
+
+TEST(FlatMemoryTest, MoveTransfersTheMapping) {
+    FlatMemory original;
+    original.write(0x4000, 7);
+
+    FlatMemory moved(std::move(original));
+    EXPECT_EQ(moved.read(0x4000), 7u);
+
+    FlatMemory assigned(true);
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned.read(0x4000), 7u);
+    EXPECT_FALSE(assigned.hugePages());
+}
+
+TEST(FlatMemoryTest, ClearReleasesEveryPage) {
+    FlatMemory memory;
+    memory.write(0x10, 1);
+    memory.write(0x12340000, 2);
+    memory.clear();
+
+    EXPECT_EQ(memory.read(0x10), 0u);
+    EXPECT_EQ(memory.read(0x12340000), 0u);
+    memory.write(0x10, 3);
+    EXPECT_EQ(memory.read(0x10), 3u);
+}
+
+class FlatMemoryParserTest : public ::testing::Test {
+   protected:
+    std::string test_filename = (std::filesystem::temp_directory_path() /
+                                 ("flat_memory_parser_test_" + std::to_string(getpid()) + ".txt"))
+                                   .string();
+    std::string out_filename = test_filename + ".out";
+    std::vector<std::string> sample_lines = {"040103E8", "040204B0", "00003800", "00004000",
+                                             "00005000", "040B0032", "040C0020", "00000000"};
+
+    void SetUp() override {
+        std::ofstream file(test_filename);
+        ASSERT_TRUE(file.is_open()) << "Failed to create test file";
+        for (const auto& line : sample_lines) {
+            file << line << "\n";
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(test_filename);
+        std::filesystem::remove(out_filename);
+    }
+};
+
+// Loading, faults and the dump behave as with the paged MemoryParser
+TEST_F(FlatMemoryParserTest, MatchesPagedMemoryParser) {
+    {
+        FlatMemoryParser flat(test_filename, out_filename, FlatMemory(true));
+        MemoryParser paged(test_filename);
+        paged.setOutputFileOnModified(false);
+
+        ASSERT_EQ(flat.getNumMemoryElements(), sample_lines.size());
+        for (uint32_t i = 0; i < sample_lines.size(); ++i) {
+            EXPECT_EQ(flat.readInstruction(INDEX_TO_ADDR(i)),
+                      paged.readInstruction(INDEX_TO_ADDR(i)));
+        }
+        EXPECT_THROW(flat.readInstruction(INDEX_TO_ADDR(sample_lines.size())),
+                     std::runtime_error);
+
+        uint32_t value = 0;
+        EXPECT_EQ(flat.tryReadMemory(0x1002, value), mips_lite::TrapCause::UNALIGNED_ACCESS);
+        EXPECT_EQ(flat.tryWriteMemory(0x1001, 1), mips_lite::TrapCause::UNALIGNED_ACCESS);
+        EXPECT_EQ(flat.readMemory(0x7FFFF000), 0u);
+        flat.setOutputFileOnModified(false);
+        flat.writeMemory(0x40, 0xDEADBEEF);
+        EXPECT_EQ(flat.readMemory(0x40), 0xDEADBEEFu);
+        EXPECT_EQ(flat.getNumMemoryElements(), ADDR_TO_INDEX(0x40) + 1);
+    }
+    EXPECT_FALSE(std::filesystem::exists(out_filename));
+
+    {
+        FlatMemoryParser flat(test_filename, out_filename);
+        flat.writeMemory(0x40, 0xDEADBEEF);
+    }
+    std::ifstream file(out_filename);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(line);
+    }
+    ASSERT_EQ(lines.size(), ADDR_TO_INDEX(0x40) + 1);
+    for (size_t i = 0; i < sample_lines.size(); ++i) {
+        EXPECT_EQ(lines[i], sample_lines[i]);
+    }
+    EXPECT_EQ(lines[sample_lines.size()], "00000000");
+    EXPECT_EQ(lines.back(), "DEADBEEF");
+}
@@ -0,0 +1,309 @@
+/**
+ * @file advance_tests.cpp
+ * @brief Tests for FunctionalSimulator::advance(), run() and runUntil(): multi-cycle stall and
+ * drain steps, and every stop condition, must leave the same pipeline state and Stats as calling
+ * cycle() one cycle at a time. Runs with statistics collection turned off must simulate the same
+ * machine.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+using RunLimits = FunctionalSimulator::RunLimits;
+using RunResult = FunctionalSimulator::RunResult;
+using StopReason = FunctionalSimulator::StopReason;
+
+TEST(AdvanceTest, MatchesCycleOnTraces) {
+    int traces_checked = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        for (bool forward : {false, true}) {
+            SCOPED_TRACE(entry.path().filename().string() + (forward ? " -f" : ""));
+            Machine stepped(entry.path().string(), forward);
+            Machine advanced(entry.path().string(), forward);
+            uint64_t cycles = 0;
+            while (!stepped.sim.isProgramFinished() && cycles < 100000) {
+                stepped.sim.cycle();
+                ++cycles;
+            }
+            EXPECT_EQ(advanced.sim.advance(100000), cycles);
+            expectSameState(stepped, advanced);
+        }
+        ++traces_checked;
+    }
+    EXPECT_GT(traces_checked, 0);
+}
+
+// Stopping after any number of cycles, including inside a skipped stretch, is exact
+TEST(AdvanceTest, StopsExactlyAtEveryBudget) {
+    for (const char* trace : {"raw-haz-load.txt", "basic-raw-haz.txt", "beq-taken.txt"}) {
+        for (bool forward : {false, true}) {
+            SCOPED_TRACE(std::string(trace) + (forward ? " -f" : ""));
+            std::string path = (traceDir() / trace).string();
+            Machine reference(path, forward);
+            uint64_t budget = 0;
+            while (!reference.sim.isProgramFinished()) {
+                reference.sim.cycle();
+                ++budget;
+                Machine advanced(path, forward);
+                ASSERT_EQ(advanced.sim.advance(budget), budget);
+                expectSameState(reference, advanced);
+                if (HasFailure()) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+TEST(AdvanceTest, FinishedProgramDoesNotAdvance) {
+    Machine machine((traceDir() / "add.txt").string(), true);
+    uint64_t cycles = machine.sim.advance(100000);
+    EXPECT_TRUE(machine.sim.isProgramFinished());
+    EXPECT_EQ(machine.sim.advance(10), 0u);
+    EXPECT_EQ(machine.stats.getClockCycles(), cycles);
+}
+
+TEST(RunTest, RunsTracesToCompletion) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().filename().string());
+        Machine machine(entry.path().string(), false);
+        RunResult result = machine.sim.run(100000);
+        EXPECT_EQ(result.reason, StopReason::HALTED);
+        EXPECT_TRUE(machine.sim.isProgramFinished());
+        EXPECT_EQ(result.cycles, machine.stats.getClockCycles());
+        EXPECT_EQ(result.instructions, machine.stats.totalInstructions());
+        EXPECT_EQ(machine.sim.getRetiredInstructions(), machine.stats.totalInstructions());
+        uint64_t by_opcode = 0;
+        for (int op = 0; op < Stats::NUM_OPCODES; ++op) {
+            by_opcode += machine.stats.getOpcodeCount(static_cast<uint8_t>(op));
+        }
+        EXPECT_EQ(by_opcode, machine.stats.totalInstructions());
+        EXPECT_EQ(machine.stats.getOpcodeCount(mips_lite::opcode::HALT), 1u);
+    }
+}
+
+TEST(RunTest, CycleLimitThenResume) {
+    std::string path = (traceDir() / "raw-haz-chaining.txt").string();
+    Machine whole(path, false);
+    RunResult total = whole.sim.run(100000);
+
+    Machine split(path, false);
+    RunResult first = split.sim.run(7);
+    EXPECT_EQ(first.reason, StopReason::CYCLE_LIMIT);
+    EXPECT_EQ(first.cycles, 7u);
+    RunResult rest = split.sim.run(100000);
+    EXPECT_EQ(rest.reason, StopReason::HALTED);
+    EXPECT_EQ(first.cycles + rest.cycles, total.cycles);
+    EXPECT_EQ(first.instructions + rest.instructions, total.instructions);
+    expectSameState(whole, split);
+
+    // Nothing left to do
+    RunResult again = split.sim.run(100000);
+    EXPECT_EQ(again.reason, StopReason::HALTED);
+    EXPECT_EQ(again.cycles, 0u);
+}
+
+// Stops on the cycle that writes back the n-th instruction
+TEST(RunTest, InstructionLimitIsExact) {
+    std::string path = (traceDir() / "raw-haz-load.txt").string();
+    for (bool forward : {false, true}) {
+        SCOPED_TRACE(forward ? "forwarding" : "no forwarding");
+        Machine reference(path, forward);
+        uint64_t cycles = 0;
+        while (!reference.sim.isProgramFinished()) {
+            uint64_t before = reference.sim.getRetiredInstructions();
+            reference.sim.cycle();
+            ++cycles;
+            if (reference.sim.getRetiredInstructions() == before ||
+                reference.sim.isProgramFinished()) {
+                continue;
+            }
+            RunLimits limits;
+            limits.max_instructions = reference.sim.getRetiredInstructions();
+            Machine limited(path, forward);
+            RunResult result = limited.sim.runUntil(limits);
+            EXPECT_EQ(result.reason, StopReason::INSTRUCTION_LIMIT);
+            EXPECT_EQ(result.cycles, cycles);
+            EXPECT_EQ(result.instructions, limits.max_instructions);
+            expectSameState(reference, limited);
+        }
+    }
+}
+
+TEST(RunTest, StopsWhenPcRetires) {
+    std::string path = (traceDir() / "beq-taken.txt").string();
+    Machine reference(path, false);
+    uint64_t cycles = 0;
+    const PipelineStageData* wb = nullptr;
+    while ((wb = reference.sim.getPipelineStage(FunctionalSimulator::WRITEBACK)) == nullptr ||
+           wb->pc != 8) {
+        ASSERT_FALSE(reference.sim.isProgramFinished());
+        reference.sim.cycle();
+        ++cycles;
+    }
+    reference.sim.cycle();
+    ++cycles;
+
+    RunLimits limits;
+    limits.stop_pc = 8;
+    Machine stopped(path, false);
+    RunResult result = stopped.sim.runUntil(limits);
+    EXPECT_EQ(result.reason, StopReason::PC_REACHED);
+    EXPECT_EQ(result.cycles, cycles);
+    expectSameState(reference, stopped);
+
+    // A PC that never retires runs to the end, and the cycle limit still applies
+    limits.stop_pc = 0x1000;
+    Machine unreached(path, false);
+    EXPECT_EQ(unreached.sim.runUntil(limits).reason, StopReason::HALTED);
+    limits.max_cycles = 3;
+    Machine budgeted(path, false);
+    EXPECT_EQ(budgeted.sim.runUntil(limits).reason, StopReason::CYCLE_LIMIT);
+    EXPECT_EQ(budgeted.stats.getClockCycles(), 3u);
+}
+
+TEST(RunTest, StopsWhenWordRetires) {
+    std::string path = (traceDir() / "beq-taken.txt").string();
+    Machine reference(path, false);
+    uint64_t cycles = 0;
+    const PipelineStageData* wb = nullptr;
+    while ((wb = reference.sim.getPipelineStage(FunctionalSimulator::WRITEBACK)) == nullptr ||
+           wb->pc != 8) {
+        ASSERT_FALSE(reference.sim.isProgramFinished());
+        reference.sim.cycle();
+        ++cycles;
+    }
+    uint32_t word = wb->instruction.getInstruction();
+    reference.sim.cycle();
+    ++cycles;
+
+    RunLimits limits;
+    limits.stop_word = word;
+    Machine stopped(path, false);
+    RunResult result = stopped.sim.runUntil(limits);
+    EXPECT_EQ(result.reason, StopReason::WORD_RETIRED);
+    EXPECT_EQ(result.cycles, cycles);
+    EXPECT_EQ(stopped.sim.getLastRetiredPC(), 8u);
+    expectSameState(reference, stopped);
+
+    // A word that never retires runs to the end
+    limits.stop_word = mips_lite::roi::END;
+    Machine unreached(path, false);
+    EXPECT_EQ(unreached.sim.runUntil(limits).reason, StopReason::HALTED);
+}
+
+// The NullStats instantiations simulate the same machine and never touch Stats
+TEST(RunTest, StatsCollectionCanBeTurnedOff) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        for (bool forward : {false, true}) {
+            SCOPED_TRACE(entry.path().filename().string() + (forward ? " -f" : ""));
+            Machine counted(entry.path().string(), forward);
+            Machine uncounted(entry.path().string(), forward);
+            uncounted.sim.setStatsCollection(false);
+            EXPECT_FALSE(uncounted.sim.isStatsCollectionEnabled());
+
+            RunResult with_stats = counted.sim.run(100000);
+            RunResult without_stats = uncounted.sim.run(100000);
+            EXPECT_EQ(without_stats.reason, with_stats.reason);
+            EXPECT_EQ(without_stats.cycles, with_stats.cycles);
+            EXPECT_EQ(without_stats.instructions, with_stats.instructions);
+            EXPECT_EQ(uncounted.sim.getPC(), counted.sim.getPC());
+            expectSameRegisters(uncounted.rf, counted.rf);
+            for (uint32_t address : counted.stats.getMemoryAddresses()) {
+                EXPECT_EQ(uncounted.mem.readMemory(address), counted.mem.readMemory(address));
+            }
+            EXPECT_EQ(uncounted.stats.getClockCycles(), 0u);
+            EXPECT_EQ(uncounted.stats.getStalls(), 0u);
+            EXPECT_EQ(uncounted.stats.totalInstructions(), 0u);
+            EXPECT_TRUE(uncounted.stats.getRegisters().empty());
+            EXPECT_TRUE(uncounted.stats.getMemoryAddresses().empty());
+        }
+    }
+}
+
+namespace {
+/// Forwards to a MemoryParser through the interface only, so the simulator takes the virtual path
+class ForwardingMemory : public IMemoryParser {
+   public:
+    explicit ForwardingMemory(MemoryParser& inner) : inner_(inner) {}
+    uint32_t readInstruction(uint32_t address) override { return inner_.readInstruction(address); }
+    uint32_t readMemory(uint32_t address) override { return inner_.readMemory(address); }
+    void writeMemory(uint32_t address, uint32_t value) override {
+        inner_.writeMemory(address, value);
+    }
+    const ProgramImage* getProgramImage() const override { return inner_.getProgramImage(); }
+
+   private:
+    MemoryParser& inner_;
+};
+}  // namespace
+
+// A MemoryParser is accessed without virtual calls; the result matches the virtual path
+TEST(RunTest, ConcreteMemoryMatchesVirtualMemory) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        for (bool forward : {false, true}) {
+            SCOPED_TRACE(entry.path().filename().string() + (forward ? " -f" : ""));
+            Machine direct(entry.path().string(), forward);
+
+            RegisterFile rf;
+            Stats stats;
+            MemoryParser mem(entry.path().string());
+            mem.setOutputFileOnModified(false);
+            ForwardingMemory wrapper(mem);
+            FunctionalSimulator sim(&rf, &stats, &wrapper, forward);
+
+            RunResult concrete = direct.sim.run(100000);
+            RunResult virtual_calls = sim.run(100000);
+            EXPECT_EQ(virtual_calls.reason, concrete.reason);
+            EXPECT_EQ(virtual_calls.cycles, concrete.cycles);
+            EXPECT_EQ(sim.getPC(), direct.sim.getPC());
+            EXPECT_EQ(stats.getMemoryAddresses(), direct.stats.getMemoryAddresses());
+            expectSameRegisters(rf, direct.rf);
+            for (uint32_t address : direct.stats.getMemoryAddresses()) {
+                EXPECT_EQ(mem.readMemory(address), direct.mem.readMemory(address));
+            }
+        }
+    }
+}
+
+// A FlatMemoryParser takes its own direct path; the result matches the paged MemoryParser
+TEST(RunTest, FlatMemoryMatchesPagedMemory) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        for (bool forward : {false, true}) {
+            SCOPED_TRACE(entry.path().filename().string() + (forward ? " -f" : ""));
+            Machine paged(entry.path().string(), forward);
+            Machine<FlatMemoryParser> flat(entry.path().string(), forward);
+
+            RunResult expected = paged.sim.run(100000);
+            RunResult result = flat.sim.run(100000);
+            EXPECT_EQ(result.reason, expected.reason);
+            EXPECT_EQ(result.cycles, expected.cycles);
+            expectSameState(flat, paged);
+        }
+    }
+}
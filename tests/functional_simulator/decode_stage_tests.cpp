@@ -64,16 +64,11 @@ class DecodeStageTest : public ::testing::Test {
 
     // Helper to properly initialize the decode stage with an instruction
     void setupDecodeStage(uint32_t instruction_word) {
-        // Create a new instruction object
-        auto instr = std::make_unique<Instruction>(instruction_word);
-
-        // Create pipeline stage data for decode stage
-        auto decode_data = std::make_unique<PipelineStageData>();
-        decode_data->instruction = std::move(instr);
-        decode_data->pc = sim->getPC();  // Use current PC
+        // Create pipeline stage data for decode stage, using current PC
+        PipelineStageData decode_data(Instruction(instruction_word), sim->getPC());
 
         // Place the instruction in the decode stage using getPipeline()
-        sim->getPipeline()[FunctionalSimulator::PipelineStage::DECODE] = std::move(decode_data);
+        sim->getPipeline()[FunctionalSimulator::PipelineStage::DECODE] = decode_data;
     }
 
     // Helper to get decode stage data
@@ -98,7 +93,7 @@ TEST_F(DecodeStageTest, DecodeBasicRTypeInstruction) {
     // Verify the instruction is in decode stage before processing
     const PipelineStageData* decode_data = getDecodeStageData();
     ASSERT_NE(decode_data, nullptr);
-    ASSERT_NE(decode_data->instruction, nullptr);
+    ASSERT_FALSE(decode_data->isEmpty());
 
     // Decode the instruction - this should:
     // 1. Read Rs register value ($1 = 100)
@@ -124,7 +119,7 @@ TEST_F(DecodeStageTest, DecodeITypeInstructionWithImmediate) {
     // Verify the decode stage now has the correct values set
     const PipelineStageData* decode_data = getDecodeStageData();
     ASSERT_NE(decode_data, nullptr);
-    ASSERT_NE(decode_data->instruction, nullptr);
+    ASSERT_FALSE(decode_data->isEmpty());
 
     // This instruction should 
     // 1. Read Rs register value ($4 = 400)
@@ -149,7 +144,7 @@ TEST_F(DecodeStageTest, DecodeBEQTypeInstruction) {
 
     const PipelineStageData* decode_data = getDecodeStageData();
     ASSERT_NE(decode_data, nullptr);
-    ASSERT_NE(decode_data->instruction, nullptr);
+    ASSERT_FALSE(decode_data->isEmpty());
     EXPECT_EQ(decode_data->rs_value, 1000);             // Should have read $10 value
     EXPECT_EQ(decode_data->rt_value, 1100);             // Should have read $11 value
     EXPECT_FALSE(decode_data->dest_reg.has_value());    // No destination register
@@ -158,13 +153,11 @@ TEST_F(DecodeStageTest, DecodeBEQTypeInstruction) {
 
 TEST_F(DecodeStageTest, ForwardingToRsRegister) {
     // Set up execute stage with instruction that writes to $1
-    auto execute_data = std::make_unique<PipelineStageData>();
-    execute_data->instruction = std::make_unique<Instruction>(0x00000000);
-    execute_data->pc = sim->getPC();
-    execute_data->alu_result = 1234;
-    execute_data->dest_reg = 1;
+    PipelineStageData execute_data(Instruction(0x00000000), sim->getPC());
+    execute_data.alu_result = 1234;
+    execute_data.dest_reg = 1;
 
-    sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = std::move(execute_data);
+    sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = execute_data;
 
     // Decode instruction that reads $1
     setupDecodeStage(r_type_add_instr);
@@ -178,13 +171,11 @@ TEST_F(DecodeStageTest, ForwardingToRsRegister) {
 // Test forwarding to Rt register  
 TEST_F(DecodeStageTest, ForwardingToRtRegister) {
     // Set up execute stage with instruction that writes to $2
-    auto execute_data = std::make_unique<PipelineStageData>();
-    execute_data->instruction = std::make_unique<Instruction>(0x00000000);
-    execute_data->pc = sim->getPC();
-    execute_data->alu_result = 5678;
-    execute_data->dest_reg = 2;
+    PipelineStageData execute_data(Instruction(0x00000000), sim->getPC());
+    execute_data.alu_result = 5678;
+    execute_data.dest_reg = 2;
 
-    sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = std::move(execute_data);
+    sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = execute_data;
 
     // Decode instruction that reads $2
     setupDecodeStage(r_type_add_instr);
@@ -198,14 +189,12 @@ TEST_F(DecodeStageTest, ForwardingToRtRegister) {
 // No forwarding when register numbers don't match
 TEST_F(DecodeStageTest, NoForwardingWhenRegistersDontMatch) {
     // Set up execute stage with instruction that writes to $5 (not used in our decode instruction)
-    auto execute_data = std::make_unique<PipelineStageData>();
-    execute_data->instruction = std::make_unique<Instruction>(0x00000000); // Dummy instruction
-    execute_data->pc = sim->getPC();
-    execute_data->alu_result = 9999;  // Some value that shouldn't be forwarded
-    execute_data->dest_reg = 5;       // Writing to register $5
+    PipelineStageData execute_data(Instruction(0x00000000), sim->getPC()); // Dummy instruction
+    execute_data.alu_result = 9999;  // Some value that shouldn't be forwarded
+    execute_data.dest_reg = 5;       // Writing to register $5
 
     // Place the instruction in the execute stage
-    sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = std::move(execute_data);
+    sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = execute_data;
 
     // Set up decode stage with ADD $3, $1, $2 (doesn't use $5)
     setupDecodeStage(r_type_add_instr);
@@ -216,7 +205,7 @@ TEST_F(DecodeStageTest, NoForwardingWhenRegistersDontMatch) {
     // Verify NO forwarding occurred
     const PipelineStageData* decode_data = getDecodeStageData();
     ASSERT_NE(decode_data, nullptr);
-    ASSERT_NE(decode_data->instruction, nullptr);
+    ASSERT_FALSE(decode_data->isEmpty());
 
     EXPECT_EQ(decode_data->rs_value, 100);  // Normal register file value for $1
     EXPECT_EQ(decode_data->rt_value, 200);  // Normal register file value for $2
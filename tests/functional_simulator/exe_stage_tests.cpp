@@ -49,19 +49,14 @@ class ExecuteStageTest : public ::testing::Test {
     // Helper to set up execute stage with an instruction and data
     void setupExecuteStage(uint32_t instruction_word, uint32_t rs_value, uint32_t rt_value, 
                           std::optional<uint8_t> dest_reg = std::nullopt, uint32_t pc_value = 1000) {
-        // Create instruction
-        auto instr = std::make_unique<Instruction>(instruction_word);
-
         // Create pipeline stage data for execute stage
-        auto execute_data = std::make_unique<PipelineStageData>();
-        execute_data->instruction = std::move(instr);
-        execute_data->rs_value = rs_value;
-        execute_data->rt_value = rt_value;
-        execute_data->dest_reg = dest_reg;
-        execute_data->pc = pc_value;
+        PipelineStageData execute_data(Instruction(instruction_word), pc_value);
+        execute_data.rs_value = rs_value;
+        execute_data.rt_value = rt_value;
+        execute_data.dest_reg = dest_reg;
 
         // Place the instruction in the execute stage
-        sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = std::move(execute_data);
+        sim->getPipeline()[FunctionalSimulator::PipelineStage::EXECUTE] = execute_data;
     }
 
     // Helper to get execute stage data
@@ -83,7 +78,7 @@ TEST_F(ExecuteStageTest, ExecuteADD) {
     // Verify instruction is in execute stage
     const PipelineStageData* execute_data = getExecuteStageData();
     ASSERT_NE(execute_data, nullptr);
-    ASSERT_NE(execute_data->instruction, nullptr);
+    ASSERT_FALSE(execute_data->isEmpty());
 
     // Execute the instruction
     sim->execute();
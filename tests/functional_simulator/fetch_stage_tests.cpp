@@ -60,7 +60,7 @@ TEST_F(FetchStageTest, FetchFourInstructions) {
     const PipelineStageData* fetch_data =
         sim->getPipelineStage(FunctionalSimulator::PipelineStage::FETCH);
     ASSERT_NE(fetch_data, nullptr);
-    EXPECT_EQ(fetch_data->instruction->getOpcode(), mips_lite::opcode::ADD);
+    EXPECT_EQ(fetch_data->instruction.getOpcode(), mips_lite::opcode::ADD);
     EXPECT_EQ(fetch_data->pc, 0);  // Should store the PC where instruction was fetched
 
     // Advance pipeline to make room for next fetch
@@ -72,7 +72,7 @@ TEST_F(FetchStageTest, FetchFourInstructions) {
     EXPECT_EQ(sim->getPC(), 8);
     fetch_data = sim->getPipelineStage(FunctionalSimulator::PipelineStage::FETCH);
     ASSERT_NE(fetch_data, nullptr);
-    EXPECT_EQ(fetch_data->instruction->getOpcode(), mips_lite::opcode::ADDI);
+    EXPECT_EQ(fetch_data->instruction.getOpcode(), mips_lite::opcode::ADDI);
     EXPECT_EQ(fetch_data->pc, 4);
 
     // Advance pipeline again
@@ -83,7 +83,7 @@ TEST_F(FetchStageTest, FetchFourInstructions) {
     EXPECT_EQ(sim->getPC(), 12);
     fetch_data = sim->getPipelineStage(FunctionalSimulator::PipelineStage::FETCH);
     ASSERT_NE(fetch_data, nullptr);
-    EXPECT_EQ(fetch_data->instruction->getOpcode(), mips_lite::opcode::SUB);
+    EXPECT_EQ(fetch_data->instruction.getOpcode(), mips_lite::opcode::SUB);
     EXPECT_EQ(fetch_data->pc, 8);
 
     // Advance pipeline again
@@ -97,7 +97,7 @@ TEST_F(FetchStageTest, FetchFourInstructions) {
 
     fetch_data = sim->getPipelineStage(FunctionalSimulator::PipelineStage::FETCH);
     ASSERT_NE(fetch_data, nullptr);
-    EXPECT_EQ(fetch_data->instruction->getOpcode(), mips_lite::opcode::HALT);
+    EXPECT_EQ(fetch_data->instruction.getOpcode(), mips_lite::opcode::HALT);
     EXPECT_EQ(fetch_data->pc, 12);
 
     // Try to fetch again - should do nothing because halt_pipeline is true
@@ -1,6 +1,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <set>
+
 #include "functional_simulator.h"
 #include "memory_interface.h"
 #include "mips_instruction.h"
@@ -108,14 +110,12 @@ TEST_F(FunctionalSimulatorTest, WriteBackWritesToRegisterAndUpdatesStats) {
     uint8_t dest_reg = 8;
     uint32_t expected_value = 0x12345678;
 
-    // Manually populate WRITEBACK stage with a PipelineStageData pointer
+    // Manually populate WRITEBACK stage slot with a PipelineStageData
     // that has our desired data.
-    auto data = std::make_unique<PipelineStageData>();
-    data->alu_result = expected_value;
-    data->dest_reg = dest_reg;
-    data->instruction =
-        std::make_unique<Instruction>(mips_lite::opcode::ADDI << 26);  // Dummy opcode
-    sim->getPipeline()[FunctionalSimulator::WRITEBACK] = std::move(data);
+    PipelineStageData data(Instruction(mips_lite::opcode::ADDI << 26), 0);  // Dummy opcode
+    data.alu_result = expected_value;
+    data.dest_reg = dest_reg;
+    sim->getPipeline()[FunctionalSimulator::WRITEBACK] = data;
 
     sim->writeBack();
 
@@ -139,11 +139,9 @@ TEST_F(FunctionalSimulatorTest, WriteBackEmptyDestRegReturns) {
 
     // NOTE: No dest_reg is set here, so writeBack should return without
     // writing to the register file.
-    auto data = std::make_unique<PipelineStageData>();
-    data->alu_result = expected_value;
-    data->instruction =
-        std::make_unique<Instruction>(mips_lite::opcode::ADDI << 26);  // Dummy opcode
-    sim->getPipeline()[FunctionalSimulator::WRITEBACK] = std::move(data);
+    PipelineStageData data(Instruction(mips_lite::opcode::ADDI << 26), 0);  // Dummy opcode
+    data.alu_result = expected_value;
+    sim->getPipeline()[FunctionalSimulator::WRITEBACK] = data;
 
     sim->writeBack();
 
@@ -161,15 +159,14 @@ TEST_F(FunctionalSimulatorTest, WriteBackUsesMemoryDataForLoad) {
     uint8_t dest_reg = 9;
     uint32_t expected_value = 0x01234567;
 
-    auto data = std::make_unique<PipelineStageData>();
-    data->dest_reg = dest_reg;
+    PipelineStageData data(Instruction(mips_lite::opcode::LDW << 26), 0);
+    data.dest_reg = dest_reg;
     // alu_result should be ignored
-    data->alu_result = 0x89ABCDEF;
+    data.alu_result = 0x89ABCDEF;
     // expected_value in memory_data should be written
-    data->memory_data = expected_value;
-    data->instruction = std::make_unique<Instruction>((mips_lite::opcode::LDW << 26));
+    data.memory_data = expected_value;
 
-    sim->getPipeline()[FunctionalSimulator::WRITEBACK] = std::move(data);
+    sim->getPipeline()[FunctionalSimulator::WRITEBACK] = data;
 
     sim->writeBack();
 
@@ -195,11 +192,10 @@ TEST_F(FunctionalSimulatorTest, MemoryStageLoadsDataFromMemory) {
 
     EXPECT_CALL(mem, readMemory(addr)).Times(1).WillOnce(::testing::Return(loaded_value));
 
-    auto data = std::make_unique<PipelineStageData>();
-    data->alu_result = addr;
-    data->instruction = std::make_unique<Instruction>((mips_lite::opcode::LDW << 26));
+    PipelineStageData data(Instruction(mips_lite::opcode::LDW << 26), 0);
+    data.alu_result = addr;
 
-    sim->getPipeline()[FunctionalSimulator::MEMORY] = std::move(data);
+    sim->getPipeline()[FunctionalSimulator::MEMORY] = data;
 
     sim->memory();
 
@@ -219,12 +215,11 @@ TEST_F(FunctionalSimulatorTest, MemoryStageStoresDataToMemory) {
 
     EXPECT_CALL(mem, writeMemory(addr, store_value)).Times(1);
 
-    auto data = std::make_unique<PipelineStageData>();
-    data->alu_result = addr;
-    data->rt_value = store_value;
-    data->instruction = std::make_unique<Instruction>((mips_lite::opcode::STW << 26));
+    PipelineStageData data(Instruction(mips_lite::opcode::STW << 26), 0);
+    data.alu_result = addr;
+    data.rt_value = store_value;
 
-    sim->getPipeline()[FunctionalSimulator::MEMORY] = std::move(data);
+    sim->getPipeline()[FunctionalSimulator::MEMORY] = data;
 
     sim->memory();
 
@@ -245,14 +240,13 @@ TEST_F(FunctionalSimulatorTest, MemoryStageIgnoresNonMemoryInstructions) {
     EXPECT_CALL(mem, readMemory).Times(0);
     EXPECT_CALL(mem, writeMemory).Times(0);
 
-    auto data = std::make_unique<PipelineStageData>();
+    PipelineStageData data(Instruction(mips_lite::opcode::MUL << 26), 0);
     // This would be treated as an address in a load / store, but is a multiply result for MULT
-    data->alu_result = mult_result;
+    data.alu_result = mult_result;
     // Should remain unchanged from the initialized value of 0x0
-    data->memory_data = 0x0;
-    data->instruction = std::make_unique<Instruction>((mips_lite::opcode::MUL << 26));
+    data.memory_data = 0x0;
 
-    sim->getPipeline()[FunctionalSimulator::MEMORY] = std::move(data);
+    sim->getPipeline()[FunctionalSimulator::MEMORY] = data;
 
     sim->memory();
 
@@ -267,6 +261,34 @@ TEST_F(FunctionalSimulatorTest, MemoryStageIgnoresNonMemoryInstructions) {
     EXPECT_EQ(modified_addrs.size(), 0);
 }
 
+// ---------------------------
+// Pipeline slots
+// ---------------------------
+
+/**
+ * @test PipelineReusesFixedSlots
+ * @brief Verifies that advancing the pipeline rotates the fixed stage slots rather than
+ * creating new stage data, so every occupied stage always points at one of the same slots.
+ */
+TEST_F(FunctionalSimulatorTest, PipelineReusesFixedSlots) {
+    // ADDI R1 R0 1 repeated forever: no hazards and no branches
+    ON_CALL(mem, readInstruction(::testing::_)).WillByDefault(::testing::Return(0x04010001));
+
+    std::set<const PipelineStageData*> seen_slots;
+    for (int i = 0; i < 20; ++i) {
+        sim->cycle();
+        for (int stage = 0; stage < FunctionalSimulator::getNumStages(); ++stage) {
+            if (const auto* data = sim->getPipelineStage(stage)) {
+                seen_slots.insert(data);
+            }
+        }
+    }
+
+    EXPECT_EQ(seen_slots.size(), static_cast<size_t>(FunctionalSimulator::getNumStages()));
+    EXPECT_EQ(stats.getClockCycles(), 20);
+    EXPECT_EQ(rf.read(1), 1);
+}
+
 /*
 // The following or something similar may be used to test individual methods
 // with mocked memory parser methods like readInstruction
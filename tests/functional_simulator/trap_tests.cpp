@@ -0,0 +1,158 @@
+/**
+ * @file trap_tests.cpp
+ * @brief Tests for guest traps in FunctionalSimulator: a faulting load, store, fetch or invalid
+ * opcode stops the run with StopReason::TRAPPED, the cause and faulting PC recorded, every older
+ * instruction retired and nothing younger. Stepping with cycle() must end in the same state.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+using mips_lite::TrapCause;
+using StopReason = FunctionalSimulator::StopReason;
+namespace opcode = mips_lite::opcode;
+
+class TrapTest : public ::testing::Test {
+   protected:
+    std::string test_filename = (std::filesystem::path(__FILE__).parent_path() /
+                                 ("test_trap_" + std::to_string(getpid()) + ".txt"))
+                                   .string();
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(test_filename);
+        ASSERT_TRUE(file.is_open()) << "Failed to create test file";
+        for (uint32_t word : words) {
+            file << std::hex << std::setw(8) << std::setfill('0') << word << std::endl;
+        }
+    }
+
+    /// Run the image with run() and with cycle(), with and without forwarding, check both trap
+    /// the same way, and pass the run() machine to `check` for the architectural state
+    template <typename Check>
+    void expectTrap(TrapCause cause, uint32_t trap_pc, uint32_t address, Check check) {
+        for (bool forward : {false, true}) {
+            SCOPED_TRACE(forward ? "forwarding" : "no forwarding");
+            Machine ran(test_filename, forward);
+            Machine stepped(test_filename, forward);
+
+            FunctionalSimulator::RunResult result = ran.sim.run(1000);
+            EXPECT_EQ(result.reason, StopReason::TRAPPED);
+            EXPECT_TRUE(ran.sim.isTrapped());
+            EXPECT_TRUE(ran.sim.isProgramFinished());
+            EXPECT_EQ(ran.sim.getTrap().cause, cause);
+            EXPECT_EQ(ran.sim.getTrap().pc, trap_pc);
+            EXPECT_EQ(ran.sim.getTrap().address, address);
+            EXPECT_EQ(ran.sim.getPC(), trap_pc);
+            for (int stage = 0; stage < FunctionalSimulator::getNumStages(); ++stage) {
+                EXPECT_EQ(ran.sim.getPipelineStage(stage), nullptr) << "stage " << stage;
+            }
+
+            uint64_t cycles = 0;
+            while (!stepped.sim.isProgramFinished() && cycles < 1000) {
+                stepped.sim.cycle();
+                ++cycles;
+            }
+            EXPECT_EQ(cycles, result.cycles);
+            EXPECT_EQ(stepped.stats.getClockCycles(), ran.stats.getClockCycles());
+            EXPECT_EQ(stepped.stats.getStalls(), ran.stats.getStalls());
+            EXPECT_EQ(stepped.stats.totalInstructions(), ran.stats.totalInstructions());
+            EXPECT_EQ(stepped.sim.getTrap().cause, cause);
+            EXPECT_EQ(stepped.sim.getPC(), trap_pc);
+            expectSameRegisters(stepped.rf, ran.rf);
+            check(ran);
+        }
+    }
+
+    void TearDown() override { std::filesystem::remove(test_filename); }
+};
+
+// Everything before the faulting load retires, nothing after it does
+TEST_F(TrapTest, UnalignedLoad) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 1),    //  0
+        encodeI(opcode::ADDI, 2, 1, 2),    //  4
+        encodeI(opcode::LDW, 3, 0, 8194),  //  8: address 8194 is not word aligned
+        encodeI(opcode::ADDI, 4, 0, 4),    // 12
+        encodeI(opcode::HALT, 0, 0, 0),    // 16
+    });
+    expectTrap(TrapCause::UNALIGNED_ACCESS, 8, 8194, [](Machine<>& m) {
+        EXPECT_EQ(m.sim.getRetiredInstructions(), 2u);
+        EXPECT_EQ(m.rf.read(2), 3u);
+        EXPECT_EQ(m.rf.read(3), 0u);
+        EXPECT_EQ(m.rf.read(4), 0u);
+    });
+}
+
+// A faulting store leaves memory and the written-address stats untouched
+TEST_F(TrapTest, UnalignedStore) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 7),  //  0
+        encodeI(opcode::STW, 1, 0, 18),  //  4: address 18 is not word aligned
+        encodeI(opcode::ADDI, 2, 0, 2),  //  8
+        encodeI(opcode::HALT, 0, 0, 0),  // 12
+        0x00000000,                      // 16
+    });
+    expectTrap(TrapCause::UNALIGNED_ACCESS, 4, 18, [](Machine<>& m) {
+        EXPECT_EQ(m.sim.getRetiredInstructions(), 1u);
+        EXPECT_EQ(m.rf.read(1), 7u);
+        EXPECT_EQ(m.rf.read(2), 0u);
+        EXPECT_EQ(m.mem.readMemory(16), 0u);
+        EXPECT_TRUE(m.stats.getMemoryAddresses().empty());
+    });
+}
+
+TEST_F(TrapTest, InvalidOpcode) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 1),  //  0
+        0xFC000000,                      //  4: opcode 63
+        encodeI(opcode::ADDI, 2, 0, 2),  //  8
+        encodeI(opcode::HALT, 0, 0, 0),  // 12
+    });
+    expectTrap(TrapCause::INVALID_OPCODE, 4, 4, [](Machine<>& m) {
+        EXPECT_EQ(m.sim.getRetiredInstructions(), 1u);
+        EXPECT_EQ(m.rf.read(2), 0u);
+    });
+}
+
+// Running off the end of the image traps at the first word that is not there
+TEST_F(TrapTest, FetchBeyondImage) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 1),  // 0
+        encodeI(opcode::ADDI, 2, 0, 2),  // 4
+    });
+    expectTrap(TrapCause::INVALID_INSTRUCTION_ADDRESS, 8, 8, [](Machine<>& m) {
+        EXPECT_EQ(m.sim.getRetiredInstructions(), 2u);
+        EXPECT_EQ(m.rf.read(2), 2u);
+    });
+}
+
+// Words fetched past the image behind a taken branch are flushed before they can trap
+TEST_F(TrapTest, WrongPathFetchFaultIsFlushed) {
+    writeImage({
+        encodeI(opcode::BEQ, 0, 0, 3),   //  0: -> 12
+        encodeI(opcode::ADDI, 1, 0, 1),  //  4
+        encodeI(opcode::HALT, 0, 0, 0),  //  8
+        encodeI(opcode::BEQ, 0, 0, -1),  // 12: -> 8, the last word of the image
+    });
+    for (bool forward : {false, true}) {
+        Machine m(test_filename, forward);
+        EXPECT_EQ(m.sim.run(1000).reason, StopReason::HALTED);
+        EXPECT_FALSE(m.sim.isTrapped());
+        EXPECT_EQ(m.sim.getTrap().cause, TrapCause::NONE);
+        EXPECT_EQ(m.rf.read(1), 0u);
+    }
+}
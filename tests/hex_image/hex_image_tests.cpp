@@ -0,0 +1,151 @@
+/**
+ * @file hex_image_tests.cpp
+ * @brief Unit tests for the hex image loader: the fast path must give the same words and the
+ * same errors as parsing every line with the std::hex stream extraction.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hex_image.h"
+
+namespace {
+constexpr size_t NO_LIMIT = SIZE_MAX;
+
+std::vector<uint32_t> parse(const std::string& text, size_t max_words = NO_LIMIT) {
+    return hex_image::parse(text.data(), text.size(), max_words);
+}
+
+/// The loader as it was: getline, trim, and a stringstream per line
+std::vector<uint32_t> referenceParse(const std::string& text) {
+    std::istringstream file(text);
+    std::vector<uint32_t> words;
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r\n"));
+        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+        if (!line.empty()) {
+            uint32_t value = 0;
+            std::stringstream ss;
+            ss << std::hex << line;
+            if (!(ss >> value)) {
+                throw std::runtime_error("Failed to parse instruction: " + line);
+            }
+            words.push_back(value);
+        }
+    }
+    return words;
+}
+
+std::string errorOf(const std::string& text, bool reference) {
+    try {
+        reference ? referenceParse(text) : parse(text);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+}  // namespace
+
+TEST(HexImageTest, CanonicalLines) {
+    EXPECT_EQ(parse("040103E8\n040204b0\n00003800\n"),
+              (std::vector<uint32_t>{0x040103E8, 0x040204B0, 0x00003800}));
+    EXPECT_EQ(parse("FFFFFFFF"), (std::vector<uint32_t>{0xFFFFFFFF}));  // No final newline
+    EXPECT_EQ(parse("1\n\n  2a \r\n\t\n"), (std::vector<uint32_t>{0x1, 0x2A}));
+    EXPECT_TRUE(parse("").empty());
+    EXPECT_TRUE(parse("\n \r\n").empty());
+}
+
+TEST(HexImageTest, UnusualLinesMatchStreamParsing) {
+    for (const std::string text :
+         {"0x1F\n", "0X1f\n", "000000001\n", "12G4\n", "12 34\n", "+5\n", "-1\n", "\v7\n",
+          "00000000000000000000000000ff\n"}) {
+        SCOPED_TRACE(text);
+        EXPECT_EQ(parse(text), referenceParse(text));
+    }
+}
+
+TEST(HexImageTest, MalformedLinesReportTheLine) {
+    for (const std::string text : {"XYZ\n", "01\n  G123 \n", "123456789\n", "0x\n", "-\n"}) {
+        SCOPED_TRACE(text);
+        std::string expected = errorOf(text, true);
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(errorOf(text, false), expected);
+    }
+    EXPECT_EQ(errorOf("01\n  G123 \n", false), "Failed to parse instruction: G123");
+}
+
+TEST(HexImageTest, RandomLinesMatchStreamParsing) {
+    const std::string alphabet = "0123456789abcdefABCDEFxX+- \t\rGz";
+    std::mt19937 rng(12345);
+    for (int trial = 0; trial < 2000; ++trial) {
+        std::string text;
+        int lines = 1 + static_cast<int>(rng() % 4);
+        for (int l = 0; l < lines; ++l) {
+            int length = static_cast<int>(rng() % 11);
+            for (int c = 0; c < length; ++c) {
+                text += alphabet[rng() % alphabet.size()];
+            }
+            text += '\n';
+        }
+        SCOPED_TRACE(text);
+        std::string expected_error = errorOf(text, true);
+        EXPECT_EQ(errorOf(text, false), expected_error);
+        if (expected_error.empty()) {
+            EXPECT_EQ(parse(text), referenceParse(text));
+        }
+    }
+}
+
+TEST(HexImageTest, WordLimit) {
+    EXPECT_EQ(parse("1\n2\n", 2).size(), 2u);
+    EXPECT_THROW(parse("1\n2\n3\n", 2), std::runtime_error);
+}
+
+// "ADDRESS: VALUE" lines are set aside with their address, or rejected if the caller cannot
+// place them, rather than read as the leading number
+TEST(HexImageTest, AddressedLines) {
+    std::string text = "1\n04000000: 11111111\n2\n  FFFFFFFC:22222222 \r\n";
+    std::vector<hex_image::PlacedWord> placed;
+    EXPECT_EQ(hex_image::parse(text.data(), text.size(), NO_LIMIT, &placed),
+              (std::vector<uint32_t>{0x1, 0x2}));
+    ASSERT_EQ(placed.size(), 2u);
+    EXPECT_EQ(placed[0].address, 0x04000000u);
+    EXPECT_EQ(placed[0].value, 0x11111111u);
+    EXPECT_EQ(placed[1].address, 0xFFFFFFFCu);
+    EXPECT_EQ(placed[1].value, 0x22222222u);
+
+    EXPECT_THROW(parse(text), std::runtime_error);
+    for (const std::string bad : {"00000002: 1\n", "0x10: 1\n", "10: \n", ": 1\n"}) {
+        SCOPED_TRACE(bad);
+        EXPECT_THROW(hex_image::parse(bad.data(), bad.size(), NO_LIMIT, &placed),
+                     std::runtime_error);
+    }
+}
+
+TEST(HexImageTest, LoadFile) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("hex_image_test_" + std::to_string(getpid()) + ".txt"))
+                          .string();
+    {
+        std::ofstream file(path);
+        file << "040103E8\n040204B0\n";
+    }
+    EXPECT_EQ(hex_image::load(path, NO_LIMIT), (std::vector<uint32_t>{0x040103E8, 0x040204B0}));
+    {
+        std::ofstream file(path, std::ios::trunc);  // Empty files cannot be mapped
+    }
+    EXPECT_TRUE(hex_image::load(path, NO_LIMIT).empty());
+    std::filesystem::remove(path);
+
+    EXPECT_THROW(hex_image::load(path, NO_LIMIT), std::runtime_error);
+}
@@ -0,0 +1,259 @@
+/**
+ * @file hybrid_simulator_tests.cpp
+ * @brief Unit tests for hybrid simulation: programs end in the same state as a full pipeline
+ * run, and the region of interest gets exactly the statistics the pipeline counts for it.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "hybrid_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+namespace opcode = mips_lite::opcode;
+namespace roi = mips_lite::roi;
+using StopReason = FunctionalSimulator::StopReason;
+
+namespace {
+/// A load-use loop of five iterations inside the region, a few instructions on either side
+const std::vector<uint32_t> KERNEL_PROGRAM = {
+    encodeI(opcode::ADDI, 1, 0, 5),   //  0: R1 = 5
+    encodeI(opcode::ADDI, 5, 0, 60),  //  4: R5 = &data
+    roi::BEGIN,                       //  8
+    encodeI(opcode::LDW, 2, 5, 0),    // 12: loop: R2 = data
+    encodeI(opcode::ADDI, 3, 2, 1),   // 16: R3 = R2 + 1 (load-use)
+    encodeI(opcode::STW, 3, 5, 0),    // 20: data = R3
+    encodeI(opcode::SUBI, 1, 1, 1),   // 24: R1 -= 1
+    encodeI(opcode::BZ, 0, 1, 2),     // 28: if R1 == 0 goto 36
+    encodeI(opcode::BEQ, 0, 0, -5),   // 32: goto loop
+    roi::END,                         // 36
+    encodeI(opcode::ADDI, 4, 0, 7),   // 40: R4 = 7
+    encodeR(opcode::ADD, 6, 4, 4),    // 44: R6 = R4 + R4
+    encodeI(opcode::HALT, 0, 0, 0),   // 48
+    encodeR(opcode::ADD, 0, 0, 0),    // 52: padding
+    encodeR(opcode::ADD, 0, 0, 0),    // 56: padding
+    0x00000000,                       // 60: data
+};
+
+/// A machine with separate Stats for the region of interest, to run a HybridSimulator over
+struct HybridMachine : Machine<> {
+    using Machine<>::Machine;
+    Stats roi_stats;
+};
+
+/// The registers, and the memory words at addresses, of a hybrid and a pipelined run
+void expectSameState(Machine<>& a, Machine<>& b, const std::vector<uint32_t>& addresses) {
+    expectSameRegisters(a.rf, b.rf);
+    for (uint32_t address : addresses) {
+        EXPECT_EQ(a.mem.readMemory(address), b.mem.readMemory(address)) << address;
+    }
+}
+
+class HybridSimulatorTest : public ::testing::Test {
+   protected:
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("hybrid_test_" + std::to_string(getpid()) + ".txt"))
+                          .string();
+
+    void TearDown() override { std::filesystem::remove(path); }
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(path);
+        for (uint32_t word : words) {
+            file << std::uppercase << std::hex << std::setw(8) << std::setfill('0') << word
+                 << "\n";
+        }
+    }
+};
+}  // namespace
+
+TEST_F(HybridSimulatorTest, RegionStatsAreSeparate) {
+    writeImage(KERNEL_PROGRAM);
+    for (bool forwarding : {false, true}) {
+        SCOPED_TRACE(forwarding ? "forwarding" : "no forwarding");
+        HybridMachine hybrid_run(path);
+        HybridSimulator hybrid(&hybrid_run.rf, &hybrid_run.stats, &hybrid_run.roi_stats,
+                               &hybrid_run.mem, forwarding);
+        hybrid.run(UINT64_MAX);
+        EXPECT_TRUE(hybrid.isProgramFinished());
+        EXPECT_FALSE(hybrid.isTrapped());
+        EXPECT_EQ(hybrid.getPC(), 52u);
+        EXPECT_EQ(hybrid.getRegionEntries(), 1u);
+
+        Machine full(path, forwarding);
+
+        EXPECT_EQ(full.sim.run(UINT64_MAX).reason, StopReason::HALTED);
+        expectSameState(hybrid_run, full, {60});
+        EXPECT_EQ(hybrid_run.mem.readMemory(60), 5u);
+
+        // Both markers and 5 iterations of the loop, the last without the back-edge
+        EXPECT_EQ(hybrid_run.roi_stats.totalInstructions(), 31u);
+        EXPECT_EQ(hybrid.getRegionInstructions(), 31u);
+        EXPECT_EQ(hybrid_run.stats.totalInstructions(), 5u);
+        EXPECT_EQ(hybrid.getOutsideInstructions(), 5u);
+        EXPECT_EQ(hybrid_run.stats.getClockCycles(), 0u);
+        EXPECT_EQ(hybrid_run.roi_stats.getMemoryAddresses().count(60), 1u);
+        EXPECT_TRUE(hybrid_run.stats.getMemoryAddresses().empty());
+
+        // The region's timing is that of a pipeline started at BEGIN
+        Machine region(path, forwarding);
+        region.rf.write(1, 5);
+        region.rf.write(5, 60);
+        region.sim.setPC(8);
+        FunctionalSimulator::RunLimits limits;
+        limits.stop_word = roi::END;
+        ASSERT_EQ(region.sim.runUntil(limits).reason, StopReason::WORD_RETIRED);
+        EXPECT_EQ(hybrid_run.roi_stats.getClockCycles(), region.stats.getClockCycles());
+        EXPECT_EQ(hybrid_run.roi_stats.getStalls(), region.stats.getStalls());
+        EXPECT_GT(hybrid_run.roi_stats.getStalls(), 0u);
+        EXPECT_EQ(hybrid_run.roi_stats.totalInstructions(), region.stats.totalInstructions());
+
+        Stats total = hybrid_run.stats;
+        total.merge(hybrid_run.roi_stats);
+        EXPECT_EQ(total.totalInstructions(), full.stats.totalInstructions());
+        EXPECT_EQ(total.getRegisters(), full.stats.getRegisters());
+        EXPECT_EQ(total.getMemoryAddresses(), full.stats.getMemoryAddresses());
+    }
+}
+
+// A region inside a loop is entered on every iteration, whatever the budget per run() call
+TEST_F(HybridSimulatorTest, RegionInALoopIsEnteredEachTime) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 3),   //  0: R1 = 3
+        encodeI(opcode::ADDI, 2, 2, 1),   //  4: loop: R2 += 1
+        roi::BEGIN,                       //  8
+        encodeR(opcode::MUL, 3, 2, 2),    // 12: R3 = R2 * R2
+        encodeR(opcode::ADD, 4, 4, 3),    // 16: R4 += R3
+        roi::END,                         // 20
+        encodeI(opcode::SUBI, 1, 1, 1),   // 24: R1 -= 1
+        encodeI(opcode::BZ, 0, 1, 4),     // 28: if R1 == 0 goto 44
+        encodeI(opcode::BEQ, 0, 0, -7),   // 32: goto loop
+        encodeR(opcode::ADD, 0, 0, 0),    // 36: padding
+        encodeR(opcode::ADD, 0, 0, 0),    // 40: padding
+        encodeI(opcode::HALT, 0, 0, 0),   // 44
+    });
+    Machine full(path, false);
+    EXPECT_EQ(full.sim.run(UINT64_MAX).reason, StopReason::HALTED);
+    EXPECT_EQ(full.rf.read(4), 14u);
+
+    for (uint64_t chunk : {uint64_t(1), uint64_t(3), UINT64_MAX}) {
+        SCOPED_TRACE("chunk " + std::to_string(chunk));
+        HybridMachine hybrid_run(path);
+        HybridSimulator hybrid(&hybrid_run.rf, &hybrid_run.stats, &hybrid_run.roi_stats,
+                               &hybrid_run.mem);
+        uint64_t retired = 0;
+        for (int calls = 0; !hybrid.isProgramFinished() && calls < 100; ++calls) {
+            uint64_t count = hybrid.run(chunk);
+            EXPECT_LE(count, chunk);
+            retired += count;
+        }
+        EXPECT_TRUE(hybrid.isProgramFinished());
+        EXPECT_FALSE(hybrid.isInRegion());
+        EXPECT_EQ(hybrid.getRegionEntries(), 3u);
+        EXPECT_EQ(hybrid.getRegionInstructions(), 12u);
+        EXPECT_EQ(retired, full.stats.totalInstructions());
+        EXPECT_EQ(hybrid.getPC(), 48u);  // One past the HALT
+        expectSameState(hybrid_run, full, {});
+    }
+}
+
+// Code stored over inside the region is not run from a stale translation afterwards
+TEST_F(HybridSimulatorTest, StoresInsideRegionReachTranslatedCode) {
+    writeImage({
+        encodeI(opcode::ADDI, 10, 0, 2),   //  0: R10 = 2
+        encodeI(opcode::ADDI, 1, 1, 1),    //  4: loop: R1 += 1, patched to R1 += 100
+        encodeI(opcode::SUBI, 10, 10, 1),  //  8: R10 -= 1
+        encodeI(opcode::BZ, 0, 10, 8),     // 12: if R10 == 0 goto 44
+        roi::BEGIN,                        // 16
+        encodeI(opcode::LDW, 2, 0, 48),    // 20: R2 = replacement instruction
+        encodeI(opcode::STW, 2, 0, 4),     // 24: patch the loop
+        roi::END,                          // 28
+        encodeI(opcode::BEQ, 0, 0, -7),    // 32: goto loop
+        encodeR(opcode::ADD, 0, 0, 0),     // 36: padding
+        encodeR(opcode::ADD, 0, 0, 0),     // 40: padding
+        encodeI(opcode::HALT, 0, 0, 0),    // 44
+        encodeI(opcode::ADDI, 1, 1, 100),  // 48: data
+    });
+    HybridMachine hybrid_run(path);
+    HybridSimulator hybrid(&hybrid_run.rf, &hybrid_run.stats, &hybrid_run.roi_stats,
+                           &hybrid_run.mem);
+    hybrid.run(UINT64_MAX);
+    EXPECT_TRUE(hybrid.isProgramFinished());
+    EXPECT_EQ(hybrid_run.rf.read(1), 101u);
+
+    Machine full(path, false);
+
+    EXPECT_EQ(full.sim.run(UINT64_MAX).reason, StopReason::HALTED);
+    expectSameState(hybrid_run, full, {4});
+}
+
+TEST_F(HybridSimulatorTest, TrapInsideRegionEndsTheProgram) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 1),  //  0: R1 = 1
+        roi::BEGIN,                      //  4
+        encodeI(opcode::LDW, 2, 0, 2),   //  8: unaligned load
+        roi::END,                        // 12
+        encodeI(opcode::HALT, 0, 0, 0),  // 16
+    });
+    HybridMachine hybrid_run(path);
+    HybridSimulator hybrid(&hybrid_run.rf, &hybrid_run.stats, &hybrid_run.roi_stats,
+                           &hybrid_run.mem);
+    hybrid.run(UINT64_MAX);
+    EXPECT_TRUE(hybrid.isProgramFinished());
+    ASSERT_TRUE(hybrid.isTrapped());
+    EXPECT_EQ(hybrid.getTrap().cause, mips_lite::TrapCause::UNALIGNED_ACCESS);
+    EXPECT_EQ(hybrid.getTrap().pc, 8u);
+    EXPECT_TRUE(hybrid.isInRegion());
+    EXPECT_EQ(hybrid_run.rf.read(1), 1u);
+    EXPECT_EQ(hybrid.run(10), 0u);
+}
+
+// Every trace ends as on the pipeline; only roi.txt has a region, the others run fast throughout
+TEST_F(HybridSimulatorTest, TracesMatchTheFullPipeline) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().filename().string());
+        bool has_region = entry.path().filename() == "roi.txt";
+        HybridMachine hybrid_run(entry.path().string());
+        HybridSimulator hybrid(&hybrid_run.rf, &hybrid_run.stats, &hybrid_run.roi_stats,
+                               &hybrid_run.mem);
+        hybrid.run(UINT64_MAX);
+        EXPECT_TRUE(hybrid.isProgramFinished());
+        EXPECT_EQ(hybrid.getRegionEntries(), has_region ? 1u : 0u);
+        EXPECT_EQ(hybrid_run.roi_stats.totalInstructions() != 0, has_region);
+
+        Machine full(entry.path().string(), false);
+
+        EXPECT_EQ(full.sim.run(UINT64_MAX).reason, StopReason::HALTED);
+        EXPECT_EQ(hybrid_run.stats.totalInstructions() + hybrid_run.roi_stats.totalInstructions(),
+                  full.stats.totalInstructions());
+        expectSameState(hybrid_run, full, {});
+    }
+}
+
+TEST_F(HybridSimulatorTest, NullDependenciesAreRejected) {
+    writeImage(KERNEL_PROGRAM);
+    HybridMachine machine(path);
+    EXPECT_THROW(HybridSimulator(&machine.rf, &machine.stats, nullptr, &machine.mem),
+                 std::invalid_argument);
+    EXPECT_THROW(HybridSimulator(&machine.rf, nullptr, &machine.roi_stats, &machine.mem),
+                 std::invalid_argument);
+    EXPECT_THROW(HybridSimulator(nullptr, &machine.stats, &machine.roi_stats, &machine.mem),
+                 std::invalid_argument);
+}
@@ -0,0 +1,238 @@
+/**
+ * @file jit_tests.cpp
+ * @brief Tests for the x86-64 JIT backend: differential checks against the cycle-accurate
+ * FunctionalSimulator, self-modifying code, faults and arena exhaustion.
+ *
+ * All tests are skipped on hosts without native code generation.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "block_translator.h"
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "jit_compiler.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+using mips_lite::InstructionCategory;
+namespace opcode = mips_lite::opcode;
+
+namespace {
+struct RunResult {
+    RegisterFile rf;
+    Stats stats;
+    uint32_t pc = 0;
+};
+
+void expectSameResult(const RunResult& a, const RunResult& b) {
+    EXPECT_EQ(a.pc, b.pc);
+    expectSameArchitecturalState(a.rf, a.stats, b.rf, b.stats);
+}
+
+void runPipeline(const std::string& path, RunResult& result) {
+    MemoryParser mem(path);
+    mem.setOutputFileOnModified(false);
+    FunctionalSimulator sim(&result.rf, &result.stats, &mem, true);
+    while (!sim.isProgramFinished() && result.stats.getClockCycles() < 100000) {
+        sim.cycle();
+    }
+    EXPECT_TRUE(sim.isProgramFinished());
+    result.pc = sim.getPC();
+}
+
+void runNative(const std::string& path, RunResult& result) {
+    MemoryParser mem(path);
+    mem.setOutputFileOnModified(false);
+    FastSimulator iss(&result.rf, &result.stats, &mem);
+    ASSERT_TRUE(iss.setNativeCompilation(true));
+    iss.run(100000);
+    EXPECT_TRUE(iss.isHalted());
+    result.pc = iss.getPC();
+}
+}  // namespace
+
+class JitTest : public ::testing::Test {
+   protected:
+    std::string test_filename = (std::filesystem::path(__FILE__).parent_path() /
+                                 ("test_jit_" + std::to_string(getpid()) + ".txt"))
+                                   .string();
+
+    void SetUp() override {
+        if (!JitCompiler::isSupported()) {
+            GTEST_SKIP() << "Native code generation is not supported on this host";
+        }
+    }
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(test_filename);
+        ASSERT_TRUE(file.is_open()) << "Failed to create test file";
+        for (uint32_t word : words) {
+            file << std::hex << std::setw(8) << std::setfill('0') << word << std::endl;
+        }
+    }
+
+    void TearDown() override { std::filesystem::remove(test_filename); }
+};
+
+// Every op kind the backend emits, including writes to R0 and fused pairs
+TEST_F(JitTest, AllOperationsMatchPipeline) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 7),          //   0: R1 = 7
+        encodeI(opcode::ADDI, 2, 0, -3),         //   4: R2 = -3
+        encodeR(opcode::ADD, 3, 1, 2),           //   8
+        encodeR(opcode::SUB, 4, 1, 2),           //  12
+        encodeR(opcode::MUL, 5, 1, 2),           //  16
+        encodeR(opcode::OR, 6, 1, 2),            //  20
+        encodeR(opcode::AND, 7, 1, 2),           //  24
+        encodeR(opcode::XOR, 8, 1, 2),           //  28
+        encodeI(opcode::ADDI, 9, 1, -100),       //  32
+        encodeI(opcode::SUBI, 10, 2, 5),         //  36
+        encodeI(opcode::MULI, 11, 2, -7),        //  40
+        encodeI(opcode::ORI, 12, 1, -32768),     //  44
+        encodeI(opcode::ANDI, 13, 2, 0x00F0),    //  48
+        encodeI(opcode::XORI, 14, 1, -1),        //  52
+        encodeR(opcode::ADD, 0, 1, 2),           //  56: write to R0 is dropped
+        encodeI(opcode::STW, 5, 0, 400),         //  60
+        encodeI(opcode::LDW, 15, 0, 400),        //  64: LDW_ADD
+        encodeR(opcode::ADD, 16, 15, 1),         //  68
+        encodeI(opcode::LDW, 17, 0, 400),        //  72: LDW_XORI
+        encodeI(opcode::XORI, 18, 17, 3),        //  76
+        encodeI(opcode::LDW, 0, 0, 400),         //  80: LDW_ADD into R0, then read R0
+        encodeR(opcode::ADD, 19, 0, 1),          //  84
+        encodeI(opcode::SUBI, 20, 1, 7),         //  88: SUBI_BZ, taken
+        encodeI(opcode::BZ, 0, 20, 2),           //  92: -> 100
+        encodeI(opcode::ADDI, 21, 0, 99),        //  96: skipped
+        encodeI(opcode::ADDI, 0, 1, 1),          // 100: ADDI_BZ writing R0, BZ on R0 is taken
+        encodeI(opcode::BZ, 0, 0, 2),            // 104: -> 112
+        encodeI(opcode::ADDI, 23, 0, 99),        // 108: skipped
+        encodeI(opcode::BEQ, 2, 1, 2),           // 112: not taken
+        encodeI(opcode::ADDI, 24, 0, 128),       // 116
+        encodeI(opcode::JR, 0, 24, 0),           // 120: -> 128
+        encodeI(opcode::ADDI, 25, 0, 99),        // 124: skipped
+        encodeI(opcode::ADDI, 26, 1, 0),         // 128
+        encodeI(opcode::ORI, 27, 0, 5),          // 132: ORI_BZ, not taken
+        encodeI(opcode::BZ, 0, 27, 2),           // 136
+        encodeI(opcode::BEQ, 1, 1, 2),           // 140: taken -> 148
+        encodeI(opcode::ADDI, 28, 0, 99),        // 144: skipped
+        encodeI(opcode::HALT, 0, 0, 0),          // 148
+    });
+
+    RunResult pipeline, native;
+    runPipeline(test_filename, pipeline);
+    runNative(test_filename, native);
+    expectSameResult(native, pipeline);
+    EXPECT_EQ(native.rf.read(5), static_cast<uint32_t>(-21));
+    EXPECT_EQ(native.rf.read(21), 0);
+    EXPECT_EQ(native.rf.read(26), 7);
+}
+
+// The loop body is compiled, then patched by a store and run once more
+TEST_F(JitTest, StoreIntoCompiledBlockIsSeen) {
+    writeImage({
+        0x04010002,  //  0: ADDI R1 R0 2     ; loop counter
+        0x3003003C,  //  4: LDW R3 R0 60     ; R3 = replacement instruction
+        0x04420001,  //  8: loop: ADDI R2 R2 1 ; patched to ADDI R2 R2 100
+        0x0C210001,  // 12: SUBI R1 R1 1
+        0x38200003,  // 16: BZ R1 3          ; -> 28
+        0x3C00FFFD,  // 20: BEQ R0 R0 -3     ; -> 8
+        0x00000000,  // 24: ADD R0 R0 R0
+        0x38800003,  // 28: BZ R4 3          ; first exit -> 40
+        0x00000000,  // 32: ADD R0 R0 R0
+        0x44000000,  // 36: HALT
+        0x04040001,  // 40: ADDI R4 R0 1
+        0x34030008,  // 44: STW R3 R0 8      ; patch the compiled loop body
+        0x04010001,  // 48: ADDI R1 R0 1
+        0x3C00FFF5,  // 52: BEQ R0 R0 -11    ; -> 8
+        0x00000000,  // 56: ADD R0 R0 R0
+        0x04420064,  // 60: data: ADDI R2 R2 100
+    });
+
+    RunResult pipeline, native;
+    runPipeline(test_filename, pipeline);
+    runNative(test_filename, native);
+    expectSameResult(native, pipeline);
+    EXPECT_EQ(native.rf.read(2), 102);
+}
+
+// A faulting load traps, with everything before it retired
+TEST_F(JitTest, FaultingLoadStopsAtTheLoad) {
+    writeImage({
+        encodeI(opcode::ADDI, 1, 0, 1),     //  0
+        encodeI(opcode::ADDI, 2, 0, 2),     //  4
+        encodeI(opcode::LDW, 3, 0, 8194),   //  8: address 8194 is not word aligned
+        encodeI(opcode::ADDI, 4, 0, 4),     // 12
+        encodeI(opcode::HALT, 0, 0, 0),     // 16
+    });
+    MemoryParser mem(test_filename);
+    mem.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FastSimulator iss(&rf, &stats, &mem);
+    ASSERT_TRUE(iss.setNativeCompilation(true));
+
+    EXPECT_EQ(iss.run(100), 2);
+    EXPECT_EQ(iss.getTrap().cause, mips_lite::TrapCause::UNALIGNED_ACCESS);
+    EXPECT_EQ(iss.getTrap().pc, 8);
+    EXPECT_EQ(iss.getTrap().address, 8194);
+    EXPECT_EQ(iss.getPC(), 8);
+    EXPECT_EQ(iss.getInstructionCount(), 2);
+    EXPECT_EQ(stats.getCategoryCount(InstructionCategory::ARITHMETIC), 2);
+    EXPECT_EQ(rf.read(2), 2);
+    EXPECT_EQ(rf.read(4), 0);
+}
+
+TEST_F(JitTest, FullArenaReturnsNull) {
+    ProgramImage image({
+        encodeI(opcode::ADDI, 1, 0, 1),
+        encodeI(opcode::ADDI, 2, 0, 2),
+        encodeI(opcode::HALT, 0, 0, 0),
+    });
+    BlockTranslator translator(&image);
+    const TranslatedBlock* block = translator.lookup(0);
+    ASSERT_NE(block, nullptr);
+
+    JitCompiler small(64);
+    EXPECT_NE(small.compile(*block), nullptr);
+    size_t used = small.codeSize();
+    EXPECT_GT(used, 0);
+    EXPECT_EQ(small.compile(*block), nullptr);  // No room for a second copy
+    EXPECT_EQ(small.codeSize(), used);
+
+    small.reset();
+    EXPECT_EQ(small.codeSize(), 0);
+    EXPECT_NE(small.compile(*block), nullptr);
+}
+
+// Differential test against the integration traces
+TEST_F(JitTest, MatchesFunctionalSimulatorOnTraces) {
+    std::filesystem::path trace_dir = traceDir();
+    ASSERT_TRUE(std::filesystem::exists(trace_dir));
+
+    int traces_checked = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(trace_dir)) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().filename().string());
+        RunResult pipeline, native;
+        runPipeline(entry.path().string(), pipeline);
+        runNative(entry.path().string(), native);
+        expectSameResult(native, pipeline);
+        ++traces_checked;
+    }
+    EXPECT_GT(traces_checked, 0);
+}
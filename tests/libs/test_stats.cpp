@@ -64,3 +64,93 @@ TEST(StatsTest, AverageStallsPerHazard) {
     stats.incrementDataHazards();  // now 2 hazards total
     EXPECT_FLOAT_EQ(stats.averageStallsPerHazard(), 1.0f);
 }
+
+TEST(StatsTest, OpcodeCounts) {
+    Stats stats;
+    stats.incrementOpcode(opcode::ADD);
+    stats.incrementOpcode(opcode::ADD);
+    stats.incrementOpcode(opcode::HALT);
+
+    EXPECT_EQ(stats.getOpcodeCount(opcode::ADD), 2);
+    EXPECT_EQ(stats.getOpcodeCount(opcode::HALT), 1);
+    EXPECT_EQ(stats.getOpcodeCount(opcode::SUB), 0);
+    EXPECT_EQ(stats.getOpcodeCount(200), 0);  // Not an opcode
+    EXPECT_EQ(stats.totalInstructions(), 0);  // Categories are counted separately
+}
+
+TEST(StatsTest, CountersDoNotWrapAt32Bits) {
+    Stats stats;
+    stats.incrementClockCycles(UINT32_MAX);
+    stats.incrementClockCycles(2);
+    stats.incrementStalls(UINT32_MAX);
+    stats.incrementStalls();
+    stats.incrementCategory(InstructionCategory::LOGICAL, UINT32_MAX);
+    stats.incrementCategory(InstructionCategory::LOGICAL);
+
+    EXPECT_EQ(stats.getClockCycles(), uint64_t(UINT32_MAX) + 2);
+    EXPECT_EQ(stats.getStalls(), uint64_t(UINT32_MAX) + 1);
+    EXPECT_EQ(stats.totalInstructions(), uint64_t(UINT32_MAX) + 1);
+}
+
+TEST(StatsTest, RegisterMask) {
+    Stats stats;
+    stats.addRegister(0);
+    stats.addRegister(31);
+    EXPECT_EQ(stats.getRegisterMask(), 0x80000001u);
+    EXPECT_EQ(stats.getRegisters().size(), 2);
+
+    // The set returned earlier is brought up to date
+    stats.addRegisters(0x6);
+    EXPECT_EQ(stats.getRegisters().size(), 4);
+    EXPECT_TRUE(stats.getRegisters().count(2));
+}
+
+TEST(StatsTest, MemoryAddressesAcrossPages) {
+    Stats stats;
+    const uint32_t addresses[] = {0x0, 0xFFC, 0x1000, 0xFFFFFFFC, 0x12345678, 0x2001};
+    for (uint32_t addr : addresses) {
+        stats.addMemoryAddress(addr);
+        stats.addMemoryAddress(addr);
+    }
+    EXPECT_EQ(stats.getMemoryAddresses().size(), 6);
+    for (uint32_t addr : addresses) {
+        EXPECT_TRUE(stats.hasMemoryAddress(addr)) << addr;
+        EXPECT_TRUE(stats.getMemoryAddresses().count(addr)) << addr;
+    }
+    EXPECT_FALSE(stats.hasMemoryAddress(0x4));
+    EXPECT_FALSE(stats.hasMemoryAddress(0x2000));
+    EXPECT_FALSE(stats.hasMemoryAddress(0x80000000));
+
+    stats.addMemoryAddress(0x4);
+    EXPECT_EQ(stats.getMemoryAddresses().size(), 7);
+    EXPECT_TRUE(stats.getMemoryAddresses().count(0x4));
+}
+
+TEST(StatsTest, MergeAddsEverything) {
+    Stats a, b;
+    a.incrementCategory(InstructionCategory::ARITHMETIC, 3);
+    a.incrementOpcode(opcode::ADD, 3);
+    a.addRegister(1);
+    a.addMemoryAddress(0x10);
+    a.incrementClockCycles(10);
+    b.incrementCategory(InstructionCategory::MEMORY_ACCESS, 2);
+    b.incrementOpcode(opcode::ADD);
+    b.addRegister(2);
+    b.addMemoryAddress(0x10);
+    b.addMemoryAddress(0x2001);
+    b.incrementClockCycles(5);
+    b.incrementStalls(2);
+    b.incrementDataHazards();
+
+    a.merge(b);
+    EXPECT_EQ(a.totalInstructions(), 5);
+    EXPECT_EQ(a.getCategoryCount(InstructionCategory::MEMORY_ACCESS), 2);
+    EXPECT_EQ(a.getOpcodeCount(opcode::ADD), 4);
+    EXPECT_EQ(a.getRegisterMask(), 0x6u);
+    EXPECT_EQ(a.getMemoryAddresses().size(), 2);
+    EXPECT_TRUE(a.hasMemoryAddress(0x2001));
+    EXPECT_EQ(a.getClockCycles(), 15);
+    EXPECT_EQ(a.getStalls(), 2);
+    EXPECT_EQ(a.getDataHazards(), 1);
+    EXPECT_EQ(b.totalInstructions(), 2);  // Left as it was
+}
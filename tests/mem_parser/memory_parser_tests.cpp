@@ -5,13 +5,17 @@
  */
 
 #include <gtest/gtest.h>
+#include <unistd.h>
 #include <sys/types.h>
 
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -30,7 +34,7 @@ class MemoryParserTest : public ::testing::Test {
                                              "040103E8", "040204B0", "00003800", "00004000"};
 
     void SetUp() override {
-        test_filename = test_dir + "/test_memory.txt";
+        test_filename = test_dir + "/test_memory_" + std::to_string(getpid()) + ".txt";
         std::ofstream file(test_filename);
         ASSERT_TRUE(file.is_open()) << "Failed to create test file";
 
@@ -41,12 +45,14 @@ class MemoryParserTest : public ::testing::Test {
     }
 
     void TearDown() override {
-        // Clean up by removing the test file
-        if (std::filesystem::exists(test_filename)) {
-            try {
-                std::filesystem::remove(test_filename);
-            } catch (const std::filesystem::filesystem_error& e) {
-                std::cerr << "Error removing test file: " << e.what() << std::endl;
+        // Clean up by removing the test file and the dump a modified parser leaves next to it
+        for (const std::string& path : {test_filename, test_filename + ".out"}) {
+            if (std::filesystem::exists(path)) {
+                try {
+                    std::filesystem::remove(path);
+                } catch (const std::filesystem::filesystem_error& e) {
+                    std::cerr << "Error removing test file: " << e.what() << std::endl;
+                }
             }
         }
     }
@@ -82,10 +88,14 @@ TEST_F(MemoryParserTest, ReadEntireFileSequentially) {
     EXPECT_THROW({ parser.readInstruction(address); }, std::runtime_error);
 }
 
-TEST_F(MemoryParserTest, readMemoryOutOfBounds) {
+// Memory spans the 32-bit address space; untouched words read as zero without allocating
+TEST_F(MemoryParserTest, readMemoryUntouched) {
     MemoryParser parser(test_filename);
-    // Test reading out of bounds
-    EXPECT_THROW({ parser.readMemory(0x2000); }, std::runtime_error);
+    parser.setOutputFileOnModified(false);
+    size_t pages = parser.getNumAllocatedPages();
+    EXPECT_EQ(parser.readMemory(0x2000), 0u);
+    EXPECT_EQ(parser.readMemory(0x7FFFF000), 0u);
+    EXPECT_EQ(parser.getNumAllocatedPages(), pages) << "Read allocated a page";
 }
 
 TEST_F(MemoryParserTest, readMemoryUnaligned) {
@@ -102,19 +112,22 @@ TEST_F(MemoryParserTest, readMemoryValid) {
     EXPECT_EQ(expected, actual) << "Memory read mismatch";
 }
 
-TEST_F(MemoryParserTest, readMemoryWithAddedZeroLines) {
+TEST_F(MemoryParserTest, readMemoryBeyondFileSize) {
     MemoryParser parser(test_filename);
     size_t curr_size = parser.getNumMemoryElements();
     EXPECT_EQ(curr_size, sample_lines.size()) << "File size mismatch";
 
-    // Add 10 lines
+    // Read 10 lines past the end, and far beyond it
     uint32_t index = static_cast<uint32_t>(sample_lines.size() - 1 + 10);
     uint32_t address = INDEX_TO_ADDR(index);
     uint32_t expected = 0x00000000;
     uint32_t actual = parser.readMemory(address);
 
     EXPECT_EQ(expected, actual) << "Memory read mismatch";
-    EXPECT_EQ(parser.getNumMemoryElements(), curr_size + 10) << "File size mismatch";
+    EXPECT_EQ(parser.readMemory(0xFFFFFFFC), 0u);
+    EXPECT_EQ(parser.getNumMemoryElements(), curr_size) << "Read extended the file";
+    EXPECT_FALSE(parser.isModified()) << "Read marked memory modified";
+    EXPECT_EQ(parser.getNumAllocatedPages(), 1u);
 }
 
 TEST_F(MemoryParserTest, jumpToInstructionUnaligned) {
@@ -129,7 +142,7 @@ TEST_F(MemoryParserTest, jumpToInstructionOutOfBounds) {
     MemoryParser parser(test_filename);
 
     // Test jumping beyond bounds
-    uint32_t jump_addr = MAX_MEMORY_SIZE + 4;
+    uint32_t jump_addr = 0x1004;
     EXPECT_THROW(parser.readInstruction(jump_addr), std::runtime_error);
 }
 
@@ -157,14 +170,21 @@ TEST_F(MemoryParserTest, writeMemoryUnaligned) {
     EXPECT_THROW(parser.writeMemory(write_addr, new_value), std::runtime_error);
 }
 
-TEST_F(MemoryParserTest, writeMemoryOutOfBounds) {
+TEST_F(MemoryParserTest, writeMemoryHighAddress) {
     MemoryParser parser(test_filename);
+    parser.setOutputFileOnModified(false);
+    size_t pages = parser.getNumAllocatedPages();
 
-    // Write beyond the maximum memory size
-    uint32_t write_addr = MAX_VEC_SIZE * 4 + 4;
+    // Write to the last word of the address space, one page away from everything else
+    uint32_t write_addr = 0xFFFFFFFC;
     uint32_t new_value = 0xAABBCCDD;
 
-    EXPECT_THROW(parser.writeMemory(write_addr, new_value), std::runtime_error);
+    EXPECT_NO_THROW(parser.writeMemory(write_addr, new_value));
+    EXPECT_EQ(parser.readMemory(write_addr), new_value);
+    EXPECT_EQ(parser.readMemory(write_addr - 4), 0u);
+    EXPECT_EQ(parser.getNumAllocatedPages(), pages + 1);
+    EXPECT_EQ(parser.getNumMemoryElements(), sample_lines.size());
+    EXPECT_EQ(parser.getNumFarPages(), 1u);
 }
 
 TEST_F(MemoryParserTest, writeReadInteraction) {
@@ -207,3 +227,313 @@ TEST_F(MemoryParserTest, writeMemoryBeyondCurrentSize) {
     uint32_t read_value = parser.readMemory(write_addr);
     EXPECT_EQ(new_value, read_value) << "Value not correctly written beyond original file size";
 }
+
+// The non-throwing accessors report the fault the throwing ones would raise
+TEST_F(MemoryParserTest, tryAccessReportsTrapCause) {
+    MemoryParser parser(test_filename);
+    parser.setOutputFileOnModified(false);
+    uint32_t value = 0x12345678;
+
+    EXPECT_EQ(parser.tryReadMemory(0x1003, value), mips_lite::TrapCause::UNALIGNED_ACCESS);
+    EXPECT_EQ(value, 0x12345678u) << "Value changed by a faulting read";
+    EXPECT_EQ(parser.tryWriteMemory(0x000D, 1), mips_lite::TrapCause::UNALIGNED_ACCESS);
+    EXPECT_EQ(parser.tryReadInstruction(INDEX_TO_ADDR(5) + 2, value),
+              mips_lite::TrapCause::UNALIGNED_ACCESS);
+    uint32_t end = INDEX_TO_ADDR(static_cast<uint32_t>(sample_lines.size()));
+    EXPECT_EQ(parser.tryReadInstruction(end, value),
+              mips_lite::TrapCause::INVALID_INSTRUCTION_ADDRESS);
+
+    EXPECT_EQ(parser.tryReadMemory(0x000C, value), mips_lite::TrapCause::NONE);
+    EXPECT_EQ(value, std::stoul(sample_lines[3], nullptr, 16));
+    EXPECT_EQ(parser.tryWriteMemory(0x0100, 0xAABBCCDD), mips_lite::TrapCause::NONE);
+    EXPECT_EQ(parser.readMemory(0x0100), 0xAABBCCDDu);
+    EXPECT_EQ(parser.tryReadMemory(0x2000, value), mips_lite::TrapCause::NONE);
+    EXPECT_EQ(value, 0u);
+}
+
+// The dump covers every word up to the highest one reached, as in the input format
+TEST_F(MemoryParserTest, dumpCoversWordsReached) {
+    std::string out = test_dir + "/test_memory_dump.txt";
+    {
+        MemoryParser parser(test_filename, out);
+        parser.writeMemory(0x1000, 0xDEADBEEF);  // In the page after the last one reached
+    }
+    std::ifstream file(out);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(line);
+    }
+    std::filesystem::remove(out);
+
+    ASSERT_EQ(lines.size(), ADDR_TO_INDEX(0x1000) + 1);
+    for (size_t i = 0; i < sample_lines.size(); ++i) {
+        EXPECT_EQ(lines[i], sample_lines[i]);
+    }
+    EXPECT_EQ(lines[sample_lines.size()], "00000000");
+    EXPECT_EQ(lines.back(), "DEADBEEF");
+}
+
+// Stores far beyond the words reached are dumped as their pages, not every word in between
+TEST_F(MemoryParserTest, farStoresAreDumpedSparsely) {
+    std::string out = test_dir + "/test_memory_far.txt";
+    auto readLines = [](const std::string& path) {
+        std::ifstream file(path);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+
+    MemoryParser parser(test_filename, out);
+    parser.setOutputFileOnModified(false);
+    parser.writeMemory(0x04000000, 0x11111111);
+    parser.writeMemory(0xFFFFFFFC, 0x22222222);
+    EXPECT_EQ(parser.getNumMemoryElements(), sample_lines.size());
+    EXPECT_EQ(parser.getNumFarPages(), 2u);
+    EXPECT_EQ(parser.readInstruction(0x04000000), 0x11111111u) << "Far page not fetchable";
+    EXPECT_THROW(parser.readInstruction(0x04001000), std::runtime_error);
+
+    parser.writeOutputFile();
+    std::vector<std::string> lines = readLines(out);
+    ASSERT_EQ(lines.size(), sample_lines.size() + 2 * 1024);
+    for (size_t i = 0; i < sample_lines.size(); ++i) {
+        EXPECT_EQ(lines[i], sample_lines[i]);
+    }
+    EXPECT_EQ(lines[sample_lines.size()], "04000000: 11111111");
+    EXPECT_EQ(lines[sample_lines.size() + 1], "04000004: 00000000");
+    EXPECT_EQ(lines.back(), "FFFFFFFC: 22222222");
+
+    // Stores that walk up to a far page take it in whole
+    parser.writeMemory(0x3004, 3);
+    EXPECT_EQ(parser.getNumFarPages(), 3u);
+    parser.writeMemory(0x1000, 1);
+    parser.writeMemory(0x1FFC, 2);
+    EXPECT_EQ(parser.getNumMemoryElements(), ADDR_TO_INDEX(0x2000));
+    parser.writeMemory(0x3000, 4);
+    EXPECT_EQ(parser.getNumMemoryElements(), ADDR_TO_INDEX(0x4000));
+
+    parser.writeOutputFile();
+    lines = readLines(out);
+    ASSERT_EQ(lines.size(), ADDR_TO_INDEX(0x4000) + 2 * 1024);
+    EXPECT_EQ(lines[ADDR_TO_INDEX(0x2000)], "00000000");
+    EXPECT_EQ(lines[ADDR_TO_INDEX(0x3000)], "00000004");
+    EXPECT_EQ(lines[ADDR_TO_INDEX(0x3004)], "00000003");
+    EXPECT_EQ(lines[ADDR_TO_INDEX(0x4000)], "04000000: 11111111");
+    std::filesystem::remove(out);
+}
+
+// Stores mark their pages dirty; the loaded image starts clean
+TEST_F(MemoryParserTest, storesMarkPagesDirty) {
+    MemoryParser parser(test_filename);
+    parser.setOutputFileOnModified(false);
+    EXPECT_TRUE(parser.getDirtyPages().empty());
+
+    parser.readMemory(0x5000);
+    EXPECT_TRUE(parser.getDirtyPages().empty()) << "Read marked a page dirty";
+    parser.writeMemory(0x0004, 1);
+    EXPECT_EQ(parser.tryWriteMemory(0x3000, 2), mips_lite::TrapCause::NONE);
+    EXPECT_EQ(parser.tryWriteMemory(0x3002, 3), mips_lite::TrapCause::UNALIGNED_ACCESS);
+    EXPECT_EQ(parser.getDirtyPages().count(), 2u);
+    EXPECT_TRUE(parser.getDirtyPages().isDirty(0x0));
+    EXPECT_TRUE(parser.getDirtyPages().isDirty(0x3));
+
+    parser.clearDirtyPages();
+    EXPECT_TRUE(parser.getDirtyPages().empty());
+}
+
+// A dump with far pages loads back to the same memory, and dumps the same again
+TEST_F(MemoryParserTest, dumpWithFarPagesReloads) {
+    std::string out = test_dir + "/test_memory_far_dump.txt";
+    std::string again = test_dir + "/test_memory_far_again.txt";
+    auto readFile = [](const std::string& path) {
+        std::ifstream file(path);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    };
+    {
+        MemoryParser parser(test_filename, out);
+        parser.writeMemory(0x0008, 0x11111111);
+        parser.writeMemory(0x04000000, 0x22222222);
+        parser.writeMemory(0xFFFFFFFC, 0x33333333);
+    }
+
+    MemoryParser reloaded(out, again);
+    EXPECT_EQ(reloaded.getNumMemoryElements(), sample_lines.size());
+    EXPECT_EQ(reloaded.getNumFarPages(), 2u);
+    EXPECT_FALSE(reloaded.isModified());
+    EXPECT_EQ(reloaded.readMemory(0x0008), 0x11111111u);
+    EXPECT_EQ(reloaded.readMemory(0x04000000), 0x22222222u);
+    EXPECT_EQ(reloaded.readMemory(0x04000004), 0u);
+    EXPECT_EQ(reloaded.readMemory(0xFFFFFFFC), 0x33333333u);
+    EXPECT_EQ(reloaded.readMemory(INDEX_TO_ADDR(sample_lines.size())), 0u);
+    EXPECT_EQ(reloaded.readInstruction(0x04000000), 0x22222222u);
+    EXPECT_EQ(reloaded.getInputWord(ADDR_TO_INDEX(0xFFFFFFFC)), 0x33333333u);
+
+    reloaded.writeOutputFile();
+    EXPECT_EQ(readFile(again), readFile(out));
+
+    // Only what changed since the reload differs from its input
+    reloaded.writeMemory(0xFFFFFFF8, 0x44444444);
+    reloaded.setOutputFormat(OutputFormat::DIFF);
+    reloaded.writeOutputFile();
+    EXPECT_EQ(readFile(again), "FFFFFFF8: 44444444\n");
+    std::filesystem::remove(out);
+    std::filesystem::remove(again);
+}
+
+// Once dumped, later dumps only rewrite the dirty pages and append the new words
+TEST_F(MemoryParserTest, repeatedDumpsMatchFullDump) {
+    std::string out = test_dir + "/test_memory_incremental.txt";
+    auto readLines = [](const std::string& path) {
+        std::ifstream file(path);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+
+    MemoryParser parser(test_filename, out);
+    parser.setOutputFileOnModified(false);
+    parser.writeMemory(0x0008, 0x11111111);
+    parser.writeOutputFile();
+    ASSERT_EQ(readLines(out).size(), sample_lines.size());
+
+    parser.writeMemory(0x0000, 0x22222222);  // Rewritten in place
+    parser.writeMemory(0x1800, 0x33333333);  // Appended, with the zeros before it
+    parser.writeOutputFile();
+    std::vector<std::string> lines = readLines(out);
+    std::filesystem::remove(out);
+
+    ASSERT_EQ(lines.size(), ADDR_TO_INDEX(0x1800) + 1);
+    EXPECT_EQ(lines[0], "22222222");
+    EXPECT_EQ(lines[1], sample_lines[1]);
+    EXPECT_EQ(lines[2], "11111111");
+    for (size_t i = 3; i < sample_lines.size(); ++i) {
+        EXPECT_EQ(lines[i], sample_lines[i]);
+    }
+    EXPECT_EQ(lines[sample_lines.size()], "00000000");
+    EXPECT_EQ(lines.back(), "33333333");
+}
+
+// Dirty dumps list every word of the pages stored to, diffs only the words that changed
+TEST_F(MemoryParserTest, dirtyAndDiffFormats) {
+    std::string out = test_dir + "/test_memory_diff.txt";
+    auto readFile = [](const std::string& path) {
+        std::ifstream file(path);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    };
+
+    MemoryParser parser(test_filename, out);
+    parser.setOutputFileOnModified(false);
+    parser.writeMemory(0x0004, 0x040204B0);  // Same as the input
+    parser.writeMemory(0x0008, 0x11111111);
+    parser.writeMemory(0x1000, 0x22222222);  // Beyond the input, in another page
+
+    parser.setOutputFormat(OutputFormat::DIFF);
+    parser.writeOutputFile();
+    EXPECT_EQ(readFile(out), "00000008: 11111111\n00001000: 22222222\n");
+
+    parser.setOutputFormat(OutputFormat::DIRTY);
+    parser.writeOutputFile();
+    std::string expected;
+    for (size_t i = 0; i < 1024; ++i) {  // All of page 0 has been reached
+        char address[9];
+        std::snprintf(address, sizeof(address), "%08zX", i * 4);
+        std::string value = i == 2 ? "11111111" :
+                            i < sample_lines.size() ? sample_lines[i] : "00000000";
+        expected += std::string(address) + ": " + value + "\n";
+    }
+    expected += "00001000: 22222222\n";
+    EXPECT_EQ(readFile(out), expected);
+
+    // Back to a full dump, which cannot patch the file the others left
+    parser.setOutputFormat(OutputFormat::FULL);
+    parser.writeOutputFile();
+    EXPECT_EQ(std::filesystem::file_size(out), (ADDR_TO_INDEX(0x1000) + 1) * 9);
+    std::filesystem::remove(out);
+}
+
+// An asynchronous dump holds the memory as it was when the dump was requested
+TEST_F(MemoryParserTest, asyncDumpIsASnapshot) {
+    std::string out = test_dir + "/test_memory_async.txt";
+    std::string sync_out = test_dir + "/test_memory_sync.txt";
+    {
+        MemoryParser parser(test_filename, out);
+        parser.setOutputFileOnModified(false);
+        parser.writeMemory(0x0008, 0x11111111);
+        parser.writeMemory(0x4000, 0x22222222);
+        parser.writeOutputFileAsync();
+        parser.writeMemory(0x0008, 0x33333333);  // After the snapshot
+        parser.waitForOutput();
+        EXPECT_TRUE(parser.isModified());  // By the later store
+    }
+    {
+        MemoryParser parser(test_filename, sync_out);
+        parser.writeMemory(0x0008, 0x11111111);
+        parser.writeMemory(0x4000, 0x22222222);
+    }  // Written by the destructor
+    std::ifstream async_file(out), sync_file(sync_out);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(async_file), {}),
+              std::string(std::istreambuf_iterator<char>(sync_file), {}));
+    std::filesystem::remove(out);
+    std::filesystem::remove(sync_out);
+}
+
+// A write that fails in the background is reported by the wait
+TEST_F(MemoryParserTest, asyncDumpReportsFailure) {
+    MemoryParser parser(test_filename, test_dir + "/missing_dir/out.txt");
+    parser.setOutputFileOnModified(false);
+    parser.writeMemory(0x0008, 0x11111111);
+    parser.writeOutputFileAsync();
+    EXPECT_THROW(parser.waitForOutput(), std::runtime_error);
+    EXPECT_NO_THROW(parser.waitForOutput());  // Reported once
+}
+
+TEST_F(MemoryParserTest, printMemoryContentFormat) {
+    MemoryParser parser(test_filename);
+    parser.setOutputFileOnModified(false);
+    parser.writeMemory(0x0008, 0xABCDEF01);
+    testing::internal::CaptureStdout();
+    parser.printMemoryContent();
+    std::string printed = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(printed.substr(0, printed.find('\n')),
+              "Memory Content: Vec Index (dec)   :   Hex Address   :   Hex Value   ");
+    EXPECT_NE(printed.find("\n2 : 0x00000008: 0xabcdef01\n"), std::string::npos);
+    EXPECT_NE(printed.find("\n15 : 0x0000003c: 0x00004000\n"), std::string::npos);
+}
+
+// Loading another image leaves nothing of the previous one behind but the storage
+TEST_F(MemoryParserTest, loadReplacesTheImage) {
+    std::string other = test_dir + "/test_memory_other.txt";
+    {
+        std::ofstream file(other);
+        file << "04010005\n44000000\n";
+    }
+    MemoryParser parser(test_filename);
+    parser.setOutputFileOnModified(false);
+    parser.writeMemory(0x1000, 0x12345678);  // Beyond the image, on another page
+    size_t pages = parser.getNumAllocatedPages();
+
+    parser.load(other);
+    EXPECT_EQ(parser.getInputFilename(), other);
+    EXPECT_EQ(parser.getOutputFilename(), other + ".out");
+    EXPECT_EQ(parser.getNumMemoryElements(), 2u);
+    EXPECT_EQ(parser.getInputImageSize(), 2u);
+    EXPECT_FALSE(parser.isModified());
+    EXPECT_TRUE(parser.getDirtyPages().empty());
+    EXPECT_EQ(parser.readInstruction(0x0), 0x04010005u);
+    EXPECT_EQ(parser.readInstruction(0x4), 0x44000000u);
+    EXPECT_EQ(parser.peekMemory(0x8), 0u);  // Old image and stores are gone
+    EXPECT_EQ(parser.peekMemory(0x1000), 0u);
+    EXPECT_LE(parser.getNumAllocatedPages(), pages);
+    ASSERT_NE(parser.getProgramImage()->lookup(0x4), nullptr);
+    EXPECT_EQ(parser.getProgramImage()->size(), 2u);
+
+    parser.load(test_filename);
+    EXPECT_EQ(parser.getNumMemoryElements(), sample_lines.size());
+    EXPECT_EQ(parser.readMemory(0x4), 0x040204B0u);
+    EXPECT_THROW(parser.load(test_dir + "/missing.txt"), std::runtime_error);
+    EXPECT_EQ(parser.getNumMemoryElements(), 0u);
+    std::filesystem::remove(other);
+}
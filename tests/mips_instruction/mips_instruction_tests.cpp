@@ -8,6 +8,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <stdexcept>
 
 #include "mips_instruction.h"
 #include "mips_lite_defs.h"
@@ -183,3 +184,54 @@ TEST_F(InstructionTest, BranchInstructionBEQ) {
     uint32_t expected_control = mips_lite::control::BRANCH | mips_lite::control::ALU_OP_SUB;
     EXPECT_EQ(instr.getControlWord(), expected_control);
 }
+
+// The opcode table generated from mips_lite_isa.def
+TEST(OpcodeTableTest, DescribesEveryOpcode) {
+    using mips_lite::InstructionCategory;
+    using mips_lite::InstructionType;
+    namespace op = mips_lite::opcode;
+
+    static_assert(mips_lite::opcode_info(op::ADD).type == InstructionType::R_TYPE);
+    static_assert(mips_lite::opcode_info(op::LDW).latency == 2);
+
+    int defined = 0;
+    for (int opcode = 0; opcode < mips_lite::NUM_OPCODES; ++opcode) {
+        defined += mips_lite::opcode_info(static_cast<uint8_t>(opcode)).valid;
+    }
+    EXPECT_EQ(defined, 18);
+
+    for (uint8_t opcode : {op::ADD, op::SUB, op::MUL, op::OR, op::AND, op::XOR}) {
+        const mips_lite::OpcodeInfo& info = mips_lite::opcode_info(opcode);
+        EXPECT_EQ(info.type, InstructionType::R_TYPE) << int(opcode);
+        EXPECT_TRUE(info.reads_rt) << int(opcode);
+        EXPECT_TRUE(info.writes_reg) << int(opcode);
+        EXPECT_EQ(info.latency, 1) << int(opcode);
+    }
+    for (uint8_t opcode : {op::ADDI, op::SUBI, op::MULI, op::ORI, op::ANDI, op::XORI, op::LDW}) {
+        const mips_lite::OpcodeInfo& info = mips_lite::opcode_info(opcode);
+        EXPECT_EQ(info.type, InstructionType::I_TYPE) << int(opcode);
+        EXPECT_FALSE(info.reads_rt) << int(opcode);
+        EXPECT_TRUE(info.writes_reg) << int(opcode);
+    }
+    for (uint8_t opcode : {op::STW, op::BZ, op::BEQ, op::JR, op::HALT}) {
+        EXPECT_FALSE(mips_lite::opcode_info(opcode).writes_reg) << int(opcode);
+    }
+    EXPECT_TRUE(mips_lite::opcode_info(op::STW).reads_rt);
+    EXPECT_TRUE(mips_lite::opcode_info(op::BEQ).reads_rt);
+    EXPECT_FALSE(mips_lite::opcode_info(op::BZ).reads_rt);
+
+    EXPECT_EQ(mips_lite::get_instruction_category(op::XORI), InstructionCategory::LOGICAL);
+    EXPECT_EQ(mips_lite::get_instruction_category(op::STW), InstructionCategory::MEMORY_ACCESS);
+    EXPECT_EQ(mips_lite::get_instruction_category(op::JR), InstructionCategory::CONTROL_FLOW);
+    EXPECT_EQ(mips_lite::get_control_word(op::JR), mips_lite::control::JUMP);
+    EXPECT_EQ(mips_lite::get_control_word(op::HALT), 0);
+}
+
+// Opcodes outside the ISA have no category and no control signals
+TEST(OpcodeTableTest, UndefinedOpcodes) {
+    const uint8_t undefined = 0b111111;
+    EXPECT_FALSE(mips_lite::opcode_info(undefined).valid);
+    EXPECT_EQ(mips_lite::get_instruction_type(undefined), mips_lite::InstructionType::I_TYPE);
+    EXPECT_EQ(mips_lite::get_control_word(undefined), 0);
+    EXPECT_THROW(mips_lite::get_instruction_category(undefined), std::invalid_argument);
+}
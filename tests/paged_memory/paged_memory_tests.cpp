@@ -0,0 +1,90 @@
+/**
+ * @file paged_memory_tests.cpp
+ * @brief Unit tests for the sparse PagedMemory
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "paged_memory.h"
+
+TEST(PagedMemoryTest, UntouchedMemoryReadsZero) {
+    PagedMemory memory;
+    EXPECT_EQ(memory.read(0), 0u);
+    EXPECT_EQ(memory.read(0x80000000), 0u);
+    EXPECT_EQ(memory.read(0xFFFFFFFC), 0u);
+    EXPECT_EQ(memory.numAllocatedPages(), 0u);
+    EXPECT_EQ(memory.page(0), nullptr);
+}
+
+TEST(PagedMemoryTest, WritesAllocateOnePagePerPage) {
+    PagedMemory memory;
+    memory.write(0x1000, 1);
+    memory.write(0x1FFC, 2);  // Same page
+    memory.write(0xFFFFFFFC, 3);
+    memory.write(0x0, 4);
+
+    EXPECT_EQ(memory.read(0x1000), 1u);
+    EXPECT_EQ(memory.read(0x1FFC), 2u);
+    EXPECT_EQ(memory.read(0xFFFFFFFC), 3u);
+    EXPECT_EQ(memory.read(0x0), 4u);
+    EXPECT_EQ(memory.read(0x1004), 0u);
+    EXPECT_EQ(memory.read(0x2000), 0u);
+
+    EXPECT_EQ(memory.numAllocatedPages(), 3u);
+    EXPECT_EQ(memory.allocatedPages(), (std::vector<uint32_t>{0x1, 0xFFFFF, 0x0}));
+    ASSERT_NE(memory.page(0x1), nullptr);
+    EXPECT_EQ(memory.page(0x1)[0], 1u);
+    EXPECT_EQ(memory.page(0x1)[PagedMemory::PAGE_WORDS - 1], 2u);
+}
+
+TEST(PagedMemoryTest, CopiesAreIndependent) {
+    PagedMemory original;
+    original.write(0x4000, 7);
+
+    PagedMemory copy(original);
+    copy.write(0x4000, 8);
+    copy.write(0x8000, 9);
+    EXPECT_EQ(original.read(0x4000), 7u);
+    EXPECT_EQ(original.read(0x8000), 0u);
+    EXPECT_EQ(original.numAllocatedPages(), 1u);
+
+    original = copy;
+    EXPECT_EQ(original.read(0x4000), 8u);
+    EXPECT_EQ(original.read(0x8000), 9u);
+
+    PagedMemory moved(std::move(copy));
+    EXPECT_EQ(moved.read(0x8000), 9u);
+}
+
+TEST(PagedMemoryTest, ClearReleasesEveryPage) {
+    PagedMemory memory;
+    memory.write(0x10, 1);
+    memory.write(0x12340000, 2);
+    memory.clear();
+
+    EXPECT_EQ(memory.numAllocatedPages(), 0u);
+    EXPECT_EQ(memory.read(0x10), 0u);
+    EXPECT_EQ(memory.read(0x12340000), 0u);
+    memory.write(0x10, 3);
+    EXPECT_EQ(memory.read(0x10), 3u);
+}
+
+TEST(PagedMemoryTest, ResetReusesPagesZeroed) {
+    PagedMemory memory;
+    memory.write(0x10, 1);
+    memory.write(0x12340010, 2);
+    memory.reset();
+
+    EXPECT_EQ(memory.numAllocatedPages(), 0u);
+    EXPECT_EQ(memory.read(0x10), 0u);
+    EXPECT_EQ(memory.read(0x12340010), 0u);
+    memory.write(0x5000, 3);  // Gets one of the old pages back, with their words cleared
+    EXPECT_EQ(memory.numAllocatedPages(), 1u);
+    EXPECT_EQ(memory.read(0x5000), 3u);
+    EXPECT_EQ(memory.read(0x5010), 0u);
+    EXPECT_EQ(memory.read(0x12340010), 0u);
+}
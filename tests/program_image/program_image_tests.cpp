@@ -0,0 +1,135 @@
+/**
+ * @file program_image_tests.cpp
+ * @brief Unit tests for the predecoded ProgramImage
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "functional_simulator.h"
+#include "mips_instruction.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+
+class ProgramImageTest : public ::testing::Test {
+   protected:
+    std::string test_dir = std::filesystem::path(__FILE__).parent_path().string();
+    std::string test_filename =
+        test_dir + "/test_program_image_" + std::to_string(getpid()) + ".txt";
+
+    const uint32_t r_type_add_instr = 0x00221800;       // ADD $3, $1, $2
+    const uint32_t i_type_addi_neg_instr = 0x04C7FF9C;  // ADDI $7, $6, -100
+    const uint32_t i_type_beq_instr = 0x3D4BFFCE;       // BEQ $10, $11, -50
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(test_filename);
+        ASSERT_TRUE(file.is_open()) << "Failed to create test file";
+        for (uint32_t word : words) {
+            file << std::hex << std::setw(8) << std::setfill('0') << word << std::endl;
+        }
+    }
+
+    void TearDown() override { std::filesystem::remove(test_filename); }
+};
+
+// Predecoded ops must carry exactly the fields the Instruction constructor extracts
+TEST_F(ProgramImageTest, DecodeMatchesInstruction) {
+    for (uint32_t word : {r_type_add_instr, i_type_addi_neg_instr, i_type_beq_instr}) {
+        DecodedOp op = ProgramImage::decode(word);
+        Instruction from_word(word);
+        Instruction from_op(op);
+
+        EXPECT_TRUE(op.valid);
+        EXPECT_EQ(from_op.getInstruction(), from_word.getInstruction());
+        EXPECT_EQ(from_op.getOpcode(), from_word.getOpcode());
+        EXPECT_EQ(from_op.getRs(), from_word.getRs());
+        EXPECT_EQ(from_op.getRt(), from_word.getRt());
+        EXPECT_EQ(from_op.getInstructionType(), from_word.getInstructionType());
+        EXPECT_EQ(from_op.getControlWord(), from_word.getControlWord());
+        EXPECT_EQ(from_op.hasRd(), from_word.hasRd());
+        EXPECT_EQ(from_op.hasImmediate(), from_word.hasImmediate());
+        if (from_word.hasRd()) {
+            EXPECT_EQ(from_op.getRd(), from_word.getRd());
+        } else {
+            EXPECT_EQ(from_op.getImmediate(), from_word.getImmediate());
+        }
+    }
+}
+
+TEST_F(ProgramImageTest, LookupIsIndexedByPc) {
+    ProgramImage image({r_type_add_instr, i_type_addi_neg_instr, i_type_beq_instr});
+
+    ASSERT_EQ(image.size(), 3);
+    ASSERT_NE(image.lookup(4), nullptr);
+    EXPECT_EQ(image.lookup(4)->word, i_type_addi_neg_instr);
+    EXPECT_EQ(image.lookup(4)->immediate, -100);
+
+    EXPECT_EQ(image.lookup(2), nullptr);   // Unaligned
+    EXPECT_EQ(image.lookup(12), nullptr);  // Past the end of the image
+}
+
+TEST_F(ProgramImageTest, InvalidateDropsEntry) {
+    ProgramImage image({r_type_add_instr, i_type_addi_neg_instr});
+
+    image.invalidate(4);
+    image.invalidate(0x1000);  // Outside of the image, ignored
+
+    EXPECT_NE(image.lookup(0), nullptr);
+    EXPECT_EQ(image.lookup(4), nullptr);
+}
+
+// MemoryParser predecodes on load and invalidates entries hit by stores
+TEST_F(ProgramImageTest, MemoryParserInvalidatesOnStore) {
+    writeImage({r_type_add_instr, i_type_addi_neg_instr});
+    MemoryParser parser(test_filename);
+    parser.setOutputFileOnModified(false);
+
+    const ProgramImage* image = parser.getProgramImage();
+    ASSERT_NE(image, nullptr);
+    ASSERT_EQ(image->size(), 2);
+    EXPECT_NE(image->lookup(4), nullptr);
+
+    parser.writeMemory(4, r_type_add_instr);
+    EXPECT_EQ(image->lookup(4), nullptr);
+    EXPECT_NE(image->lookup(0), nullptr);
+}
+
+// A program that overwrites one of its own instructions must execute the new word
+TEST_F(ProgramImageTest, SelfModifyingProgramSeesStore) {
+    writeImage({
+        0x30010020,  // LDW R1 R0 32   ; R1 = replacement instruction
+        0x34010018,  // STW R1 R0 24   ; overwrite the ADDI below
+        0x00000000,  // ADD R0 R0 R0
+        0x00000000,  // ADD R0 R0 R0
+        0x00000000,  // ADD R0 R0 R0
+        0x00000000,  // ADD R0 R0 R0
+        0x04020001,  // ADDI R2 R0 1   ; replaced by ADDI R2 R0 7
+        0x44000000,  // HALT
+        0x04020007,  // data: ADDI R2 R0 7
+    });
+
+    for (bool forwarding : {false, true}) {
+        MemoryParser parser(test_filename);
+        parser.setOutputFileOnModified(false);
+        RegisterFile rf;
+        Stats stats;
+        FunctionalSimulator sim(&rf, &stats, &parser, forwarding);
+
+        while (!sim.isProgramFinished() && stats.getClockCycles() < 1000) {
+            sim.cycle();
+        }
+
+        EXPECT_TRUE(sim.isProgramFinished());
+        EXPECT_EQ(rf.read(2), 7) << "forwarding=" << forwarding;
+    }
+}
@@ -0,0 +1,226 @@
+/**
+ * @file sampled_simulation_tests.cpp
+ * @brief Unit tests for sampled simulation: the profile covers every instruction, clustering
+ * separates program phases, and estimates agree with full FunctionalSimulator runs.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "sampled_simulation.h"
+#include "stats.h"
+#include "test_helpers.h"
+
+namespace opcode = mips_lite::opcode;
+
+namespace {
+/// Alternates an ALU loop and a load-use loop, each `inner` iterations, `outer` times
+std::vector<uint32_t> phasedProgram(int16_t outer, int16_t inner) {
+    return {
+        encodeI(opcode::ADDI, 10, 0, outer),  //  0: R10 = outer
+        encodeI(opcode::ADDI, 1, 0, inner),   //  4: phase A: R1 = inner
+        encodeI(opcode::ADDI, 2, 2, 3),       //  8: R2 += 3
+        encodeI(opcode::ADDI, 3, 3, 5),       // 12: R3 += 5
+        encodeR(opcode::XOR, 4, 2, 3),        // 16: R4 = R2 ^ R3
+        encodeI(opcode::SUBI, 1, 1, 1),       // 20: R1 -= 1
+        encodeI(opcode::BZ, 0, 1, 2),         // 24: if R1 == 0 goto 32
+        encodeI(opcode::BEQ, 0, 0, -5),       // 28: goto 8
+        encodeI(opcode::ADDI, 1, 0, inner),   // 32: phase B: R1 = inner
+        encodeI(opcode::ADDI, 5, 0, 88),      // 36: R5 = &data
+        encodeI(opcode::LDW, 6, 5, 0),        // 40: R6 = data
+        encodeI(opcode::ADDI, 7, 6, 1),       // 44: R7 = R6 + 1 (load-use)
+        encodeI(opcode::STW, 7, 5, 0),        // 48: data = R7
+        encodeI(opcode::SUBI, 1, 1, 1),       // 52: R1 -= 1
+        encodeI(opcode::BZ, 0, 1, 2),         // 56: if R1 == 0 goto 64
+        encodeI(opcode::BEQ, 0, 0, -5),       // 60: goto 40
+        encodeI(opcode::SUBI, 10, 10, 1),     // 64: R10 -= 1
+        encodeI(opcode::BZ, 0, 10, 4),        // 68: if R10 == 0 goto 84
+        encodeI(opcode::BEQ, 0, 0, -17),      // 72: goto 4
+        encodeR(opcode::ADD, 0, 0, 0),        // 76: padding
+        encodeR(opcode::ADD, 0, 0, 0),        // 80: padding
+        encodeI(opcode::HALT, 0, 0, 0),       // 84: HALT
+        0x00000000,                           // 88: data
+    };
+}
+
+struct FullRun {
+    uint64_t cycles;
+    uint64_t stalls;
+    uint64_t instructions;
+};
+
+FullRun runPipeline(const std::string& path, bool forwarding) {
+    MemoryParser memory(path);
+    memory.setOutputFileOnModified(false);
+    RegisterFile registers;
+    Stats stats;
+    FunctionalSimulator simulator(&registers, &stats, &memory, forwarding);
+    EXPECT_EQ(simulator.run(UINT64_MAX).reason, FunctionalSimulator::StopReason::HALTED);
+    return {stats.getClockCycles(), stats.getStalls(), stats.totalInstructions()};
+}
+
+class SampledSimulationTest : public ::testing::Test {
+   protected:
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("sampled_test_" + std::to_string(getpid()) + ".txt"))
+                          .string();
+
+    void TearDown() override { std::filesystem::remove(path); }
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(path);
+        for (uint32_t word : words) {
+            file << std::uppercase << std::hex << std::setw(8) << std::setfill('0') << word
+                 << "\n";
+        }
+    }
+};
+
+/// An interval made of one block
+sampling::Interval interval(uint32_t leader, uint64_t first) {
+    return {first, 1000, {{leader, 1000}}};
+}
+}  // namespace
+
+TEST_F(SampledSimulationTest, ProfileCoversEveryInstruction) {
+    writeImage(phasedProgram(5, 100));
+    MemoryParser image(path);
+    image.setOutputFileOnModified(false);
+    sampling::Config config;
+    config.interval_length = 250;
+    sampling::Profile profile = sampling::profile(image, config);
+
+    EXPECT_TRUE(profile.halted);
+    EXPECT_EQ(profile.total_instructions, runPipeline(path, false).instructions);
+    ASSERT_EQ(profile.intervals.size(), (profile.total_instructions + 249) / 250);
+    uint64_t next = 0;
+    for (const sampling::Interval& interval : profile.intervals) {
+        EXPECT_EQ(interval.first_instruction, next);
+        uint64_t counted = 0;
+        for (const auto& [leader, count] : interval.blocks) {
+            counted += count;
+        }
+        EXPECT_EQ(counted, interval.num_instructions);
+        next += interval.num_instructions;
+    }
+    EXPECT_EQ(profile.intervals.front().blocks.front().first, 0u);  // The entry block
+
+    config.max_instructions = 600;
+    profile = sampling::profile(image, config);
+    EXPECT_FALSE(profile.halted);
+    EXPECT_EQ(profile.total_instructions, 600u);
+    EXPECT_EQ(profile.intervals.back().num_instructions, 100u);
+}
+
+TEST_F(SampledSimulationTest, ClusteringSeparatesPhases) {
+    std::vector<sampling::Interval> intervals;
+    for (uint64_t i = 0; i < 12; ++i) {
+        intervals.push_back(interval(i % 3 == 0 ? 8 : 40, i * 1000));
+    }
+    sampling::Clustering clustering = sampling::cluster(intervals, sampling::Config());
+    ASSERT_EQ(clustering.representatives.size(), 2u);
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        EXPECT_EQ(clustering.assignment[i] == clustering.assignment[0], i % 3 == 0) << i;
+        EXPECT_EQ(intervals[clustering.representatives[clustering.assignment[i]]].blocks,
+                  intervals[i].blocks);
+    }
+
+    // One phase is one cluster
+    intervals.assign(6, interval(8, 0));
+    clustering = sampling::cluster(intervals, sampling::Config());
+    EXPECT_EQ(clustering.representatives.size(), 1u);
+
+    sampling::Config config;
+    config.max_clusters = 1;
+    intervals.push_back(interval(40, 0));
+    EXPECT_EQ(sampling::cluster(intervals, config).representatives.size(), 1u);
+    EXPECT_TRUE(sampling::cluster({}, config).representatives.empty());
+}
+
+// With the whole program in one interval, the "sample" is a full run from a cold pipeline
+TEST_F(SampledSimulationTest, SingleIntervalIsExact) {
+    for (const auto& entry : std::filesystem::directory_iterator(traceDir())) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        for (bool forwarding : {false, true}) {
+            SCOPED_TRACE(entry.path().filename().string() + (forwarding ? " forwarding" : ""));
+            MemoryParser image(entry.path().string());
+            image.setOutputFileOnModified(false);
+            sampling::Config config;
+            config.forwarding = forwarding;
+            sampling::Estimate estimate = sampling::estimate(image, config);
+
+            FullRun full = runPipeline(entry.path().string(), forwarding);
+            EXPECT_TRUE(estimate.halted);
+            EXPECT_EQ(estimate.total_instructions, full.instructions);
+            ASSERT_EQ(estimate.samples.size(), 1u);
+            EXPECT_DOUBLE_EQ(estimate.clock_cycles, static_cast<double>(full.cycles));
+            EXPECT_DOUBLE_EQ(estimate.stalls, static_cast<double>(full.stalls));
+        }
+    }
+}
+
+// A long phased program is estimated closely from a few samples
+TEST_F(SampledSimulationTest, EstimateMatchesFullRun) {
+    writeImage(phasedProgram(20, 500));
+    MemoryParser image(path);
+    image.setOutputFileOnModified(false);
+    for (bool forwarding : {false, true}) {
+        SCOPED_TRACE(forwarding ? "forwarding" : "no forwarding");
+        sampling::Config config;
+        config.interval_length = 1000;
+        config.warmup_length = 100;
+        config.forwarding = forwarding;
+        sampling::Estimate estimate = sampling::estimate(image, config);
+        FullRun full = runPipeline(path, forwarding);
+
+        EXPECT_EQ(estimate.total_instructions, full.instructions);
+        EXPECT_GE(estimate.samples.size(), 2u);
+        EXPECT_LT(estimate.detailed_instructions, full.instructions / 10);
+        double weights = 0.0;
+        std::set<size_t> sampled;
+        for (const sampling::Sample& sample : estimate.samples) {
+            weights += sample.weight;
+            EXPECT_TRUE(sampled.insert(sample.interval).second);
+        }
+        EXPECT_NEAR(weights, 1.0, 1e-9);
+        EXPECT_NEAR(estimate.clock_cycles / full.cycles, 1.0, 0.01);
+        EXPECT_NEAR(estimate.cpi, double(full.cycles) / full.instructions, 0.01);
+        EXPECT_NEAR(estimate.stalls / full.cycles, double(full.stalls) / full.cycles, 0.01);
+
+        // Deterministic
+        sampling::Estimate again = sampling::estimate(image, config);
+        EXPECT_EQ(again.clock_cycles, estimate.clock_cycles);
+    }
+}
+
+TEST_F(SampledSimulationTest, InvalidConfigurationsAreRejected) {
+    writeImage(phasedProgram(1, 1));
+    MemoryParser image(path);
+    image.setOutputFileOnModified(false);
+    sampling::Config config;
+    config.interval_length = 0;
+    EXPECT_THROW(sampling::estimate(image, config), std::invalid_argument);
+    config = sampling::Config();
+    config.max_clusters = 0;
+    EXPECT_THROW(sampling::estimate(image, config), std::invalid_argument);
+    config = sampling::Config();
+    config.bic_threshold = 1.5;
+    EXPECT_THROW(sampling::cluster({}, config), std::invalid_argument);
+}
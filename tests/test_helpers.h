@@ -0,0 +1,104 @@
+/**
+ * @file test_helpers.h
+ * @brief Helpers shared by the unit tests: instruction encoders, the directory of integration
+ * traces, and a FunctionalSimulator bundled with its own registers, stats and memory, together
+ * with the checks that two runs ended in the same state.
+ *
+ * Test targets get this directory on their include path by linking mips_lite_test_helpers.
+ */
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "register_file.h"
+#include "stats.h"
+
+/// Encode an R-type instruction: rd = rs OP rt.
+constexpr uint32_t encodeR(uint8_t op, uint8_t rd, uint8_t rs, uint8_t rt) {
+    return (uint32_t(op) << 26) | (uint32_t(rs) << 21) | (uint32_t(rt) << 16) |
+           (uint32_t(rd) << 11);
+}
+
+/// Encode an I-type instruction: rt = rs OP imm, or a load, store or branch.
+constexpr uint32_t encodeI(uint8_t op, uint8_t rt, uint8_t rs, int16_t imm) {
+    return (uint32_t(op) << 26) | (uint32_t(rs) << 21) | (uint32_t(rt) << 16) |
+           uint16_t(imm);
+}
+
+/// The integration traces, traces/hex.
+inline std::filesystem::path traceDir() {
+    return std::filesystem::path(__FILE__).parent_path() / ".." / "traces" / "hex";
+}
+
+/// One FunctionalSimulator with its own register file, stats and memory
+template <typename Parser = MemoryParser>
+struct Machine {
+    RegisterFile rf;
+    Stats stats;
+    Parser mem;
+    FunctionalSimulator sim;
+
+    explicit Machine(const std::string& path, bool forward = false)
+        : mem(path), sim(&rf, &stats, &mem, forward) {
+        mem.setOutputFileOnModified(false);
+    }
+};
+
+/// Every general-purpose register
+inline void expectSameRegisters(const RegisterFile& a, const RegisterFile& b) {
+    for (uint8_t reg = 0; reg < mips_lite::NUM_REGISTERS; ++reg) {
+        EXPECT_EQ(a.read(reg), b.read(reg)) << "R" << int(reg);
+    }
+}
+
+/// Registers plus the statistics every engine keeps: instruction categories, registers written
+/// and addresses stored to.
+inline void expectSameArchitecturalState(const RegisterFile& rf_a, const Stats& stats_a,
+                                         const RegisterFile& rf_b, const Stats& stats_b) {
+    expectSameRegisters(rf_a, rf_b);
+    for (int category = 0; category < Stats::NUM_CATEGORIES; ++category) {
+        auto c = static_cast<mips_lite::InstructionCategory>(category);
+        EXPECT_EQ(stats_a.getCategoryCount(c), stats_b.getCategoryCount(c)) << category;
+    }
+    EXPECT_EQ(stats_a.getRegisters(), stats_b.getRegisters());
+    EXPECT_EQ(stats_a.getMemoryAddresses(), stats_b.getMemoryAddresses());
+}
+
+/// Everything two pipeline runs can be told apart by: PC, trap, pipeline contents, all of Stats
+/// and every memory word.
+template <typename A, typename B>
+void expectSameState(Machine<A>& a, Machine<B>& b) {
+    EXPECT_EQ(a.sim.getPC(), b.sim.getPC());
+    EXPECT_EQ(a.sim.isProgramFinished(), b.sim.isProgramFinished());
+    EXPECT_EQ(a.sim.getRetiredInstructions(), b.sim.getRetiredInstructions());
+    EXPECT_EQ(a.sim.getTrap().cause, b.sim.getTrap().cause);
+    EXPECT_EQ(a.sim.getTrap().pc, b.sim.getTrap().pc);
+    expectSameArchitecturalState(a.rf, a.stats, b.rf, b.stats);
+    for (int opcode = 0; opcode < Stats::NUM_OPCODES; ++opcode) {
+        EXPECT_EQ(a.stats.getOpcodeCount(opcode), b.stats.getOpcodeCount(opcode));
+    }
+    EXPECT_EQ(a.stats.getStalls(), b.stats.getStalls());
+    EXPECT_EQ(a.stats.getClockCycles(), b.stats.getClockCycles());
+    EXPECT_EQ(a.stats.getDataHazards(), b.stats.getDataHazards());
+    for (int stage = 0; stage < FunctionalSimulator::getNumStages(); ++stage) {
+        const PipelineStageData* x = a.sim.getPipelineStage(stage);
+        const PipelineStageData* y = b.sim.getPipelineStage(stage);
+        ASSERT_EQ(x == nullptr, y == nullptr) << "stage " << stage;
+        if (x) {
+            EXPECT_EQ(x->pc, y->pc) << "stage " << stage;
+            EXPECT_EQ(x->alu_result, y->alu_result) << "stage " << stage;
+        }
+    }
+    ASSERT_EQ(a.mem.getNumMemoryElements(), b.mem.getNumMemoryElements());
+    for (uint32_t i = 0; i < a.mem.getNumMemoryElements(); ++i) {
+        EXPECT_EQ(a.mem.peekMemory(INDEX_TO_ADDR(i)), b.mem.peekMemory(INDEX_TO_ADDR(i))) << i;
+    }
+}
@@ -0,0 +1,235 @@
+/**
+ * @file timing_model_tests.cpp
+ * @brief Tests for the analytic pipeline timing model: hand-checked hazard cases, and clock
+ * cycle and stall counts compared against FunctionalSimulator::cycle() on the integration
+ * traces and on random programs, with and without forwarding.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fast_simulator.h"
+#include "functional_simulator.h"
+#include "mips_lite_defs.h"
+#include "mips_mem_parser.h"
+#include "program_image.h"
+#include "register_file.h"
+#include "stats.h"
+#include "test_helpers.h"
+#include "timing_model.h"
+
+namespace opcode = mips_lite::opcode;
+
+namespace {
+constexpr uint32_t HALT_WORD = uint32_t(opcode::HALT) << 26;
+
+struct Timing {
+    uint64_t cycles = 0;
+    uint64_t stalls = 0;
+    uint64_t instructions = 0;
+    uint32_t pc = 0;
+};
+
+Timing runPipeline(const std::string& path, bool forward) {
+    MemoryParser mem(path);
+    mem.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FunctionalSimulator sim(&rf, &stats, &mem, forward);
+    while (!sim.isProgramFinished() && stats.getClockCycles() < 100000) {
+        sim.cycle();
+    }
+    EXPECT_TRUE(sim.isProgramFinished());
+    return {stats.getClockCycles(), stats.getStalls(), stats.totalInstructions(), sim.getPC()};
+}
+
+Timing runModel(const std::string& path, bool forward) {
+    MemoryParser mem(path);
+    mem.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FastSimulator iss(&rf, &stats, &mem);
+    iss.setTiming(true, forward);
+    iss.run(100000);
+    EXPECT_TRUE(iss.isHalted());
+    return {stats.getClockCycles(), stats.getStalls(), stats.totalInstructions(), iss.getPC()};
+}
+
+void expectSameTiming(const std::string& path) {
+    for (bool forward : {false, true}) {
+        SCOPED_TRACE(forward ? "forwarding" : "no forwarding");
+        Timing pipeline = runPipeline(path, forward);
+        Timing model = runModel(path, forward);
+        EXPECT_EQ(model.cycles, pipeline.cycles);
+        EXPECT_EQ(model.stalls, pipeline.stalls);
+        EXPECT_EQ(model.instructions, pipeline.instructions);
+        EXPECT_EQ(model.pc, pipeline.pc);
+    }
+}
+
+/// Feed a straight-line sequence (no taken branches) to a model
+TimingModel modelFor(const std::vector<uint32_t>& words, bool forward) {
+    TimingModel model(forward);
+    for (uint32_t word : words) {
+        model.retire(ProgramImage::decode(word), false);
+    }
+    return model;
+}
+
+/**
+ * Random program over R0-R5 so hazards are frequent: ALU ops, loads and stores to a small data
+ * area, and forward branches (some to the very next word, some right before the final HALT).
+ */
+std::vector<uint32_t> randomProgram(std::mt19937& rng, int length) {
+    std::uniform_int_distribution<int> reg(0, 5);
+    std::uniform_int_distribution<int> kind(0, 9);
+    std::uniform_int_distribution<int> alu(0, 11);
+    std::uniform_int_distribution<int> imm(-4, 4);
+    std::uniform_int_distribution<int> slot(0, 7);
+    std::vector<uint32_t> words;
+    for (int i = 0; i < length; ++i) {
+        int k = kind(rng);
+        uint8_t rd = reg(rng), rs = reg(rng), rt = reg(rng);
+        if (k <= 4) {
+            uint8_t op = alu(rng);
+            words.push_back(op % 2 == 0 ? encodeR(op, rd, rs, rt)
+                                        : encodeI(op, rt, rs, static_cast<int16_t>(imm(rng))));
+        } else if (k <= 6) {
+            uint8_t op = k == 5 ? opcode::LDW : opcode::STW;
+            words.push_back(encodeI(op, rt, 0, static_cast<int16_t>(2048 + 4 * slot(rng))));
+        } else {
+            // Forward branch that stays inside the program (the HALT is at index length)
+            int max_offset = length - i;
+            int offset = 1 + static_cast<int>(rng() % max_offset);
+            uint8_t op = k == 9 ? opcode::BEQ : opcode::BZ;
+            words.push_back(encodeI(op, rt, rs, static_cast<int16_t>(offset)));
+        }
+    }
+    words.push_back(HALT_WORD);
+    return words;
+}
+}  // namespace
+
+class TimingModelTest : public ::testing::Test {
+   protected:
+    std::string test_filename = (std::filesystem::path(__FILE__).parent_path() /
+                                 ("test_timing_model_" + std::to_string(getpid()) + ".txt"))
+                                   .string();
+
+    void writeImage(const std::vector<uint32_t>& words) {
+        std::ofstream file(test_filename);
+        ASSERT_TRUE(file.is_open()) << "Failed to create test file";
+        for (uint32_t word : words) {
+            file << std::hex << std::setw(8) << std::setfill('0') << word << std::endl;
+        }
+    }
+
+    void TearDown() override { std::filesystem::remove(test_filename); }
+};
+
+TEST(TimingModelUnitTest, HaltAloneTakesFiveCycles) {
+    TimingModel model = modelFor({HALT_WORD}, false);
+    EXPECT_EQ(model.clockCycles(), 5u);
+    EXPECT_EQ(model.stalls(), 0u);
+}
+
+TEST(TimingModelUnitTest, NothingRetiredTakesNoCycles) {
+    TimingModel model(true);
+    EXPECT_EQ(model.clockCycles(), 0u);
+}
+
+TEST(TimingModelUnitTest, RawHazardWithoutForwardingStallsTwice) {
+    std::vector<uint32_t> words = {encodeI(opcode::ADDI, 1, 0, 5), encodeR(opcode::ADD, 2, 1, 1),
+                                   HALT_WORD};
+    EXPECT_EQ(modelFor(words, false).stalls(), 2u);
+    EXPECT_EQ(modelFor(words, true).stalls(), 0u);
+}
+
+TEST(TimingModelUnitTest, LoadUseWithForwardingStallsOnce) {
+    std::vector<uint32_t> words = {encodeI(opcode::LDW, 1, 0, 64), encodeR(opcode::ADD, 2, 1, 0),
+                                   HALT_WORD};
+    EXPECT_EQ(modelFor(words, true).stalls(), 1u);
+    EXPECT_EQ(modelFor(words, false).stalls(), 2u);
+}
+
+// Reading R0 after writing it, and an I-type rt that is a destination, not a source
+TEST(TimingModelUnitTest, WritesToR0AndWriteAfterWriteNeverStall) {
+    std::vector<uint32_t> words = {encodeI(opcode::ADDI, 0, 0, 5), encodeR(opcode::ADD, 2, 0, 0),
+                                   encodeI(opcode::ADDI, 3, 0, 1), encodeI(opcode::ADDI, 3, 0, 7),
+                                   HALT_WORD};
+    EXPECT_EQ(modelFor(words, false).stalls(), 0u);
+}
+
+TEST(TimingModelUnitTest, TakenBranchCostsTwoCycles) {
+    DecodedOp branch = ProgramImage::decode(encodeI(opcode::BEQ, 0, 0, 2));
+    DecodedOp halt = ProgramImage::decode(HALT_WORD);
+    TimingModel not_taken, taken;
+    not_taken.retire(branch, false);
+    not_taken.retire(halt, false);
+    taken.retire(branch, true);
+    taken.retire(halt, false);
+    EXPECT_EQ(taken.clockCycles(), not_taken.clockCycles() + 2);
+}
+
+TEST_F(TimingModelTest, MatchesPipelineOnTraces) {
+    std::filesystem::path trace_dir = traceDir();
+    ASSERT_TRUE(std::filesystem::exists(trace_dir));
+
+    int traces_checked = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(trace_dir)) {
+        if (entry.path().extension() != ".txt") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().filename().string());
+        expectSameTiming(entry.path().string());
+        ++traces_checked;
+    }
+    EXPECT_GT(traces_checked, 0);
+}
+
+TEST_F(TimingModelTest, MatchesPipelineOnRandomPrograms) {
+    std::mt19937 rng(12345);
+    for (int program = 0; program < 200; ++program) {
+        SCOPED_TRACE("program " + std::to_string(program));
+        writeImage(randomProgram(rng, 40));
+        expectSameTiming(test_filename);
+        if (HasFailure()) {
+            break;
+        }
+    }
+}
+
+// A taken branch with HALT right behind it ends the program without retiring the HALT
+TEST_F(TimingModelTest, HaltBehindTakenBranch) {
+    writeImage({encodeI(opcode::ADDI, 1, 0, 3), encodeI(opcode::BEQ, 1, 1, 2), HALT_WORD,
+                encodeI(opcode::ADDI, 2, 0, 1), HALT_WORD});
+    expectSameTiming(test_filename);
+    EXPECT_EQ(runModel(test_filename, false).pc, 12u);
+}
+
+// A budget-limited run reports the cycles of what it retired, and the totals add up
+TEST_F(TimingModelTest, SplitRunsAddUp) {
+    writeImage({encodeI(opcode::ADDI, 1, 0, 3), encodeR(opcode::ADD, 2, 1, 1),
+                encodeR(opcode::ADD, 3, 2, 2), HALT_WORD});
+    MemoryParser mem(test_filename);
+    mem.setOutputFileOnModified(false);
+    RegisterFile rf;
+    Stats stats;
+    FastSimulator iss(&rf, &stats, &mem);
+    iss.setTiming(true, false);
+    iss.run(2);
+    EXPECT_EQ(stats.getClockCycles(), iss.getTimingModel()->clockCycles());
+    while (iss.step()) {
+    }
+    Timing pipeline = runPipeline(test_filename, false);
+    EXPECT_EQ(stats.getClockCycles(), pipeline.cycles);
+    EXPECT_EQ(stats.getStalls(), pipeline.stalls);
+}